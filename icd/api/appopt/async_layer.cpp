@@ -36,7 +36,6 @@
 #include "include/vk_shader.h"
 #include "include/vk_graphics_pipeline.h"
 #include "include/vk_compute_pipeline.h"
-#include "palListImpl.h"
 
 namespace vk
 {
@@ -71,7 +70,6 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyShaderModule(
         AsyncLayer* pAsyncLayer = pDevice->GetAsyncLayer();
         const VkAllocationCallbacks* pAllocCB = pAllocator ? pAllocator : pDevice->VkInstance()->GetAllocCallbacks();
 
-        pAsyncLayer->SyncAll();
         vk::async::ShaderModule::ObjectFromHandle(shaderModule)->Destroy(pDevice, pAllocCB);
     }
 }
@@ -98,6 +96,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(
         {
             stages[stage] = createInfo.pStages[stage];
             vk::async::ShaderModule* pModule = vk::async::ShaderModule::ObjectFromHandle(stages[stage].module);
+            pModule->PrioritizeAsyncBuild(pAsyncLayer);
             stages[stage].module = pModule->GetNextLayerModule();
         }
         createInfo.pStages = stages;
@@ -130,6 +129,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(
         VkComputePipelineCreateInfo createInfo = pCreateInfos[i];
         VK_ASSERT(createInfo.stage.module != VK_NULL_HANDLE);
         vk::async::ShaderModule* pModule = vk::async::ShaderModule::ObjectFromHandle(createInfo.stage.module);
+        pModule->PrioritizeAsyncBuild(pAsyncLayer);
         createInfo.stage.module = pModule->GetNextLayerModule();
         result = ASYNC_CALL_NEXT_LAYER(vkCreateComputePipelines)(device,
                                                                  pipelineCache,
@@ -150,54 +150,46 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(
 AsyncLayer::AsyncLayer(Device* pDevice)
     :
     m_pDevice(pDevice),
-    m_pModuleTaskThreads(),
-    m_pPipelineTaskThreads()
+    m_taskPool(ExecuteTask, this, pDevice->VkInstance()->Allocator())
 {
     Util::SystemInfo sysInfo = {};
     Util::QuerySystemInfo(&sysInfo);
 
-    for (uint32_t i = 0; i < MaxTaskType; ++i)
-    {
-        m_taskId[i] = 0;
-        m_activeThreadCount[i] = Util::Min(MaxThreads, sysInfo.cpuLogicalCoreCount / 2);
-    }
-    for (uint32_t i = 0; i < m_activeThreadCount[0]; ++i)
-    {
-        m_pModuleTaskThreads[i] = VK_PLACEMENT_NEW(m_moduleTaskThreadBuffer[i])
-                                  async::TaskThread<ShaderModuleTask>(this, pDevice->VkInstance()->Allocator());
-        m_pModuleTaskThreads[i]->Begin();
-
-        m_pPipelineTaskThreads[i] = VK_PLACEMENT_NEW(m_pipelineTaskThreadBuffer[i])
-                                    async::TaskThread<PartialPipelineTask>(this, pDevice->VkInstance()->Allocator());
-        m_pPipelineTaskThreads[i]->Begin();
-    }
+    m_taskPool.Init(sysInfo.cpuLogicalCoreCount / 2);
 }
 
 // =====================================================================================================================
 AsyncLayer::~AsyncLayer()
 {
-    for (uint32_t i = 0; i < m_activeThreadCount[0]; ++i)
+}
+
+// =====================================================================================================================
+// Executes a task taken from the task pool.
+void AsyncLayer::ExecuteTask(
+    void*      pPayload,
+    AsyncTask* pTask)
+{
+    AsyncLayer* pAsyncLayer = static_cast<AsyncLayer*>(pPayload);
+
+    switch (pTask->type)
     {
-        m_pModuleTaskThreads[i]->SetStop();
-        m_pModuleTaskThreads[i]->Join();
-        Util::Destructor(m_pModuleTaskThreads[i]);
-        m_pModuleTaskThreads[i] = nullptr;
-
-        m_pPipelineTaskThreads[i]->SetStop();
-        m_pPipelineTaskThreads[i]->Join();
-        Util::Destructor(m_pPipelineTaskThreads[i]);
-        m_pPipelineTaskThreads[i] = nullptr;
+    case ShaderModuleTaskType:
+        pTask->shaderModule.pObj->Execute(pAsyncLayer, &pTask->shaderModule);
+        break;
+    case PartialPipelineTaskType:
+        pTask->partialPipeline.pObj->Execute(pAsyncLayer, &pTask->partialPipeline);
+        break;
+    default:
+        VK_NEVER_CALLED();
+        break;
     }
 }
 
 // =====================================================================================================================
+// Blocks until all async compile tasks have finished.
 void AsyncLayer::SyncAll()
 {
-    for (uint32_t i = 0; i < m_activeThreadCount[0]; ++i)
-    {
-        m_pModuleTaskThreads[i]->SyncAll();
-        m_pPipelineTaskThreads[i]->SyncAll();
-    }
+    m_taskPool.SyncAll();
 }
 
 // =====================================================================================================================
@@ -35,7 +35,7 @@
 #pragma once
 
 #include "opt_layer.h"
-#include "async_task_thread.h"
+#include "async_task_pool.h"
 
 namespace vk
 {
@@ -44,30 +44,6 @@ class Device;
 class AsyncLayer;
 class PalAllocator;
 
-namespace async { class ShaderModule; class PartialPipeline; }
-
-// Represents the shader module async compile info
-struct ShaderModuleTask
-{
-    VkShaderModuleCreateInfo info;        // Shader module create info
-    async::ShaderModule*     pObj;        // Output shader module object
-};
-
-// Represents the pipeline async compile info
-struct PartialPipelineTask
-{
-    VkShaderModule              shaderModuleHandle; // Shader module handle
-    async::PartialPipeline*     pObj;               // Output shader module object
-};
-
-// Thread task type
-enum TaskType : uint32_t
-{
-    ShaderModuleTaskType = 0,
-    PartialPipelineTaskType,
-    MaxTaskType,
-};
-
 // =====================================================================================================================
 // Class that specifies dispatch table override behavior for async compiler layers
 class AsyncLayer : public OptLayer
@@ -80,36 +56,32 @@ public:
 
     VK_INLINE Device* GetDevice() { return m_pDevice; }
 
-    void* GetTaskThread(TaskType type)
+    // Returns false if there are no async compile threads, in which case the task is not added.
+    bool AddTask(const AsyncTask& task)
     {
-        VK_ASSERT(type < MaxTaskType);
-        if (type == ShaderModuleTaskType)
-        {
-            return (m_activeThreadCount[type] > 0) ?
-                    m_pModuleTaskThreads[(m_taskId[type]++) % m_activeThreadCount[type]] :
-                    nullptr;
-        }
-        else
+        const bool added = (m_taskPool.GetThreadCount() > 0);
+
+        if (added)
         {
-            return (m_activeThreadCount[type] > 0) ?
-                    m_pPipelineTaskThreads[(m_taskId[type]++) % m_activeThreadCount[type]] :
-                    nullptr;
+            m_taskPool.AddTask(task);
         }
+
+        return added;
     }
 
+    VK_INLINE void PrioritizeTasks(const async::ShaderModule* pModule)
+        { m_taskPool.PrioritizeTasks(pModule); }
+
+    VK_INLINE void CancelTasks(const async::ShaderModule* pModule)
+        { m_taskPool.CancelTasks(pModule); }
+
     void SyncAll();
 
 protected:
-    static constexpr uint32_t        MaxThreads = 8;  // Max thread count for shader module compile
+    static void ExecuteTask(void* pPayload, AsyncTask* pTask);
+
     Device*                          m_pDevice;                  // Vulkan Device object
-    async::TaskThread<ShaderModuleTask>* m_pModuleTaskThreads[MaxThreads]; // Async compiler threads
-    async::TaskThread<PartialPipelineTask>* m_pPipelineTaskThreads[MaxThreads]; // Async compiler threads
-    uint32_t                         m_taskId[MaxTaskType];                   // Hint to select compile thread
-    uint32_t                         m_activeThreadCount[MaxTaskType];        // Active thread count
-    // Internal buffer for m_taskThreadBuffer
-    uint8_t                          m_moduleTaskThreadBuffer[MaxThreads][sizeof(async::TaskThread<ShaderModuleTask>)];
-    uint8_t                          m_pipelineTaskThreadBuffer[MaxThreads]
-                                                               [sizeof(async::TaskThread<PartialPipelineTask>)];
+    async::TaskPool                  m_taskPool;                 // Async compiler threads
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
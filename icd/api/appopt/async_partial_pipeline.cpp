@@ -90,19 +90,18 @@ VkResult PartialPipeline::Destroy()
 // Builds partial pipeline in async mode
 void PartialPipeline::AsyncBuildPartialPipeline(
     AsyncLayer* pAsyncLayer,
+    ShaderModule* pModule,
     VkShaderModule asyncShaderModule)
 {
-    auto pTaskThread = reinterpret_cast<async::TaskThread<PartialPipelineTask>*>
-                       (pAsyncLayer->GetTaskThread(PartialPipelineTaskType));
-    if (pTaskThread != nullptr)
-    {
-        PartialPipelineTask task = {};
+    AsyncTask task = {};
 
-        task.shaderModuleHandle = asyncShaderModule;
-        task.pObj = this;
-        pTaskThread->AddTask(&task);
-    }
-    else
+    task.type = PartialPipelineTaskType;
+    task.priority = TaskPriorityLow;
+    task.pModule = pModule;
+    task.partialPipeline.shaderModuleHandle = asyncShaderModule;
+    task.partialPipeline.pObj = this;
+
+    if (pAsyncLayer->AddTask(task) == false)
     {
         Destroy();
     }
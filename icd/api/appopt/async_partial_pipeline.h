@@ -47,6 +47,8 @@ namespace vk
 namespace async
 {
 
+class ShaderModule;
+
 // =====================================================================================================================
 // Implementation of a async shader module
 class PartialPipeline
@@ -80,7 +82,7 @@ public:
 
     void Execute(AsyncLayer* pAsyncLayer, PartialPipelineTask* pTask);
 
-    void AsyncBuildPartialPipeline(AsyncLayer* pAsyncLayer, VkShaderModule asyncShaderModule);
+    void AsyncBuildPartialPipeline(AsyncLayer* pAsyncLayer, ShaderModule* pModule, VkShaderModule asyncShaderModule);
 
 protected:
     PartialPipeline(const VkAllocationCallbacks* pAllocator);
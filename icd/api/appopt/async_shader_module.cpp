@@ -103,10 +103,9 @@ VkResult ShaderModule::Destroy(
     const VkAllocationCallbacks* pAllocator)
 {
     AsyncLayer* pAsyncLayer = pDevice->GetAsyncLayer();
-    if (m_asyncModule == VK_NULL_HANDLE)
-    {
-        pAsyncLayer->SyncAll();
-    }
+
+    // Speculative work for the module is of no use anymore, and running tasks still reference it.
+    pAsyncLayer->CancelTasks(this);
 
     if (m_immedModule != VK_NULL_HANDLE)
     {
@@ -132,19 +131,29 @@ VkResult ShaderModule::Destroy(
 void ShaderModule::AsyncBuildShaderModule(
     AsyncLayer* pAsyncLayer)
 {
-    auto pTaskThread = reinterpret_cast<async::TaskThread<ShaderModuleTask>*>
-                       (pAsyncLayer->GetTaskThread(ShaderModuleTaskType));
-    if (pTaskThread != nullptr)
+    vk::ShaderModule* pNextLayerModule = vk::ShaderModule::ObjectFromHandle(m_immedModule);
+
+    AsyncTask task = {};
+    task.type = ShaderModuleTaskType;
+    task.priority = TaskPriorityNormal;
+    task.pModule = this;
+    task.shaderModule.info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    task.shaderModule.info.pCode = reinterpret_cast<const uint32_t*>(pNextLayerModule->GetCode());
+    task.shaderModule.info.codeSize = pNextLayerModule->GetCodeSize();
+    task.shaderModule.info.flags = VK_SHADER_MODULE_ENABLE_OPT_BIT;
+    task.shaderModule.pObj = this;
+    pAsyncLayer->AddTask(task);
+}
+
+// =====================================================================================================================
+// Moves the optimized build of the module ahead of other queued work if it hasn't finished yet, because a pipeline is
+// being created from the module.
+void ShaderModule::PrioritizeAsyncBuild(
+    AsyncLayer* pAsyncLayer)
+{
+    if (m_asyncModule == VK_NULL_HANDLE)
     {
-        vk::ShaderModule* pNextLayerModule = vk::ShaderModule::ObjectFromHandle(m_immedModule);
-
-        ShaderModuleTask task = {};
-        task.info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        task.info.pCode = reinterpret_cast<const uint32_t*>(pNextLayerModule->GetCode());
-        task.info.codeSize = pNextLayerModule->GetCodeSize();
-        task.info.flags = VK_SHADER_MODULE_ENABLE_OPT_BIT;
-        task.pObj = this;
-        pTaskThread->AddTask(&task);
+        pAsyncLayer->PrioritizeTasks(this);
     }
 }
 
@@ -168,7 +177,7 @@ void ShaderModule::Execute(
         if ((pPartialPipelineObj != nullptr) && (m_asyncModule != VK_NULL_HANDLE))
         {
             // Build partial pipeline in async mode
-            pPartialPipelineObj->AsyncBuildPartialPipeline(pDevice->GetAsyncLayer(), m_asyncModule);
+            pPartialPipelineObj->AsyncBuildPartialPipeline(pDevice->GetAsyncLayer(), this, m_asyncModule);
         }
     }
 }
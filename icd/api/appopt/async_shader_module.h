@@ -66,6 +66,8 @@ public:
 
     void AsyncBuildShaderModule(AsyncLayer* pAsyncLayer);
 
+    void PrioritizeAsyncBuild(AsyncLayer* pAsyncLayer);
+
 protected:
     ShaderModule(VkShaderModule immedModule);
 
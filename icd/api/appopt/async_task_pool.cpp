@@ -0,0 +1,456 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  async_task_pool.cpp
+* @brief Implementation of class async::TaskPool
+***********************************************************************************************************************
+*/
+#include "async_task_pool.h"
+#include "async_partial_pipeline.h"
+
+#include "palListImpl.h"
+
+namespace vk
+{
+
+namespace async
+{
+
+// =====================================================================================================================
+TaskPool::Worker::Worker(
+    TaskPool*     pPool,
+    uint32_t      index,
+    PalAllocator* pAllocator)
+    :
+    pPool(pPool),
+    index(index),
+    pRunningModule(nullptr)
+{
+    lock.Init();
+
+    for (uint32_t i = 0; i < TaskPriorityCount; ++i)
+    {
+        pTasks[i] = VK_PLACEMENT_NEW(taskListBuffer[i]) TaskList(pAllocator);
+    }
+}
+
+// =====================================================================================================================
+TaskPool::Worker::~Worker()
+{
+    for (uint32_t i = 0; i < TaskPriorityCount; ++i)
+    {
+        Util::Destructor(pTasks[i]);
+        pTasks[i] = nullptr;
+    }
+}
+
+// =====================================================================================================================
+TaskPool::TaskPool(
+    ExecuteFunc   pfnExecute,
+    void*         pPayload,
+    PalAllocator* pAllocator)
+    :
+    m_pfnExecute(pfnExecute),
+    m_pPayload(pPayload),
+    m_pAllocator(pAllocator),
+    m_threadCount(0),
+    m_pWorkers(),
+    m_nextWorker(0),
+    m_queuedCount(0),
+    m_pendingCount(0),
+    m_stop(false)
+{
+    m_countLock.Init();
+    m_workQueued.Init();
+    m_idle.Init();
+    m_taskDone.Init();
+}
+
+// =====================================================================================================================
+TaskPool::~TaskPool()
+{
+    {
+        Util::MutexAuto mutexAuto(&m_countLock);
+
+        m_stop = true;
+        m_workQueued.WakeAll();
+    }
+
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        if (m_pWorkers[i]->thread.IsCreated())
+        {
+            m_pWorkers[i]->thread.Join();
+        }
+
+        Util::Destructor(m_pWorkers[i]);
+        m_pWorkers[i] = nullptr;
+    }
+}
+
+// =====================================================================================================================
+// Starts the worker threads.  Tasks run on the calling thread if no worker thread could be started.
+void TaskPool::Init(
+    uint32_t threadCount)
+{
+    VK_ASSERT(m_threadCount == 0);
+
+    threadCount = Util::Min(threadCount, MaxThreads);
+
+    // Workers only use the count to spread tasks and to steal them, and no task is added before this returns, so the
+    // threads that started don't need to see the final count right away.
+    uint32_t startedCount = 0;
+
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_pWorkers[i] = VK_PLACEMENT_NEW(m_workerBuffer[i]) Worker(this, i, m_pAllocator);
+
+        if (m_pWorkers[i]->thread.Begin(ThreadFunc, m_pWorkers[i]) != Util::Result::Success)
+        {
+            Util::Destructor(m_pWorkers[i]);
+            m_pWorkers[i] = nullptr;
+
+            break;
+        }
+
+        ++startedCount;
+    }
+
+    m_threadCount = startedCount;
+}
+
+// =====================================================================================================================
+// Adds a task to the list of its priority of the next worker in turn.
+void TaskPool::AddTask(
+    const AsyncTask& task)
+{
+    VK_ASSERT(m_threadCount > 0);
+    VK_ASSERT(task.priority < TaskPriorityCount);
+
+    {
+        Util::MutexAuto mutexAuto(&m_countLock);
+
+        ++m_queuedCount;
+        ++m_pendingCount;
+    }
+
+    Worker* pWorker = m_pWorkers[Util::AtomicIncrement(&m_nextWorker) % m_threadCount];
+
+    Util::Result result = Util::Result::Success;
+
+    {
+        Util::MutexAuto mutexAuto(&pWorker->lock);
+
+        result = pWorker->pTasks[task.priority]->PushBack(task);
+    }
+
+    if (result == Util::Result::Success)
+    {
+        Util::MutexAuto mutexAuto(&m_countLock);
+
+        m_workQueued.WakeAll();
+    }
+    else
+    {
+        // Out of memory; run the task right here instead.
+        {
+            Util::MutexAuto mutexAuto(&m_countLock);
+
+            --m_queuedCount;
+        }
+
+        AsyncTask localTask = task;
+        ExecuteTask(&localTask, nullptr);
+    }
+}
+
+// =====================================================================================================================
+// Returns once every task added so far, and every task those add in turn, has finished executing.
+void TaskPool::SyncAll()
+{
+    Util::MutexAuto mutexAuto(&m_countLock);
+
+    // A timeout of UINT32_MAX waits without a timeout.
+    while (m_pendingCount > 0)
+    {
+        m_idle.Wait(&m_countLock, UINT32_MAX);
+    }
+}
+
+// =====================================================================================================================
+// Raises the queued tasks of a module from normal to high priority, e.g. because a pipeline is being created from the
+// module right now and its optimized build is on the critical path.
+void TaskPool::PrioritizeTasks(
+    const ShaderModule* pModule)
+{
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        Worker* pWorker = m_pWorkers[i];
+
+        Util::MutexAuto mutexAuto(&pWorker->lock);
+
+        TaskList* pTasks = pWorker->pTasks[TaskPriorityNormal];
+
+        for (auto it = pTasks->Begin(); it.Get() != nullptr;)
+        {
+            if (it.Get()->pModule == pModule)
+            {
+                AsyncTask task = *it.Get();
+                task.priority  = TaskPriorityHigh;
+
+                if (pWorker->pTasks[TaskPriorityHigh]->PushBack(task) == Util::Result::Success)
+                {
+                    pTasks->Erase(&it);
+                }
+                else
+                {
+                    it.Next();
+                }
+            }
+            else
+            {
+                it.Next();
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Drops the queued tasks of a module that is being destroyed, and waits for its running tasks to finish.  Tasks of
+// other modules are not waited for.
+void TaskPool::CancelTasks(
+    const ShaderModule* pModule)
+{
+    while (RemoveTasks(pModule))
+    {
+        Util::MutexAuto mutexAuto(&m_countLock);
+
+        // The running tasks may queue new tasks for the module, so scan again once they are done.
+        while (IsRunning(pModule))
+        {
+            m_taskDone.Wait(&m_countLock, UINT32_MAX);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Returns true if a worker is running a task of the module.  The caller must hold m_countLock.
+bool TaskPool::IsRunning(
+    const ShaderModule* pModule) const
+{
+    bool running = false;
+
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        running |= (m_pWorkers[i]->pRunningModule == pModule);
+    }
+
+    return running;
+}
+
+// =====================================================================================================================
+// Removes the queued tasks of a module from all workers.  Returns true if a task of the module is still running.
+bool TaskPool::RemoveTasks(
+    const ShaderModule* pModule)
+{
+    // All worker locks are held at once, so a task is either queued or marked as running while the workers are
+    // scanned, and a running task can't queue a new one for the module behind the scan.
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        m_pWorkers[i]->lock.Lock();
+    }
+
+    uint32_t removedCount = 0;
+
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        for (uint32_t priority = 0; priority < TaskPriorityCount; ++priority)
+        {
+            TaskList* pTasks = m_pWorkers[i]->pTasks[priority];
+
+            for (auto it = pTasks->Begin(); it.Get() != nullptr;)
+            {
+                AsyncTask* pTask = it.Get();
+
+                if (pTask->pModule == pModule)
+                {
+                    if (pTask->type == PartialPipelineTaskType)
+                    {
+                        // Partial pipeline objects are owned by their task.
+                        pTask->partialPipeline.pObj->Destroy();
+                    }
+
+                    pTasks->Erase(&it);
+                    ++removedCount;
+                }
+                else
+                {
+                    it.Next();
+                }
+            }
+        }
+    }
+
+    bool running = false;
+
+    {
+        Util::MutexAuto mutexAuto(&m_countLock);
+
+        running = IsRunning(pModule);
+
+        if (removedCount > 0)
+        {
+            m_queuedCount  -= removedCount;
+            m_pendingCount -= removedCount;
+
+            if (m_pendingCount == 0)
+            {
+                m_idle.WakeAll();
+            }
+        }
+    }
+
+    for (uint32_t i = m_threadCount; i > 0; --i)
+    {
+        m_pWorkers[i - 1]->lock.Unlock();
+    }
+
+    return running;
+}
+
+// =====================================================================================================================
+// Takes the oldest task of the highest priority queued on any worker.  Of tasks with the same priority, those of the
+// worker's own lists are preferred over those stolen from other workers.  Returns false if all lists are empty.
+bool TaskPool::TakeTask(
+    uint32_t   workerIndex,
+    AsyncTask* pTask)
+{
+    Worker* pWorker = m_pWorkers[workerIndex];
+    bool    taken   = false;
+
+    for (uint32_t priority = 0; (taken == false) && (priority < TaskPriorityCount); ++priority)
+    {
+        for (uint32_t i = 0; (taken == false) && (i < m_threadCount); ++i)
+        {
+            Worker* pVictim = m_pWorkers[(workerIndex + i) % m_threadCount];
+
+            taken = PopTask(pVictim, static_cast<TaskPriority>(priority), pWorker, pTask);
+        }
+    }
+
+    return taken;
+}
+
+// =====================================================================================================================
+// Pops the oldest task of a priority from the lists of pVictim, and marks it as running on pWorker.
+bool TaskPool::PopTask(
+    Worker*      pVictim,
+    TaskPriority priority,
+    Worker*      pWorker,
+    AsyncTask*   pTask)
+{
+    Util::MutexAuto mutexAuto(&pVictim->lock);
+
+    auto it = pVictim->pTasks[priority]->Begin();
+
+    const bool popped = (it.Get() != nullptr);
+
+    if (popped)
+    {
+        *pTask = *it.Get();
+        pVictim->pTasks[priority]->Erase(&it);
+
+        // Still under the lock of pVictim, so CancelTasks() sees the task either queued or running.
+        Util::MutexAuto countAuto(&m_countLock);
+
+        pWorker->pRunningModule = pTask->pModule;
+
+        --m_queuedCount;
+    }
+
+    return popped;
+}
+
+// =====================================================================================================================
+// Executes a task and counts it as finished.  pWorker is null if the task runs outside of the worker threads.
+void TaskPool::ExecuteTask(
+    AsyncTask* pTask,
+    Worker*    pWorker)
+{
+    m_pfnExecute(m_pPayload, pTask);
+
+    Util::MutexAuto mutexAuto(&m_countLock);
+
+    if (pWorker != nullptr)
+    {
+        pWorker->pRunningModule = nullptr;
+        m_taskDone.WakeAll();
+    }
+
+    if (--m_pendingCount == 0)
+    {
+        m_idle.WakeAll();
+    }
+}
+
+// =====================================================================================================================
+// Async thread function
+void TaskPool::ThreadFunc(
+    void* pParam)
+{
+    auto pWorker = static_cast<Worker*>(pParam);
+    pWorker->pPool->WorkerLoop(pWorker->index);
+}
+
+// =====================================================================================================================
+// The implementation of async thread function
+void TaskPool::WorkerLoop(
+    uint32_t workerIndex)
+{
+    while (m_stop == false)
+    {
+        AsyncTask task;
+
+        if (TakeTask(workerIndex, &task))
+        {
+            ExecuteTask(&task, m_pWorkers[workerIndex]);
+        }
+        else
+        {
+            Util::MutexAuto mutexAuto(&m_countLock);
+
+            // Sleeps until new tasks are queued.  A timeout of UINT32_MAX waits without a timeout.
+            while ((m_queuedCount == 0) && (m_stop == false))
+            {
+                m_workQueued.Wait(&m_countLock, UINT32_MAX);
+            }
+        }
+    }
+}
+
+} // namespace async
+
+} // namespace vk
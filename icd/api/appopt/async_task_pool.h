@@ -0,0 +1,177 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  async_task_pool.h
+* @brief Declaration of class async::TaskPool
+***********************************************************************************************************************
+*/
+#ifndef __ASYNC_TASK_POOL_H__
+#define __ASYNC_TASK_POOL_H__
+
+#pragma once
+
+#include "include/vk_alloccb.h"
+#include "palConditionVariable.h"
+#include "palList.h"
+#include "palMutex.h"
+#include "palThread.h"
+
+namespace vk
+{
+
+class PalAllocator;
+
+namespace async { class ShaderModule; class PartialPipeline; }
+
+// Represents the shader module async compile info
+struct ShaderModuleTask
+{
+    VkShaderModuleCreateInfo info;        // Shader module create info
+    async::ShaderModule*     pObj;        // Output shader module object
+};
+
+// Represents the pipeline async compile info
+struct PartialPipelineTask
+{
+    VkShaderModule              shaderModuleHandle; // Shader module handle
+    async::PartialPipeline*     pObj;               // Output shader module object
+};
+
+// Thread task type
+enum TaskType : uint32_t
+{
+    ShaderModuleTaskType = 0,
+    PartialPipelineTaskType,
+    MaxTaskType,
+};
+
+// Order in which queued tasks are taken.  Higher priority tasks are taken first, regardless of the worker they are
+// queued on.
+enum TaskPriority : uint32_t
+{
+    TaskPriorityHigh = 0,    // Tasks on the critical path, i.e. the modules of pipelines the application creates
+    TaskPriorityNormal,      // Builds of shader modules
+    TaskPriorityLow,         // Speculative builds of partial pipelines
+    TaskPriorityCount,
+};
+
+// Represents an async compile task of any type
+struct AsyncTask
+{
+    TaskType             type;                // Selects the member of the union below
+    TaskPriority         priority;            // Priority of the task while it is queued
+    async::ShaderModule* pModule;             // Module the task belongs to; its tasks are cancelled when destroyed
+    union
+    {
+        ShaderModuleTask    shaderModule;     // Task of type ShaderModuleTaskType
+        PartialPipelineTask partialPipeline;  // Task of type PartialPipelineTaskType
+    };
+};
+
+namespace async
+{
+
+// =====================================================================================================================
+// Worker threads shared by all async compile tasks.  Every worker owns a task list per priority, which new tasks are
+// spread over.  A worker takes the oldest task of the highest priority that any worker has queued, preferring its own
+// lists over stealing from others, so critical path work never waits behind speculative work and a slow task only
+// holds up the tasks that nobody else is free to take.
+class TaskPool
+{
+public:
+    // Callback executing a task taken from the pool
+    typedef void (*ExecuteFunc)(void* pPayload, AsyncTask* pTask);
+
+    static constexpr uint32_t MaxThreads = 8;  // Max worker thread count
+
+    TaskPool(ExecuteFunc pfnExecute, void* pPayload, PalAllocator* pAllocator);
+    ~TaskPool();
+
+    void Init(uint32_t threadCount);
+
+    VK_INLINE uint32_t GetThreadCount() const
+        { return m_threadCount; }
+
+    void AddTask(const AsyncTask& task);
+
+    void PrioritizeTasks(const ShaderModule* pModule);
+
+    void CancelTasks(const ShaderModule* pModule);
+
+    void SyncAll();
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(TaskPool);
+    PAL_DISALLOW_COPY_AND_ASSIGN(TaskPool);
+
+    typedef Util::List<AsyncTask, PalAllocator> TaskList;
+
+    // A worker thread and the tasks assigned to it
+    struct Worker
+    {
+        TaskPool*           pPool;                     // Pool owning the worker
+        uint32_t            index;                     // Index of the worker in the pool
+        Util::Thread        thread;                    // Worker thread
+        Util::Mutex         lock;                      // Lock for accessing pTasks
+        TaskList*           pTasks[TaskPriorityCount]; // Queued tasks per priority, oldest first
+        const ShaderModule* pRunningModule;            // Module of the running task, protected by m_countLock
+
+        uint8_t taskListBuffer[TaskPriorityCount][sizeof(TaskList)]; // Internal buffer for pTasks
+
+        Worker(TaskPool* pPool, uint32_t index, PalAllocator* pAllocator);
+        ~Worker();
+    };
+
+    bool TakeTask(uint32_t workerIndex, AsyncTask* pTask);
+    bool PopTask(Worker* pVictim, TaskPriority priority, Worker* pWorker, AsyncTask* pTask);
+    void ExecuteTask(AsyncTask* pTask, Worker* pWorker);
+    bool RemoveTasks(const ShaderModule* pModule);
+    bool IsRunning(const ShaderModule* pModule) const;
+
+    static void ThreadFunc(void* pParam);
+    void WorkerLoop(uint32_t workerIndex);
+
+    const ExecuteFunc m_pfnExecute;                                 // Callback executing the tasks
+    void* const       m_pPayload;                                   // Client data passed to m_pfnExecute
+    PalAllocator*     m_pAllocator;                                 // Allocator of the task lists
+    uint32_t          m_threadCount;                                // Number of running worker threads
+    Worker*           m_pWorkers[MaxThreads];                       // Worker threads
+    uint8_t           m_workerBuffer[MaxThreads][sizeof(Worker)];   // Internal buffer for m_pWorkers
+    volatile uint32_t m_nextWorker;                                 // Hint to select the worker of a new task
+    uint32_t          m_queuedCount;                                // Tasks that no worker has taken yet
+    uint32_t          m_pendingCount;                               // Tasks that have not finished executing
+    Util::Mutex       m_countLock;                                  // Lock for accessing the counts above and m_stop
+    Util::ConditionVariable m_workQueued;                           // Signaled when tasks are queued or on m_stop
+    Util::ConditionVariable m_idle;                                 // Signaled when m_pendingCount drops to zero
+    Util::ConditionVariable m_taskDone;                             // Signaled whenever a worker finishes a task
+    volatile bool     m_stop;                                       // Flag to stop the worker threads
+};
+
+} // namespace async
+
+} // namespace vk
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_cleaner.cpp
+* @brief Implementation of the background cleanup of the pipeline cache directory
+***********************************************************************************************************************
+*/
+#include "include/archive_cleaner.h"
+#include "include/vk_conv.h"
+#include "include/vk_instance.h"
+
+#include "palVectorImpl.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace vk
+{
+
+// Time between two scans of the cache directory
+static constexpr float CleanIntervalSeconds = 60.0f;
+
+// Once over budget, files are removed until they take up no more than this percentage of it, so that the next few
+// archive writes don't put the directory over budget right away again.
+static constexpr uint64_t LowWaterPercent = 90;
+
+// =====================================================================================================================
+// Creates the cleaner.  Its thread doesn't run until Start() is called.  Returns nullptr on failure.
+ArchiveCleaner* ArchiveCleaner::Create(
+    Instance*   pInstance,
+    const char* pCachePath,
+    uint64_t    budget,
+    uint64_t    minIdleSeconds)
+{
+    VK_ASSERT(pCachePath != nullptr);
+
+    ArchiveCleaner* pCleaner = nullptr;
+
+    void* pMem = pInstance->AllocMem(sizeof(ArchiveCleaner), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if (pMem != nullptr)
+    {
+        pCleaner = VK_PLACEMENT_NEW(pMem) ArchiveCleaner(pInstance, budget, minIdleSeconds);
+
+        if (pCleaner->Initialize(pCachePath) != VK_SUCCESS)
+        {
+            pCleaner->Destroy();
+            pCleaner = nullptr;
+        }
+    }
+
+    return pCleaner;
+}
+
+// =====================================================================================================================
+// Stops the cleaner thread and frees the cleaner.
+void ArchiveCleaner::Destroy()
+{
+    Instance* const pInstance = m_pInstance;
+
+    this->~ArchiveCleaner();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+ArchiveCleaner::ArchiveCleaner(
+    Instance* pInstance,
+    uint64_t  budget,
+    uint64_t  minIdleSeconds)
+    :
+    m_pInstance      { pInstance },
+    m_budget         { budget },
+    m_minIdleSeconds { minIdleSeconds },
+    m_path           {},
+    m_files          { pInstance->Allocator() },
+    m_keptFiles      { pInstance->Allocator() },
+    m_keepFailed     { false },
+    m_stop           { false }
+{
+}
+
+// =====================================================================================================================
+ArchiveCleaner::~ArchiveCleaner()
+{
+    m_stop = true;
+    m_stopEvent.Set();
+
+    if (m_thread.IsCreated())
+    {
+        m_thread.Join();
+    }
+}
+
+// =====================================================================================================================
+VkResult ArchiveCleaner::Initialize(
+    const char* pCachePath)
+{
+    Util::EventCreateFlags stopFlags = {};
+    stopFlags.manualReset       = true;
+    stopFlags.initiallySignaled = false;
+
+    Util::Strncpy(m_path, pCachePath, sizeof(m_path));
+
+    return PalToVkResult(m_stopEvent.Init(stopFlags));
+}
+
+// =====================================================================================================================
+// Protects a file of the directory from removal.  Must be called before Start().
+void ArchiveCleaner::KeepFile(
+    const char* pFileName)
+{
+    VK_ASSERT(m_thread.IsCreated() == false);
+
+    KeptFile file = {};
+    Util::Strncpy(file.name, pFileName, sizeof(file.name));
+
+    if (m_keptFiles.PushBack(file) != Util::Result::Success)
+    {
+        m_keepFailed = true;
+    }
+}
+
+// =====================================================================================================================
+// Starts the cleaner thread, which scans the directory right away.  Fails if a kept file couldn't be recorded, since
+// the cleaner could remove it otherwise.
+VkResult ArchiveCleaner::Start()
+{
+    VkResult result = m_keepFailed ? VK_ERROR_OUT_OF_HOST_MEMORY : VK_SUCCESS;
+
+    if (result == VK_SUCCESS)
+    {
+        result = PalToVkResult(m_thread.Begin(ThreadFunc, this));
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Returns true if a file of the directory is one the cache has open.
+bool ArchiveCleaner::IsKept(
+    const char* pFileName
+    ) const
+{
+    bool kept = false;
+
+    for (uint32_t i = 0; (kept == false) && (i < m_keptFiles.NumElements()); ++i)
+    {
+        kept = (strcmp(m_keptFiles.At(i).name, pFileName) == 0);
+    }
+
+    return kept;
+}
+
+// =====================================================================================================================
+// Scans the cache directory and, if its files exceed the budget, removes the files that have been idle long enough,
+// oldest first, until the files are below the low water mark.  Kept files count against the budget but stay.
+void ArchiveCleaner::Clean()
+{
+    m_files.Clear();
+
+    uint64_t totalSize = 0;
+
+    DIR* pDir = opendir(m_path);
+
+    if (pDir != nullptr)
+    {
+        const int dirFd = dirfd(pDir);
+
+        for (const dirent* pEntry = readdir(pDir); pEntry != nullptr; pEntry = readdir(pDir))
+        {
+            struct stat fileStat = {};
+
+            if ((fstatat(dirFd, pEntry->d_name, &fileStat, AT_SYMLINK_NOFOLLOW) == 0) && S_ISREG(fileStat.st_mode))
+            {
+                CacheFile file = {};
+                Util::Strncpy(file.name, pEntry->d_name, sizeof(file.name));
+                file.size    = static_cast<uint64_t>(fileStat.st_size);
+                file.lastUse = Util::Max(fileStat.st_atime, fileStat.st_mtime);
+
+                totalSize += file.size;
+
+                // A file that can't be tracked still counts against the budget; it just won't be removed this time.
+                m_files.PushBack(file);
+            }
+        }
+
+        if ((totalSize > m_budget) && (m_files.NumElements() > 0))
+        {
+            const uint64_t lowWater = (m_budget / 100) * LowWaterPercent;
+            const time_t   now      = time(nullptr);
+
+            CacheFile* const pFiles = &m_files.At(0);
+
+            std::sort(pFiles, pFiles + m_files.NumElements(),
+                [](const CacheFile& lhs, const CacheFile& rhs)
+                {
+                    return lhs.lastUse < rhs.lastUse;
+                });
+
+            for (uint32_t i = 0; (m_stop == false) && (totalSize > lowWater) && (i < m_files.NumElements()); ++i)
+            {
+                const CacheFile& file = pFiles[i];
+
+                // The files are sorted by their last use, so every following file is in use as well.
+                if (static_cast<uint64_t>(now - file.lastUse) < m_minIdleSeconds)
+                {
+                    break;
+                }
+
+                // An archive another process has open stays intact for it; only its name goes away.
+                if ((IsKept(file.name) == false) && (unlinkat(dirFd, file.name, 0) == 0))
+                {
+                    totalSize -= file.size;
+                }
+            }
+        }
+
+        closedir(pDir);
+    }
+}
+
+// =====================================================================================================================
+void ArchiveCleaner::ThreadFunc(
+    void* pParam)
+{
+    static_cast<ArchiveCleaner*>(pParam)->CleanerLoop();
+}
+
+// =====================================================================================================================
+void ArchiveCleaner::CleanerLoop()
+{
+    while (m_stop == false)
+    {
+        Clean();
+
+        m_stopEvent.Wait(CleanIntervalSeconds);
+    }
+}
+
+} // namespace vk
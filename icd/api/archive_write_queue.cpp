@@ -0,0 +1,362 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_write_queue.cpp
+* @brief Implementation of a write-behind queue in front of the writable pipeline cache archive
+***********************************************************************************************************************
+*/
+#include "include/archive_write_queue.h"
+#include "include/vk_conv.h"
+#include "include/vk_instance.h"
+
+#include "palHashSetImpl.h"
+#include "palListImpl.h"
+#include "palVectorImpl.h"
+
+#include <limits.h>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace vk
+{
+
+// Number of buckets in the set of queued IDs
+static constexpr uint32_t PendingIdBuckets = 64;
+
+// =====================================================================================================================
+// Creates the queue and starts its I/O thread.  Returns nullptr on failure, in which case the caller keeps writing to
+// the archive synchronously.
+ArchiveWriteQueue* ArchiveWriteQueue::Create(
+    Instance*                 pInstance,
+    uint32_t                  shardCount,
+    Util::ICacheLayer* const* ppShardLayers,
+    const char*               pFilePath,
+    const char* const*        ppFileNames)
+{
+    VK_ASSERT(shardCount > 0);
+    VK_ASSERT(ppShardLayers != nullptr);
+    VK_ASSERT(pFilePath != nullptr);
+    VK_ASSERT(ppFileNames != nullptr);
+
+    ArchiveWriteQueue* pQueue = nullptr;
+
+    void* pMem = pInstance->AllocMem(sizeof(ArchiveWriteQueue), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if (pMem != nullptr)
+    {
+        pQueue = VK_PLACEMENT_NEW(pMem) ArchiveWriteQueue(pInstance);
+
+        if (pQueue->Initialize(shardCount, ppShardLayers, pFilePath, ppFileNames) != VK_SUCCESS)
+        {
+            pQueue->Destroy();
+            pQueue = nullptr;
+        }
+    }
+
+    return pQueue;
+}
+
+// =====================================================================================================================
+// Writes out every queued entry, stops the I/O thread and frees the queue.
+void ArchiveWriteQueue::Destroy()
+{
+    Instance* const pInstance = m_pInstance;
+
+    this->~ArchiveWriteQueue();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+ArchiveWriteQueue::ArchiveWriteQueue(
+    Instance* pInstance)
+    :
+    m_pInstance     { pInstance },
+    m_shards        { pInstance->Allocator() },
+    m_pendingWrites { pInstance->Allocator() },
+    m_pendingIds    { PendingIdBuckets, pInstance->Allocator() },
+    m_queuedBytes   { 0 },
+    m_busy          { false },
+    m_stop          { false }
+{
+}
+
+// =====================================================================================================================
+ArchiveWriteQueue::~ArchiveWriteQueue()
+{
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        m_stop = true;
+        m_workQueued.WakeAll();
+    }
+
+    if (m_thread.IsCreated())
+    {
+        // The I/O thread drains the queue before it exits.
+        m_thread.Join();
+    }
+
+    VK_ASSERT(m_pendingWrites.NumElements() == 0);
+
+#if defined(__unix__)
+    for (uint32_t i = 0; i < m_shards.NumElements(); ++i)
+    {
+        if (m_shards.At(i).syncFd >= 0)
+        {
+            close(m_shards.At(i).syncFd);
+        }
+    }
+#endif
+}
+
+// =====================================================================================================================
+VkResult ArchiveWriteQueue::Initialize(
+    uint32_t                  shardCount,
+    Util::ICacheLayer* const* ppShardLayers,
+    const char*               pFilePath,
+    const char* const*        ppFileNames)
+{
+    Util::Result palResult = m_lock.Init();
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_pendingIds.Init();
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_workQueued.Init();
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_batchDone.Init();
+    }
+
+    for (uint32_t i = 0; (palResult == Util::Result::Success) && (i < shardCount); ++i)
+    {
+        VK_ASSERT(ppShardLayers[i] != nullptr);
+
+        Shard shard  = {};
+        shard.pLayer = ppShardLayers[i];
+        shard.syncFd = -1;
+
+#if defined(__unix__)
+        char fullPath[PATH_MAX] = {};
+
+        // The archive layer owns its own handle of the file; this one only exists to sync the file after each batch.
+        // It is opened for writing, since syncing through a read-only descriptor isn't guaranteed to flush the data
+        // on every filesystem.  Without it writes still happen, they are just left to the kernel to flush.
+        if (Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", pFilePath, ppFileNames[i]) > 0)
+        {
+            shard.syncFd = open(fullPath, O_WRONLY | O_CLOEXEC);
+        }
+
+        VK_ALERT(shard.syncFd < 0);
+#endif
+
+        palResult = m_shards.PushBack(shard);
+
+#if defined(__unix__)
+        if ((palResult != Util::Result::Success) && (shard.syncFd >= 0))
+        {
+            close(shard.syncFd);
+        }
+#endif
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_thread.Begin(ThreadFunc, this);
+    }
+
+    return PalToVkResult(palResult);
+}
+
+// =====================================================================================================================
+// Returns once every entry queued so far has been written to the archive and the shards it went to have been synced.
+void ArchiveWriteQueue::Drain()
+{
+    Util::MutexAuto lock(&m_lock);
+
+    // A timeout of UINT32_MAX waits without a timeout.
+    while ((m_pendingWrites.NumElements() > 0) || m_busy)
+    {
+        m_batchDone.Wait(&m_lock, UINT32_MAX);
+    }
+}
+
+// =====================================================================================================================
+// Queues a copy of the entry for the I/O thread to write to the given shard.  An entry with the same ID that is still
+// queued is not queued again.  Returns NotReady if the queue is full or out of memory; the entry is not queued then and
+// must be written by the caller.
+Util::Result ArchiveWriteQueue::Enqueue(
+    const CacheId* pCacheId,
+    const void*    pData,
+    size_t         dataSize,
+    uint32_t       shard)
+{
+    VK_ASSERT(shard < m_shards.NumElements());
+
+    Util::Result result = Util::Result::NotReady;
+
+    Util::MutexAuto lock(&m_lock);
+
+    if (m_pendingIds.Contains(*pCacheId))
+    {
+        result = Util::Result::Success;
+    }
+    else if ((m_queuedBytes + dataSize) <= MaxQueuedBytes)
+    {
+        PendingWrite write = {};
+        write.cacheId      = *pCacheId;
+        write.dataSize     = dataSize;
+        write.shard        = shard;
+        write.pData        = m_pInstance->AllocMem(dataSize, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+        if (write.pData != nullptr)
+        {
+            memcpy(write.pData, pData, dataSize);
+
+            if ((m_pendingIds.Insert(*pCacheId) == Util::Result::Success) &&
+                (m_pendingWrites.PushBack(write) == Util::Result::Success))
+            {
+                m_queuedBytes += dataSize;
+
+                m_workQueued.WakeAll();
+
+                result = Util::Result::Success;
+            }
+            else
+            {
+                m_pendingIds.Erase(*pCacheId);
+                m_pInstance->FreeMem(write.pData);
+            }
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Takes the oldest entry off the queue.  Its ID stays in m_pendingIds until the entry has been written.
+bool ArchiveWriteQueue::PopWrite(
+    PendingWrite* pWrite)
+{
+    Util::MutexAuto lock(&m_lock);
+
+    bool popped = false;
+    auto it     = m_pendingWrites.Begin();
+
+    if (it.Get() != nullptr)
+    {
+        *pWrite = *it.Get();
+        m_pendingWrites.Erase(&it);
+
+        popped = true;
+    }
+
+    return popped;
+}
+
+// =====================================================================================================================
+// Writes every queued entry to the archive, including ones queued while the batch is being written, then syncs each
+// shard file the batch wrote to once.
+void ArchiveWriteQueue::WriteBatch()
+{
+    PendingWrite write = {};
+
+    while (PopWrite(&write))
+    {
+        Shard& shard = m_shards.At(write.shard);
+
+        // The archive may already hold the entry if another process stored it, which is fine.
+        shard.pLayer->Store(&write.cacheId, write.pData, write.dataSize);
+        shard.dirty = true;
+
+        m_pInstance->FreeMem(write.pData);
+
+        Util::MutexAuto lock(&m_lock);
+
+        m_pendingIds.Erase(write.cacheId);
+        m_queuedBytes -= write.dataSize;
+    }
+
+    for (uint32_t i = 0; i < m_shards.NumElements(); ++i)
+    {
+        Shard& shard = m_shards.At(i);
+
+#if defined(__unix__)
+        if (shard.dirty && (shard.syncFd >= 0))
+        {
+            fdatasync(shard.syncFd);
+        }
+#endif
+
+        shard.dirty = false;
+    }
+}
+
+// =====================================================================================================================
+void ArchiveWriteQueue::ThreadFunc(
+    void* pParam)
+{
+    static_cast<ArchiveWriteQueue*>(pParam)->WriterLoop();
+}
+
+// =====================================================================================================================
+void ArchiveWriteQueue::WriterLoop()
+{
+    m_lock.Lock();
+
+    // Entries queued before the stop request must still reach the archive, so the thread only exits once the queue is
+    // empty.  A timeout of UINT32_MAX waits without a timeout.
+    while ((m_pendingWrites.NumElements() > 0) || (m_stop == false))
+    {
+        if (m_pendingWrites.NumElements() == 0)
+        {
+            m_workQueued.Wait(&m_lock, UINT32_MAX);
+        }
+        else
+        {
+            m_busy = true;
+            m_lock.Unlock();
+
+            WriteBatch();
+
+            m_lock.Lock();
+            m_busy = false;
+            m_batchDone.WakeAll();
+        }
+    }
+
+    m_lock.Unlock();
+}
+
+} // namespace vk
@@ -179,7 +179,7 @@ Result CacheAdapter::SetValue(
     }
     else
     {
-        palResult = m_pPipelineBinaryCache->StorePipelineBinary(&pQuery->hashId, dataLen, pData);
+        palResult = m_pPipelineBinaryCache->StoreCacheEntry(&pQuery->hashId, dataLen, pData);
     }
     result = (palResult == Util::Result::Success) ? Result::Success : Result::ErrorUnknown;
 
@@ -34,17 +34,24 @@
 #include "include/vk_shader.h"
 #include "include/vk_pipeline_cache.h"
 
+#include "palHashMapImpl.h"
+
 #include <inttypes.h>
 
 namespace vk
 {
 
+// Number of buckets in the tables of interned shader modules
+static constexpr uint32_t InternedShaderModuleBuckets = 256;
+
 // =====================================================================================================================
 CompilerSolutionLlpc::CompilerSolutionLlpc(
     PhysicalDevice* pPhysicalDevice)
     :
     CompilerSolution(pPhysicalDevice),
-    m_pLlpc(nullptr)
+    m_pLlpc(nullptr),
+    m_internedModules(InternedShaderModuleBuckets, pPhysicalDevice->VkInstance()->Allocator()),
+    m_internedModuleData(InternedShaderModuleBuckets, pPhysicalDevice->VkInstance()->Allocator())
 {
 
 }
@@ -71,6 +78,14 @@ VkResult CompilerSolutionLlpc::Initialize(
 
     VkResult result = CompilerSolution::Initialize(gfxIp, gfxIpLevel, pInternalCache);
 
+    if ((result == VK_SUCCESS) &&
+        ((m_internLock.Init() != Util::Result::Success) ||
+         (m_internedModules.Init() != Util::Result::Success) ||
+         (m_internedModuleData.Init() != Util::Result::Success)))
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
     if (result == VK_SUCCESS)
     {
         result = CreateLlpcCompiler(pInternalCache);
@@ -88,6 +103,9 @@ void CompilerSolutionLlpc::Destroy()
         m_pLlpc->Destroy();
         m_pLlpc = nullptr;
     }
+
+    // Every shader module should have been destroyed by now.
+    VK_ASSERT(m_internedModules.GetNumEntries() == 0);
 }
 
 // =====================================================================================================================
@@ -123,7 +141,6 @@ VkResult CompilerSolutionLlpc::BuildShaderModule(
     const Util::MetroHash::Hash& hash)
 {
     VK_IGNORE(pDevice);
-    VK_IGNORE(hash);
     VkResult result = VK_SUCCESS;
     auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
 
@@ -142,24 +159,39 @@ VkResult CompilerSolutionLlpc::BuildShaderModule(
     pPipelineCompiler->ApplyPipelineOptions(pDevice, 0, &moduleInfo.options.pipelineOptions);
     moduleInfo.options.enableOpt = (flags & VK_SHADER_MODULE_ENABLE_OPT_BIT) ? true : false;
 
-    Vkgc::Result llpcResult = m_pLlpc->BuildShaderModule(&moduleInfo, &buildOut);
-
-    if ((llpcResult == Vkgc::Result::Success) || (llpcResult == Vkgc::Result::Delayed))
-    {
-        pShaderModule->pLlpcShaderModule = buildOut.pModuleData;
-        VK_ASSERT(pShaderMemory == pShaderModule->pLlpcShaderModule);
-    }
-    else
+    // Modules built from the same code with the same options are identical, so they share one copy of the module
+    // data.  The 64-bit code hash passed in also names replacement shaders; the key hashes the code again at 128 bits
+    // so that two different modules can't realistically collide.
+    Util::MetroHash::Hash key = {};
+    Util::MetroHash128    hasher;
+    hasher.Update(hash);
+    hasher.Update(reinterpret_cast<const uint8_t*>(pCode), codeSize);
+    hasher.Update(moduleInfo.options);
+    hasher.Finalize(key.bytes);
+
+    if (AcquireInternedShaderModule(key, &pShaderModule->pLlpcShaderModule) == false)
     {
-        // Clean up if fail
-        pInstance->FreeMem(pShaderMemory);
-        if (llpcResult == Vkgc::Result::ErrorOutOfMemory)
+        Vkgc::Result llpcResult = m_pLlpc->BuildShaderModule(&moduleInfo, &buildOut);
+
+        if ((llpcResult == Vkgc::Result::Success) || (llpcResult == Vkgc::Result::Delayed))
         {
-            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            VK_ASSERT(pShaderMemory == buildOut.pModuleData);
+
+            // If another thread built the same module meanwhile, its module data is used and ours is freed.
+            pShaderModule->pLlpcShaderModule = InternShaderModule(key, buildOut.pModuleData);
         }
         else
         {
-            result = VK_ERROR_INITIALIZATION_FAILED;
+            // Clean up if fail
+            pInstance->FreeMem(pShaderMemory);
+            if (llpcResult == Vkgc::Result::ErrorOutOfMemory)
+            {
+                result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            }
+            else
+            {
+                result = VK_ERROR_INITIALIZATION_FAILED;
+            }
         }
     }
 
@@ -172,20 +204,160 @@ void CompilerSolutionLlpc::FreeShaderModule(ShaderModuleHandle* pShaderModule)
 {
     auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
 
-    pInstance->FreeMem(pShaderModule->pLlpcShaderModule);
+    if (ReleaseInternedShaderModule(pShaderModule->pLlpcShaderModule))
+    {
+        pInstance->FreeMem(pShaderModule->pLlpcShaderModule);
+    }
+}
+
+// =====================================================================================================================
+// Adds a reference to the module data of a shader module.  Returns false if the module data isn't interned.
+bool CompilerSolutionLlpc::RetainShaderModule(
+    const ShaderModuleHandle* pShaderModule)
+{
+    Util::MutexAuto lock(&m_internLock);
+
+    InternedShaderModule** ppInterned = m_internedModuleData.FindKey(pShaderModule->pLlpcShaderModule);
+
+    if (ppInterned != nullptr)
+    {
+        (*ppInterned)->refCount++;
+    }
+
+    return (ppInterned != nullptr);
+}
+
+// =====================================================================================================================
+// Looks up an interned shader module.  On success, adds a reference to it and returns its module data.
+bool CompilerSolutionLlpc::AcquireInternedShaderModule(
+    const Util::MetroHash::Hash& key,
+    void**                       ppModuleData)
+{
+    Util::MutexAuto lock(&m_internLock);
+
+    InternedShaderModule** ppInterned = m_internedModules.FindKey(key);
+
+    if (ppInterned != nullptr)
+    {
+        (*ppInterned)->refCount++;
+        *ppModuleData = (*ppInterned)->pModuleData;
+    }
+
+    return (ppInterned != nullptr);
+}
+
+// =====================================================================================================================
+// Interns freshly built module data and returns the module data the caller must use, with a reference added to it.
+// This is pModuleData itself unless the key was interned meanwhile, in which case pModuleData is freed.  Module data
+// that can't be interned for lack of memory is returned as is and simply stays private to its shader module.
+void* CompilerSolutionLlpc::InternShaderModule(
+    const Util::MetroHash::Hash& key,
+    void*                        pModuleData)
+{
+    Instance* const pInstance = m_pPhysicalDevice->Manager()->VkInstance();
+
+    Util::MutexAuto lock(&m_internLock);
+
+    bool                   existed    = false;
+    InternedShaderModule** ppInterned = nullptr;
+
+    if (m_internedModules.FindAllocate(key, &existed, &ppInterned) == Util::Result::Success)
+    {
+        if (existed)
+        {
+            (*ppInterned)->refCount++;
+
+            pInstance->FreeMem(pModuleData);
+            pModuleData = (*ppInterned)->pModuleData;
+        }
+        else
+        {
+            void* pMem = pInstance->AllocMem(
+                sizeof(InternedShaderModule),
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+            InternedShaderModule* pInterned = static_cast<InternedShaderModule*>(pMem);
+
+            if (pInterned != nullptr)
+            {
+                pInterned->key         = key;
+                pInterned->pModuleData = pModuleData;
+                pInterned->refCount    = 1;
+            }
+
+            if ((pInterned != nullptr) &&
+                (m_internedModuleData.Insert(pModuleData, pInterned) == Util::Result::Success))
+            {
+                *ppInterned = pInterned;
+            }
+            else
+            {
+                pInstance->FreeMem(pInterned);
+                m_internedModules.Erase(key);
+            }
+        }
+    }
+
+    return pModuleData;
 }
 
 // =====================================================================================================================
-// Creates partial pipeline binary for compute shader and fragment shader
+// Drops a reference to module data.  Returns true if the caller must free the module data, either because it wasn't
+// interned or because this was its last reference.
+bool CompilerSolutionLlpc::ReleaseInternedShaderModule(
+    void* pModuleData)
+{
+    Instance* const pInstance = m_pPhysicalDevice->Manager()->VkInstance();
+
+    bool freeModuleData = true;
+
+    Util::MutexAuto lock(&m_internLock);
+
+    InternedShaderModule** ppInterned = m_internedModuleData.FindKey(pModuleData);
+
+    if (ppInterned != nullptr)
+    {
+        InternedShaderModule* pInterned = *ppInterned;
+
+        VK_ASSERT(pInterned->refCount > 0);
+
+        if (--pInterned->refCount == 0)
+        {
+            m_internedModules.Erase(pInterned->key);
+            m_internedModuleData.Erase(pModuleData);
+            pInstance->FreeMem(pInterned);
+        }
+        else
+        {
+            freeModuleData = false;
+        }
+    }
+
+    return freeModuleData;
+}
+
+// =====================================================================================================================
+// Creates partial pipeline binary for compute shader and fragment shader.  The stage parts LLPC builds are cached in
+// pCache, if given.
 VkResult CompilerSolutionLlpc::CreatePartialPipelineBinary(
     uint32_t                             deviceIdx,
     void*                                pShaderModuleData,
     Vkgc::ShaderModuleEntryData*         pShaderModuleEntryData,
     const Vkgc::ResourceMappingRootNode* pResourceMappingNode,
     uint32_t                             mappingNodeCount,
-    Vkgc::ColorTarget*                   pColorTarget)
+    Vkgc::ColorTarget*                   pColorTarget,
+    Vkgc::ICache*                        pCache,
+    size_t*                              pPipelineBinarySize,
+    const void**                         ppPipelineBinary)
 {
-    auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
+    const RuntimeSettings& settings  = m_pPhysicalDevice->GetRuntimeSettings();
+    auto                   pInstance = m_pPhysicalDevice->Manager()->VkInstance();
+
+    if (settings.shaderCacheMode == ShaderCacheDisable)
+    {
+        pCache = nullptr;
+    }
 
     VkResult result = VK_SUCCESS;
 
@@ -222,6 +394,7 @@ VkResult CompilerSolutionLlpc::CreatePartialPipelineBinary(
             pipelineBuildInfo.pfnOutputAlloc = AllocateShaderOutput;
             pipelineBuildInfo.pUserData = &pLlpcPipelineBuffer;
             pipelineBuildInfo.deviceIndex = deviceIdx;
+            pipelineBuildInfo.cache = pCache;
             pipelineBuildInfo.cs.pModuleData = pShaderModuleData;
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 41
             pipelineBuildInfo.cs.pUserDataNodes = pRawNodes;
@@ -238,7 +411,11 @@ VkResult CompilerSolutionLlpc::CreatePartialPipelineBinary(
                 VK_ASSERT(pLlpcPipelineBuffer == nullptr);
                 result = VK_ERROR_INITIALIZATION_FAILED;
             }
-            pInstance->FreeMem(const_cast<void*>(pipelineOut.pipelineBin.pCode));
+            else
+            {
+                *ppPipelineBinary    = pipelineOut.pipelineBin.pCode;
+                *pPipelineBinarySize = pipelineOut.pipelineBin.codeSize;
+            }
         }
         else
         {
@@ -252,6 +429,7 @@ VkResult CompilerSolutionLlpc::CreatePartialPipelineBinary(
             pipelineBuildInfo.pfnOutputAlloc = AllocateShaderOutput;
             pipelineBuildInfo.pUserData = &pLlpcPipelineBuffer;
             pipelineBuildInfo.iaState.deviceIndex = deviceIdx;
+            pipelineBuildInfo.cache = pCache;
             pipelineBuildInfo.fs.pModuleData = pShaderModuleData;
 
             pipelineBuildInfo.fs.pEntryTarget = pShaderModuleEntryData->pEntryName;
@@ -276,7 +454,11 @@ VkResult CompilerSolutionLlpc::CreatePartialPipelineBinary(
                 VK_ASSERT(pLlpcPipelineBuffer == nullptr);
                 result = VK_ERROR_INITIALIZATION_FAILED;
             }
-            pInstance->FreeMem(const_cast<void*>(pipelineOut.pipelineBin.pCode));
+            else
+            {
+                *ppPipelineBinary    = pipelineOut.pipelineBin.pCode;
+                *pPipelineBinarySize = pipelineOut.pipelineBin.codeSize;
+            }
         }
     }
 
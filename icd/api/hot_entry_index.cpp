@@ -0,0 +1,349 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  hot_entry_index.cpp
+* @brief Implementation of the index of hot pipeline cache entries and of their prefetching
+***********************************************************************************************************************
+*/
+#include "include/hot_entry_index.h"
+#include "include/vk_conv.h"
+#include "include/vk_instance.h"
+
+#include "palFile.h"
+#include "palHashMapImpl.h"
+#include "palVectorImpl.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace vk
+{
+
+static constexpr uint32_t HotIndexMagic   = 0x49544F48;  // "HOTI"
+static constexpr uint32_t HotIndexVersion = 1;
+
+// Number of buckets of the access records
+static constexpr uint32_t AccessBuckets = 256;
+
+// Entries first used after this many distinct entries are not recorded.  They are unlikely to make the index, and it
+// keeps applications that stream in new pipelines all the time from growing the records without bound.
+static constexpr uint32_t MaxRecordsPerEntry = 4;
+
+// =====================================================================================================================
+// Creates the index and reads the entries the previous run recorded, if any.  Returns nullptr on failure, in which case
+// the cache runs without prefetching.
+HotEntryIndex* HotEntryIndex::Create(
+    Instance*   pInstance,
+    const char* pFilePath,
+    const char* pFileName,
+    uint32_t    maxEntries)
+{
+    VK_ASSERT(pFilePath != nullptr);
+    VK_ASSERT(pFileName != nullptr);
+
+    HotEntryIndex* pIndex = nullptr;
+
+    char fullPath[PATH_MAX] = {};
+
+    if ((maxEntries > 0) &&
+        (Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s.hot", pFilePath, pFileName) > 0))
+    {
+        void* pMem = pInstance->AllocMem(sizeof(HotEntryIndex), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+        if (pMem != nullptr)
+        {
+            pIndex = VK_PLACEMENT_NEW(pMem) HotEntryIndex(pInstance, maxEntries);
+
+            if (pIndex->Initialize(fullPath) != VK_SUCCESS)
+            {
+                pIndex->Destroy();
+                pIndex = nullptr;
+            }
+        }
+    }
+
+    return pIndex;
+}
+
+// =====================================================================================================================
+// Stops prefetching, writes the entries used during this run to the index file and frees the index.
+void HotEntryIndex::Destroy()
+{
+    Instance* const pInstance = m_pInstance;
+
+    this->~HotEntryIndex();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+HotEntryIndex::HotEntryIndex(
+    Instance* pInstance,
+    uint32_t  maxEntries)
+    :
+    m_pInstance        { pInstance },
+    m_maxEntries       { maxEntries },
+    m_path             {},
+    m_previousEntries  { pInstance->Allocator() },
+    m_accesses         { AccessBuckets, pInstance->Allocator() },
+    m_accessSequence   { 0 },
+    m_pfnPrefetch      { nullptr },
+    m_pPrefetchContext { nullptr },
+    m_prefetchCount    { 0 },
+    m_stop             { false }
+{
+}
+
+// =====================================================================================================================
+HotEntryIndex::~HotEntryIndex()
+{
+    m_stop = true;
+
+    if (m_thread.IsCreated())
+    {
+        m_thread.Join();
+    }
+
+    if (m_path[0] != '\0')
+    {
+        WriteIndex();
+    }
+}
+
+// =====================================================================================================================
+VkResult HotEntryIndex::Initialize(
+    const char* pFullPath)
+{
+    Util::Result palResult = m_lock.Init();
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_accesses.Init();
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        Util::Strncpy(m_path, pFullPath, sizeof(m_path));
+
+        ReadIndex();
+    }
+
+    return PalToVkResult(palResult);
+}
+
+// =====================================================================================================================
+// Reads the index written by the previous run.  A missing or malformed index leaves nothing to prefetch.
+void HotEntryIndex::ReadIndex()
+{
+    if (Util::File::Exists(m_path))
+    {
+        const size_t fileSize = Util::File::GetFileSize(m_path);
+
+        Util::File  file;
+        IndexHeader header = {};
+
+        if ((fileSize >= sizeof(IndexHeader)) &&
+            (file.Open(m_path, Util::FileAccessRead | Util::FileAccessBinary) == Util::Result::Success))
+        {
+            if ((file.Read(&header, sizeof(header), nullptr) == Util::Result::Success) &&
+                (header.magic == HotIndexMagic)                                       &&
+                (header.version == HotIndexVersion)                                   &&
+                (header.entryCount <= m_maxEntries)                                   &&
+                (fileSize == (sizeof(IndexHeader) + (header.entryCount * sizeof(CacheId)))))
+            {
+                Util::Result palResult = Util::Result::Success;
+
+                for (uint32_t i = 0; (palResult == Util::Result::Success) && (i < header.entryCount); ++i)
+                {
+                    CacheId cacheId = {};
+
+                    palResult = file.Read(&cacheId, sizeof(cacheId), nullptr);
+
+                    if (palResult == Util::Result::Success)
+                    {
+                        palResult = m_previousEntries.PushBack(cacheId);
+                    }
+                }
+
+                if (palResult != Util::Result::Success)
+                {
+                    m_previousEntries.Clear();
+                }
+            }
+
+            file.Close();
+        }
+    }
+}
+
+// =====================================================================================================================
+// Writes the hottest entries of this run to the index, ordered by their first use.  The index is written to a temporary
+// file which then replaces the old index, so concurrent processes and crashes never leave a partial index behind.
+void HotEntryIndex::WriteIndex()
+{
+    Util::MutexAuto lock(&m_lock);
+
+    // A run that didn't look up anything, e.g. one that ended early, keeps the previous index.
+    const uint32_t recordCount = m_accesses.GetNumEntries();
+
+    RankedEntry* pEntries = (recordCount > 0) ?
+        static_cast<RankedEntry*>(m_pInstance->AllocMem(recordCount * sizeof(RankedEntry),
+                                                        VK_SYSTEM_ALLOCATION_SCOPE_OBJECT)) :
+        nullptr;
+
+    if (pEntries != nullptr)
+    {
+        uint32_t entryCount = 0;
+
+        for (auto it = m_accesses.Begin(); it.Get() != nullptr; it.Next())
+        {
+            pEntries[entryCount].cacheId = it.Get()->key;
+            pEntries[entryCount].access  = it.Get()->value;
+            ++entryCount;
+        }
+
+        VK_ASSERT(entryCount == recordCount);
+
+        // Keep the most used entries, preferring the ones needed earlier among equally used ones.
+        std::sort(pEntries, pEntries + entryCount,
+            [](const RankedEntry& lhs, const RankedEntry& rhs)
+            {
+                return (lhs.access.accessCount != rhs.access.accessCount) ?
+                       (lhs.access.accessCount > rhs.access.accessCount) :
+                       (lhs.access.firstAccess < rhs.access.firstAccess);
+            });
+
+        entryCount = Util::Min(entryCount, m_maxEntries);
+
+        // Then prefetch them in the order the application will probably ask for them.
+        std::sort(pEntries, pEntries + entryCount,
+            [](const RankedEntry& lhs, const RankedEntry& rhs)
+            {
+                return lhs.access.firstAccess < rhs.access.firstAccess;
+            });
+
+        char tempPath[PATH_MAX] = {};
+
+        if (Util::Snprintf(tempPath, sizeof(tempPath), "%s.%d.tmp", m_path, static_cast<int>(getpid())) > 0)
+        {
+            Util::File file;
+
+            if (file.Open(tempPath, Util::FileAccessWrite | Util::FileAccessBinary) == Util::Result::Success)
+            {
+                IndexHeader header = {};
+                header.magic       = HotIndexMagic;
+                header.version     = HotIndexVersion;
+                header.entryCount  = entryCount;
+
+                Util::Result palResult = file.Write(&header, sizeof(header));
+
+                for (uint32_t i = 0; (palResult == Util::Result::Success) && (i < entryCount); ++i)
+                {
+                    palResult = file.Write(&pEntries[i].cacheId, sizeof(CacheId));
+                }
+
+                file.Close();
+
+                if ((palResult != Util::Result::Success) || (rename(tempPath, m_path) != 0))
+                {
+                    remove(tempPath);
+                }
+            }
+        }
+
+        m_pInstance->FreeMem(pEntries);
+    }
+}
+
+// =====================================================================================================================
+// Records a lookup of an entry of the cache.
+void HotEntryIndex::RecordAccess(
+    const CacheId* pCacheId)
+{
+    Util::MutexAuto lock(&m_lock);
+
+    AccessRecord* pRecord = m_accesses.FindKey(*pCacheId);
+
+    if (pRecord != nullptr)
+    {
+        ++pRecord->accessCount;
+    }
+    else if (m_accessSequence < (m_maxEntries * MaxRecordsPerEntry))
+    {
+        bool existed = false;
+
+        if (m_accesses.FindAllocate(*pCacheId, &existed, &pRecord) == Util::Result::Success)
+        {
+            pRecord->firstAccess = m_accessSequence++;
+            pRecord->accessCount = 1;
+        }
+    }
+}
+
+// =====================================================================================================================
+// Starts handing the entries of the previous run to the given callback on a background thread.  Does nothing if the
+// previous run left no index.
+VkResult HotEntryIndex::StartPrefetch(
+    PrefetchFunc pfnPrefetch,
+    void*        pContext)
+{
+    VK_ASSERT(m_thread.IsCreated() == false);
+
+    Util::Result palResult = Util::Result::Success;
+
+    if (m_previousEntries.NumElements() > 0)
+    {
+        m_pfnPrefetch      = pfnPrefetch;
+        m_pPrefetchContext = pContext;
+
+        palResult = m_thread.Begin(ThreadFunc, this);
+    }
+
+    return PalToVkResult(palResult);
+}
+
+// =====================================================================================================================
+void HotEntryIndex::ThreadFunc(
+    void* pParam)
+{
+    static_cast<HotEntryIndex*>(pParam)->PrefetchLoop();
+}
+
+// =====================================================================================================================
+void HotEntryIndex::PrefetchLoop()
+{
+    bool proceed = true;
+
+    for (uint32_t i = 0; proceed && (m_stop == false) && (i < m_previousEntries.NumElements()); ++i)
+    {
+        proceed = m_pfnPrefetch(m_pPrefetchContext, &m_previousEntries.At(i));
+
+        Util::AtomicIncrement(&m_prefetchCount);
+    }
+}
+
+} // namespace vk
@@ -0,0 +1,283 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  in_flight_compile_table.cpp
+* @brief Implementation of the table deduplicating concurrent compiles of the same pipeline binary
+***********************************************************************************************************************
+*/
+#include "include/in_flight_compile_table.h"
+#include "include/vk_instance.h"
+
+#include "palHashMapImpl.h"
+
+#include <string.h>
+
+namespace vk
+{
+
+// Number of buckets in the table of in-flight pipeline compiles
+static constexpr uint32_t InFlightCompileBuckets = 32;
+
+// =====================================================================================================================
+InFlightCompileTable::InFlightCompileTable(
+    Instance* pInstance)
+    :
+    m_pInstance(pInstance),
+    m_compiles(InFlightCompileBuckets, pInstance->Allocator()),
+    m_sharedBinaries(InFlightCompileBuckets, pInstance->Allocator())
+{
+}
+
+// =====================================================================================================================
+Util::Result InFlightCompileTable::Init()
+{
+    Util::Result result = m_lock.Init();
+
+    if (result == Util::Result::Success)
+    {
+        result = m_compileDone.Init();
+    }
+
+    if (result == Util::Result::Success)
+    {
+        result = m_compiles.Init();
+    }
+
+    if (result == Util::Result::Success)
+    {
+        result = m_sharedBinaries.Init();
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Called after a cache miss, before compiling a pipeline binary.  If another thread is already compiling the binary
+// with the same cache ID, waits for it and returns its binary instead of compiling the same pipeline twice.  A binary
+// returned this way must be released with ReleaseSharedBinary().
+//
+// Returns true if the caller must compile the binary itself.  In that case, if *ppCompile is not null, the caller must
+// publish its result with End() so that threads which started waiting meanwhile wake up.
+bool InFlightCompileTable::Begin(
+    const Util::MetroHash::Hash* pCacheId,
+    Compile**                    ppCompile,
+    size_t*                      pPipelineBinarySize,
+    const void**                 ppPipelineBinary)
+{
+    Compile* pCompile = nullptr;
+    bool     isOwner  = false;
+
+    m_lock.Lock();
+
+    bool      existed    = false;
+    Compile** ppExisting = nullptr;
+
+    if (m_compiles.FindAllocate(*pCacheId, &existed, &ppExisting) == Util::Result::Success)
+    {
+        if (existed)
+        {
+            pCompile = *ppExisting;
+
+            Util::AtomicIncrement(&pCompile->refCount);
+        }
+        else
+        {
+            void* pMemory = m_pInstance->AllocMem(
+                sizeof(Compile),
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+            if (pMemory != nullptr)
+            {
+                pCompile = VK_PLACEMENT_NEW(pMemory) Compile();
+
+                pCompile->refCount   = 1;
+                pCompile->done       = false;
+                pCompile->result     = VK_INCOMPLETE;
+                pCompile->binarySize = 0;
+                pCompile->pBinary    = nullptr;
+
+                *ppExisting = pCompile;
+                isOwner     = true;
+            }
+            else
+            {
+                // Don't leave a null entry behind; the caller just compiles without deduplication.
+                m_compiles.Erase(*pCacheId);
+            }
+        }
+    }
+
+    bool mustCompile = true;
+
+    if (isOwner)
+    {
+        *ppCompile = pCompile;
+    }
+    else
+    {
+        *ppCompile = nullptr;
+
+        if (pCompile != nullptr)
+        {
+            // Sleep until the compiling thread publishes its result.  A timeout of UINT32_MAX waits without a timeout.
+            while (pCompile->done == false)
+            {
+                m_compileDone.Wait(&m_lock, UINT32_MAX);
+            }
+
+            if (pCompile->result == VK_SUCCESS)
+            {
+                // The reference on the compile is kept until the binary is freed, see ReleaseSharedBinary().
+                *pPipelineBinarySize = pCompile->binarySize;
+                *ppPipelineBinary    = pCompile->pBinary;
+
+                mustCompile = false;
+            }
+        }
+    }
+
+    m_lock.Unlock();
+
+    // If the other compile failed, compile again so that this pipeline reports its own error.
+    if ((pCompile != nullptr) && (isOwner == false) && mustCompile)
+    {
+        Release(pCompile);
+    }
+
+    return mustCompile;
+}
+
+// =====================================================================================================================
+// Publishes the result of a compile started by Begin() to the threads waiting for it.
+void InFlightCompileTable::End(
+    const Util::MetroHash::Hash* pCacheId,
+    Compile*                     pCompile,
+    VkResult                     result,
+    size_t                       pipelineBinarySize,
+    const void*                  pPipelineBinary)
+{
+    m_lock.Lock();
+
+    // Once the entry is removed no other thread can start waiting on it, so the reference count is final here.
+    m_compiles.Erase(*pCacheId);
+
+    const bool hasWaiters = (pCompile->refCount > 1);
+
+    m_lock.Unlock();
+
+    if (hasWaiters)
+    {
+        void* pBinary = nullptr;
+
+        // The compiling thread's binary is freed along with its pipeline, so the waiting threads get a copy.
+        if (result == VK_SUCCESS)
+        {
+            pBinary = m_pInstance->AllocMem(
+                pipelineBinarySize,
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+            if (pBinary != nullptr)
+            {
+                memcpy(pBinary, pPipelineBinary, pipelineBinarySize);
+            }
+            else
+            {
+                result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            }
+        }
+
+        m_lock.Lock();
+
+        if ((pBinary != nullptr) && (m_sharedBinaries.Insert(pBinary, pCompile) != Util::Result::Success))
+        {
+            m_pInstance->FreeMem(pBinary);
+            pBinary = nullptr;
+            result  = VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+
+        pCompile->result     = result;
+        pCompile->binarySize = (pBinary != nullptr) ? pipelineBinarySize : 0;
+        pCompile->pBinary    = pBinary;
+        pCompile->done       = true;
+
+        m_compileDone.WakeAll();
+
+        m_lock.Unlock();
+    }
+
+    Release(pCompile);
+}
+
+// =====================================================================================================================
+// Drops one reference to an in-flight compile, freeing it and its shared binary after the last one.
+void InFlightCompileTable::Release(
+    Compile* pCompile)
+{
+    if (Util::AtomicDecrement(&pCompile->refCount) == 0)
+    {
+        if (pCompile->pBinary != nullptr)
+        {
+            m_lock.Lock();
+            m_sharedBinaries.Erase(pCompile->pBinary);
+            m_lock.Unlock();
+
+            m_pInstance->FreeMem(pCompile->pBinary);
+        }
+
+        Util::Destructor(pCompile);
+        m_pInstance->FreeMem(pCompile);
+    }
+}
+
+// =====================================================================================================================
+// Releases a binary which was handed to a waiting thread by Begin().  Returns false if the binary isn't one of those.
+bool InFlightCompileTable::ReleaseSharedBinary(
+    const void* pPipelineBinary)
+{
+    Compile* pCompile = nullptr;
+
+    m_lock.Lock();
+
+    Compile* const* ppCompile = m_sharedBinaries.FindKey(pPipelineBinary);
+
+    if (ppCompile != nullptr)
+    {
+        pCompile = *ppCompile;
+    }
+
+    m_lock.Unlock();
+
+    if (pCompile != nullptr)
+    {
+        Release(pCompile);
+    }
+
+    return (pCompile != nullptr);
+}
+
+} // namespace vk
@@ -0,0 +1,79 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  api_state_copier.h
+* @brief Helper to copy application structures the driver keeps beyond the API call that passed them in
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/vk_utils.h"
+
+#include "palInlineFuncs.h"
+
+#include <string.h>
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Lays out copies of application structures in one buffer.  With a null buffer it only adds up the size they need, so
+// the same code runs twice: once to size the buffer and once to fill it.
+class ApiStateCopier
+{
+public:
+    ApiStateCopier(void* pBuffer) : m_pBuffer(pBuffer), m_size(0) { }
+
+    // Returns the copy of count elements at pSrc, or null if nothing is copied.
+    template<typename T>
+    T* Copy(const T* pSrc, size_t count)
+    {
+        T* pCopy = nullptr;
+
+        if ((pSrc != nullptr) && (count > 0))
+        {
+            m_size = Util::Pow2Align(m_size, alignof(T));
+
+            if (m_pBuffer != nullptr)
+            {
+                pCopy = static_cast<T*>(Util::VoidPtrInc(m_pBuffer, m_size));
+                memcpy(pCopy, pSrc, sizeof(T) * count);
+            }
+
+            m_size += sizeof(T) * count;
+        }
+
+        return pCopy;
+    }
+
+    size_t GetSize() const { return m_size; }
+
+private:
+    void*  m_pBuffer;
+    size_t m_size;
+};
+
+} // namespace vk
@@ -0,0 +1,123 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_cleaner.h
+* @brief Keeps the pipeline cache directory within its size budget from a background thread
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palEvent.h"
+#include "palThread.h"
+#include "palVector.h"
+
+#include <limits.h>
+#include <time.h>
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// Cleans up the pipeline cache directory against a byte budget.  A dedicated thread scans the directory once it is
+// started and then periodically; whenever the files exceed the budget, it removes idle files, oldest first, until
+// they are comfortably below it again or no file may be removed.
+//
+// This is best effort rather than a budget the directory is held to.  The files the creating cache has open are never
+// removed, however long ago they were used; the cache names them before it starts the cleaner.  PAL archives can't drop
+// single entries and an archive that is open can't be replaced, so the running application's own shards are never
+// retired, and a directory whose running applications alone exceed the budget stays over it.  What the cleaner frees is
+// the archives of applications that haven't run lately.
+//
+// The last use of a file is the later of its access and modification times, which is approximate: reads update the
+// access time at most daily on the usual relatime mounts.  Files used within the minimum idle time are never removed,
+// which also protects the archives that other running processes have open.
+class ArchiveCleaner
+{
+public:
+    static ArchiveCleaner* Create(
+        Instance*   pInstance,
+        const char* pCachePath,
+        uint64_t    budget,
+        uint64_t    minIdleSeconds);
+
+    void Destroy();
+
+    void KeepFile(const char* pFileName);
+
+    VkResult Start();
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(ArchiveCleaner);
+    PAL_DISALLOW_COPY_AND_ASSIGN(ArchiveCleaner);
+
+    // A file of the cache directory
+    struct CacheFile
+    {
+        char     name[NAME_MAX + 1]; // Name of the file within the directory
+        uint64_t size;               // Size of the file in bytes
+        time_t   lastUse;            // Later of the access and modification times
+    };
+
+    using FileVector = Util::Vector<CacheFile, 16, PalAllocator>;
+
+    // Name of a file within the directory which is never removed
+    struct KeptFile
+    {
+        char name[NAME_MAX + 1];
+    };
+
+    using KeptFileVector = Util::Vector<KeptFile, 8, PalAllocator>;
+
+    ArchiveCleaner(Instance* pInstance, uint64_t budget, uint64_t minIdleSeconds);
+    ~ArchiveCleaner();
+
+    VkResult Initialize(const char* pCachePath);
+
+    bool IsKept(const char* pFileName) const;
+
+    void Clean();
+
+    static void ThreadFunc(void* pParam);
+    void CleanerLoop();
+
+    Instance* const m_pInstance;
+    const uint64_t  m_budget;          // Bytes the files of the directory may take up
+    const uint64_t  m_minIdleSeconds;  // Time since the last use before a file may be removed
+    char            m_path[PATH_MAX];  // Cache directory
+    FileVector      m_files;           // Files found by the last scan, reused between scans
+    KeptFileVector  m_keptFiles;       // Files the cache has open
+    bool            m_keepFailed;      // A kept file couldn't be recorded, so the cleaner must not run
+    Util::Thread    m_thread;          // Cleaner thread
+    Util::Event     m_stopEvent;       // Signaled to stop the cleaner thread
+    volatile bool   m_stop;            // Flag to stop the cleaner thread
+};
+
+} // namespace vk
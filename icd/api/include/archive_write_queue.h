@@ -0,0 +1,138 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_write_queue.h
+* @brief Declaration of a write-behind queue in front of the writable pipeline cache archive
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palCacheLayer.h"
+#include "palConditionVariable.h"
+#include "palHashSet.h"
+#include "palList.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+#include "palThread.h"
+#include "palVector.h"
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// Takes archive writes off the threads creating pipelines.  Stored entries are copied into a queue which a dedicated
+// I/O thread drains into the cache layers of the archive shards.  The thread writes everything that queued up while it
+// was busy as one batch, and then syncs each shard file the batch wrote to once.
+//
+// Entries reach the archive through the archive layer's regular Store(), so a crash loses at most the entries that
+// are still queued; it never leaves a partially written entry behind that the archive layer itself wouldn't.  The
+// shard files must be opened without asynchronous file I/O, so that a Store() has handed its data to the kernel by the
+// time the shard is synced.
+class ArchiveWriteQueue
+{
+public:
+    using CacheId = Util::MetroHash::Hash;
+
+    static ArchiveWriteQueue* Create(
+        Instance*                 pInstance,
+        uint32_t                  shardCount,
+        Util::ICacheLayer* const* ppShardLayers,
+        const char*               pFilePath,
+        const char* const*        ppFileNames);
+
+    void Destroy();
+
+    void Drain();
+
+    Util::Result Enqueue(
+        const CacheId* pCacheId,
+        const void*    pData,
+        size_t         dataSize,
+        uint32_t       shard);
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(ArchiveWriteQueue);
+    PAL_DISALLOW_COPY_AND_ASSIGN(ArchiveWriteQueue);
+
+    // Maximum number of bytes waiting in the queue.  Stores beyond this are left to the caller to write synchronously,
+    // which keeps a stalled disk from growing the queue without bound.
+    static constexpr size_t MaxQueuedBytes = 64 * 1024 * 1024;
+
+    struct PendingWrite
+    {
+        CacheId  cacheId;  // ID of the entry
+        void*    pData;    // Copy of the entry data, owned by the queue
+        size_t   dataSize; // Size of the entry data
+        uint32_t shard;    // Archive shard the entry is written to
+    };
+
+    using WriteList = Util::List<PendingWrite, PalAllocator>;
+    using IdSet     = Util::HashSet<CacheId, PalAllocator, Util::JenkinsHashFunc>;
+
+    // Archive shard written by the queue
+    struct Shard
+    {
+        Util::ICacheLayer* pLayer; // Layer the entries of the shard are written to
+        int                syncFd; // Writable descriptor of the shard file used to sync written batches
+        bool               dirty;  // Written to by the current batch
+    };
+
+    using ShardVector = Util::Vector<Shard, 8, PalAllocator>;
+
+    explicit ArchiveWriteQueue(Instance* pInstance);
+    ~ArchiveWriteQueue();
+
+    VkResult Initialize(
+        uint32_t                  shardCount,
+        Util::ICacheLayer* const* ppShardLayers,
+        const char*               pFilePath,
+        const char* const*        ppFileNames);
+
+    bool PopWrite(PendingWrite* pWrite);
+    void WriteBatch();
+
+    static void ThreadFunc(void* pParam);
+    void WriterLoop();
+
+    Instance* const          m_pInstance;
+    ShardVector              m_shards;        // Archive shards the queued entries are written to
+    Util::Thread             m_thread;        // I/O thread
+    WriteList                m_pendingWrites; // Entries waiting to be written, oldest first
+    IdSet                    m_pendingIds;    // IDs of the queued and in-flight entries, to coalesce repeated stores
+    size_t                   m_queuedBytes;   // Bytes of entry data held by the queue
+    bool                     m_busy;          // The I/O thread is writing or syncing a batch
+    bool                     m_stop;          // Flag to stop the I/O thread
+    Util::Mutex              m_lock;          // Protects the queue state above
+    Util::ConditionVariable  m_workQueued;    // Signaled when entries are queued or the queue is destroyed
+    Util::ConditionVariable  m_batchDone;     // Signaled when the I/O thread has written and synced a batch
+};
+
+} // namespace vk
@@ -38,6 +38,7 @@
 #include "vkgcDefs.h"
 
 #include "include/app_shader_optimizer.h"
+#include "include/pipeline_compile_telemetry.h"
 
 #include "palMetroHash.h"
 
@@ -92,7 +93,9 @@ struct GraphicsPipelineCreateInfo
     PipelineCompilerType                   compilerType;
     bool                                   freeWithCompiler;
     Util::MetroHash::Hash                  basePipelineHash;
+    uint64_t                               pipelineHash;         // Hash of pipelineInfo, or 0 if not computed yet
     PipelineCreationFeedback               pipelineFeedback;
+    PipelineCompileRecord                  compileRecord;
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 41
     Vkgc::ResourceMappingData              resourceMapping;
 #endif
@@ -110,7 +113,9 @@ struct ComputePipelineCreateInfo
     PipelineCompilerType                   compilerType;
     bool                                   freeWithCompiler;
     Util::MetroHash::Hash                  basePipelineHash;
+    uint64_t                               pipelineHash;         // Hash of pipelineInfo, or 0 if not computed yet
     PipelineCreationFeedback               pipelineFeedback;
+    PipelineCompileRecord                  compileRecord;
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 41
     Vkgc::ResourceMappingData              resourceMapping;
 #endif
@@ -146,13 +151,18 @@ public:
 
     virtual void FreeShaderModule(ShaderModuleHandle* pShaderModule) = 0;
 
+    virtual bool RetainShaderModule(const ShaderModuleHandle* pShaderModule) = 0;
+
     virtual VkResult CreatePartialPipelineBinary(
         uint32_t                             deviceIdx,
         void*                                pShaderModuleData,
         Vkgc::ShaderModuleEntryData*         pShaderModuleEntryData,
         const Vkgc::ResourceMappingRootNode* pResourceMappingNode,
         uint32_t                             mappingNodeCount,
-        Vkgc::ColorTarget*                   pColorTarget) = 0;
+        Vkgc::ColorTarget*                   pColorTarget,
+        Vkgc::ICache*                        pCache,
+        size_t*                              pPipelineBinarySize,
+        const void**                         ppPipelineBinary) = 0;
 
     virtual VkResult CreateGraphicsPipelineBinary(
         Device*                     pDevice,
@@ -34,6 +34,9 @@
 
 #include "llpc.h"
 
+#include "palHashMap.h"
+#include "palMutex.h"
+
 namespace vk
 {
 
@@ -69,13 +72,18 @@ public:
 
     virtual void FreeShaderModule(ShaderModuleHandle* pShaderModule);
 
+    virtual bool RetainShaderModule(const ShaderModuleHandle* pShaderModule);
+
     virtual VkResult CreatePartialPipelineBinary(
         uint32_t                             deviceIdx,
         void*                                pShaderModuleData,
         Vkgc::ShaderModuleEntryData*         pShaderModuleEntryData,
         const Vkgc::ResourceMappingRootNode* pResourceMappingNode,
         uint32_t                             mappingNodeCount,
-        Vkgc::ColorTarget*                   pColorTarget);
+        Vkgc::ColorTarget*                   pColorTarget,
+        Vkgc::ICache*                        pCache,
+        size_t*                              pPipelineBinarySize,
+        const void**                         ppPipelineBinary);
 
     virtual VkResult CreateGraphicsPipelineBinary(
         Device*                     pDevice,
@@ -111,9 +119,35 @@ public:
 private:
     VkResult CreateLlpcCompiler(Vkgc::ICache* pCache);
 
+    // A built shader module shared by every shader module created from the same code with the same build options
+    struct InternedShaderModule
+    {
+        Util::MetroHash::Hash key;         // Hash of the code and the build options
+        void*                 pModuleData; // Module data built by LLPC
+        uint32_t              refCount;    // Number of ShaderModuleHandles referencing the module data
+    };
+
+    typedef Util::HashMap<Util::MetroHash::Hash, InternedShaderModule*, PalAllocator, Util::JenkinsHashFunc>
+        InternedShaderModuleMap;
+    typedef Util::HashMap<const void*, InternedShaderModule*, PalAllocator> InternedShaderModuleDataMap;
+
+    bool AcquireInternedShaderModule(
+        const Util::MetroHash::Hash& key,
+        void**                       ppModuleData);
+
+    void* InternShaderModule(
+        const Util::MetroHash::Hash& key,
+        void*                        pModuleData);
+
+    bool ReleaseInternedShaderModule(
+        void* pModuleData);
+
 private:
     Llpc::ICompiler*    m_pLlpc;               // LLPC compiler object
 
+    InternedShaderModuleMap     m_internedModules;      // Interned shader modules, keyed by code and options hash
+    InternedShaderModuleDataMap m_internedModuleData;   // Interned shader modules, keyed by their module data
+    Util::Mutex                 m_internLock;           // Protects the interned shader module maps
 };
 
 }
@@ -0,0 +1,134 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  hot_entry_index.h
+* @brief Records which pipeline cache entries an application uses, to prefetch them from the archive in later runs
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+#include "palThread.h"
+#include "palVector.h"
+
+#include <limits.h>
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// A small index file next to the pipeline cache archive that lists the entries an application used most, in the order
+// it first requested them.  During a run, every lookup of the cache is recorded; when the cache is destroyed, the
+// hottest entries are written back to the index.  At startup, a background thread walks the index of the previous run
+// and hands each entry to a prefetch callback, which loads it from the archive into the memory layer before the
+// application asks for it.  This turns the random reads of a cold start into reads the application doesn't wait for.
+class HotEntryIndex
+{
+public:
+    using CacheId = Util::MetroHash::Hash;
+
+    // Prefetches one entry.  Returns false to end prefetching, e.g. once the memory layer is full.
+    typedef bool (*PrefetchFunc)(void* pContext, const CacheId* pCacheId);
+
+    static HotEntryIndex* Create(
+        Instance*   pInstance,
+        const char* pFilePath,
+        const char* pFileName,
+        uint32_t    maxEntries);
+
+    void Destroy();
+
+    void RecordAccess(const CacheId* pCacheId);
+
+    VkResult StartPrefetch(
+        PrefetchFunc pfnPrefetch,
+        void*        pContext);
+
+    uint32_t GetPrefetchCount() const { return m_prefetchCount; }
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(HotEntryIndex);
+    PAL_DISALLOW_COPY_AND_ASSIGN(HotEntryIndex);
+
+    // File header of the index
+    struct IndexHeader
+    {
+        uint32_t magic;      // HotIndexMagic
+        uint32_t version;    // HotIndexVersion
+        uint32_t entryCount; // Number of cache IDs following the header
+        uint32_t reserved;
+    };
+
+    // Use of an entry during this run
+    struct AccessRecord
+    {
+        uint32_t firstAccess; // Sequence number of the first lookup of the entry
+        uint32_t accessCount; // Number of lookups of the entry
+    };
+
+    // Entry of the index as it is written
+    struct RankedEntry
+    {
+        CacheId      cacheId;
+        AccessRecord access;
+    };
+
+    using AccessMap = Util::HashMap<CacheId, AccessRecord, PalAllocator, Util::JenkinsHashFunc>;
+    using IdVector  = Util::Vector<CacheId, 8, PalAllocator>;
+
+    HotEntryIndex(Instance* pInstance, uint32_t maxEntries);
+    ~HotEntryIndex();
+
+    VkResult Initialize(const char* pFullPath);
+
+    void ReadIndex();
+    void WriteIndex();
+
+    static void ThreadFunc(void* pParam);
+    void PrefetchLoop();
+
+    Instance* const   m_pInstance;
+    const uint32_t    m_maxEntries;        // Maximum number of entries written to the index
+    char              m_path[PATH_MAX];    // Full path of the index file
+    IdVector          m_previousEntries;   // Entries of the index written by the previous run, in request order
+    AccessMap         m_accesses;          // Entries used during this run
+    uint32_t          m_accessSequence;    // Number of distinct entries used during this run
+    Util::Mutex       m_lock;              // Protects the access records
+    Util::Thread      m_thread;            // Prefetch thread
+    PrefetchFunc      m_pfnPrefetch;       // Callback loading one entry
+    void*             m_pPrefetchContext;  // Context passed to the callback
+    volatile uint32_t m_prefetchCount;     // Number of entries handed to the callback
+    volatile bool     m_stop;              // Flag to stop the prefetch thread
+};
+
+} // namespace vk
@@ -0,0 +1,100 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  in_flight_compile_table.h
+* @brief Declaration of the table deduplicating concurrent compiles of the same pipeline binary
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palConditionVariable.h"
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// Tracks the pipeline binaries being compiled, keyed by their cache ID.  After a cache miss, the first thread to ask
+// for a cache ID compiles the binary, while the threads asking for it meanwhile wait for the result and share one copy
+// of the binary instead of compiling the same pipeline again.  The copy is freed once the last of them releases it.
+class InFlightCompileTable
+{
+public:
+    // A pipeline binary which is being compiled by one thread while other threads requesting the same cache ID wait
+    // for its result.
+    struct Compile
+    {
+        volatile uint32_t refCount;   // The compiling thread plus every waiting thread which still uses pBinary
+        bool              done;       // Set once the compiling thread has published its result (under m_lock)
+        VkResult          result;     // Result of the compile
+        size_t            binarySize; // Size of pBinary
+        void*             pBinary;    // Copy of the compiled binary, shared by all waiting threads
+    };
+
+    explicit InFlightCompileTable(Instance* pInstance);
+
+    Util::Result Init();
+
+    bool Begin(
+        const Util::MetroHash::Hash* pCacheId,
+        Compile**                    ppCompile,
+        size_t*                      pPipelineBinarySize,
+        const void**                 ppPipelineBinary);
+
+    void End(
+        const Util::MetroHash::Hash* pCacheId,
+        Compile*                     pCompile,
+        VkResult                     result,
+        size_t                       pipelineBinarySize,
+        const void*                  pPipelineBinary);
+
+    bool ReleaseSharedBinary(
+        const void* pPipelineBinary);
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(InFlightCompileTable);
+    PAL_DISALLOW_COPY_AND_ASSIGN(InFlightCompileTable);
+
+    typedef Util::HashMap<Util::MetroHash::Hash, Compile*, PalAllocator, Util::JenkinsHashFunc> CompileMap;
+    typedef Util::HashMap<const void*, Compile*, PalAllocator> SharedBinaryMap;
+
+    void Release(Compile* pCompile);
+
+    Instance* const         m_pInstance;
+    CompileMap              m_compiles;       // Pipeline binaries currently being compiled, keyed by cache ID
+    SharedBinaryMap         m_sharedBinaries; // Binaries handed to waiting threads, mapped to their compile
+    Util::Mutex             m_lock;           // Protects m_compiles, m_sharedBinaries and the done flags
+    Util::ConditionVariable m_compileDone;    // Signaled whenever a compile publishes its result
+};
+
+} // namespace vk
@@ -54,6 +54,7 @@
 // Internal (under development) extension definitions
 
 #include "devext/vk_amd_gpa_interface.h"
+#include "devext/vk_ext_graphics_pipeline_library.h"
 
 #define VK_FORMAT_BEGIN_RANGE VK_FORMAT_UNDEFINED
 #define VK_FORMAT_END_RANGE VK_FORMAT_ASTC_12x12_SRGB_BLOCK
@@ -42,6 +42,7 @@ namespace vk
 enum LogTagId : uint32_t {
     GeneralPrint,
     PipelineCompileTime,
+    PipelineCacheStats,
     LogTagIdCount
 };
 
@@ -49,6 +50,7 @@ static const char* LogTag[LogTagIdCount] =
 {
     "GeneralPrint",
     "PipelineCompileTime",
+    "PipelineCacheStats",
 };
 
 static void AmdvlkLog(
@@ -0,0 +1,106 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  mapped_pipeline_archive.h
+* @brief Declaration of a read-only, memory mapped file of pipeline binaries
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palHashMap.h"
+#include "palMetroHash.h"
+
+namespace Util
+{
+class IPlatformKey;
+} // namespace Util
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// A read-only file of pipeline binaries which is mapped into the address space instead of being read.
+//
+// The file uses the format PipelineBinaryCache::Serialize() produces: a ChecksummedBlobHeader followed by
+// ChecksummedCacheEntry headers, each followed by its binary.  The header must match the platform key of the device;
+// files in the older format, verified by a hash of the whole file, are not accepted.  Beyond that, only the entry
+// headers are touched when the file is opened; binaries are returned as pointers into the mapping, so only the pages of
+// binaries that are actually used get faulted in, and processes mapping the same file share its pages.
+class MappedPipelineArchive
+{
+public:
+    using CacheId = Util::MetroHash::Hash;
+
+    static MappedPipelineArchive* Create(
+        Instance*                 pInstance,
+        const Util::IPlatformKey* pPlatformKey,
+        const char*               pFilePath,
+        const char*               pFileName);
+
+    void Destroy();
+
+    bool FindBinary(
+        const CacheId* pCacheId,
+        size_t*        pPipelineBinarySize,
+        const void**   ppPipelineBinary) const;
+
+    bool ContainsBinary(const void* pPipelineBinary) const;
+
+    uint32_t GetEntryCount() const { return m_entries.GetNumEntries(); }
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(MappedPipelineArchive);
+    PAL_DISALLOW_COPY_AND_ASSIGN(MappedPipelineArchive);
+
+    explicit MappedPipelineArchive(Instance* pInstance);
+    ~MappedPipelineArchive();
+
+    VkResult Initialize(
+        const Util::IPlatformKey* pPlatformKey,
+        const char*               pFullPath);
+
+    VkResult BuildIndex();
+
+    struct Entry
+    {
+        const void* pData;    // Binary inside the mapping
+        size_t      dataSize; // Size of the binary
+    };
+
+    using EntryMap = Util::HashMap<CacheId, Entry, PalAllocator, Util::JenkinsHashFunc>;
+
+    Instance* const m_pInstance;
+    void*           m_pMapping;     // Base address of the mapped file
+    size_t          m_mappingSize;  // Size of the mapped file
+    EntryMap        m_entries;      // Maps cache IDs to binaries inside the mapping
+};
+
+} // namespace vk
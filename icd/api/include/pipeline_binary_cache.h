@@ -31,8 +31,10 @@
 #pragma once
 #include "pipeline_compiler.h"
 
+#include "palConditionVariable.h"
 #include "palHashMap.h"
 #include "palMetroHash.h"
+#include "palThread.h"
 #include "palVector.h"
 #include "palCacheLayer.h"
 #include "cache_adapter.h"
@@ -45,19 +47,72 @@ class IPlatformKey;
 namespace vk
 {
 
+class ArchiveCleaner;
+class ArchiveWriteQueue;
+class HotEntryIndex;
 class CacheAdapter;
+class MappedPipelineArchive;
+class SharedPipelineCache;
 struct BinaryCacheEntry
 {
     Util::MetroHash::Hash hashId;
     size_t                dataSize;
 };
 
+// Header of a pipeline binary which is stored in encoded (compressed) form.  Plain pipeline binaries are ELF files and
+// never start with the marker, so unencoded entries, including every entry of older caches, load as they are.
+struct EncodedBinaryHeader
+{
+    uint32_t marker;      // EncodedBinaryMarker
+    uint32_t encoding;    // PipelineBinaryCompression mode the data following the header is encoded with
+    uint64_t decodedSize; // Size of the pipeline binary once decoded
+};
+
+constexpr uint32_t EncodedBinaryMarker = 0x43425056; // "VPBC"
+
 constexpr size_t SHA_DIGEST_LENGTH = 20;
 struct PipelineBinaryCachePrivateHeader
 {
     uint8_t  hashId[SHA_DIGEST_LENGTH];
 };
 
+// Takes the place of the PipelineBinaryCachePrivateHeader in caches serialized with per-entry checksums instead of a
+// checksum of the whole blob.  The entries of these caches start with a ChecksummedCacheEntry header.
+struct ChecksummedBlobHeader
+{
+    uint32_t marker;         // ChecksummedBlobMarker
+    uint32_t flags;          // ChecksummedBlobFlags
+    uint32_t entryCount;     // Number of entries following the header
+    uint32_t platformKey[2]; // 64-bit key of the platform the blob was serialized on, low half first
+};
+
+static_assert(sizeof(ChecksummedBlobHeader) == sizeof(PipelineBinaryCachePrivateHeader),
+              "Checksummed blobs must keep the layout of the entries that follow the header");
+
+constexpr uint32_t ChecksummedBlobMarker = 0x43455056; // "VPEC"
+
+enum ChecksummedBlobFlags : uint32_t
+{
+    ChecksummedBlobDelta = 0x1, // Only holds the entries added since the previous snapshot
+};
+
+struct ChecksummedCacheEntry
+{
+    Util::MetroHash::Hash hashId;
+    size_t                dataSize;
+    uint64_t              checksum; // MetroHash64 of the hash ID, the data size and the entry data
+};
+
+// Counters describing how well the in-memory layer of a pipeline binary cache is doing
+struct PipelineBinaryCacheStats
+{
+    uint32_t hits;          // Pipeline binary loads that found their binary
+    uint32_t misses;        // Pipeline binary loads that didn't
+    uint32_t evictions;     // Entries evicted from memory to stay within the memory budget
+    uint64_t residentBytes; // Bytes held by tracked in-memory entries (only tracked when a budget is set)
+    uint32_t prefetches;    // Entries of the hot entry index handed to the prefetch thread
+};
+
 // Unified pipeline cache interface
 class PipelineBinaryCache
 {
@@ -77,6 +132,12 @@ public:
         size_t dataSize,
         const void* pData);
 
+    static bool IsValidBlob(
+        Instance*                 pInstance,
+        const Util::IPlatformKey* pPlatformKey,
+        size_t                    dataSize,
+        const void*               pData);
+
     VkResult Initialize(
         const PhysicalDevice* pPhysicalDevice);
 
@@ -89,15 +150,21 @@ public:
         const CacheId* pCacheId);
 
     Util::Result LoadPipelineBinary(
-        const CacheId*  pCacheId,
-        size_t*         pPipelineBinarySize,
-        const void**    ppPipelineBinary) const;
+        const CacheId*     pCacheId,
+        size_t*            pPipelineBinarySize,
+        const void**       ppPipelineBinary,
+        PipelineCacheTier* pCacheTier = nullptr);
 
     Util::Result StorePipelineBinary(
         const CacheId*  pCacheId,
         size_t          pipelineBinarySize,
         const void*     pPipelineBinary);
 
+    Util::Result StoreCacheEntry(
+        const CacheId*  pCacheId,
+        size_t          dataSize,
+        const void*     pData);
+
     Util::Result GetPipelineBinary(
         const Util::QueryResult* pQeuryId,
         void*                    pPipelineBinary) const;
@@ -152,6 +219,10 @@ public:
 
     void FreePipelineBinary(const void* pPipelineBinary);
 
+    void GetStats(PipelineBinaryCacheStats* pStats);
+
+    void DrainArchiveWrites();
+
     void Destroy() { this->~PipelineBinaryCache(); }
 
     CacheAdapter* GetCacheAdapter() { return m_pCacheAdapter; }
@@ -198,11 +269,82 @@ private:
         const PhysicalDevice*  pPhysicalDevice,
         const RuntimeSettings& settings);
 
+    void KeepArchiveFile(const char* pFileName);
+
+#if defined(__unix__)
+    VkResult InitSharedCache(
+        const RuntimeSettings& settings);
+#endif
+
+    void GetDefaultCacheName(
+        char*  pNameBuffer,
+        size_t bufferSize) const;
+
     Util::ICacheLayer*  GetMemoryLayer() const { return m_pMemoryLayer; }
     Util::IArchiveFile* OpenReadOnlyArchive(const char* path, const char* fileName, size_t bufferSize);
-    Util::IArchiveFile* OpenWritableArchive(const char* path, const char* fileName, size_t bufferSize);
+    Util::IArchiveFile* OpenWritableArchive(
+        const char* path,
+        const char* fileName,
+        size_t      bufferSize,
+        bool        allowAsyncFileIo);
     Util::ICacheLayer*  CreateFileLayer(Util::IArchiveFile* pFile);
 
+    Util::Result StoreEntry(
+        const CacheId*  pCacheId,
+        size_t          dataSize,
+        const void*     pData);
+
+    void TrackMemoryEntry(
+        const CacheId*  pCacheId);
+
+    void EnforceMemoryBudget();
+
+    void StoreInitialData(
+        size_t      dataSize,
+        const void* pData);
+
+    bool IsIntactLegacyBlob(
+        size_t      dataSize,
+        const void* pData);
+
+    Util::Result StoreInitialEntry(
+        const ChecksummedCacheEntry* pEntry,
+        const void*                  pEntryData,
+        bool                         checksummed);
+
+    VkResult StartInitialDataIngest(
+        size_t      dataSize,
+        const void* pData);
+
+    static void IngestThreadFunc(void* pParam);
+
+    void IngestInitialData();
+
+    void IngestPendingEntry(
+        const CacheId* pCacheId);
+
+    void WaitForInitialData() const;
+
+    void LogStoredEntry(
+        const CacheId* pCacheId,
+        uint64_t       checksum,
+        bool           initial);
+
+    uint64_t GetEntryChecksum(
+        const CacheId* pCacheId,
+        size_t         dataSize,
+        const void*    pData);
+
+    static bool PrefetchEntry(
+        void*          pContext,
+        const CacheId* pCacheId);
+
+    Util::Result DecodePipelineBinary(
+        const void*  pData,
+        size_t       dataSize,
+        size_t*      pPipelineBinarySize,
+        const void** ppPipelineBinary) const;
+
     // Override the driver's default location
     static constexpr char   EnvVarPath[] = "AMD_VK_PIPELINE_CACHE_PATH";
 
@@ -212,6 +354,9 @@ private:
     // Filename of an additional, read-only archive
     static constexpr char   EnvVarReadOnlyFileName[] = "AMD_VK_PIPELINE_CACHE_READ_ONLY_FILENAME";
 
+    // Filename of a serialized pipeline cache which is mapped into memory and searched before any other layer
+    static constexpr char   EnvVarMappedFileName[] = "AMD_VK_PIPELINE_CACHE_MAPPED_FILENAME";
+
     static const uint32_t   ArchiveType;                // TypeId created by hashed string VK_SHADER_PIPELINE_CACHE
     static const uint32_t   ElfType;                    // TypeId created by hashed string VK_PIPELINE_ELF
 
@@ -239,11 +384,90 @@ private:
     FileVector          m_openFiles;
     LayerVector         m_archiveLayers;
 
+    MappedPipelineArchive* m_pMappedArchive; // Optional memory mapped, read-only file of pipeline binaries
+
+    SharedPipelineCache*   m_pSharedCache;   // Optional cache in shared memory, shared with other processes
+
+    ArchiveWriteQueue*  m_pWriteQueue;       // Writes stored entries to the archive layers in the background
+
+    // Maximum number of shards the writable archive is split into
+    static constexpr uint32_t MaxArchiveShards = 32;
+
+    Util::ICacheLayer*  m_pArchiveShards[MaxArchiveShards]; // Write layer of each archive shard
+    uint32_t            m_archiveShardCount; // Number of archive shards stores are routed to, 0 if they aren't routed
+    ArchiveCleaner*     m_pArchiveCleaner;   // Keeps the cache directory within its size budget
+
+    HotEntryIndex*      m_pHotIndex;         // Records the entries in use and prefetches them in later runs
+
     bool                m_isInternalCache;
 
+    PipelineBinaryCompression m_compression; // Encoding used for newly stored pipeline binaries
+
     CacheAdapter*       m_pCacheAdapter;
 
     Util::Mutex         m_entriesMutex;      // Mutex that will be used to get cache state by Query
+
+    // CLOCK bookkeeping of the entries in the memory layer, which keeps it within m_memoryBudget.  Each entry has a
+    // reference bit that is set on every use; the clock hand clears set bits and evicts entries whose bit is clear.
+    struct ClockEntry
+    {
+        CacheId cacheId;    // ID of the entry
+        size_t  dataSize;   // Bytes the entry takes up in the memory layer
+        bool    referenced; // Used since the clock hand last passed it
+        bool    inUse;      // False if the slot is free
+    };
+
+    using ClockEntryVector = Util::Vector<ClockEntry, 64, PalAllocator>;
+    using ClockSlotVector  = Util::Vector<uint32_t, 64, PalAllocator>;
+    using ClockIndexMap    = Util::HashMap<CacheId, uint32_t, PalAllocator, Util::JenkinsHashFunc>;
+
+    uint64_t            m_memoryBudget;      // Byte budget of the memory layer, 0 if unbounded
+    uint64_t            m_residentBytes;     // Bytes of all tracked entries
+    uint32_t            m_clockHand;         // Next slot the clock hand inspects
+    ClockEntryVector    m_clockEntries;      // Clock slots
+    ClockSlotVector     m_freeClockSlots;    // Indices of free clock slots
+    ClockIndexMap       m_clockIndex;        // Maps cache IDs to clock slots
+    Util::Mutex         m_clockLock;         // Protects the clock bookkeeping
+
+    uint64_t            m_prefetchedBytes;   // Bytes loaded into the memory layer by the prefetch thread
+
+    // Log of the entries stored into an application cache, in the order they were stored.  Snapshots in delta mode
+    // serialize the entries logged since the previous snapshot, and the checksums of entries are computed only once.
+    struct LoggedEntry
+    {
+        CacheId  cacheId;  // ID of the entry
+        uint64_t checksum; // MetroHash64 of the entry data
+        bool     initial;  // The entry came from the initial data, which the application already has
+    };
+
+    using EntryLog      = Util::Vector<LoggedEntry, 64, PalAllocator>;
+    using EntryLogIndex = Util::HashMap<CacheId, uint32_t, PalAllocator, Util::JenkinsHashFunc>;
+
+    bool                m_deltaSnapshots;    // Serialize only the entries added since the previous snapshot
+    EntryLog            m_entryLog;          // Stored entries, oldest first
+    EntryLogIndex       m_entryLogIndex;     // Maps cache IDs to their position in the log
+    uint32_t            m_snapshotEntries;   // Number of logged entries the previous snapshots covered
+    Util::Mutex         m_entryLogLock;      // Protects the entry log
+
+    // The initial data of an application cache is ingested on a thread of its own, so creating the cache doesn't wait
+    // for it.  Lookups meanwhile ingest the single entry they need ahead of the thread, found through an index of the
+    // entries which haven't been ingested yet.
+    using PendingEntryMap = Util::HashMap<CacheId, size_t, PalAllocator, Util::JenkinsHashFunc>;
+
+    bool                m_asyncInitialData;  // Ingest the initial data in the background
+    void*               m_pInitialData;      // Copy of the initial data, while it is being ingested
+    size_t              m_initialDataSize;   // Size of the initial data
+    bool                m_checksummedInit;   // The initial data has per-entry checksums
+    PendingEntryMap     m_pendingEntries;    // Maps IDs of entries not ingested yet to their offset in the data
+    mutable Util::Mutex m_ingestLock;        // Protects the pending entries and keeps the initial data alive
+    Util::Thread        m_ingestThread;      // Ingests the initial data
+    mutable Util::ConditionVariable m_ingestDone; // Signaled once the initial data has been ingested
+    volatile bool       m_ingestPending;     // Initial data is being ingested
+    volatile bool       m_stopIngest;        // Flag to stop the ingest thread
+
+    volatile uint32_t   m_hitCount;          // Number of loads which found their binary
+    volatile uint32_t   m_missCount;         // Number of loads which didn't
+    volatile uint32_t   m_evictionCount;     // Number of entries evicted to stay within the budget
 };
 
 } // namespace vk
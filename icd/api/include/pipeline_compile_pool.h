@@ -0,0 +1,108 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compile_pool.h
+* @brief Declaration of a driver-owned worker pool used to create batches of pipelines in parallel.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+#include "include/vk_utils.h"
+
+#include "palConditionVariable.h"
+#include "palList.h"
+#include "palMutex.h"
+#include "palThread.h"
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// A fixed set of worker threads that execute the indices of a batch in parallel.  The thread submitting a batch also
+// works on it and does not return until every index of the batch has finished, so batch state may live on its stack.
+class PipelineCompilePool
+{
+public:
+    // Callback executed once for every index of a batch
+    typedef void (*WorkFunc)(void* pPayload, uint32_t index);
+
+    static constexpr uint32_t MaxThreads = 16;
+
+    static VkResult Create(
+        Instance*              pInstance,
+        uint32_t               threadCount,
+        PipelineCompilePool**  ppPool);
+
+    void Destroy();
+
+    void Execute(
+        uint32_t count,
+        WorkFunc pfnWork,
+        void*    pPayload);
+
+    VK_INLINE uint32_t GetThreadCount() const
+        { return m_threadCount; }
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(PipelineCompilePool);
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineCompilePool);
+
+    // A batch of work submitted by a single Execute() call
+    struct Batch
+    {
+        WorkFunc          pfnWork;      // Callback executed for each index
+        void*             pPayload;     // Client data passed to the callback
+        uint32_t          count;        // Total number of indices in the batch
+        uint32_t          nextIndex;    // Next index that has not been claimed yet (protected by m_lock)
+        uint32_t          pendingCount; // Number of indices that have not finished executing (protected by m_lock)
+    };
+
+    PipelineCompilePool(Instance* pInstance);
+    ~PipelineCompilePool();
+
+    VkResult Initialize(uint32_t threadCount);
+
+    bool ClaimWork(Batch* pBatch, Batch** ppClaimedBatch, uint32_t* pIndex);
+    void RunWork(Batch* pBatch, uint32_t index);
+
+    static void ThreadFunc(void* pParam);
+    void WorkerLoop();
+
+    Instance* const                  m_pInstance;
+    uint32_t                         m_threadCount;          // Number of running worker threads
+    Util::Thread                     m_threads[MaxThreads];  // Worker threads
+    Util::List<Batch*, PalAllocator> m_batches;              // Batches which still have unclaimed indices
+    Util::Mutex                      m_lock;                 // Protects m_batches, m_stop and the batch counters
+    Util::ConditionVariable          m_workQueued;           // Signaled when a batch is queued or the pool stops
+    Util::ConditionVariable          m_batchDone;            // Signaled when the last index of a batch finishes
+    bool                             m_stop;                 // Flag to stop the worker threads
+};
+
+} // namespace vk
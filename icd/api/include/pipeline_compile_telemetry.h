@@ -0,0 +1,135 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compile_telemetry.h
+* @brief Declaration of per-pipeline compile records kept in a lock-free ring buffer
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_utils.h"
+
+#include "palConditionVariable.h"
+#include "palMutex.h"
+#include "palThread.h"
+
+#include <limits.h>
+
+namespace vk
+{
+
+class Instance;
+
+// Where the binary of a pipeline came from
+enum PipelineCacheTier : uint32_t
+{
+    PipelineCacheTierNone,          // Not found in any cache; the pipeline was compiled
+    PipelineCacheTierApplication,   // The application's VkPipelineCache
+    PipelineCacheTierMemory,        // In-memory layer of the driver's internal cache
+    PipelineCacheTierArchive,       // On-disk archive of the driver's internal cache
+    PipelineCacheTierInFlight,      // Another thread's concurrent compile of the same pipeline
+    PipelineCacheTierShared,        // Shared memory cache of the processes of the application
+    PipelineCacheTierCount
+};
+
+// =====================================================================================================================
+// Per-pipeline compile record.  Times are in CPU performance counter ticks (see Util::GetPerfCpuTime()).
+struct PipelineCompileRecord
+{
+    uint64_t            apiHash;       // Hash of the Vulkan create info
+    uint64_t            pipelineHash;  // Hash of the pipeline build info, which also names pipeline dumps
+    VkPipelineBindPoint bindPoint;     // Graphics or compute
+    PipelineCacheTier   cacheTier;     // Where the binary came from
+    int64_t             convertTime;   // Converting the Vulkan create info to pipeline build info
+    int64_t             hashTime;      // Computing the API, pipeline and cache ID hashes
+    int64_t             cacheTime;     // Looking up and loading the ELF from the caches
+    int64_t             compileTime;   // Compiling the pipeline with LLPC
+    int64_t             palCreateTime; // Creating the Pal::IPipeline and its state objects
+    int64_t             totalTime;     // Whole vkCreate*Pipelines call for this pipeline
+};
+
+// =====================================================================================================================
+// Fixed size ring buffer of the most recent pipeline compile records.  Recording is lock-free, so it can be left on in
+// production without serializing pipeline creation; once the ring is full the oldest records are overwritten.
+//
+// Each slot carries a sequence number which a writer swaps to SlotBusy to claim the slot, and sets to the record's
+// ticket once the record is written.  A writer which finds the slot claimed by another one that wrapped onto it drops
+// its record instead of tearing the other's, and a flush skips records that are being written or were overwritten
+// while being read.
+//
+// Records are appended to the file as they age, every quarter of the ring, so a crash only loses the newest ones.  The
+// file is written by a thread of its own, which recording only wakes, so creating pipelines never waits for file I/O.
+class PipelineCompileTelemetry
+{
+public:
+    PipelineCompileTelemetry();
+
+    VkResult Init(
+        Instance*   pInstance,
+        uint32_t    recordCount,
+        const char* pFilePath);
+
+    void Destroy();
+
+    void Record(const PipelineCompileRecord& record);
+
+    bool IsEnabled() const { return (m_pSlots != nullptr); }
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineCompileTelemetry);
+
+    // Sequence number of a slot which a writer has claimed
+    static constexpr uint32_t SlotBusy = UINT32_MAX;
+
+    struct Slot
+    {
+        volatile uint32_t     sequence; // Sequence number of the record's ticket, zero if empty, or SlotBusy
+        PipelineCompileRecord record;
+    };
+
+    static uint32_t GetSequence(uint64_t ticket);
+
+    static void ThreadFunc(void* pParam);
+
+    void FlushLoop();
+
+    void Flush(uint64_t endTicket);
+
+    Instance*               m_pInstance;
+    Slot*                   m_pSlots;             // Ring of records
+    uint32_t                m_slotMask;           // Number of slots minus one; the number of slots is a power of two
+    volatile uint64_t       m_nextTicket;         // Ticket of the next record, which picks its slot
+    uint64_t                m_flushedTicket;      // Tickets below this one have been appended to the file
+    uint64_t                m_requestedTicket;    // Tickets below this one are due to be appended to the file
+    bool                    m_stop;               // Flag to stop the flush thread
+    Util::Mutex             m_flushLock;          // Protects the requested ticket and the stop flag
+    Util::ConditionVariable m_flushRequested;     // Wakes the flush thread
+    Util::Thread            m_flushThread;        // Appends the records to the file
+    char                    m_filePath[PATH_MAX]; // File the records are appended to
+};
+
+} // namespace vk
@@ -38,6 +38,7 @@
 #include "include/compiler_solution_llpc.h"
 
 #include "include/vk_shader_code.h"
+#include "include/in_flight_compile_table.h"
 
 namespace vk
 {
@@ -51,6 +52,22 @@ struct ShaderModuleHandle;
 
 class PipelineBinaryCache;
 
+// =====================================================================================================================
+// The structures of a graphics pipeline create info that the compiler input and the PAL pipeline state are converted
+// from, collected in one walk of the pNext chains of the create info and of its state create infos.
+struct GraphicsPipelineExtStructs
+{
+    const VkGraphicsPipelineCreateInfo*                          pGraphicsPipelineCreateInfo;
+    const VkPipelineCreationFeedbackCreateInfoEXT*               pPipelineCreationFeedbackCreateInfo;
+    const VkPipelineTessellationDomainOriginStateCreateInfo*     pTessellationDomainOriginState;
+    const VkPipelineRasterizationStateRasterizationOrderAMD*     pRasterizationOrder;
+    const VkPipelineRasterizationConservativeStateCreateInfoEXT* pConservativeRasterizationState;
+    const VkPipelineRasterizationStateStreamCreateInfoEXT*       pRasterizationStreamState;
+    const VkPipelineRasterizationLineStateCreateInfoEXT*         pRasterizationLineState;
+    const VkPipelineRasterizationDepthClipStateCreateInfoEXT*    pDepthClipState;
+    const VkPipelineSampleLocationsStateCreateInfoEXT*           pSampleLocationsState;
+};
+
 // =====================================================================================================================
 class PipelineCompiler
 {
@@ -118,9 +135,14 @@ public:
         const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeadbackCreateInfo,
         const PipelineCreationFeedback*                pPipelineFeedback);
 
+    static void GetGraphicsPipelineExtStructs(
+        const VkGraphicsPipelineCreateInfo* pIn,
+        GraphicsPipelineExtStructs*         pExtStructs);
+
     VkResult ConvertGraphicsPipelineInfo(
         Device*                                         pDevice,
         const VkGraphicsPipelineCreateInfo*             pIn,
+        const GraphicsPipelineExtStructs&               extStructs,
         GraphicsPipelineCreateInfo*                     pInfo,
         VbBindingInfo*                                  pVbInfo,
         const VkPipelineCreationFeedbackCreateInfoEXT** ppPipelineCreationFeadbackCreateInfo);
@@ -133,6 +155,8 @@ public:
 
     void FreeShaderModule(ShaderModuleHandle* pShaderModule);
 
+    bool RetainShaderModule(const ShaderModuleHandle* pShaderModule);
+
     void FreeComputePipelineBinary(
         ComputePipelineCreateInfo* pCreateInfo,
         const void*                pPipelineBinary,
@@ -166,11 +190,19 @@ public:
         Vkgc::PipelineShaderOptions* pShaderOptions
     ) const;
 
+    void ApplyFastCompileOptions(GraphicsPipelineCreateInfo* pCreateInfo) const;
+
     VK_INLINE Vkgc::GfxIpVersion& GetGfxIp() { return m_gfxIp; }
 
+    bool HasSameTarget(const PipelineCompiler& other) const;
+
     void GetElfCacheMetricString(char* pOutStr, size_t outStrSize);
+
+    void RecordPipelineCompile(const PipelineCompileRecord& record) { m_telemetry.Record(record); }
 private:
 
+    static void ApplyFastCompileShaderOptions(Vkgc::PipelineShaderOptions* pShaderOptions);
+
     void ApplyProfileOptions(
         Device*                      pDevice,
         ShaderStage                  stage,
@@ -213,13 +245,14 @@ private:
 
     Util::Result GetCachedPipelineBinary(
         const Util::MetroHash::Hash* pCacheId,
-        const PipelineBinaryCache*   pPipelineBinaryCache,
+        PipelineBinaryCache*         pPipelineBinaryCache,
         size_t*                      pPipelineBinarySize,
         const void**                 ppPipelineBinary,
         bool*                        pIsUserCacheHit,
         bool*                        pIsInternalCacheHit,
         bool*                        pFreeWithCompiler,
-        PipelineCreationFeedback*    pPipelineFeedback);
+        PipelineCreationFeedback*    pPipelineFeedback,
+        PipelineCacheTier*           pCacheTier);
 
     // -----------------------------------------------------------------------------------------------------------------
 
@@ -230,17 +263,31 @@ private:
 
     PipelineBinaryCache* m_pBinaryCache;       // Pipeline binary cache object
 
-    // Metrics
-    uint32_t             m_cacheAttempts;      // Number of attempted cache loads
-    uint32_t             m_cacheHits;          // Number of cache hits
-    uint32_t             m_totalBinaries;      // Total number of binaries compiled or fetched
-    int64_t              m_totalTimeSpent;     // Accumulation of time spent either loading or compiling pipeline
+    InFlightCompileTable m_inFlightCompiles;   // Pipeline binaries currently being compiled
+
+    // Metrics, updated atomically since the pipelines of a batch are created concurrently
+    volatile uint32_t    m_cacheAttempts;      // Number of attempted cache loads
+    volatile uint32_t    m_cacheHits;          // Number of cache hits
+    volatile uint32_t    m_totalBinaries;      // Total number of binaries compiled or fetched
+    volatile uint64_t    m_totalTimeSpent;     // Accumulation of time spent either loading or compiling pipeline
                                                // binaries
+    PipelineCompileTelemetry m_telemetry;      // Records of the most recently created pipelines
 
     void GetPipelineCreationInfoNext(
         const VkStructHeader*                             pHeader,
         const VkPipelineCreationFeedbackCreateInfoEXT**   ppPipelineCreationFeadbackCreateInfo);
 
+    static void ResetPipelineCreationFeedback(
+        const VkPipelineCreationFeedbackCreateInfoEXT*    pPipelineCreationFeadbackCreateInfo);
+
+    void GetPartialPipelineCacheId(
+        uint32_t                           deviceIdx,
+        const void*                        pShaderModuleData,
+        const Vkgc::ShaderModuleEntryData* pShaderModuleEntryData,
+        uint32_t                           mappingNodeCount,
+        const Vkgc::ColorTarget*           pColorTarget,
+        PipelineBinaryCache::CacheId*      pCacheId) const;
+
     static VkPipelineCreateFlags GetCacheIdControlFlags(
         VkPipelineCreateFlags in);
 }; // class PipelineCompiler
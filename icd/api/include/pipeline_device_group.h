@@ -0,0 +1,240 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_device_group.h
+* @brief Creation of the pipeline binaries of every device of a device group.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/compiler_solution.h"
+#include "include/pipeline_compile_pool.h"
+#include "include/pipeline_compiler.h"
+#include "include/vk_device.h"
+
+#include "palMetroHash.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Binaries a device group compiles, and the compile input and result of each of them.  Compiles running concurrently
+// need their own create info because the compiler writes its per compile state into it.
+template<typename CreateInfo>
+struct DeviceGroupCompile
+{
+    Device*                pDevice;
+    PipelineCache*         pPipelineCache;
+    uint32_t               rasterizationStream;               // Graphics pipelines only
+    size_t*                pBinarySizes;                      // Binary size of each device
+    const void**           ppBinaries;                        // Binary of each device
+    Util::MetroHash::Hash* pCacheIds;                         // Cache ID of each device
+    uint32_t               compileCount;                      // Number of binaries to compile
+    uint32_t               deviceIndices[MaxPalDevices];      // Device of each compile
+    CreateInfo             createInfos[MaxPalDevices];        // Compile input of each compile
+    VkResult               results[MaxPalDevices];            // Result of each compile
+};
+
+// =====================================================================================================================
+VK_INLINE VkResult CreatePipelineBinary(
+    const DeviceGroupCompile<GraphicsPipelineCreateInfo>& group,
+    uint32_t                                              deviceIdx,
+    GraphicsPipelineCreateInfo*                           pCreateInfo)
+{
+    return group.pDevice->GetCompiler(deviceIdx)->CreateGraphicsPipelineBinary(
+        group.pDevice,
+        deviceIdx,
+        group.pPipelineCache,
+        pCreateInfo,
+        &group.pBinarySizes[deviceIdx],
+        &group.ppBinaries[deviceIdx],
+        group.rasterizationStream,
+        &group.pCacheIds[deviceIdx]);
+}
+
+// =====================================================================================================================
+VK_INLINE VkResult CreatePipelineBinary(
+    const DeviceGroupCompile<ComputePipelineCreateInfo>& group,
+    uint32_t                                             deviceIdx,
+    ComputePipelineCreateInfo*                           pCreateInfo)
+{
+    return group.pDevice->GetCompiler(deviceIdx)->CreateComputePipelineBinary(
+        group.pDevice,
+        deviceIdx,
+        group.pPipelineCache,
+        pCreateInfo,
+        &group.pBinarySizes[deviceIdx],
+        &group.ppBinaries[deviceIdx],
+        &group.pCacheIds[deviceIdx]);
+}
+
+// =====================================================================================================================
+// Runs one compile of a device group, called by the pipeline compile pool.
+template<typename CreateInfo>
+void CompileDeviceGroupBinary(
+    void*    pPayload,
+    uint32_t index)
+{
+    DeviceGroupCompile<CreateInfo>* pGroup = static_cast<DeviceGroupCompile<CreateInfo>*>(pPayload);
+
+    pGroup->results[index] = CreatePipelineBinary(*pGroup, pGroup->deviceIndices[index], &pGroup->createInfos[index]);
+}
+
+// =====================================================================================================================
+// Creates the pipeline binary of every device of a device group.  A device reuses the binary of an earlier device when
+// no shader reads the device index and both compilers have the same target, so a group of identical GPUs compiles once.
+// Binaries that do differ are compiled concurrently on the pipeline compile pool.
+//
+// A binary already present in ppBinaries (e.g. found by an optimized tier lookup) is kept.  pBinarySources receives
+// the device whose binary each device uses; only devices that are their own source own a binary to free, with the
+// freeWithCompiler flag in pFreeWithCompiler.  pCreateInfo receives the feedback and compile record of the default
+// device, and the feedback of every compile is reported to pFeedbackInfo.
+template<typename CreateInfo>
+VkResult CreateDeviceGroupBinaries(
+    Device*                                        pDevice,
+    PipelineCache*                                 pPipelineCache,
+    CreateInfo*                                    pCreateInfo,
+    uint32_t                                       rasterizationStream,
+    bool                                           readsDeviceIndex,
+    const VkPipelineCreationFeedbackCreateInfoEXT* pFeedbackInfo,
+    size_t*                                        pBinarySizes,
+    const void**                                   ppBinaries,
+    Util::MetroHash::Hash*                         pCacheIds,
+    uint32_t*                                      pBinarySources,
+    bool*                                          pFreeWithCompiler)
+{
+    const uint32_t numPalDevices = pDevice->NumPalDevices();
+    VkResult       result        = VK_SUCCESS;
+
+    DeviceGroupCompile<CreateInfo> group;
+
+    group.pDevice             = pDevice;
+    group.pPipelineCache      = pPipelineCache;
+    group.rasterizationStream = rasterizationStream;
+    group.pBinarySizes        = pBinarySizes;
+    group.ppBinaries          = ppBinaries;
+    group.pCacheIds           = pCacheIds;
+    group.compileCount        = 0;
+
+    for (uint32_t i = 0; i < numPalDevices; ++i)
+    {
+        pBinarySources[i] = i;
+
+        for (uint32_t j = 0; (readsDeviceIndex == false) && (pBinarySources[i] == i) && (j < i); ++j)
+        {
+            if ((pBinarySources[j] == j) && pDevice->GetCompiler(i)->HasSameTarget(*pDevice->GetCompiler(j)))
+            {
+                pBinarySources[i] = j;
+            }
+        }
+
+        if (pBinarySources[i] == i)
+        {
+            if (ppBinaries[i] == nullptr)
+            {
+                group.deviceIndices[group.compileCount++] = i;
+            }
+            else
+            {
+                pFreeWithCompiler[i] = pCreateInfo->freeWithCompiler;
+            }
+        }
+    }
+
+    if (group.compileCount == 1)
+    {
+        // The common single-GPU case compiles on this thread straight from the original create info.
+        const uint32_t deviceIdx = group.deviceIndices[0];
+
+        result = CreatePipelineBinary(group, deviceIdx, pCreateInfo);
+
+        pFreeWithCompiler[deviceIdx] = pCreateInfo->freeWithCompiler;
+    }
+    else if (group.compileCount > 1)
+    {
+        PipelineCompiler*    pDefaultCompiler = pDevice->GetCompiler(DefaultDeviceIndex);
+        PipelineCompilePool* pCompilePool     = pDevice->GetPipelineCompilePool();
+
+        for (uint32_t i = 0; i < group.compileCount; ++i)
+        {
+            // Shallow copies: the copies share the converted shader input that pCreateInfo owns.
+            group.createInfos[i] = *pCreateInfo;
+            group.results[i]     = VK_SUCCESS;
+        }
+
+        if (pCompilePool != nullptr)
+        {
+            pCompilePool->Execute(group.compileCount, CompileDeviceGroupBinary<CreateInfo>, &group);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < group.compileCount; ++i)
+            {
+                CompileDeviceGroupBinary<CreateInfo>(&group, i);
+            }
+        }
+
+        for (uint32_t i = 0; i < group.compileCount; ++i)
+        {
+            const uint32_t deviceIdx = group.deviceIndices[i];
+
+            pFreeWithCompiler[deviceIdx] = group.createInfos[i].freeWithCompiler;
+
+            if (group.results[i] == VK_SUCCESS)
+            {
+                pDefaultCompiler->SetPipelineCreationFeedbackInfo(
+                    pFeedbackInfo,
+                    &group.createInfos[i].pipelineFeedback);
+            }
+            else if (result == VK_SUCCESS)
+            {
+                result = group.results[i];
+            }
+
+            if (deviceIdx == DefaultDeviceIndex)
+            {
+                pCreateInfo->pipelineFeedback = group.createInfos[i].pipelineFeedback;
+                pCreateInfo->compileRecord    = group.createInfos[i].compileRecord;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < numPalDevices; ++i)
+    {
+        const uint32_t source = pBinarySources[i];
+
+        if (source != i)
+        {
+            pBinarySizes[i] = pBinarySizes[source];
+            ppBinaries[i]   = ppBinaries[source];
+            pCacheIds[i]    = pCacheIds[source];
+        }
+    }
+
+    return result;
+}
+
+} // namespace vk
@@ -0,0 +1,118 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_tier_up_queue.h
+* @brief Declaration of the background queue that recompiles tiered graphics pipelines with full optimization
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+#include "include/compiler_solution.h"
+
+#include "palConditionVariable.h"
+#include "palList.h"
+#include "palMutex.h"
+#include "palPipeline.h"
+#include "palThread.h"
+
+namespace vk
+{
+
+class Device;
+class GraphicsPipeline;
+class PipelineBinaryCache;
+class PipelineCache;
+
+// =====================================================================================================================
+// Recompiles tiered graphics pipelines with full optimization on a background thread.
+//
+// A tiered pipeline is first compiled with the fast shader options so that vkCreateGraphicsPipelines returns quickly.
+// Its creator prepares a job holding an optimized copy of the pipeline's compiler input before doing so, and submits
+// the job once the pipeline object exists.  The queue thread compiles the optimized binary, stores it in the internal
+// pipeline binary cache and in the application's pipeline cache, if that still exists, creates a PAL pipeline from it
+// and installs that in the pipeline object.  The pipeline binds the optimized PAL pipeline from then on.
+class PipelineTierUpQueue
+{
+public:
+    struct Job;
+
+    static VkResult Create(
+        Device*               pDevice,
+        PipelineTierUpQueue** ppQueue);
+
+    void Destroy();
+
+    static bool IsTierable(
+        const Device*                       pDevice,
+        const VkGraphicsPipelineCreateInfo* pCreateInfo);
+
+    Job* PrepareJob(
+        const VkGraphicsPipelineCreateInfo* pCreateInfo);
+
+    void SubmitJob(
+        Job*                                   pJob,
+        GraphicsPipeline*                      pPipeline,
+        PipelineCache*                         pPipelineCache,
+        const Pal::GraphicsPipelineCreateInfo& palCreateInfo,
+        uint32_t                               rasterizationStream);
+
+    void DiscardJob(
+        Job* pJob);
+
+    void Cancel(
+        const GraphicsPipeline* pPipeline);
+
+    void ForgetPipelineCache(
+        const PipelineCache* pPipelineCache);
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(PipelineTierUpQueue);
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineTierUpQueue);
+
+    PipelineTierUpQueue(Device* pDevice);
+    ~PipelineTierUpQueue();
+
+    VkResult Initialize();
+
+    Job* PopJob();
+    void RunJob(Job* pJob);
+
+    static void ThreadFunc(void* pParam);
+    void WorkerLoop();
+
+    Device* const                  m_pDevice;
+    Util::Thread                   m_thread;      // Thread compiling the optimized tiers
+    Util::List<Job*, PalAllocator> m_jobs;        // Submitted jobs, oldest first
+    Job*                           m_pRunningJob; // Job being compiled by the thread, if any
+    Util::Mutex                    m_lock;        // Protects m_jobs, m_pRunningJob and the jobs' target pipelines
+                                                  // and pipeline caches
+    Util::ConditionVariable        m_workQueued;  // Signaled when a job is submitted or the thread is to stop
+    volatile bool                  m_stop;        // Flag to stop the thread
+};
+
+} // namespace vk
@@ -0,0 +1,144 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shared_pipeline_cache.h
+* @brief Declaration of a pipeline binary cache in shared memory, shared by the processes of an application
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+
+#include "palMetroHash.h"
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// A fixed size pipeline binary cache in POSIX shared memory.  Every process opening the same name shares the cache, so
+// a binary one process stores is found by all others.  The memory carries the platform key of the process that
+// formatted it, and processes with another key don't use it, since their binaries aren't interchangeable.
+//
+// Entries are inserted without locks: an inserting process reserves space in the data heap with an atomic add, claims
+// an empty hash bucket with a compare-and-swap, copies the binary and then marks the bucket ready.  Readers only use
+// ready buckets, and entries are never removed or moved, so a binary can be read in place for as long as the cache is
+// mapped.  Until the process that created the memory has written the header, the cache reports only misses.
+//
+// Since entries are never removed, a full cache is retired instead: once the heap or a probe sequence is full, or the
+// memory holds binaries of another platform key, its name is unlinked.  Processes mapping it keep using it, and the
+// next process to start creates a new cache under the same name.
+//
+// The cache is not an ICacheLayer in the layer chain.  Layers copy binaries out on every load and evict and link them,
+// while binaries of the shared cache are read in place and stay put.  So it sits beside the chain like the mapped
+// archive: PipelineBinaryCache looks it up after the chain misses and stores every new binary into it as well.
+class SharedPipelineCache
+{
+public:
+    using CacheId = Util::MetroHash::Hash;
+
+    static SharedPipelineCache* Create(
+        Instance*   pInstance,
+        const char* pName,
+        size_t      size,
+        uint64_t    platformKey);
+
+    void Destroy();
+
+    bool FindBinary(
+        const CacheId* pCacheId,
+        size_t*        pDataSize,
+        const void**   ppData) const;
+
+    void StoreBinary(
+        const CacheId* pCacheId,
+        size_t         dataSize,
+        const void*    pData);
+
+    bool ContainsBinary(const void* pPipelineBinary) const;
+
+private:
+    PAL_DISALLOW_DEFAULT_CTOR(SharedPipelineCache);
+    PAL_DISALLOW_COPY_AND_ASSIGN(SharedPipelineCache);
+
+    explicit SharedPipelineCache(Instance* pInstance);
+    ~SharedPipelineCache();
+
+    VkResult Initialize(const char* pName, size_t size, uint64_t platformKey);
+
+    VkResult Map(size_t size);
+    void Unmap();
+
+    bool AcceptHeader(uint64_t platformKey);
+    bool IsReady() const;
+    void Retire();
+
+    // Start of the shared memory.  Everything following it is at a fixed place computed from the size.
+    struct Header
+    {
+        volatile uint32_t magic;          // SharedCacheFormatting while a process writes the header, then
+                                          // SharedCacheMagic
+        volatile uint32_t usedBytes;      // Bytes of the data heap handed out
+        uint32_t          platformKey[2]; // Platform key of the binaries, low dword first; written before the magic
+    };
+
+    // A hash bucket.  All fields but state are written once, by the process that claimed the bucket, before it is
+    // marked ready.
+    struct Bucket
+    {
+        volatile uint32_t state;     // BucketState
+        uint32_t          dataSize;  // Size of the binary
+        uint32_t          offset;    // Offset of the binary in the data heap
+        uint32_t          reserved;
+        CacheId           cacheId;   // ID of the binary
+    };
+
+    enum BucketState : uint32_t
+    {
+        BucketEmpty   = 0,
+        BucketClaimed = 1,
+        BucketReady   = 2,
+    };
+
+    Instance* const        m_pInstance;
+    char                   m_name[256];   // Name of the shared memory
+    uint64_t               m_device;      // Device and inode of the shared memory, to tell it apart from a newer
+    uint64_t               m_inode;       // cache created under the same name
+    uint64_t               m_platformKey; // Platform key of the binaries this process stores
+    void*                  m_pMapping;    // Base address of the shared memory
+    size_t                 m_mappingSize; // Size of the shared memory
+    Header*                m_pHeader;     // Header at the start of the shared memory
+    Bucket*                m_pBuckets;    // Hash buckets following the header
+    uint32_t               m_bucketCount; // Number of hash buckets
+    void*                  m_pHeap;       // Data heap following the buckets
+    uint32_t               m_heapSize;    // Size of the data heap
+    mutable volatile bool  m_ready;       // Whether the header has been written, with this process' platform key
+    volatile uint32_t      m_retired;     // Nonzero once this process has unlinked the full cache
+};
+
+} // namespace vk
@@ -0,0 +1,135 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  vk_deferred_operation.h
+ * @brief Deferred host operation object (VK_KHR_deferred_host_operations) related functionality for Vulkan.
+ ***********************************************************************************************************************
+ */
+
+#ifndef __VK_DEFERRED_OPERATION_H__
+#define __VK_DEFERRED_OPERATION_H__
+
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+#include "include/vk_defines.h"
+#include "include/vk_dispatch.h"
+
+#include "palMutex.h"
+
+namespace vk
+{
+
+class Device;
+
+// =====================================================================================================================
+// A deferred host operation.  A deferrable command splits its work into independent items and attaches them to the
+// operation; application threads then execute those items by joining the operation.
+class DeferredHostOperation : public NonDispatchable<VkDeferredOperationKHR, DeferredHostOperation>
+{
+public:
+    // Executes one work item of the deferred command
+    typedef void (*WorkFunc)(void* pPayload, uint32_t index);
+
+    // Called once after the last work item has finished; returns the result of the deferred command.  The finish
+    // callback owns pPayload and must release it.
+    typedef VkResult (*FinishFunc)(void* pPayload);
+
+    static VkResult Create(
+        Device*                         pDevice,
+        const VkAllocationCallbacks*    pAllocator,
+        VkDeferredOperationKHR*         pDeferredOperation);
+
+    static DeferredHostOperation* FromCreateInfo(const void* pNext);
+
+    void Destroy(
+        Device*                         pDevice,
+        const VkAllocationCallbacks*    pAllocator);
+
+    VkResult Defer(
+        uint32_t                        workCount,
+        WorkFunc                        pfnWork,
+        FinishFunc                      pfnFinish,
+        void*                           pPayload);
+
+    VkResult Join();
+
+    VkResult GetResult() const;
+
+    uint32_t GetMaxConcurrency() const;
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(DeferredHostOperation);
+
+    DeferredHostOperation();
+    ~DeferredHostOperation() { }
+
+    bool ClaimWork(uint32_t* pIndex);
+
+    bool IsComplete() const;
+
+    WorkFunc          m_pfnWork;      // Work item callback of the deferred command
+    FinishFunc        m_pfnFinish;    // Completion callback of the deferred command
+    void*             m_pPayload;     // Client data of the deferred command
+    uint32_t          m_workCount;    // Number of work items in the deferred command
+    uint32_t          m_nextIndex;    // Next work item that has not been claimed yet (protected by m_lock)
+    volatile uint32_t m_pendingCount; // Number of work items that have not finished executing
+    bool              m_complete;     // Set once the finish callback has produced m_result (protected by m_lock)
+    VkResult          m_result;       // Result of the deferred command (protected by m_lock)
+    Util::Mutex       m_lock;         // Protects work item claiming and the completion state
+};
+
+namespace entry
+{
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateDeferredOperationKHR(
+    VkDevice                                    device,
+    const VkAllocationCallbacks*                pAllocator,
+    VkDeferredOperationKHR*                     pDeferredOperation);
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyDeferredOperationKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation,
+    const VkAllocationCallbacks*                pAllocator);
+
+VKAPI_ATTR uint32_t VKAPI_CALL vkGetDeferredOperationMaxConcurrencyKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation);
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetDeferredOperationResultKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation);
+
+VKAPI_ATTR VkResult VKAPI_CALL vkDeferredOperationJoinKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation);
+
+} // namespace entry
+
+} // namespace vk
+
+#endif /* __VK_DEFERRED_OPERATION_H__ */
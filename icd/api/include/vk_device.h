@@ -90,6 +90,8 @@ class DispatchableQueue;
 class Instance;
 class OptLayer;
 class PhysicalDevice;
+class PipelineCompilePool;
+class PipelineTierUpQueue;
 class Queue;
 class SqttMgr;
 class SwapChain;
@@ -550,6 +552,12 @@ public:
     VK_INLINE AsyncLayer* GetAsyncLayer()
         { return m_pAsyncLayer; }
 
+    VK_INLINE PipelineCompilePool* GetPipelineCompilePool()
+        { return m_pPipelineCompilePool; }
+
+    VK_INLINE PipelineTierUpQueue* GetPipelineTierUpQueue()
+        { return m_pPipelineTierUpQueue; }
+
     VK_INLINE Util::Mutex* GetMemoryMutex()
         { return &m_memoryMutex; }
 
@@ -704,6 +712,10 @@ protected:
     OptLayer*                           m_pAppOptLayer;            // State for an app-specific layer, otherwise null
     BarrierFilterLayer*                 m_pBarrierFilterLayer;     // State for enabling barrier filtering, otherwise
                                                                    // null
+    PipelineCompilePool*                m_pPipelineCompilePool;    // Worker threads for batched pipeline creation,
+                                                                   // otherwise null
+    PipelineTierUpQueue*                m_pPipelineTierUpQueue;    // Background compiler of optimized pipeline tiers
+                                                                   // if pipelines are tiered, otherwise null
 
     Util::Mutex                         m_memoryMutex;             // Shared mutex used occasionally by memory objects
 
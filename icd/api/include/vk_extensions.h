@@ -231,6 +231,7 @@ public:
         KHR_BUFFER_DEVICE_ADDRESS,
         KHR_CREATE_RENDERPASS2,
         KHR_DEDICATED_ALLOCATION,
+        KHR_DEFERRED_HOST_OPERATIONS,
         KHR_DEPTH_STENCIL_RESOLVE,
         KHR_DESCRIPTOR_UPDATE_TEMPLATE,
         KHR_DEVICE_GROUP,
@@ -254,6 +255,7 @@ public:
         KHR_MAINTENANCE3,
         KHR_MULTIVIEW,
         KHR_PIPELINE_EXECUTABLE_PROPERTIES,
+        KHR_PIPELINE_LIBRARY,
         KHR_RELAXED_BLOCK_LAYOUT,
         KHR_SAMPLER_MIRROR_CLAMP_TO_EDGE,
         KHR_SAMPLER_YCBCR_CONVERSION,
@@ -288,6 +290,7 @@ public:
         EXT_EXTERNAL_MEMORY_DMA_BUF,
         EXT_EXTERNAL_MEMORY_HOST,
         EXT_GLOBAL_PRIORITY,
+        EXT_GRAPHICS_PIPELINE_LIBRARY,
         EXT_HDR_METADATA,
         EXT_HOST_QUERY_RESET,
         EXT_IMAGE_ROBUSTNESS,
@@ -48,6 +48,7 @@ class Device;
 class PipelineCache;
 class CmdBuffer;
 struct CmdBufferRenderState;
+struct GraphicsPipelineExtStructs;
 
 // Sample pattern structure containing pal format sample locations and sample counts
 // ToDo: Move this struct to different header once render_graph implementation is removed.
@@ -197,6 +198,10 @@ public:
         return m_flags.viewIndexFromDeviceIndex;
     }
 
+    void InstallOptimizedTier(
+        Pal::IPipeline* pPalPipeline,
+        void*           pPalPipelineMem);
+
 protected:
     // Immediate state info that will be written during Bind() but is not
     // encapsulated within a state object.
@@ -289,12 +294,14 @@ protected:
     static void ConvertGraphicsPipelineInfo(
         Device*                             pDevice,
         const VkGraphicsPipelineCreateInfo* pIn,
+        const GraphicsPipelineExtStructs&   extStructs,
         const VbBindingInfo*                pVbInfo,
         CreateInfo*                         pInfo);
 
     static void BuildRasterizationState(
         Device*                                       pDevice,
         const VkPipelineRasterizationStateCreateInfo* pIn,
+        const GraphicsPipelineExtStructs&             extStructs,
         CreateInfo*                                   pInfo,
         const bool                                    dynamicStateFlags[]);
 
@@ -351,6 +358,8 @@ private:
     Pal::IDepthStencilState*  m_pPalDepthStencil[MaxPalDevices];  // PAL depth stencil state object
     VbBindingInfo             m_vbInfo;                           // Information about vertex buffer bindings
 
+    void*                     m_pOptimizedPalPipelineMem;         // Memory of m_pOptimizedPalPipeline
+
     union
     {
         uint8 value;
@@ -362,7 +371,7 @@ private:
             uint8 bindStencilRefMasks      : 1;
             uint8 bindInputAssemblyState   : 1;
             uint8 customSampleLocations    : 1;
-            uint8 reserved1                : 1;
+            uint8 tiered                   : 1;
             uint8 reserved                 : 1;
         };
     } m_flags;
@@ -0,0 +1,122 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  vk_graphics_pipeline_library.h
+ * @brief Graphics pipeline libraries of VK_EXT_graphics_pipeline_library.
+ ***********************************************************************************************************************
+ */
+
+#ifndef __VK_GRAPHICS_PIPELINE_LIBRARY_H__
+#define __VK_GRAPHICS_PIPELINE_LIBRARY_H__
+
+#pragma once
+
+#include "include/vk_pipeline.h"
+#include "include/vk_shader_code.h"
+
+namespace vk
+{
+
+class Device;
+class PipelineCache;
+
+// =====================================================================================================================
+// A graphics pipeline library holds one or more parts of a graphics pipeline: its vertex input, pre-rasterization
+// shaders, fragment shader or fragment output interface.  The library has no PAL pipeline; it keeps copies of the state
+// of its parts, which a pipeline linking it compiles together with the parts of its other libraries.
+class GraphicsPipelineLibrary : public Pipeline, public NonDispatchable<VkPipeline, GraphicsPipelineLibrary>
+{
+public:
+    // Upper bound on the number of distinct dynamic states of a linked pipeline
+    static constexpr uint32_t MaxDynamicStates = 64;
+
+    // A complete graphics pipeline create info assembled from a create info and the libraries it links
+    struct LinkedCreateInfo
+    {
+        VkGraphicsPipelineCreateInfo      createInfo;
+        VkGraphicsPipelineLibraryFlagsEXT libraryFlags;                              // Parts createInfo contains
+        VkPipelineShaderStageCreateInfo   stages[ShaderStage::ShaderStageGfxCount];
+        VkPipelineDynamicStateCreateInfo  dynamicState;
+        VkDynamicState                    dynamicStates[MaxDynamicStates];
+        VkPipelineLayout                  unionLayout;                               // Union of the library layouts,
+                                                                                     // if createInfo uses one
+    };
+
+    static VkResult Create(
+        Device*                                 pDevice,
+        PipelineCache*                          pPipelineCache,
+        const VkGraphicsPipelineCreateInfo*     pCreateInfo,
+        const VkAllocationCallbacks*            pAllocator,
+        VkPipeline*                             pPipeline);
+
+    VkResult Destroy(
+        Device*                         pDevice,
+        const VkAllocationCallbacks*    pAllocator) override;
+
+    static VkGraphicsPipelineLibraryFlagsEXT GetLibraryFlags(
+        const VkGraphicsPipelineCreateInfo*     pCreateInfo);
+
+    static const VkPipelineLibraryCreateInfoKHR* GetLibraryCreateInfo(
+        const VkGraphicsPipelineCreateInfo*     pCreateInfo);
+
+    static VkResult BuildLinkedCreateInfo(
+        Device*                                 pDevice,
+        const VkGraphicsPipelineCreateInfo*     pCreateInfo,
+        const VkAllocationCallbacks*            pAllocator,
+        LinkedCreateInfo*                       pLinkedInfo);
+
+    static void FreeLinkedCreateInfo(
+        Device*                                 pDevice,
+        const VkAllocationCallbacks*            pAllocator,
+        LinkedCreateInfo*                       pLinkedInfo);
+
+    VkGraphicsPipelineLibraryFlagsEXT GetLibraryFlags() const
+        { return m_libraryFlags; }
+
+    // Returns the state of the parts the library holds.  The state of the other parts is left null.  The layout and
+    // render pass are copies the library owns, and the subpass is always 0.
+    const VkGraphicsPipelineCreateInfo* GetCreateInfo() const
+        { return &m_createInfo; }
+
+protected:
+    GraphicsPipelineLibrary(
+        Device* const                           pDevice,
+        VkGraphicsPipelineLibraryFlagsEXT       libraryFlags,
+        const VkGraphicsPipelineCreateInfo&     createInfo,
+        const VkShaderModule*                   pShaderModules);
+
+    void PrecompileFragmentShader(
+        Device*                                 pDevice) const;
+
+    VkGraphicsPipelineLibraryFlagsEXT m_libraryFlags;
+    VkGraphicsPipelineCreateInfo      m_createInfo;    // Copy of the library state, stored after the object
+    VkShaderModule                    m_shaderModules[ShaderStage::ShaderStageGfxCount]; // Shader modules the library
+                                                                                         // created for its stages
+};
+
+} // namespace vk
+
+#endif /* __VK_GRAPHICS_PIPELINE_LIBRARY_H__ */
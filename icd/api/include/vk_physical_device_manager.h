@@ -91,6 +91,8 @@ public:
         uint32_t*                       pPhysicalDeviceCount,
         VkPhysicalDeviceProperties**    ppPhysicalDeviceProperties);
 
+    void DrainPipelineCacheWrites();
+
 protected:
     PhysicalDeviceManager(
         Instance*       pInstance,
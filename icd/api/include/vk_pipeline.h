@@ -139,16 +139,20 @@ public:
         return reinterpret_cast<Pipeline*>(pipeline);
     }
 
+    // Returns the PAL pipeline which is bound on the given device.  Once the optimized tier of a tiered pipeline is
+    // installed, that is the optimized tier, so shader queries and debug names describe the code that runs.
     const Pal::IPipeline* PalPipeline(int32_t idx) const
     {
         VK_ASSERT((idx >= 0) && (idx < static_cast<int32_t>(MaxPalDevices)));
-        return m_pPalPipeline[idx];
+        const Pal::IPipeline* pOptimizedPalPipeline = m_pOptimizedPalPipeline;
+        return (pOptimizedPalPipeline != nullptr) ? pOptimizedPalPipeline : m_pPalPipeline[idx];
     }
 
     Pal::IPipeline* PalPipeline(int32_t idx)
     {
         VK_ASSERT((idx >= 0) && (idx < static_cast<int32_t>(MaxPalDevices)));
-        return m_pPalPipeline[idx];
+        Pal::IPipeline* pOptimizedPalPipeline = m_pOptimizedPalPipeline;
+        return (pOptimizedPalPipeline != nullptr) ? pOptimizedPalPipeline : m_pPalPipeline[idx];
     }
 
     VK_INLINE uint64_t PalPipelineHash() const
@@ -203,6 +207,8 @@ protected:
     Device* const                      m_pDevice;
     UserDataLayout                     m_userDataLayout;
     Pal::IPipeline*                    m_pPalPipeline[MaxPalDevices];
+    Pal::IPipeline* volatile           m_pOptimizedPalPipeline; // Optimized tier of a tiered graphics pipeline, used
+                                                                // instead of m_pPalPipeline once it is compiled
     uint64_t                           m_palPipelineHash; // Unique hash for Pal::Pipeline
     uint32_t                           m_staticStateMask; // Bitfield to detect which subset of pipeline state is
                                                           // static (written at bind-time as opposed to via vkCmd*).
@@ -69,6 +69,9 @@ public:
 
     Pal::ShaderHash GetCodeHash(const char* pEntryPoint) const;
 
+    // Returns true if the code may read the DeviceIndex built-in, i.e. if it compiles differently for each device
+    bool ReadsDeviceIndex() const { return m_readsDeviceIndex; }
+
     void* GetShaderData(PipelineCompilerType compilerType) const
     {
         return GetShaderData(compilerType, &m_handle);
@@ -86,6 +89,7 @@ protected:
     const void*                m_pCode;
     ShaderModuleHandle         m_handle;
     Pal::ShaderHash            m_codeHash;
+    bool                       m_readsDeviceIndex;
 };
 
 namespace entry
@@ -0,0 +1,249 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  mapped_pipeline_archive.cpp
+* @brief Implementation of a read-only, memory mapped file of pipeline binaries
+***********************************************************************************************************************
+*/
+#include "include/mapped_pipeline_archive.h"
+#include "include/pipeline_binary_cache.h"
+#include "include/vk_instance.h"
+
+#include "palHashMapImpl.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vk
+{
+
+// Number of buckets in the entry index
+static constexpr uint32_t EntryMapBuckets = 1024;
+
+// =====================================================================================================================
+// Maps the given file and indexes its entries.  Returns nullptr if the file doesn't exist or isn't a valid file of
+// pipeline binaries for the given platform.
+MappedPipelineArchive* MappedPipelineArchive::Create(
+    Instance*                 pInstance,
+    const Util::IPlatformKey* pPlatformKey,
+    const char*               pFilePath,
+    const char*               pFileName)
+{
+    VK_ASSERT(pFilePath != nullptr);
+    VK_ASSERT(pFileName != nullptr);
+
+    MappedPipelineArchive* pArchive = nullptr;
+
+    char fullPath[PATH_MAX] = {};
+
+    if (Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", pFilePath, pFileName) > 0)
+    {
+        void* pMem = pInstance->AllocMem(sizeof(MappedPipelineArchive), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+        if (pMem != nullptr)
+        {
+            pArchive = VK_PLACEMENT_NEW(pMem) MappedPipelineArchive(pInstance);
+
+            if (pArchive->Initialize(pPlatformKey, fullPath) != VK_SUCCESS)
+            {
+                pArchive->Destroy();
+                pArchive = nullptr;
+            }
+        }
+    }
+
+    return pArchive;
+}
+
+// =====================================================================================================================
+void MappedPipelineArchive::Destroy()
+{
+    Instance* const pInstance = m_pInstance;
+
+    this->~MappedPipelineArchive();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+MappedPipelineArchive::MappedPipelineArchive(
+    Instance* pInstance)
+    :
+    m_pInstance   { pInstance },
+    m_pMapping    { nullptr },
+    m_mappingSize { 0 },
+    m_entries     { EntryMapBuckets, pInstance->Allocator() }
+{
+}
+
+// =====================================================================================================================
+MappedPipelineArchive::~MappedPipelineArchive()
+{
+    if (m_pMapping != nullptr)
+    {
+        munmap(m_pMapping, m_mappingSize);
+    }
+}
+
+// =====================================================================================================================
+VkResult MappedPipelineArchive::Initialize(
+    const Util::IPlatformKey* pPlatformKey,
+    const char*               pFullPath)
+{
+    VkResult result = (m_entries.Init() == Util::Result::Success) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+
+    if (result == VK_SUCCESS)
+    {
+        const int fd = open(pFullPath, O_RDONLY | O_CLOEXEC);
+
+        result = VK_ERROR_INITIALIZATION_FAILED;
+
+        if (fd >= 0)
+        {
+            struct stat fileStat = {};
+
+            if ((fstat(fd, &fileStat) == 0) &&
+                (static_cast<size_t>(fileStat.st_size) > sizeof(PipelineBinaryCachePrivateHeader)))
+            {
+                void* pMapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+                if (pMapping != MAP_FAILED)
+                {
+                    m_pMapping    = pMapping;
+                    m_mappingSize = fileStat.st_size;
+
+                    ChecksummedBlobHeader blobHeader = {};
+                    memcpy(&blobHeader, m_pMapping, sizeof(blobHeader));
+
+                    // Binaries built for another GPU or driver must never reach PAL, so the platform key in the header
+                    // is checked.  Older files without per-entry checksums carry a hash of the platform key and the
+                    // whole file instead, which would have to be read in full to verify it, so they are rejected;
+                    // serializing the cache again writes the current format.
+                    if ((blobHeader.marker == ChecksummedBlobMarker) &&
+                        PipelineBinaryCache::IsValidBlob(m_pInstance, pPlatformKey, m_mappingSize, m_pMapping))
+                    {
+                        // Lookups jump around the file, so don't let the kernel read ahead of the pages that are
+                        // touched.
+                        madvise(m_pMapping, m_mappingSize, MADV_RANDOM);
+
+                        result = BuildIndex();
+                    }
+                }
+            }
+
+            // The mapping stays valid after the descriptor is closed.
+            close(fd);
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Walks the entry headers of the mapped file and records where each binary is.  Per-entry checksums are not verified:
+// that would fault in every binary, which is exactly what mapping the file is meant to avoid.  Every entry is bounds
+// checked instead, and a truncated or malformed file is rejected.
+VkResult MappedPipelineArchive::BuildIndex()
+{
+    VkResult result    = VK_SUCCESS;
+    size_t   offset    = sizeof(PipelineBinaryCachePrivateHeader);
+
+    // Checksummed entry headers start with the fields of the plain ones.
+    const size_t entrySize = sizeof(ChecksummedCacheEntry);
+
+    while ((result == VK_SUCCESS) && (offset < m_mappingSize))
+    {
+        const size_t remaining = m_mappingSize - offset;
+
+        BinaryCacheEntry header = {};
+
+        if (remaining >= entrySize)
+        {
+            // Entries are packed back to back, so the header may not be naturally aligned.
+            memcpy(&header, Util::VoidPtrInc(m_pMapping, offset), sizeof(BinaryCacheEntry));
+        }
+
+        if ((remaining < entrySize) ||
+            (header.dataSize > (remaining - entrySize)))
+        {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        }
+        else
+        {
+            bool   existed = false;
+            Entry* pEntry  = nullptr;
+
+            if (m_entries.FindAllocate(header.hashId, &existed, &pEntry) == Util::Result::Success)
+            {
+                if (existed == false)
+                {
+                    pEntry->pData    = Util::VoidPtrInc(m_pMapping, offset + entrySize);
+                    pEntry->dataSize = header.dataSize;
+                }
+            }
+            else
+            {
+                result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            }
+
+            offset += entrySize + header.dataSize;
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Looks up a binary.  The returned pointer stays valid until the archive is destroyed and must not be freed.
+bool MappedPipelineArchive::FindBinary(
+    const CacheId* pCacheId,
+    size_t*        pPipelineBinarySize,
+    const void**   ppPipelineBinary) const
+{
+    const Entry* pEntry = m_entries.FindKey(*pCacheId);
+
+    if (pEntry != nullptr)
+    {
+        *pPipelineBinarySize = pEntry->dataSize;
+        *ppPipelineBinary    = pEntry->pData;
+    }
+
+    return (pEntry != nullptr);
+}
+
+// =====================================================================================================================
+// Returns true if the given binary was returned by FindBinary().
+bool MappedPipelineArchive::ContainsBinary(
+    const void* pPipelineBinary) const
+{
+    return (m_pMapping != nullptr) &&
+           (pPipelineBinary >= m_pMapping) &&
+           (pPipelineBinary < Util::VoidPtrInc(m_pMapping, m_mappingSize));
+}
+
+} // namespace vk
@@ -28,7 +28,12 @@
 * @brief Implementation of the Vulkan interface for PAL layered caching.
 ***********************************************************************************************************************
 */
+#include "include/archive_cleaner.h"
+#include "include/archive_write_queue.h"
+#include "include/hot_entry_index.h"
+#include "include/mapped_pipeline_archive.h"
 #include "include/pipeline_binary_cache.h"
+#include "include/shared_pipeline_cache.h"
 #include "include/vk_physical_device.h"
 
 #include "palArchiveFile.h"
@@ -46,6 +51,10 @@
 #include <limits.h>
 #include <string.h>
 
+#if ICD_BUILD_LZ4
+#include <lz4.h>
+#endif
+
 namespace vk
 {
 #if defined(__unix__)
@@ -55,6 +64,19 @@ namespace vk
 constexpr char   PipelineBinaryCache::EnvVarPath[];
 constexpr char   PipelineBinaryCache::EnvVarFileName[];
 constexpr char   PipelineBinaryCache::EnvVarReadOnlyFileName[];
+constexpr char   PipelineBinaryCache::EnvVarMappedFileName[];
+
+// Number of buckets in the index of entries tracked for the memory budget
+static constexpr uint32_t ClockIndexBuckets = 256;
+
+// Bytes the prefetch thread loads into the memory layer at most when the layer has no budget
+static constexpr uint64_t MaxUnbudgetedPrefetchBytes = 64ull * 1024 * 1024;
+
+// Number of buckets in the index of the entry log of application caches
+static constexpr uint32_t EntryLogBuckets = 256;
+
+// Number of buckets in the index of initial data entries which haven't been ingested yet
+static constexpr uint32_t PendingEntryBuckets = 256;
 
 static constexpr char   ArchiveTypeString[]  = "VK_SHADER_PIPELINE_CACHE";
 static constexpr size_t ArchiveTypeStringLen = sizeof(ArchiveTypeString);
@@ -107,37 +129,131 @@ static Util::Result CalculateHashId(
     return result;
 }
 
+// =====================================================================================================================
+// Computes the checksum of an entry of a serialized cache.  It covers the entry header as well as the data, so an entry
+// whose ID was corrupted isn't stored under the wrong ID, and a corrupted size is caught before it is trusted.
+static uint64_t ComputeEntryChecksum(
+    const Util::MetroHash::Hash* pHashId,
+    size_t                       dataSize,
+    const void*                  pData)
+{
+    Util::MetroHash64 hasher;
+    uint64_t          checksum = 0;
+
+    hasher.Update(*pHashId);
+    hasher.Update(static_cast<uint64_t>(dataSize));
+    hasher.Update(static_cast<const uint8_t*>(pData), dataSize);
+    hasher.Finalize(reinterpret_cast<uint8_t* const>(&checksum));
+
+    return checksum;
+}
+
+// =====================================================================================================================
+// Reads the header of the entry at the given offset of a serialized cache.  Plain entry headers are the leading fields
+// of the checksummed ones.  Returns false if there is no complete entry at the offset.
+static bool ReadBlobEntry(
+    const void*            pData,
+    size_t                 dataSize,
+    size_t                 offset,
+    size_t                 entrySize,
+    ChecksummedCacheEntry* pEntry)
+{
+    bool complete = false;
+
+    if ((dataSize > offset) && ((dataSize - offset) > entrySize))
+    {
+        // Entries are packed back to back, so the header may not be naturally aligned.
+        memcpy(pEntry, Util::VoidPtrInc(pData, offset), entrySize);
+
+        complete = (pEntry->dataSize <= (dataSize - offset - entrySize));
+    }
+
+    return complete;
+}
+
+// =====================================================================================================================
+// Returns true if the entries of a serialized cache end exactly at the end of the blob.  Only the entry headers are
+// read.
+static bool EntriesSpanBlob(
+    const void* pData,
+    size_t      dataSize,
+    size_t      entrySize)
+{
+    ChecksummedCacheEntry entry  = {};
+    size_t                offset = sizeof(PipelineBinaryCachePrivateHeader);
+
+    while (ReadBlobEntry(pData, dataSize, offset, entrySize, &entry))
+    {
+        offset += entrySize + entry.dataSize;
+    }
+
+    return (offset == dataSize);
+}
+
+// =====================================================================================================================
+// Checks whether a blob is a serialized cache.  Blobs with per-entry checksums have the platform key in their header
+// checked; their entries are verified as they are ingested.  Older blobs carry a hash of the platform key and the whole
+// blob instead, which takes reading all of it, so only their entry headers are checked here and the hash is verified
+// by the cache before it ingests them, on the ingest thread if the data is ingested in the background.
 bool PipelineBinaryCache::IsValidBlob(
     const PhysicalDevice* pPhysicalDevice,
     size_t dataSize,
     const void* pData)
 {
-    bool     isValid            = false;
-    size_t   blobSize           = dataSize;
-    auto pBinaryPrivateHeader   = static_cast<const PipelineBinaryCachePrivateHeader*>(pData);
-    uint8_t  hashId[SHA_DIGEST_LENGTH];
+    return IsValidBlob(pPhysicalDevice->Manager()->VkInstance(), pPhysicalDevice->GetPlatformKey(), dataSize, pData);
+}
+
+// =====================================================================================================================
+bool PipelineBinaryCache::IsValidBlob(
+    Instance*                 pInstance,
+    const Util::IPlatformKey* pPlatformKey,
+    size_t                    dataSize,
+    const void*               pData)
+{
+    bool isValid = false;
 
-    pData         = Util::VoidPtrInc(pData, sizeof(PipelineBinaryCachePrivateHeader));
-    blobSize     -= sizeof(PipelineBinaryCachePrivateHeader);
+    ChecksummedBlobHeader checksummedHeader = {};
 
-    if (pPhysicalDevice->GetPlatformKey() != nullptr)
+    if ((dataSize >= sizeof(PipelineBinaryCachePrivateHeader)) && (pPlatformKey != nullptr))
     {
-        Util::Result        result          = CalculateHashId(
-                                                pPhysicalDevice->Manager()->VkInstance(),
-                                                pPhysicalDevice->GetPlatformKey(),
-                                                pData,
-                                                blobSize,
-                                                hashId);
+        memcpy(&checksummedHeader, pData, sizeof(checksummedHeader));
 
-        if (result == Util::Result::Success)
+        if (checksummedHeader.marker == ChecksummedBlobMarker)
         {
-            isValid = (memcmp(hashId, pBinaryPrivateHeader->hashId, SHA_DIGEST_LENGTH) == 0);
+            const uint64_t platformKey = pPlatformKey->GetKey64();
+
+            isValid = (checksummedHeader.platformKey[0] == Util::LowPart(platformKey)) &&
+                      (checksummedHeader.platformKey[1] == Util::HighPart(platformKey));
+        }
+        else
+        {
+            isValid = EntriesSpanBlob(pData, dataSize, sizeof(BinaryCacheEntry));
         }
     }
 
     return isValid;
 }
 
+// =====================================================================================================================
+// Verifies the hash of the platform key and the whole blob which serialized caches without per-entry checksums carry.
+bool PipelineBinaryCache::IsIntactLegacyBlob(
+    size_t      dataSize,
+    const void* pData)
+{
+    auto    pBinaryPrivateHeader = static_cast<const PipelineBinaryCachePrivateHeader*>(pData);
+    uint8_t hashId[SHA_DIGEST_LENGTH];
+
+    const Util::Result result = CalculateHashId(
+                                    m_pInstance,
+                                    m_pPlatformKey,
+                                    Util::VoidPtrInc(pData, sizeof(PipelineBinaryCachePrivateHeader)),
+                                    dataSize - sizeof(PipelineBinaryCachePrivateHeader),
+                                    hashId);
+
+    return (result == Util::Result::Success) &&
+           (memcmp(hashId, pBinaryPrivateHeader->hashId, SHA_DIGEST_LENGTH) == 0);
+}
+
 // =====================================================================================================================
 // Allocate and initialize a PipelineBinaryCache object
 PipelineBinaryCache* PipelineBinaryCache::Create(
@@ -163,33 +279,11 @@ PipelineBinaryCache* PipelineBinaryCache::Create(
         else if ((pInitData != nullptr) &&
                  (initDataSize > (sizeof(BinaryCacheEntry) + sizeof(PipelineBinaryCachePrivateHeader))))
         {
-            const void* pBlob           = pInitData;
-            size_t   blobSize           = initDataSize;
-            constexpr size_t EntrySize  = sizeof(BinaryCacheEntry);
-
-            pBlob         = Util::VoidPtrInc(pBlob, sizeof(PipelineBinaryCachePrivateHeader));
-            blobSize     -= sizeof(PipelineBinaryCachePrivateHeader);
-            while (blobSize > EntrySize)
+            // Fall back to ingesting the data right away if it can't be done in the background.
+            if ((pObj->m_asyncInitialData == false) ||
+                (pObj->StartInitialDataIngest(initDataSize, pInitData) != VK_SUCCESS))
             {
-                const BinaryCacheEntry* pEntry  = static_cast<const BinaryCacheEntry*>(pBlob);
-                const void*             pData   = Util::VoidPtrInc(pBlob, sizeof(BinaryCacheEntry));
-                const size_t entryAndDataSize   = pEntry->dataSize + sizeof(BinaryCacheEntry);
-
-                if (blobSize >= entryAndDataSize)
-                {
-                    //add to cache
-                    Util::Result result = pObj->StorePipelineBinary(&pEntry->hashId, pEntry->dataSize, pData);
-                    if (result != Util::Result::Success)
-                    {
-                        break;
-                    }
-                    pBlob = Util::VoidPtrInc(pBlob, entryAndDataSize);
-                    blobSize -= entryAndDataSize;
-                }
-                else
-                {
-                    break;
-                }
+                pObj->StoreInitialData(initDataSize, pInitData);
             }
         }
     }
@@ -213,8 +307,37 @@ PipelineBinaryCache::PipelineBinaryCache(
     m_pArchiveLayer    { nullptr },
     m_openFiles        { pInstance->Allocator() },
     m_archiveLayers    { pInstance->Allocator() },
+    m_pMappedArchive   { nullptr },
+    m_pSharedCache     { nullptr },
+    m_pWriteQueue      { nullptr },
+    m_pArchiveShards   {},
+    m_archiveShardCount{ 0 },
+    m_pArchiveCleaner  { nullptr },
+    m_pHotIndex        { nullptr },
     m_isInternalCache  { internal },
-    m_pCacheAdapter    { nullptr }
+    m_compression      { PipelineBinaryCompressionNone },
+    m_pCacheAdapter    { nullptr },
+    m_memoryBudget     { 0 },
+    m_residentBytes    { 0 },
+    m_clockHand        { 0 },
+    m_clockEntries     { pInstance->Allocator() },
+    m_freeClockSlots   { pInstance->Allocator() },
+    m_clockIndex       { ClockIndexBuckets, pInstance->Allocator() },
+    m_prefetchedBytes  { 0 },
+    m_deltaSnapshots   { false },
+    m_entryLog         { pInstance->Allocator() },
+    m_entryLogIndex    { EntryLogBuckets, pInstance->Allocator() },
+    m_snapshotEntries  { 0 },
+    m_asyncInitialData { false },
+    m_pInitialData     { nullptr },
+    m_initialDataSize  { 0 },
+    m_checksummedInit  { false },
+    m_pendingEntries   { PendingEntryBuckets, pInstance->Allocator() },
+    m_ingestPending    { false },
+    m_stopIngest       { false },
+    m_hitCount         { 0 },
+    m_missCount        { 0 },
+    m_evictionCount    { 0 }
 {
     // Without copy constructor, a class type variable can't be initialized in initialization list with gcc 4.8.5.
     // Initialize m_gfxIp here instead to make gcc 4.8.5 work.
@@ -224,12 +347,40 @@ PipelineBinaryCache::PipelineBinaryCache(
 // =====================================================================================================================
 PipelineBinaryCache::~PipelineBinaryCache()
 {
+    // Stop ingesting the initial data before the layers go away.
+    m_stopIngest = true;
+
+    if (m_ingestThread.IsCreated())
+    {
+        m_ingestThread.Join();
+    }
+
+    if (m_pArchiveCleaner != nullptr)
+    {
+        m_pArchiveCleaner->Destroy();
+        m_pArchiveCleaner = nullptr;
+    }
+
+    // Stop prefetching before the layers go away.
+    if (m_pHotIndex != nullptr)
+    {
+        m_pHotIndex->Destroy();
+        m_pHotIndex = nullptr;
+    }
+
     if (m_pCacheAdapter != nullptr)
     {
         m_pCacheAdapter->Destroy();
         m_pCacheAdapter = nullptr;
     }
 
+    // Write out the queued entries while the archive is still open.
+    if (m_pWriteQueue != nullptr)
+    {
+        m_pWriteQueue->Destroy();
+        m_pWriteQueue = nullptr;
+    }
+
     for (FileVector::Iter i = m_openFiles.Begin(); i.IsValid(); i.Next())
     {
         i.Get()->Destroy();
@@ -246,6 +397,20 @@ PipelineBinaryCache::~PipelineBinaryCache()
 
     m_archiveLayers.Clear();
 
+    if (m_pMappedArchive != nullptr)
+    {
+        m_pMappedArchive->Destroy();
+        m_pMappedArchive = nullptr;
+    }
+
+#if defined(__unix__)
+    if (m_pSharedCache != nullptr)
+    {
+        m_pSharedCache->Destroy();
+        m_pSharedCache = nullptr;
+    }
+#endif
+
     if (m_pMemoryLayer != nullptr)
     {
         m_pMemoryLayer->Destroy();
@@ -270,6 +435,13 @@ Util::Result PipelineBinaryCache::QueryPipelineBinary(
 {
     VK_ASSERT(m_pTopLayer != nullptr);
 
+    if (m_pHotIndex != nullptr)
+    {
+        m_pHotIndex->RecordAccess(pCacheId);
+    }
+
+    IngestPendingEntry(pCacheId);
+
     uint32_t policy = Util::ICacheLayer::LinkPolicy::LoadOnQuery;
     // We have to make sure the Query is atomic, otherwise we could get unexpected result while running multi-thread
     // test case.
@@ -277,67 +449,798 @@ Util::Result PipelineBinaryCache::QueryPipelineBinary(
     Util::Result result = m_pTopLayer->Query(pCacheId, policy, flags, pQuery);
     m_entriesMutex.Unlock();
 
-    return result;
+    return result;
+}
+
+// =====================================================================================================================
+// Query if a pipeline binary exists in cache
+// Must call ReleaseCacheRef() when the flags contains AcquireEntryRef
+Util::Result PipelineBinaryCache::WaitPipelineBinary(
+    const CacheId*     pCacheId)
+{
+    VK_ASSERT(m_pTopLayer != nullptr);
+
+    return m_pTopLayer->WaitForEntry(pCacheId);
+}
+// =====================================================================================================================
+// Attempt to load a graphics pipeline binary from cache.  The binary must be released with FreePipelineBinary().  If
+// pCacheTier is given, it receives whether the binary was found in memory or in an archive.
+Util::Result PipelineBinaryCache::LoadPipelineBinary(
+    const CacheId*     pCacheId,
+    size_t*            pPipelineBinarySize,
+    const void**       ppPipelineBinary,
+    PipelineCacheTier* pCacheTier)
+{
+    VK_ASSERT(m_pTopLayer != nullptr);
+
+    Util::Result result = Util::Result::Success;
+
+    if (m_pHotIndex != nullptr)
+    {
+        m_pHotIndex->RecordAccess(pCacheId);
+    }
+
+    IngestPendingEntry(pCacheId);
+
+    size_t      mappedSize  = 0;
+    const void* pMappedData = nullptr;
+
+    // Binaries in the mapped archive are handed out in place, without a copy, unless they need to be decoded.
+    if ((m_pMappedArchive != nullptr) &&
+        m_pMappedArchive->FindBinary(pCacheId, &mappedSize, &pMappedData))
+    {
+        result = DecodePipelineBinary(pMappedData, mappedSize, pPipelineBinarySize, ppPipelineBinary);
+
+        if (pCacheTier != nullptr)
+        {
+            *pCacheTier = PipelineCacheTierArchive;
+        }
+    }
+    else
+    {
+        Util::QueryResult query = {};
+
+        result = m_pTopLayer->Query(pCacheId, 0, 0, &query);
+
+        size_t      sharedSize  = 0;
+        const void* pSharedData = nullptr;
+        bool        foundShared = false;
+
+#if defined(__unix__)
+        // Binaries another process of the application compiled are handed out in place as well.
+        foundShared = (result != Util::Result::Success) &&
+                      (m_pSharedCache != nullptr)        &&
+                      m_pSharedCache->FindBinary(pCacheId, &sharedSize, &pSharedData);
+#endif
+
+        if (foundShared)
+        {
+            result = DecodePipelineBinary(pSharedData, sharedSize, pPipelineBinarySize, ppPipelineBinary);
+
+            if (pCacheTier != nullptr)
+            {
+                *pCacheTier = PipelineCacheTierShared;
+            }
+        }
+        else if (result == Util::Result::Success)
+        {
+            if (pCacheTier != nullptr)
+            {
+                *pCacheTier = (query.pLayer == m_pMemoryLayer) ? PipelineCacheTierMemory : PipelineCacheTierArchive;
+            }
+
+            void* pOutputMem = m_pInstance->AllocMem(
+                query.dataSize,
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+            if (pOutputMem != nullptr)
+            {
+                result = m_pTopLayer->Load(&query, pOutputMem);
+
+                if (result == Util::Result::Success)
+                {
+                    // Counts against the budget only if the entry is in the memory layer, either already or loaded
+                    // into it from an archive.
+                    TrackMemoryEntry(pCacheId);
+
+                    result = DecodePipelineBinary(pOutputMem, query.dataSize, pPipelineBinarySize, ppPipelineBinary);
+                }
+
+                // Unless the entry was stored as-is, the caller gets a separately allocated, decoded binary.
+                if ((result != Util::Result::Success) || (*ppPipelineBinary != pOutputMem))
+                {
+                    m_pInstance->FreeMem(pOutputMem);
+                }
+            }
+            else
+            {
+                result = Util::Result::ErrorOutOfMemory;
+            }
+        }
+    }
+
+    Util::AtomicIncrement((result == Util::Result::Success) ? &m_hitCount : &m_missCount);
+
+    return result;
+}
+
+// =====================================================================================================================
+// Returns the pipeline binary stored in a cache entry.  Entries stored without encoding are returned in place; encoded
+// entries are decoded into a new allocation which is released with FreePipelineBinary().
+Util::Result PipelineBinaryCache::DecodePipelineBinary(
+    const void*  pData,
+    size_t       dataSize,
+    size_t*      pPipelineBinarySize,
+    const void** ppPipelineBinary) const
+{
+    Util::Result        result = Util::Result::Success;
+    EncodedBinaryHeader header = {};
+
+    if (dataSize >= sizeof(EncodedBinaryHeader))
+    {
+        // Entries in mapped files are packed back to back, so the header may not be naturally aligned.
+        memcpy(&header, pData, sizeof(EncodedBinaryHeader));
+    }
+
+    if (header.marker != EncodedBinaryMarker)
+    {
+        *pPipelineBinarySize = dataSize;
+        *ppPipelineBinary    = pData;
+    }
+    else
+    {
+        // An encoding this build can't decode is treated like a miss, so the pipeline just gets compiled again.
+        result = Util::Result::NotFound;
+
+#if ICD_BUILD_LZ4
+        const size_t encodedSize = dataSize - sizeof(EncodedBinaryHeader);
+
+        if ((header.encoding == PipelineBinaryCompressionLz4) &&
+            (encodedSize <= INT_MAX) &&
+            (header.decodedSize <= INT_MAX))
+        {
+            void* pOutputMem = m_pInstance->AllocMem(
+                static_cast<size_t>(header.decodedSize),
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+            if (pOutputMem != nullptr)
+            {
+                const int decodedSize = LZ4_decompress_safe(
+                    static_cast<const char*>(Util::VoidPtrInc(pData, sizeof(EncodedBinaryHeader))),
+                    static_cast<char*>(pOutputMem),
+                    static_cast<int>(encodedSize),
+                    static_cast<int>(header.decodedSize));
+
+                if (decodedSize == static_cast<int>(header.decodedSize))
+                {
+                    *pPipelineBinarySize = decodedSize;
+                    *ppPipelineBinary    = pOutputMem;
+
+                    result = Util::Result::Success;
+                }
+                else
+                {
+                    m_pInstance->FreeMem(pOutputMem);
+
+                    result = Util::Result::ErrorInvalidValue;
+                }
+            }
+            else
+            {
+                result = Util::Result::ErrorOutOfMemory;
+            }
+        }
+#endif
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Attempt to store a pipeline binary into a cache chain, encoded as selected by the PipelineBinaryCompression setting
+Util::Result PipelineBinaryCache::StorePipelineBinary(
+    const CacheId*  pCacheId,
+    size_t          pipelineBinarySize,
+    const void*     pPipelineBinary)
+{
+    VK_ASSERT(m_pTopLayer != nullptr);
+
+    Util::Result result = Util::Result::Success;
+    bool         stored = false;
+
+#if ICD_BUILD_LZ4
+    if ((m_compression == PipelineBinaryCompressionLz4) && (pipelineBinarySize <= LZ4_MAX_INPUT_SIZE))
+    {
+        const int    maxEncodedSize = LZ4_compressBound(static_cast<int>(pipelineBinarySize));
+        void* const  pEncoded       = m_pInstance->AllocMem(
+            sizeof(EncodedBinaryHeader) + maxEncodedSize,
+            VK_DEFAULT_MEM_ALIGN,
+            VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+
+        if (pEncoded != nullptr)
+        {
+            const int encodedSize = LZ4_compress_default(
+                static_cast<const char*>(pPipelineBinary),
+                static_cast<char*>(Util::VoidPtrInc(pEncoded, sizeof(EncodedBinaryHeader))),
+                static_cast<int>(pipelineBinarySize),
+                maxEncodedSize);
+
+            const size_t entrySize = sizeof(EncodedBinaryHeader) + encodedSize;
+
+            // Binaries which don't shrink are stored as they are.
+            if ((encodedSize > 0) && (entrySize < pipelineBinarySize))
+            {
+                EncodedBinaryHeader* pHeader = static_cast<EncodedBinaryHeader*>(pEncoded);
+
+                pHeader->marker      = EncodedBinaryMarker;
+                pHeader->encoding    = PipelineBinaryCompressionLz4;
+                pHeader->decodedSize = pipelineBinarySize;
+
+                result = StoreEntry(pCacheId, entrySize, pEncoded);
+                stored = true;
+            }
+
+            m_pInstance->FreeMem(pEncoded);
+        }
+    }
+#endif
+
+    if (stored == false)
+    {
+        result = StoreEntry(pCacheId, pipelineBinarySize, pPipelineBinary);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Attempt to store cache entry data into a cache chain as-is.  This is used for data which is not a pipeline binary,
+// and for entries copied from another cache, which are already encoded.
+Util::Result PipelineBinaryCache::StoreCacheEntry(
+    const CacheId*  pCacheId,
+    size_t          dataSize,
+    const void*     pData)
+{
+    VK_ASSERT(m_pTopLayer != nullptr);
+
+    return StoreEntry(pCacheId, dataSize, pData);
+}
+
+// =====================================================================================================================
+// Stores entry data into the cache chain and accounts for it in the memory budget
+Util::Result PipelineBinaryCache::StoreEntry(
+    const CacheId*  pCacheId,
+    size_t          dataSize,
+    const void*     pData)
+{
+    Util::Result result = m_pTopLayer->Store(pCacheId, pData, dataSize);
+
+    if (result == Util::Result::Success)
+    {
+        TrackMemoryEntry(pCacheId);
+
+        if (m_isInternalCache == false)
+        {
+            bool logged = false;
+
+            {
+                Util::MutexAuto lock(&m_entryLogLock);
+
+                logged = (m_entryLogIndex.FindKey(*pCacheId) != nullptr);
+            }
+
+            // Entries of the initial data are logged before they are stored, with the checksum they were verified
+            // with, so they aren't hashed twice.
+            if (logged == false)
+            {
+                LogStoredEntry(pCacheId, ComputeEntryChecksum(pCacheId, dataSize, pData), false);
+            }
+        }
+
+        // With archive shards, the memory layer doesn't pass stores down and the archive copy is written here, to the
+        // shard the entry hashes to.  If the queue can't take the entry, write it synchronously rather than dropping
+        // it from the archive.
+        if (m_archiveShardCount > 0)
+        {
+            const uint32_t shard = pCacheId->dwords[0] % m_archiveShardCount;
+
+            if ((m_pWriteQueue == nullptr) ||
+                (m_pWriteQueue->Enqueue(pCacheId, pData, dataSize, shard) != Util::Result::Success))
+            {
+                m_pArchiveShards[shard]->Store(pCacheId, pData, dataSize);
+            }
+        }
+
+#if defined(__unix__)
+        if (m_pSharedCache != nullptr)
+        {
+            m_pSharedCache->StoreBinary(pCacheId, dataSize, pData);
+        }
+#endif
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Loads an entry of the archive into the memory layer ahead of its first use.  Called on the prefetch thread of the hot
+// entry index.  Returns false once the memory layer is full, since further prefetches would only evict entries.
+// Without a memory budget the layer is unbounded, so prefetching stops after MaxUnbudgetedPrefetchBytes instead.
+bool PipelineBinaryCache::PrefetchEntry(
+    void*          pContext,
+    const CacheId* pCacheId)
+{
+    PipelineBinaryCache* const pCache = static_cast<PipelineBinaryCache*>(pContext);
+
+    bool proceed = true;
+
+    size_t      mappedSize  = 0;
+    const void* pMappedData = nullptr;
+
+    Util::QueryResult query = {};
+
+    // Binaries of the mapped archive are read in place and never go through the memory layer, and entries already in
+    // the memory layer need no prefetch.
+    if (((pCache->m_pMappedArchive == nullptr) ||
+         (pCache->m_pMappedArchive->FindBinary(pCacheId, &mappedSize, &pMappedData) == false)) &&
+        (pCache->m_pTopLayer->Query(pCacheId, 0, 0, &query) == Util::Result::Success)        &&
+        (query.pLayer != pCache->m_pMemoryLayer))
+    {
+        // Read the entry from the archive without holding m_entriesMutex, which the threads creating pipelines query
+        // under.  The promotion below then finds the file's pages in memory rather than on disk.
+        void* pData = pCache->m_pInstance->AllocMem(query.dataSize, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+        Util::Result result = (pData != nullptr) ? pCache->m_pTopLayer->Load(&query, pData) :
+                                                   Util::Result::ErrorOutOfMemory;
+
+        pCache->m_pInstance->FreeMem(pData);
+
+        if (result == Util::Result::Success)
+        {
+            pCache->m_entriesMutex.Lock();
+            result = pCache->m_pTopLayer->Query(
+                pCacheId,
+                Util::ICacheLayer::LinkPolicy::LoadOnQuery,
+                0,
+                &query);
+            pCache->m_entriesMutex.Unlock();
+        }
+
+        if (result == Util::Result::Success)
+        {
+            pCache->m_prefetchedBytes += query.dataSize;
+
+            if (pCache->m_memoryBudget > 0)
+            {
+                pCache->TrackMemoryEntry(pCacheId);
+
+                Util::MutexAuto lock(&pCache->m_clockLock);
+
+                proceed = (pCache->m_residentBytes < pCache->m_memoryBudget);
+            }
+            else
+            {
+                proceed = (pCache->m_prefetchedBytes < MaxUnbudgetedPrefetchBytes);
+            }
+        }
+    }
+
+    return proceed;
+}
+
+// =====================================================================================================================
+// Stores the entries of a serialized cache, the initial data of an application cache, on the calling thread.
+void PipelineBinaryCache::StoreInitialData(
+    size_t      dataSize,
+    const void* pData)
+{
+    ChecksummedBlobHeader header = {};
+    memcpy(&header, pData, sizeof(header));
+
+    const bool   checksummed = (header.marker == ChecksummedBlobMarker);
+    const size_t entrySize   = checksummed ? sizeof(ChecksummedCacheEntry) : sizeof(BinaryCacheEntry);
+
+    Util::Result          result = Util::Result::Success;
+    size_t                offset = sizeof(PipelineBinaryCachePrivateHeader);
+    ChecksummedCacheEntry entry  = {};
+
+    // A blob without per-entry checksums is only stored if it is intact as a whole.
+    if ((checksummed == false) && (IsIntactLegacyBlob(dataSize, pData) == false))
+    {
+        result = Util::Result::ErrorInvalidValue;
+    }
+
+    while ((result == Util::Result::Success) && ReadBlobEntry(pData, dataSize, offset, entrySize, &entry))
+    {
+        result  = StoreInitialEntry(&entry, Util::VoidPtrInc(pData, offset + entrySize), checksummed);
+        offset += entrySize + entry.dataSize;
+    }
+}
+
+// =====================================================================================================================
+// Stores an entry of the initial data.  Entries of blobs with per-entry checksums are stored only if their checksum
+// matches, so a corrupt entry doesn't take the rest of the blob with it.
+Util::Result PipelineBinaryCache::StoreInitialEntry(
+    const ChecksummedCacheEntry* pEntry,
+    const void*                  pEntryData,
+    bool                         checksummed)
+{
+    Util::Result result = Util::Result::Success;
+
+    const uint64_t checksum = ComputeEntryChecksum(&pEntry->hashId, pEntry->dataSize, pEntryData);
+
+    if ((checksummed == false) || (checksum == pEntry->checksum))
+    {
+        // Logging the entry before it is stored marks it as one the application already has, so it isn't part of the
+        // next delta snapshot.
+        LogStoredEntry(&pEntry->hashId, checksum, true);
+
+        result = StoreCacheEntry(&pEntry->hashId, pEntry->dataSize, pEntryData);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Copies the initial data of an application cache and starts the thread which ingests it.  The application may free
+// its data as soon as vkCreatePipelineCache returns, so the copy is needed, but copying is far cheaper than verifying
+// and storing every entry.
+VkResult PipelineBinaryCache::StartInitialDataIngest(
+    size_t      dataSize,
+    const void* pData)
+{
+    VkResult result = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+    m_pInitialData = m_pInstance->AllocMem(dataSize, VK_DEFAULT_MEM_ALIGN, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if ((m_pInitialData != nullptr) && (m_pendingEntries.Init() == Util::Result::Success))
+    {
+        ChecksummedBlobHeader header = {};
+        memcpy(&header, pData, sizeof(header));
+        memcpy(m_pInitialData, pData, dataSize);
+
+        m_initialDataSize = dataSize;
+        m_checksummedInit = (header.marker == ChecksummedBlobMarker);
+        m_ingestPending   = true;
+
+        result = PalToVkResult(m_ingestThread.Begin(IngestThreadFunc, this));
+
+        if (result != VK_SUCCESS)
+        {
+            m_ingestPending = false;
+        }
+    }
+
+    if ((result != VK_SUCCESS) && (m_pInitialData != nullptr))
+    {
+        m_pInstance->FreeMem(m_pInitialData);
+        m_pInitialData = nullptr;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+void PipelineBinaryCache::IngestThreadFunc(
+    void* pParam)
+{
+    static_cast<PipelineBinaryCache*>(pParam)->IngestInitialData();
+}
+
+// =====================================================================================================================
+// Ingests the initial data on the ingest thread.  All entries are indexed first, so that lookups can take the entries
+// they need ahead of the thread, then the entries which are still pending are verified and stored in order.  Blobs
+// without per-entry checksums are verified as a whole before any of their entries is indexed; lookups miss meanwhile.
+void PipelineBinaryCache::IngestInitialData()
+{
+    const size_t entrySize = m_checksummedInit ? sizeof(ChecksummedCacheEntry) : sizeof(BinaryCacheEntry);
+
+    ChecksummedCacheEntry entry  = {};
+    size_t                offset = sizeof(PipelineBinaryCachePrivateHeader);
+
+    // Entries past the end of the index, if it couldn't be completed, are stored unconditionally below.
+    size_t indexEnd = offset;
+
+    Util::Result result = Util::Result::Success;
+
+    if ((m_checksummedInit == false) && (IsIntactLegacyBlob(m_initialDataSize, m_pInitialData) == false))
+    {
+        result = Util::Result::ErrorInvalidValue;
+    }
+
+    while ((m_stopIngest == false)             &&
+           (result == Util::Result::Success)   &&
+           ReadBlobEntry(m_pInitialData, m_initialDataSize, offset, entrySize, &entry))
+    {
+        Util::MutexAuto lock(&m_ingestLock);
+
+        bool    existed = false;
+        size_t* pOffset = nullptr;
+
+        if (m_pendingEntries.FindAllocate(entry.hashId, &existed, &pOffset) != Util::Result::Success)
+        {
+            break;
+        }
+
+        // Duplicates of an entry are skipped, only the first copy is stored.
+        if (existed == false)
+        {
+            *pOffset = offset;
+        }
+
+        offset  += entrySize + entry.dataSize;
+        indexEnd = offset;
+    }
+
+    offset = sizeof(PipelineBinaryCachePrivateHeader);
+
+    while ((m_stopIngest == false)             &&
+           (result == Util::Result::Success)   &&
+           ReadBlobEntry(m_pInitialData, m_initialDataSize, offset, entrySize, &entry))
+    {
+        bool pending = (offset >= indexEnd);
+
+        if (pending == false)
+        {
+            Util::MutexAuto lock(&m_ingestLock);
+
+            const size_t* pOffset = m_pendingEntries.FindKey(entry.hashId);
+
+            // The entry is gone from the index if a lookup has stored it already.
+            if ((pOffset != nullptr) && (*pOffset == offset))
+            {
+                m_pendingEntries.Erase(entry.hashId);
+                pending = true;
+            }
+        }
+
+        if (pending)
+        {
+            result = StoreInitialEntry(&entry, Util::VoidPtrInc(m_pInitialData, offset + entrySize), m_checksummedInit);
+        }
+
+        offset += entrySize + entry.dataSize;
+    }
+
+    {
+        // Lookups check this under the lock, and hold it while they store an entry, so none of them can still be
+        // reading the data when it is freed.
+        Util::MutexAuto lock(&m_ingestLock);
+
+        m_ingestPending = false;
+        m_ingestDone.WakeAll();
+    }
+
+    m_pInstance->FreeMem(m_pInitialData);
+    m_pInitialData = nullptr;
+}
+
+// =====================================================================================================================
+// Stores an entry of the initial data right away if it is still waiting to be ingested, so a lookup doesn't miss an
+// entry the application provided just because the ingest thread hasn't got to it yet.  Lookups wait for this one entry
+// only; entries the thread is storing at the time may still miss, which just means their pipelines get compiled.
+void PipelineBinaryCache::IngestPendingEntry(
+    const CacheId* pCacheId)
+{
+    if (m_ingestPending)
+    {
+        Util::MutexAuto lock(&m_ingestLock);
+
+        const size_t* pOffset = m_ingestPending ? m_pendingEntries.FindKey(*pCacheId) : nullptr;
+
+        if (pOffset != nullptr)
+        {
+            const size_t entrySize = m_checksummedInit ? sizeof(ChecksummedCacheEntry) : sizeof(BinaryCacheEntry);
+            const size_t offset    = *pOffset;
+
+            ChecksummedCacheEntry entry = {};
+
+            m_pendingEntries.Erase(*pCacheId);
+
+            if (ReadBlobEntry(m_pInitialData, m_initialDataSize, offset, entrySize, &entry))
+            {
+                StoreInitialEntry(&entry, Util::VoidPtrInc(m_pInitialData, offset + entrySize), m_checksummedInit);
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Waits until the initial data has been ingested, for operations which need all entries of the cache.
+void PipelineBinaryCache::WaitForInitialData() const
+{
+    if (m_isInternalCache == false)
+    {
+        Util::MutexAuto lock(&m_ingestLock);
+
+        // A timeout of UINT32_MAX waits without a timeout.
+        while (m_ingestPending)
+        {
+            m_ingestDone.Wait(&m_ingestLock, UINT32_MAX);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Appends a newly stored entry of an application cache to the entry log, along with the checksum it is serialized with.
+void PipelineBinaryCache::LogStoredEntry(
+    const CacheId* pCacheId,
+    uint64_t       checksum,
+    bool           initial)
+{
+    LoggedEntry entry = {};
+    entry.cacheId     = *pCacheId;
+    entry.checksum    = checksum;
+    entry.initial     = initial;
+
+    Util::MutexAuto lock(&m_entryLogLock);
+
+    bool      existed = false;
+    uint32_t* pIndex  = nullptr;
+
+    if ((m_entryLogIndex.FindAllocate(*pCacheId, &existed, &pIndex) == Util::Result::Success) && (existed == false))
+    {
+        *pIndex = m_entryLog.NumElements();
+
+        if (m_entryLog.PushBack(entry) != Util::Result::Success)
+        {
+            m_entryLogIndex.Erase(*pCacheId);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Returns the checksum of an entry, from the entry log if it is logged.
+uint64_t PipelineBinaryCache::GetEntryChecksum(
+    const CacheId* pCacheId,
+    size_t         dataSize,
+    const void*    pData)
+{
+    uint64_t checksum = 0;
+    bool     logged   = false;
+
+    if (m_isInternalCache == false)
+    {
+        Util::MutexAuto lock(&m_entryLogLock);
+
+        const uint32_t* pIndex = m_entryLogIndex.FindKey(*pCacheId);
+
+        if (pIndex != nullptr)
+        {
+            checksum = m_entryLog.At(*pIndex).checksum;
+            logged   = true;
+        }
+    }
+
+    if (logged == false)
+    {
+        checksum = ComputeEntryChecksum(pCacheId, dataSize, pData);
+    }
+
+    return checksum;
+}
+
+// =====================================================================================================================
+// Records a use of an entry of the memory layer, then evicts entries until the layer fits its budget again.  Entries
+// which the memory layer doesn't hold, like archive hits which weren't promoted into it, aren't tracked.
+void PipelineBinaryCache::TrackMemoryEntry(
+    const CacheId*  pCacheId)
+{
+    Util::QueryResult query = {};
+
+    if ((m_memoryBudget > 0)          &&
+        (m_pMemoryLayer != nullptr)   &&
+        (m_pMemoryLayer->Query(pCacheId, 0, 0, &query) == Util::Result::Success))
+    {
+        const size_t dataSize = query.dataSize;
+
+        Util::MutexAuto lock(&m_clockLock);
+
+        bool      existed = false;
+        uint32_t* pSlot   = nullptr;
+
+        if (m_clockIndex.FindAllocate(*pCacheId, &existed, &pSlot) == Util::Result::Success)
+        {
+            if (existed)
+            {
+                ClockEntry& entry = m_clockEntries[*pSlot];
+
+                m_residentBytes  += dataSize;
+                m_residentBytes  -= entry.dataSize;
+                entry.dataSize    = dataSize;
+                entry.referenced  = true;
+            }
+            else
+            {
+                ClockEntry entry = {};
+                entry.cacheId    = *pCacheId;
+                entry.dataSize   = dataSize;
+                entry.referenced = true;
+                entry.inUse      = true;
+
+                Util::Result result = Util::Result::Success;
+
+                if (m_freeClockSlots.IsEmpty() == false)
+                {
+                    m_freeClockSlots.PopBack(pSlot);
+                    m_clockEntries[*pSlot] = entry;
+                }
+                else
+                {
+                    *pSlot = m_clockEntries.NumElements();
+                    result = m_clockEntries.PushBack(entry);
+                }
+
+                if (result == Util::Result::Success)
+                {
+                    m_residentBytes += dataSize;
+                }
+                else
+                {
+                    // Untracked entries are never evicted, which is the safe direction to fail in.
+                    m_clockIndex.Erase(*pCacheId);
+                }
+            }
+
+            EnforceMemoryBudget();
+        }
+    }
 }
 
 // =====================================================================================================================
-// Query if a pipeline binary exists in cache
-// Must call ReleaseCacheRef() when the flags contains AcquireEntryRef
-Util::Result PipelineBinaryCache::WaitPipelineBinary(
-    const CacheId*     pCacheId)
-{
-    VK_ASSERT(m_pTopLayer != nullptr);
-
-    return m_pTopLayer->WaitForEntry(pCacheId);
-}
-// =====================================================================================================================
-// Attempt to load a graphics pipeline binary from cache
-Util::Result PipelineBinaryCache::LoadPipelineBinary(
-    const CacheId* pCacheId,
-    size_t*        pPipelineBinarySize,
-    const void**   ppPipelineBinary) const
+// Runs the clock hand until the tracked entries fit the memory budget.  Must be called with m_clockLock held.
+void PipelineBinaryCache::EnforceMemoryBudget()
 {
-    VK_ASSERT(m_pTopLayer != nullptr);
-
-    Util::QueryResult query  = {};
-    Util::Result      result = m_pTopLayer->Query(pCacheId, 0, 0, &query);
-
-    if (result == Util::Result::Success)
+    while ((m_residentBytes > m_memoryBudget) && (m_clockIndex.GetNumEntries() > 0))
     {
-        void* pOutputMem = m_pInstance->AllocMem(
-            query.dataSize,
-            VK_DEFAULT_MEM_ALIGN,
-            VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+        const uint32_t slot  = m_clockHand;
+        ClockEntry&    entry = m_clockEntries[slot];
 
-        if (pOutputMem != nullptr)
-        {
-            result = m_pTopLayer->Load(&query, pOutputMem);
+        m_clockHand = (m_clockHand + 1) % m_clockEntries.NumElements();
 
-            if (result == Util::Result::Success)
+        if (entry.inUse)
+        {
+            if (entry.referenced)
             {
-                *pPipelineBinarySize = query.dataSize;
-                *ppPipelineBinary    = pOutputMem;
+                // Give the entry a second chance
+                entry.referenced = false;
             }
             else
             {
-                m_pInstance->FreeMem(pOutputMem);
+                // Only evict from memory; archive layers below keep their copy, so a later load can bring it back.
+                m_pMemoryLayer->Evict(&entry.cacheId);
+
+                m_residentBytes -= entry.dataSize;
+                entry.inUse      = false;
+
+                m_clockIndex.Erase(entry.cacheId);
+                m_freeClockSlots.PushBack(slot);
+
+                Util::AtomicIncrement(&m_evictionCount);
             }
         }
     }
-
-    return result;
 }
 
 // =====================================================================================================================
-// Attempt to store a binary into a cache chain
-Util::Result PipelineBinaryCache::StorePipelineBinary(
-    const CacheId*  pCacheId,
-    size_t          pipelineBinarySize,
-    const void*     pPipelineBinary)
+// Returns the hit, miss and eviction counters of the cache
+void PipelineBinaryCache::GetStats(
+    PipelineBinaryCacheStats* pStats)
 {
-    VK_ASSERT(m_pTopLayer != nullptr);
+    pStats->hits          = m_hitCount;
+    pStats->misses        = m_missCount;
+    pStats->evictions     = m_evictionCount;
+    pStats->residentBytes = 0;
+    pStats->prefetches    = (m_pHotIndex != nullptr) ? m_pHotIndex->GetPrefetchCount() : 0;
+
+    if (m_memoryBudget > 0)
+    {
+        Util::MutexAuto lock(&m_clockLock);
 
-    return m_pTopLayer->Store(pCacheId, pPipelineBinary, pipelineBinarySize);
+        pStats->residentBytes = m_residentBytes;
+    }
 }
 
 // =====================================================================================================================
@@ -502,7 +1405,15 @@ Util::Result PipelineBinaryCache::StoreReinjectionBinary(
 void PipelineBinaryCache::FreePipelineBinary(
     const void* pPipelineBinary)
 {
-    if (pPipelineBinary != nullptr)
+    bool shared = false;
+
+#if defined(__unix__)
+    shared = (m_pSharedCache != nullptr) && m_pSharedCache->ContainsBinary(pPipelineBinary);
+#endif
+
+    if ((pPipelineBinary != nullptr) &&
+        ((m_pMappedArchive == nullptr) || (m_pMappedArchive->ContainsBinary(pPipelineBinary) == false)) &&
+        (shared == false))
     {
         m_pInstance->FreeMem(const_cast<void*>(pPipelineBinary));
     }
@@ -519,6 +1430,43 @@ VkResult PipelineBinaryCache::Initialize(
 
     m_entriesMutex.Init();
 
+    // The entry log is only kept for application caches, which are the ones that get serialized.
+    if (m_isInternalCache == false)
+    {
+        if ((m_entryLogLock.Init() != Util::Result::Success) ||
+            (m_entryLogIndex.Init() != Util::Result::Success))
+        {
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+
+        if ((result == VK_SUCCESS) &&
+            ((m_ingestLock.Init() != Util::Result::Success) ||
+             (m_ingestDone.Init() != Util::Result::Success)))
+        {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        m_deltaSnapshots   = settings.pipelineCacheDeltaSnapshots;
+        m_asyncInitialData = settings.pipelineCacheAsyncInitialData;
+    }
+
+    // Only the driver's internal cache is bounded; the contents of application caches are up to the application.
+    if (m_isInternalCache && (settings.pipelineBinaryCacheMemoryBudget > 0))
+    {
+        if ((m_clockLock.Init() == Util::Result::Success) &&
+            (m_clockIndex.Init() == Util::Result::Success))
+        {
+            m_memoryBudget = settings.pipelineBinaryCacheMemoryBudget;
+        }
+    }
+
+#if ICD_BUILD_LZ4
+    m_compression = settings.pipelineBinaryCompression;
+#else
+    // No codec is built in, so binaries can only be stored uncompressed.
+    VK_ALERT(settings.pipelineBinaryCompression != PipelineBinaryCompressionNone);
+#endif
+
     if (result == VK_SUCCESS)
     {
         m_pPlatformKey = pPhysicalDevice->GetPlatformKey();
@@ -539,6 +1487,12 @@ VkResult PipelineBinaryCache::Initialize(
         result = OrderLayers(settings);
     }
 
+    // Warm the memory layer with the entries earlier runs used, while the application is still starting up.
+    if ((result == VK_SUCCESS) && (m_pHotIndex != nullptr))
+    {
+        VK_ALERT(m_pHotIndex->StartPrefetch(PrefetchEntry, this) != VK_SUCCESS);
+    }
+
 #if ICD_GPUOPEN_DEVMODE_BUILD
     if ((result == VK_SUCCESS) &&
         (m_pReinjectionLayer != nullptr))
@@ -874,11 +1828,13 @@ Util::IArchiveFile* PipelineBinaryCache::OpenReadOnlyArchive(
 }
 
 // =====================================================================================================================
-// Open an archive file from disk for read + write
+// Open an archive file from disk for read + write.  Without asynchronous file I/O, a store has handed its data to the
+// kernel by the time it returns.
 Util::IArchiveFile* PipelineBinaryCache::OpenWritableArchive(
     const char* pFilePath,
     const char* pFileName,
-    size_t      bufferSize)
+    size_t      bufferSize,
+    bool        allowAsyncFileIo)
 {
     VK_ASSERT(pFilePath != nullptr);
     VK_ASSERT(pFileName != nullptr);
@@ -901,7 +1857,7 @@ Util::IArchiveFile* PipelineBinaryCache::OpenWritableArchive(
     info.useStrictVersionControl = true;
     info.allowWriteAccess        = true;
     info.allowCreateFile         = true;
-    info.allowAsyncFileIo        = true;
+    info.allowAsyncFileIo        = allowAsyncFileIo;
     info.useBufferedReadMemory   = (bufferSize > 0);
     info.maxReadBufferMem        = bufferSize;
 
@@ -1003,19 +1959,21 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
                 if (Util::Snprintf(pathBuffer, _MAX_FNAME, "%s%s", pUserDataPath, pCacheSubPath) > 0)
                 {
                     pCachePath = pathBuffer;
-#if VK_IS_PAL_VERSION_AT_LEAST(582, 2)
+
+                    // The directory is kept within its budget by a background thread, so that neither this nor any
+                    // pipeline creation waits for it to be scanned and cleaned up.  The thread starts once the
+                    // archives below are open and the cleaner knows to leave them alone.
                     if (settings.allowCleanUpCacheDirectory)
                     {
-                        uint64 totalSize = 0, oldestTime = 0;
-                        if (Util::GetStatusOfDir(pCachePath, &totalSize, &oldestTime) == Util::Result::Success)
-                        {
-                            if (totalSize >= settings.pipelineCacheDefaultLocationLimitation)
-                            {
-                                Util::RemoveFilesOfDir(pCachePath, oldestTime + settings.thresholdOfCleanUpCache);
-                            }
-                        }
+                        m_pArchiveCleaner = ArchiveCleaner::Create(
+                            m_pInstance,
+                            pCachePath,
+                            settings.pipelineCacheDefaultLocationLimitation,
+                            settings.thresholdOfCleanUpCache);
+
+                        VK_ALERT(m_pArchiveCleaner == nullptr);
                     }
-#endif
+
                     result = VK_SUCCESS;
                 }
             }
@@ -1045,6 +2003,7 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
                 {
                     m_openFiles.PushBack(pFile);
                     m_archiveLayers.PushBack(pLayer);
+                    KeepArchiveFile(pThirdPartyFileName);
 
                     pThirdPartyLayer = pLayer;
 
@@ -1059,6 +2018,22 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
             }
         }
 
+        // Open the optional memory mapped cache file. This may fail gracefully too.  ISA replacement patches the
+        // binaries it is handed, so it can't be used with binaries that live in a read-only mapping.
+        const char* const pMappedFileName = getenv(EnvVarMappedFileName);
+
+        if ((pMappedFileName != nullptr) && (settings.shaderReplaceMode != ShaderReplaceShaderISA))
+        {
+            m_pMappedArchive = MappedPipelineArchive::Create(m_pInstance, m_pPlatformKey, pCachePath, pMappedFileName);
+
+            VK_ALERT(m_pMappedArchive == nullptr);
+
+            if (m_pMappedArchive != nullptr)
+            {
+                KeepArchiveFile(pMappedFileName);
+            }
+        }
+
         // Buffer to hold constructed filename
         char nameBuffer[_MAX_FNAME] = {};
 
@@ -1066,97 +2041,141 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
 
         if (pCacheFileName == nullptr)
         {
-            // If no naming scheme is given, compute the name by AppHash + PlatformKey
-            Util::Hash128 appHash        = {};
-            char*         pExecutablePtr = nullptr;
-
-            Util::Result palResult = Util::GetExecutableName(nameBuffer, &pExecutablePtr, sizeof(nameBuffer));
-            VK_ASSERT(IsErrorResult(palResult) == false);
-            Util::MetroHash128::Hash(reinterpret_cast<const uint8_t*>(nameBuffer), sizeof(nameBuffer), appHash.bytes);
-
-            Util::Snprintf(
-                nameBuffer,
-                sizeof(nameBuffer),
-                "%llX%llX",
-                Util::MetroHash::Compact64(&appHash),
-                m_pPlatformKey->GetKey64());
+            GetDefaultCacheName(nameBuffer, sizeof(nameBuffer));
         }
         else
         {
             Util::Strncpy(nameBuffer, pCacheFileName, sizeof(nameBuffer));
         }
 
-        Util::ICacheLayer* pWriteLayer    = nullptr;
-        Util::ICacheLayer* pLastReadLayer = pThirdPartyLayer;
+        // The hot entry index is named after the archive without the suffix of the attempt, so that every run finds
+        // the index of the previous one.
+        if (settings.pipelineCachePrefetchEntryCount > 0)
+        {
+            m_pHotIndex = HotEntryIndex::Create(
+                m_pInstance,
+                pCachePath,
+                nameBuffer,
+                settings.pipelineCachePrefetchEntryCount);
+
+            VK_ALERT(m_pHotIndex == nullptr);
+        }
+
+        // The writable archive is split into shards by the hash of the entries, so that a corrupt write only loses
+        // one shard and the cleaner can evict the cold parts of a cache.  Routing stores to the shards needs the
+        // memory layer, so without it there is a single shard, which is linked below the other archives as before.  An
+        // archive named through the environment is kept in one file as well, since tools refer to it by that name.
+        const uint32_t shardCount = ((m_pMemoryLayer != nullptr) && (pCacheFileName == nullptr)) ?
+            Util::Clamp(settings.pipelineCacheArchiveShardCount, 1u, MaxArchiveShards) : 1;
+
+        // The write queue syncs the shards after writing to them, which only makes the entries durable if the archive
+        // layer has actually written them by then.  The queue's writes are off the critical path anyway.
+        const bool writeBehind = settings.pipelineCacheArchiveWriteBehind && (m_pMemoryLayer != nullptr);
 
-        char* const  nameEnd        = &nameBuffer[strnlen(nameBuffer, sizeof(nameBuffer))];
-        const size_t charsRemaining = sizeof(nameBuffer) - (nameEnd - nameBuffer);
+        char        shardNames[MaxArchiveShards][_MAX_FNAME] = {};
+        const char* pShardNames[MaxArchiveShards]            = {};
+        uint32_t    writeLayerCount                          = 0;
 
-        constexpr int MaxAttempts = 10;
-        for (int attemptCt = 0; attemptCt < MaxAttempts; ++attemptCt)
+        Util::ICacheLayer* pLastLayer     = pThirdPartyLayer;
+        bool               lastIsReadOnly = true;
+
+        const size_t baseNameLength = strnlen(nameBuffer, sizeof(nameBuffer));
+
+        for (uint32_t shard = 0; shard < shardCount; ++shard)
         {
-            size_t bufferSize = (m_pArchiveLayer == nullptr) ? PrimayrLayerBufferSize : SecondaryLayerBufferSize;
+            // A single shard keeps the name of the unsharded archive; otherwise the shard index is appended.
+            nameBuffer[baseNameLength] = '\0';
 
-            // Create the final name based off the attempt
-            *nameEnd = '\0';
-            if (attemptCt == 0)
-            {
-                Util::Strncat(nameBuffer, sizeof(nameBuffer), ".parc");
-            }
-            else
+            if (shardCount > 1)
             {
-                Util::Snprintf(nameEnd, charsRemaining, "_%d.parc", attemptCt);
+                Util::Snprintf(&nameBuffer[baseNameLength], sizeof(nameBuffer) - baseNameLength, ".%u", shard);
             }
 
-            Util::IArchiveFile* pFile    = OpenWritableArchive(pCachePath, nameBuffer, bufferSize);
-            bool                readOnly = false;
+            char* const  nameEnd        = &nameBuffer[strnlen(nameBuffer, sizeof(nameBuffer))];
+            const size_t charsRemaining = sizeof(nameBuffer) - (nameEnd - nameBuffer);
 
-            // Attempt to open the file as a read only instead if we failed
-            if (pFile == nullptr)
-            {
-                pFile    = OpenReadOnlyArchive(pCachePath, nameBuffer, bufferSize);
-                readOnly = true;
-            }
+            Util::ICacheLayer* pWriteLayer = nullptr;
 
-            // Only create the layer if one of the two above calls successfully openned the file
-            if (pFile != nullptr)
+            constexpr int MaxAttempts = 10;
+            for (int attemptCt = 0; (pWriteLayer == nullptr) && (attemptCt < MaxAttempts); ++attemptCt)
             {
-                Util::ICacheLayer* pLayer = CreateFileLayer(pFile);
+                // The shards share the read buffer memory a single archive would get.
+                const size_t bufferSize =
+                    (((pThirdPartyLayer == nullptr) && (attemptCt == 0)) ? PrimayrLayerBufferSize
+                                                                         : SecondaryLayerBufferSize) / shardCount;
+
+                // Create the final name based off the attempt
+                *nameEnd = '\0';
+                if (attemptCt == 0)
+                {
+                    Util::Strncat(nameBuffer, sizeof(nameBuffer), ".parc");
+                }
+                else
+                {
+                    Util::Snprintf(nameEnd, charsRemaining, "_%d.parc", attemptCt);
+                }
 
-                if (pLayer != nullptr)
+                Util::IArchiveFile* pFile    = OpenWritableArchive(pCachePath, nameBuffer, bufferSize, !writeBehind);
+                bool                readOnly = false;
+
+                // Attempt to open the file as a read only instead if we failed
+                if (pFile == nullptr)
                 {
-                    m_openFiles.PushBack(pFile);
-                    m_archiveLayers.PushBack(pLayer);
+                    pFile    = OpenReadOnlyArchive(pCachePath, nameBuffer, bufferSize);
+                    readOnly = true;
+                }
 
-                    if (pLastReadLayer != nullptr)
-                    {
-                        pLastReadLayer->SetLoadPolicy(Util::ICacheLayer::LinkPolicy::PassCalls);
-                        pLastReadLayer->SetStorePolicy(Util::ICacheLayer::LinkPolicy::Skip | Util::ICacheLayer::LinkPolicy::PassData);
-                        // Connect to previous read layer as read-through / write-through + skip
-                        pLastReadLayer->Link(pLayer);
-                    }
+                // Only create the layer if one of the two above calls successfully openned the file
+                if (pFile != nullptr)
+                {
+                    Util::ICacheLayer* pLayer = CreateFileLayer(pFile);
 
-                    // Ensure the first read or write layer is set to "top" of the chain.
-                    if (m_pArchiveLayer == nullptr)
+                    if (pLayer != nullptr)
                     {
-                        m_pArchiveLayer = pLayer;
-                    }
+                        m_openFiles.PushBack(pFile);
+                        m_archiveLayers.PushBack(pLayer);
+                        KeepArchiveFile(nameBuffer);
 
-                    if (readOnly)
-                    {
-                        pLastReadLayer = pLayer;
+                        if (pLastLayer != nullptr)
+                        {
+                            // Connect to the previous layer as read-through.  Read only layers pass stores on to the
+                            // write layer below them; the write layers of shards are stored into directly.
+                            pLastLayer->SetLoadPolicy(Util::ICacheLayer::LinkPolicy::PassCalls);
+                            pLastLayer->SetStorePolicy(lastIsReadOnly ?
+                                (Util::ICacheLayer::LinkPolicy::Skip | Util::ICacheLayer::LinkPolicy::PassData) :
+                                Util::ICacheLayer::LinkPolicy::PassCalls);
+                            pLastLayer->Link(pLayer);
+                        }
+
+                        // Ensure the first read or write layer is set to "top" of the chain.
+                        if (m_pArchiveLayer == nullptr)
+                        {
+                            m_pArchiveLayer = pLayer;
+                        }
+
+                        pLastLayer     = pLayer;
+                        lastIsReadOnly = readOnly;
+
+                        if (readOnly == false)
+                        {
+                            pWriteLayer = pLayer;
+                        }
                     }
                     else
                     {
-                        pWriteLayer = pLayer;
-                        break;
+                        pFile->Destroy();
+                        m_pInstance->FreeMem(pFile);
                     }
                 }
-                else
-                {
-                    pFile->Destroy();
-                    m_pInstance->FreeMem(pFile);
-                }
+            }
+
+            if (pWriteLayer != nullptr)
+            {
+                Util::Strncpy(shardNames[writeLayerCount], nameBuffer, sizeof(shardNames[writeLayerCount]));
+
+                pShardNames[writeLayerCount]      = shardNames[writeLayerCount];
+                m_pArchiveShards[writeLayerCount] = pWriteLayer;
+                ++writeLayerCount;
             }
         }
 
@@ -1165,12 +2184,140 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
             result = VK_ERROR_INITIALIZATION_FAILED;
         }
 
-        VK_ASSERT(pWriteLayer != nullptr);
+        VK_ASSERT(writeLayerCount > 0);
+
+        // Stores are kept in the memory layer, which serves them until they are written, and StoreEntry() writes them
+        // to their shard.  Entries of a shard that couldn't be opened for writing go to the other shards; lookups
+        // search every shard anyway.
+        if ((result == VK_SUCCESS) &&
+            (writeLayerCount > 0) &&
+            (m_pMemoryLayer != nullptr))
+        {
+            m_archiveShardCount = writeLayerCount;
+
+            m_pMemoryLayer->SetStorePolicy(Util::ICacheLayer::LinkPolicy::PassCalls);
+
+            // Move archive writes off the threads creating pipelines.
+            if (settings.pipelineCacheArchiveWriteBehind)
+            {
+                m_pWriteQueue = ArchiveWriteQueue::Create(
+                    m_pInstance,
+                    m_archiveShardCount,
+                    m_pArchiveShards,
+                    pCachePath,
+                    pShardNames);
+
+                VK_ALERT(m_pWriteQueue == nullptr);
+            }
+        }
+    }
+
+    if ((m_pArchiveCleaner != nullptr) && ((result != VK_SUCCESS) || (m_pArchiveCleaner->Start() != VK_SUCCESS)))
+    {
+        m_pArchiveCleaner->Destroy();
+        m_pArchiveCleaner = nullptr;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Waits until the entries queued for the archive have been written and synced.
+void PipelineBinaryCache::DrainArchiveWrites()
+{
+    if (m_pWriteQueue != nullptr)
+    {
+        m_pWriteQueue->Drain();
+    }
+}
+
+// =====================================================================================================================
+// Keeps the directory cleaner, if any, from removing an archive file this cache has open.
+void PipelineBinaryCache::KeepArchiveFile(
+    const char* pFileName)
+{
+    if (m_pArchiveCleaner != nullptr)
+    {
+        m_pArchiveCleaner->KeepFile(pFileName);
+    }
+}
+
+// =====================================================================================================================
+// Computes the name of the application's cache from the hash of the executable name and the platform key
+void PipelineBinaryCache::GetDefaultCacheName(
+    char*  pNameBuffer,
+    size_t bufferSize) const
+{
+    Util::Hash128 appHash        = {};
+    char*         pExecutablePtr = nullptr;
+
+    memset(pNameBuffer, 0, bufferSize);
+
+    Util::Result palResult = Util::GetExecutableName(pNameBuffer, &pExecutablePtr, bufferSize);
+    VK_ASSERT(IsErrorResult(palResult) == false);
+    Util::MetroHash128::Hash(reinterpret_cast<const uint8_t*>(pNameBuffer), bufferSize, appHash.bytes);
+
+    Util::Snprintf(
+        pNameBuffer,
+        bufferSize,
+        "%llX%llX",
+        Util::MetroHash::Compact64(&appHash),
+        m_pPlatformKey->GetKey64());
+}
+
+#if defined(__unix__)
+// =====================================================================================================================
+// Opens the cache in shared memory which all processes of the application on this machine share.  The name carries the
+// platform key, so processes running another driver or on another GPU use another cache.  A failure only disables the
+// shared cache.
+VkResult PipelineBinaryCache::InitSharedCache(
+    const RuntimeSettings& settings)
+{
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+
+    // ISA replacement patches the binaries it is handed, which would change them for the other processes too.
+    if ((settings.pipelineCacheSharedMemorySize > 0) && (settings.shaderReplaceMode != ShaderReplaceShaderISA))
+    {
+        char cacheName[_MAX_FNAME]  = {};
+        char sharedName[_MAX_FNAME] = {};
+
+        const char* const pCacheFileName = getenv(EnvVarFileName);
+
+        if (pCacheFileName == nullptr)
+        {
+            GetDefaultCacheName(cacheName, sizeof(cacheName));
+        }
+        else
+        {
+            Util::Strncpy(cacheName, pCacheFileName, sizeof(cacheName));
+        }
+
+        // The default name has the platform key already, but a name from the environment doesn't.
+        if (pCacheFileName == nullptr)
+        {
+            Util::Snprintf(sharedName, sizeof(sharedName), "/amdvlk-%s", cacheName);
+        }
+        else
+        {
+            Util::Snprintf(sharedName, sizeof(sharedName), "/amdvlk-%s-%llX", cacheName, m_pPlatformKey->GetKey64());
+        }
+
+        m_pSharedCache = SharedPipelineCache::Create(
+            m_pInstance,
+            sharedName,
+            static_cast<size_t>(settings.pipelineCacheSharedMemorySize),
+            m_pPlatformKey->GetKey64());
+
+        VK_ALERT(m_pSharedCache == nullptr);
+
+        result = (m_pSharedCache != nullptr) ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
     }
 
     return result;
 }
 
+#endif
+
 // =====================================================================================================================
 // Initialize layers (a single layer that supports storage for binaries needs to succeed)
 VkResult PipelineBinaryCache::InitLayers(
@@ -1199,6 +2346,11 @@ VkResult PipelineBinaryCache::InitLayers(
         {
             result = VK_SUCCESS;
         }
+
+#if defined(__unix__)
+        // The shared cache sits beside the chain and never stores binaries on its own, so it doesn't count here.
+        InitSharedCache(settings);
+#endif
     }
 
     return result;
@@ -1263,7 +2415,10 @@ VkResult PipelineBinaryCache::OrderLayers(
 }
 
 // =====================================================================================================================
-// Copies the pipeline cache data to the memory blob provided by the calling function.
+// Copies the pipeline cache data to the memory blob provided by the calling function.  Each entry carries its own
+// checksum, computed once when the entry was stored, so serializing doesn't hash the whole blob.  In delta mode only
+// the entries stored since the previous complete snapshot are copied, so the cost of a checkpoint depends on the number
+// of new pipelines rather than on the size of the cache.
 //
 // NOTE: It is expected that the calling function has not used this pipeline cache since querying the size
 VkResult PipelineBinaryCache::Serialize(
@@ -1276,75 +2431,150 @@ VkResult PipelineBinaryCache::Serialize(
 #if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 534
     if (m_pMemoryLayer != nullptr)
     {
-        if (*pSize == 0)
+        // Entries of the initial data which aren't ingested yet would be missing from the blob.
+        WaitForInitialData();
+
+        size_t   curCount      = 0;
+        size_t   curDataSize   = 0;
+        uint32_t snapshotStart = 0;
+        uint32_t snapshotEnd   = 0;
+
+        if (m_deltaSnapshots)
         {
-            size_t curCount, curDataSize;
+            Util::MutexAuto lock(&m_entryLogLock);
 
-            result = PalToVkResult(Util::GetMemoryCacheLayerCurSize(m_pMemoryLayer, &curCount, &curDataSize));
-            if (result == VK_SUCCESS)
-            {
-                *pSize = curCount * sizeof(BinaryCacheEntry) + curDataSize + sizeof(PipelineBinaryCachePrivateHeader);
-            }
+            snapshotStart = m_snapshotEntries;
+            snapshotEnd   = m_entryLog.NumElements();
+            curCount      = snapshotEnd - snapshotStart;
+            result        = VK_SUCCESS;
         }
         else
         {
-            size_t curCount, curDataSize;
-
             result = PalToVkResult(Util::GetMemoryCacheLayerCurSize(m_pMemoryLayer, &curCount, &curDataSize));
-            if (result == VK_SUCCESS)
+        }
+
+        if (result == VK_SUCCESS)
+        {
+            // A full size query only needs the totals of the memory layer, not the IDs.
+            const size_t idCount = (m_deltaSnapshots || (*pSize > 0)) ? Util::Max(curCount, size_t(1)) : 1;
+
+            Util::AutoBuffer<Util::Hash128, 8, PalAllocator> cacheIds(idCount, m_pInstance->Allocator());
+
+            if (m_deltaSnapshots)
             {
-                if (*pSize > (sizeof(BinaryCacheEntry) + sizeof(PipelineBinaryCachePrivateHeader)))
                 {
-                    Util::AutoBuffer<Util::Hash128, 8, PalAllocator> cacheIds(curCount, m_pInstance->Allocator());
-                    size_t remainingSpace    = *pSize - sizeof(PipelineBinaryCachePrivateHeader);
+                    Util::MutexAuto lock(&m_entryLogLock);
+
+                    curCount = 0;
+
+                    // Entries of the initial data are logged as they are ingested, but the application has them.
+                    for (uint32_t i = snapshotStart; i < snapshotEnd; i++)
+                    {
+                        const LoggedEntry& logged = m_entryLog.At(i);
+
+                        if (logged.initial == false)
+                        {
+                            cacheIds[curCount++] = logged.cacheId;
+                        }
+                    }
+                }
+
+                // The sizes come from the memory layer's index; the data of the entries isn't touched.
+                for (size_t i = 0; i < curCount; i++)
+                {
+                    Util::QueryResult query = {};
 
-                    result = PalToVkResult(Util::GetMemoryCacheLayerHashIds(m_pMemoryLayer, curCount, &cacheIds[0]));
-                    if (result == VK_SUCCESS)
+                    if (m_pMemoryLayer->Query(&cacheIds[i], 0, 0, &query) == Util::Result::Success)
                     {
-                        void* pDataDst = pBlob;
+                        curDataSize += query.dataSize;
+                    }
+                }
+            }
+            else if (*pSize > 0)
+            {
+                result = PalToVkResult(Util::GetMemoryCacheLayerHashIds(m_pMemoryLayer, curCount, &cacheIds[0]));
+            }
+
+            const size_t requiredSize =
+                curCount * sizeof(ChecksummedCacheEntry) + curDataSize + sizeof(PipelineBinaryCachePrivateHeader);
+
+            if (result == VK_SUCCESS)
+            {
+                if (*pSize == 0)
+                {
+                    // Sizing the blob doesn't touch the data of any entry.
+                    *pSize = requiredSize;
+                }
+                else if (*pSize >= sizeof(PipelineBinaryCachePrivateHeader))
+                {
+                    const size_t blobSize       = *pSize;
+                    size_t       remainingSpace = blobSize - sizeof(PipelineBinaryCachePrivateHeader);
+                    uint32_t     entryCount     = 0;
 
-                        // reserved for privateHeader
-                        pDataDst = Util::VoidPtrInc(pDataDst, sizeof(PipelineBinaryCachePrivateHeader));
+                    // reserved for privateHeader
+                    void* pDataDst = Util::VoidPtrInc(pBlob, sizeof(PipelineBinaryCachePrivateHeader));
 
-                        for (uint32_t i = 0; i < curCount && remainingSpace > sizeof(BinaryCacheEntry); i++)
+                    for (uint32_t i = 0; i < curCount && remainingSpace > sizeof(ChecksummedCacheEntry); i++)
+                    {
+                        // Copy each entry straight out of the memory layer's storage.  Holding a reference keeps the
+                        // entry from being evicted while it is being copied.
+                        Util::QueryResult query = {};
+
+                        if (m_pMemoryLayer->Query(&cacheIds[i],
+                                                  0,
+                                                  Util::ICacheLayer::QueryFlags::AcquireEntryRef,
+                                                  &query) == Util::Result::Success)
                         {
-                            size_t           dataSize;
-                            const void*      pBinaryCacheData;
+                            const void* pBinaryCacheData = nullptr;
 
-                            result = PalToVkResult(LoadPipelineBinary(&cacheIds[i], &dataSize, &pBinaryCacheData));
-                            if (result == VK_SUCCESS)
+                            if ((remainingSpace >= (sizeof(ChecksummedCacheEntry) + query.dataSize)) &&
+                                (m_pMemoryLayer->GetCacheData(&query, &pBinaryCacheData) == Util::Result::Success))
                             {
-                                if (remainingSpace >= (sizeof(BinaryCacheEntry) + dataSize))
-                                {
-                                    BinaryCacheEntry* pEntry =  static_cast<BinaryCacheEntry*>(pDataDst);
+                                ChecksummedCacheEntry entry = {};
 
-                                    pEntry->hashId    = cacheIds[i];
-                                    pEntry->dataSize  = dataSize;
+                                entry.hashId   = cacheIds[i];
+                                entry.dataSize = query.dataSize;
+                                entry.checksum = GetEntryChecksum(&cacheIds[i], query.dataSize, pBinaryCacheData);
 
-                                    pDataDst = Util::VoidPtrInc(pDataDst, sizeof(BinaryCacheEntry));
-                                    memcpy(pDataDst, pBinaryCacheData, dataSize);
-                                    pDataDst = Util::VoidPtrInc(pDataDst, dataSize);
-                                    remainingSpace -= (sizeof(BinaryCacheEntry) + dataSize);
-                                }
-                                m_pInstance->FreeMem(const_cast<void*>(pBinaryCacheData));
+                                // Entries are packed back to back, so the header may not be naturally aligned.
+                                memcpy(pDataDst, &entry, sizeof(entry));
+                                pDataDst = Util::VoidPtrInc(pDataDst, sizeof(ChecksummedCacheEntry));
+                                memcpy(pDataDst, pBinaryCacheData, query.dataSize);
+                                pDataDst = Util::VoidPtrInc(pDataDst, query.dataSize);
+                                remainingSpace -= (sizeof(ChecksummedCacheEntry) + query.dataSize);
+
+                                ++entryCount;
                             }
+
+                            m_pMemoryLayer->ReleaseCacheRef(&query);
                         }
                     }
-                    if (*pSize < (sizeof(BinaryCacheEntry) * curCount + curDataSize + sizeof(PipelineBinaryCachePrivateHeader)))
+
+                    *pSize -= remainingSpace;
+
+                    const uint64_t platformKey = m_pPlatformKey->GetKey64();
+
+                    ChecksummedBlobHeader header = {};
+                    header.marker         = ChecksummedBlobMarker;
+                    header.flags          = m_deltaSnapshots ? ChecksummedBlobDelta : 0;
+                    header.entryCount     = entryCount;
+                    header.platformKey[0] = Util::LowPart(platformKey);
+                    header.platformKey[1] = Util::HighPart(platformKey);
+
+                    memcpy(pBlob, &header, sizeof(header));
+
+                    if (blobSize < requiredSize)
                     {
                         result = VK_INCOMPLETE;
                     }
-                    *pSize -= remainingSpace;
-
-                    auto pBinaryPrivateHeader = static_cast<PipelineBinaryCachePrivateHeader*>(pBlob);
-                    void* pData               = Util::VoidPtrInc(pBlob, sizeof(PipelineBinaryCachePrivateHeader));
+                    else if (m_deltaSnapshots)
+                    {
+                        // The application has everything up to here now.  A snapshot taken concurrently may have
+                        // covered more already.
+                        Util::MutexAuto lock(&m_entryLogLock);
 
-                    result = PalToVkResult(CalculateHashId(
-                                                m_pInstance,
-                                                m_pPlatformKey,
-                                                pData,
-                                                *pSize - sizeof(PipelineBinaryCachePrivateHeader),
-                                                pBinaryPrivateHeader->hashId));
+                        m_snapshotEntries = Util::Max(m_snapshotEntries, snapshotEnd);
+                    }
                 }
                 else
                 {
@@ -1371,6 +2601,8 @@ VkResult PipelineBinaryCache::Merge(
     {
         for (uint32_t i = 0; i < srcCacheCount; i++)
         {
+            ppSrcCaches[i]->WaitForInitialData();
+
             Util::ICacheLayer* pMemoryLayer = ppSrcCaches[i]->GetMemoryLayer();
             size_t curCount, curDataSize;
 
@@ -1382,20 +2614,28 @@ VkResult PipelineBinaryCache::Merge(
                 result = PalToVkResult(Util::GetMemoryCacheLayerHashIds(pMemoryLayer, curCount, &cacheIds[0]));
                 if (result == VK_SUCCESS)
                 {
-                    for (uint32_t j = 0; j < curCount; j++)
+                    for (uint32_t j = 0; (j < curCount) && (result == VK_SUCCESS); j++)
                     {
-                        size_t           dataSize;
-                        const void*      pBinaryCacheData;
-
-                        result = PalToVkResult(ppSrcCaches[i]->LoadPipelineBinary(&cacheIds[j], &dataSize, &pBinaryCacheData));
-                        if (result == VK_SUCCESS)
+                        Util::QueryResult query = {};
+
+                        // Entries already in this cache aren't touched at all, so the cost of a merge only depends on
+                        // the entries which are actually new.  These are stored straight from the source layer's
+                        // storage instead of through a temporary copy; the reference keeps the source entry alive
+                        // while it is being stored.
+                        if ((m_pMemoryLayer->Query(&cacheIds[j], 0, 0, &query) != Util::Result::Success) &&
+                            (pMemoryLayer->Query(&cacheIds[j],
+                                                 0,
+                                                 Util::ICacheLayer::QueryFlags::AcquireEntryRef,
+                                                 &query) == Util::Result::Success))
                         {
-                            result = PalToVkResult(StorePipelineBinary(&cacheIds[j], dataSize, pBinaryCacheData));
-                            m_pInstance->FreeMem(const_cast<void*>(pBinaryCacheData));
-                            if (result != VK_SUCCESS)
+                            const void* pBinaryCacheData = nullptr;
+
+                            if (pMemoryLayer->GetCacheData(&query, &pBinaryCacheData) == Util::Result::Success)
                             {
-                                break;
+                                result = PalToVkResult(StoreCacheEntry(&cacheIds[j], query.dataSize, pBinaryCacheData));
                             }
+
+                            pMemoryLayer->ReleaseCacheRef(&query);
                         }
                     }
                 }
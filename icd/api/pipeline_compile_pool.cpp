@@ -0,0 +1,295 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compile_pool.cpp
+* @brief Implementation of a driver-owned worker pool used to create batches of pipelines in parallel.
+***********************************************************************************************************************
+*/
+
+#include "include/pipeline_compile_pool.h"
+#include "include/vk_conv.h"
+#include "include/vk_instance.h"
+
+#include "palListImpl.h"
+#include "palSysUtil.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Allocates a pool and starts its worker threads.
+VkResult PipelineCompilePool::Create(
+    Instance*              pInstance,
+    uint32_t               threadCount,
+    PipelineCompilePool**  ppPool)
+{
+    VkResult result = VK_SUCCESS;
+    void*    pMem   = pInstance->AllocMem(sizeof(PipelineCompilePool), VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+
+    if (pMem != nullptr)
+    {
+        PipelineCompilePool* pPool = VK_PLACEMENT_NEW(pMem) PipelineCompilePool(pInstance);
+
+        result = pPool->Initialize(threadCount);
+
+        if (result == VK_SUCCESS)
+        {
+            *ppPool = pPool;
+        }
+        else
+        {
+            pPool->Destroy();
+        }
+    }
+    else
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Stops the worker threads and frees the pool.
+void PipelineCompilePool::Destroy()
+{
+    Instance* pInstance = m_pInstance;
+
+    Util::Destructor(this);
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+PipelineCompilePool::PipelineCompilePool(
+    Instance* pInstance)
+    :
+    m_pInstance(pInstance),
+    m_threadCount(0),
+    m_batches(pInstance->Allocator()),
+    m_stop(false)
+{
+}
+
+// =====================================================================================================================
+PipelineCompilePool::~PipelineCompilePool()
+{
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        m_stop = true;
+        m_workQueued.WakeAll();
+    }
+
+    for (uint32_t i = 0; i < m_threadCount; ++i)
+    {
+        m_threads[i].Join();
+    }
+
+    VK_ASSERT(m_batches.NumElements() == 0);
+}
+
+// =====================================================================================================================
+VkResult PipelineCompilePool::Initialize(
+    uint32_t threadCount)
+{
+    Util::Result palResult = m_lock.Init();
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_workQueued.Init();
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_batchDone.Init();
+    }
+
+    threadCount = Util::Min(threadCount, MaxThreads);
+
+    for (uint32_t i = 0; (palResult == Util::Result::Success) && (i < threadCount); ++i)
+    {
+        palResult = m_threads[i].Begin(ThreadFunc, this);
+
+        if (palResult == Util::Result::Success)
+        {
+            m_threadCount++;
+        }
+    }
+
+    // Running with fewer threads than requested is still correct as the submitting thread always participates.
+    return (m_threadCount > 0) ? VK_SUCCESS : PalToVkResult(palResult);
+}
+
+// =====================================================================================================================
+// Executes pfnWork for every index in [0, count) and returns once all of them have finished.  The calling thread works
+// on the batch alongside the pool threads.
+void PipelineCompilePool::Execute(
+    uint32_t count,
+    WorkFunc pfnWork,
+    void*    pPayload)
+{
+    Batch batch;
+    batch.pfnWork      = pfnWork;
+    batch.pPayload     = pPayload;
+    batch.count        = count;
+    batch.nextIndex    = 0;
+    batch.pendingCount = count;
+
+    bool queued = false;
+
+    if (count > 1)
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        if (m_batches.PushBack(&batch) == Util::Result::Success)
+        {
+            m_workQueued.WakeAll();
+            queued = true;
+        }
+    }
+
+    if (queued)
+    {
+        Batch*   pClaimedBatch = nullptr;
+        uint32_t index         = 0;
+
+        while (ClaimWork(&batch, &pClaimedBatch, &index))
+        {
+            RunWork(&batch, index);
+        }
+
+        Util::MutexAuto lock(&m_lock);
+
+        // Every index is claimed at this point; sleep until the pool threads still executing some of them are done.
+        // A timeout of UINT32_MAX waits without a timeout.
+        while (batch.pendingCount > 0)
+        {
+            m_batchDone.Wait(&m_lock, UINT32_MAX);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            pfnWork(pPayload, i);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Claims the next unclaimed index, either from the given batch or, if pBatch is null, from the oldest queued batch.
+// Returns false if there is no work left to claim.
+bool PipelineCompilePool::ClaimWork(
+    Batch*    pBatch,
+    Batch**   ppClaimedBatch,
+    uint32_t* pIndex)
+{
+    Util::MutexAuto lock(&m_lock);
+
+    bool claimed = false;
+    auto it      = m_batches.Begin();
+
+    while ((claimed == false) && (it.Get() != nullptr))
+    {
+        Batch* pCurrent = *it.Get();
+
+        if ((pBatch == nullptr) || (pBatch == pCurrent))
+        {
+            VK_ASSERT(pCurrent->nextIndex < pCurrent->count);
+
+            *ppClaimedBatch = pCurrent;
+            *pIndex         = pCurrent->nextIndex++;
+            claimed         = true;
+
+            // Batches are dequeued as soon as their last index is claimed so that nobody references them after the
+            // submitting thread returns.
+            if (pCurrent->nextIndex == pCurrent->count)
+            {
+                m_batches.Erase(&it);
+            }
+        }
+        else
+        {
+            it.Next();
+        }
+    }
+
+    return claimed;
+}
+
+// =====================================================================================================================
+void PipelineCompilePool::RunWork(
+    Batch*   pBatch,
+    uint32_t index)
+{
+    pBatch->pfnWork(pBatch->pPayload, index);
+
+    // The submitting thread may return and release the batch as soon as the lock is dropped.
+    Util::MutexAuto lock(&m_lock);
+
+    if (--pBatch->pendingCount == 0)
+    {
+        m_batchDone.WakeAll();
+    }
+}
+
+// =====================================================================================================================
+void PipelineCompilePool::ThreadFunc(
+    void* pParam)
+{
+    static_cast<PipelineCompilePool*>(pParam)->WorkerLoop();
+}
+
+// =====================================================================================================================
+void PipelineCompilePool::WorkerLoop()
+{
+    bool stop = false;
+
+    while (stop == false)
+    {
+        Batch*   pBatch = nullptr;
+        uint32_t index  = 0;
+
+        if (ClaimWork(nullptr, &pBatch, &index))
+        {
+            RunWork(pBatch, index);
+        }
+        else
+        {
+            Util::MutexAuto lock(&m_lock);
+
+            // Sleep until a batch is queued or the pool is destroyed.  A timeout of UINT32_MAX waits without a timeout.
+            while ((m_batches.NumElements() == 0) && (m_stop == false))
+            {
+                m_workQueued.Wait(&m_lock, UINT32_MAX);
+            }
+
+            stop = m_stop;
+        }
+    }
+}
+
+} // namespace vk
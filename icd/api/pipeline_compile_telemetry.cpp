@@ -0,0 +1,291 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compile_telemetry.cpp
+* @brief Implementation of per-pipeline compile records kept in a lock-free ring buffer
+***********************************************************************************************************************
+*/
+#include "include/pipeline_compile_telemetry.h"
+#include "include/vk_conv.h"
+#include "include/vk_instance.h"
+#include "utils/json_writer.h"
+
+#include "palInlineFuncs.h"
+#include "palJsonWriter.h"
+#include "palSysUtil.h"
+
+namespace vk
+{
+
+static constexpr const char* CacheTierNames[PipelineCacheTierCount] =
+{
+    "none",
+    "application",
+    "memory",
+    "archive",
+    "inFlight",
+    "shared",
+};
+
+// =====================================================================================================================
+PipelineCompileTelemetry::PipelineCompileTelemetry()
+    :
+    m_pInstance      { nullptr },
+    m_pSlots         { nullptr },
+    m_slotMask       { 0 },
+    m_nextTicket     { 0 },
+    m_flushedTicket  { 0 },
+    m_requestedTicket{ 0 },
+    m_stop           { false },
+    m_filePath       {}
+{
+}
+
+// =====================================================================================================================
+// Allocates the ring and starts the flush thread.  recordCount is rounded up to a power of two.
+VkResult PipelineCompileTelemetry::Init(
+    Instance*   pInstance,
+    uint32_t    recordCount,
+    const char* pFilePath)
+{
+    VK_ASSERT(recordCount > 0);
+    VK_ASSERT(m_pSlots == nullptr);
+
+    const uint32_t slotCount = Util::Pow2Pad(recordCount);
+
+    VkResult result = VK_SUCCESS;
+    void*    pMem   = nullptr;
+
+    if ((m_flushLock.Init() != Util::Result::Success) || (m_flushRequested.Init() != Util::Result::Success))
+    {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+    else
+    {
+        pMem = pInstance->AllocMem(sizeof(Slot) * slotCount, VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE);
+
+        if (pMem == nullptr)
+        {
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+    }
+
+    if (pMem != nullptr)
+    {
+        m_pInstance = pInstance;
+        m_pSlots    = static_cast<Slot*>(pMem);
+        m_slotMask  = slotCount - 1;
+
+        Util::Strncpy(m_filePath, pFilePath, sizeof(m_filePath));
+
+        for (uint32_t i = 0; i < slotCount; ++i)
+        {
+            VK_PLACEMENT_NEW(&m_pSlots[i]) Slot();
+            m_pSlots[i].sequence = 0;
+        }
+
+        result = PalToVkResult(m_flushThread.Begin(ThreadFunc, this));
+
+        if (result != VK_SUCCESS)
+        {
+            m_pInstance->FreeMem(m_pSlots);
+            m_pSlots = nullptr;
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Stops the flush thread, appends the records which haven't been written yet to the file and frees the ring.
+void PipelineCompileTelemetry::Destroy()
+{
+    if (m_pSlots != nullptr)
+    {
+        {
+            Util::MutexAuto lock(&m_flushLock);
+
+            m_stop = true;
+            m_flushRequested.WakeAll();
+        }
+
+        m_flushThread.Join();
+
+        Flush(m_nextTicket);
+
+        m_pInstance->FreeMem(m_pSlots);
+        m_pSlots = nullptr;
+    }
+}
+
+// =====================================================================================================================
+// Returns the sequence number of a ticket, which is never zero or SlotBusy.
+uint32_t PipelineCompileTelemetry::GetSequence(
+    uint64_t ticket)
+{
+    return static_cast<uint32_t>(ticket % (SlotBusy - 1)) + 1;
+}
+
+// =====================================================================================================================
+// Adds a record to the ring, overwriting the oldest one if the ring is full.
+void PipelineCompileTelemetry::Record(
+    const PipelineCompileRecord& record)
+{
+    if (m_pSlots != nullptr)
+    {
+        const uint64_t ticket   = Util::AtomicIncrement64(&m_nextTicket) - 1;
+        Slot&          slot     = m_pSlots[ticket & m_slotMask];
+        const uint32_t sequence = slot.sequence;
+
+        if ((sequence != SlotBusy) && (Util::AtomicCompareAndSwap(&slot.sequence, sequence, SlotBusy) == sequence))
+        {
+            slot.record = record;
+
+            // The compare and swap is a full barrier, so the record is visible before its sequence number.
+            Util::AtomicCompareAndSwap(&slot.sequence, SlotBusy, GetSequence(ticket));
+        }
+
+        // Every quarter of the ring, have the records which are a quarter of the ring old or older appended.  Their
+        // writers are long done, and they won't be overwritten before another quarter of the ring has been recorded.
+        const uint64_t quarter = Util::Max((static_cast<uint64_t>(m_slotMask) + 1) / 4, uint64_t(1));
+
+        if (((ticket + 1) % quarter) == 0)
+        {
+            Util::MutexAuto lock(&m_flushLock);
+
+            m_requestedTicket = Util::Max(m_requestedTicket, ticket + 1 - quarter);
+            m_flushRequested.WakeAll();
+        }
+    }
+}
+
+// =====================================================================================================================
+void PipelineCompileTelemetry::ThreadFunc(
+    void* pParam)
+{
+    static_cast<PipelineCompileTelemetry*>(pParam)->FlushLoop();
+}
+
+// =====================================================================================================================
+// Appends records to the file whenever recording asks for it, until the telemetry is destroyed.  The records still in
+// the ring then are appended by Destroy().
+void PipelineCompileTelemetry::FlushLoop()
+{
+    m_flushLock.Lock();
+
+    while (m_stop == false)
+    {
+        if (m_requestedTicket > m_flushedTicket)
+        {
+            const uint64_t endTicket = m_requestedTicket;
+
+            m_flushLock.Unlock();
+
+            Flush(endTicket);
+
+            m_flushLock.Lock();
+        }
+        else
+        {
+            // A timeout of UINT32_MAX waits without a timeout.
+            m_flushRequested.Wait(&m_flushLock, UINT32_MAX);
+        }
+    }
+
+    m_flushLock.Unlock();
+}
+
+// =====================================================================================================================
+// Appends the records from the last flush up to endTicket, oldest first, to the file as a single line of JSON.  Times
+// are written in microseconds.
+void PipelineCompileTelemetry::Flush(
+    uint64_t endTicket)
+{
+    const uint64_t slotCount   = static_cast<uint64_t>(m_slotMask) + 1;
+    const uint64_t beginTicket = Util::Max(m_flushedTicket, (endTicket > slotCount) ? (endTicket - slotCount) : 0);
+
+    if (endTicket > beginTicket)
+    {
+        const double usPerTick = 1000000.0 / static_cast<double>(Util::GetPerfFrequency());
+
+        // Records which were overwritten before they could be written out
+        uint64_t droppedRecords = beginTicket - m_flushedTicket;
+
+        utils::JsonOutputStream jsonStream(m_filePath);
+        Util::JsonWriter        jsonWriter(&jsonStream);
+
+        jsonWriter.BeginMap(true);
+        jsonWriter.KeyAndBeginList("records", true);
+
+        for (uint64_t ticket = beginTicket; ticket < endTicket; ++ticket)
+        {
+            Slot& slot = m_pSlots[ticket & m_slotMask];
+
+            // Compare and swap without a change reads the sequence number with a full barrier.
+            const uint32_t        sequence = Util::AtomicCompareAndSwap(&slot.sequence, 0, 0);
+            PipelineCompileRecord record   = slot.record;
+
+            // Skip the record if it was being written, got dropped, or was overwritten by a newer one while it was
+            // copied.
+            if ((sequence == GetSequence(ticket)) && (Util::AtomicCompareAndSwap(&slot.sequence, 0, 0) == sequence))
+            {
+                char apiHash[32]      = {};
+                char pipelineHash[32] = {};
+
+                Util::Snprintf(apiHash, sizeof(apiHash), "0x%016llX", record.apiHash);
+                Util::Snprintf(pipelineHash, sizeof(pipelineHash), "0x%016llX", record.pipelineHash);
+
+                jsonWriter.BeginMap(true);
+                jsonWriter.KeyAndValue("apiHash", apiHash);
+                jsonWriter.KeyAndValue("pipelineHash", pipelineHash);
+                jsonWriter.KeyAndValue("type",
+                    (record.bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) ? "compute" : "graphics");
+                jsonWriter.KeyAndValue("cacheTier", CacheTierNames[record.cacheTier]);
+                jsonWriter.KeyAndValue("convertUs", record.convertTime * usPerTick);
+                jsonWriter.KeyAndValue("hashUs", record.hashTime * usPerTick);
+                jsonWriter.KeyAndValue("cacheUs", record.cacheTime * usPerTick);
+                jsonWriter.KeyAndValue("compileUs", record.compileTime * usPerTick);
+                jsonWriter.KeyAndValue("palCreateUs", record.palCreateTime * usPerTick);
+                jsonWriter.KeyAndValue("totalUs", record.totalTime * usPerTick);
+                jsonWriter.EndMap();
+            }
+            else
+            {
+                ++droppedRecords;
+            }
+        }
+
+        jsonWriter.EndList();
+        jsonWriter.KeyAndValue("droppedRecords", droppedRecords);
+        jsonWriter.EndMap();
+
+        jsonStream.WriteCharacter('\n');
+
+        m_flushedTicket = endTicket;
+    }
+}
+
+} // namespace vk
@@ -63,6 +63,7 @@ PipelineCompiler::PipelineCompiler(
     m_pPhysicalDevice(pPhysicalDevice)
     , m_compilerSolutionLlpc(pPhysicalDevice)
     , m_pBinaryCache(nullptr)
+    , m_inFlightCompiles(pPhysicalDevice->VkInstance())
     , m_cacheAttempts(0)
     , m_cacheHits(0)
     , m_totalBinaries(0)
@@ -77,12 +78,13 @@ void PipelineCompiler::GetElfCacheMetricString(
     char*   pOutStr,
     size_t  outStrSize)
 {
-    const int64_t freq = Util::GetPerfFrequency();
+    const int64_t freq      = Util::GetPerfFrequency();
+    const int64_t timeSpent = static_cast<int64_t>(m_totalTimeSpent);
 
-    const int64_t avgUs = ((m_totalTimeSpent / m_totalBinaries) * 1000000) / freq;
+    const int64_t avgUs = ((timeSpent / m_totalBinaries) * 1000000) / freq;
     const double  avgMs = avgUs / 1000.0;
 
-    const int64_t totalUs = (m_totalTimeSpent * 1000000) / freq;
+    const int64_t totalUs = (timeSpent * 1000000) / freq;
     const double  totalMs = totalUs / 1000.0;
 
     const double  hitRate = m_cacheAttempts > 0 ?
@@ -95,7 +97,29 @@ void PipelineCompiler::GetElfCacheMetricString(
         "Total time spent - %0.1f ms\n"
         "Average time spent per request - %0.3f ms\n";
 
-    Util::Snprintf(pOutStr, outStrSize, metricFmtString, hitRate * 100, m_totalBinaries, totalMs, avgMs);
+    int length = Util::Snprintf(pOutStr, outStrSize, metricFmtString, hitRate * 100, m_totalBinaries, totalMs, avgMs);
+
+    if ((m_pBinaryCache != nullptr) && (length > 0) && (static_cast<size_t>(length) < outStrSize))
+    {
+        PipelineBinaryCacheStats stats = {};
+        m_pBinaryCache->GetStats(&stats);
+
+        static constexpr char binaryCacheFmtString[] =
+            "Binary cache hits - %u\n"
+            "Binary cache misses - %u\n"
+            "Binary cache evictions - %u\n"
+            "Binary cache resident size - %llu bytes\n"
+            "Binary cache prefetched entries - %u\n";
+
+        Util::Snprintf(pOutStr + length,
+                       outStrSize - length,
+                       binaryCacheFmtString,
+                       stats.hits,
+                       stats.misses,
+                       stats.evictions,
+                       static_cast<unsigned long long>(stats.residentBytes),
+                       stats.prefetches);
+    }
 }
 
 // =====================================================================================================================
@@ -152,6 +176,11 @@ VkResult PipelineCompiler::Initialize()
     // Create compiler objects
     VkResult result = VK_SUCCESS;
 
+    if (m_inFlightCompiles.Init() != Util::Result::Success)
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
     Vkgc::ICache* pCacheAdapter = nullptr;
     if ((result == VK_SUCCESS) &&
         ((settings.usePalPipelineCaching) ||
@@ -173,6 +202,17 @@ VkResult PipelineCompiler::Initialize()
         result = m_compilerSolutionLlpc.Initialize(m_gfxIp, info.gfxLevel, pCacheAdapter);
     }
 
+    // Pipelines are created just as well without the records, so failing to allocate them isn't fatal.
+    if ((result == VK_SUCCESS) && (settings.pipelineCompileTelemetryRecordCount > 0))
+    {
+        VkResult telemetryResult = m_telemetry.Init(
+            m_pPhysicalDevice->VkInstance(),
+            settings.pipelineCompileTelemetryRecordCount,
+            settings.pipelineCompileTelemetryFile);
+
+        VK_ALERT(telemetryResult != VK_SUCCESS);
+    }
+
 #if  PAL_BUILD_SHADER_DBG
     if ((result == VK_SUCCESS) && (strlen(settings.shaderDbgCfgDirectory) > 0))
     {
@@ -200,6 +240,17 @@ void PipelineCompiler::Destroy()
 {
     m_compilerSolutionLlpc.Destroy();
 
+    // Appends the records which haven't been written yet.
+    m_telemetry.Destroy();
+
+    if ((m_pBinaryCache != nullptr) && (m_totalBinaries > 0))
+    {
+        char metricString[1024] = {};
+        GetElfCacheMetricString(&metricString[0], sizeof(metricString));
+
+        AmdvlkLog(m_pPhysicalDevice->GetRuntimeSettings().logTagIdMask, PipelineCacheStats, "\n%s", &metricString[0]);
+    }
+
     if (m_pBinaryCache)
     {
         m_pBinaryCache->Destroy();
@@ -327,6 +378,15 @@ void PipelineCompiler::FreeShaderModule(
     m_compilerSolutionLlpc.FreeShaderModule(pShaderModule);
 }
 
+// =====================================================================================================================
+// Adds a reference to shader module data so that it outlives its shader module.  The reference is dropped by
+// FreeShaderModule().  Returns false if the module data isn't shared and so can't be referenced.
+bool PipelineCompiler::RetainShaderModule(
+    const ShaderModuleHandle* pShaderModule)
+{
+    return m_compilerSolutionLlpc.RetainShaderModule(pShaderModule);
+}
+
 // =====================================================================================================================
 // Replaces pipeline binary from external replacment file (<pipeline_name>_repalce.elf)
 template<class PipelineBuildInfo>
@@ -545,13 +605,14 @@ void PipelineCompiler::ReplacePipelineIsaCode(
 // Checks PAL Pipeline cache for existing pipeline binary.
 Util::Result PipelineCompiler::GetCachedPipelineBinary(
     const Util::MetroHash::Hash* pCacheId,
-    const PipelineBinaryCache*   pPipelineBinaryCache,
+    PipelineBinaryCache*         pPipelineBinaryCache,
     size_t*                      pPipelineBinarySize,
     const void**                 ppPipelineBinary,
     bool*                        pIsUserCacheHit,
     bool*                        pIsInternalCacheHit,
     bool*                        pFreeWithCompiler,
-    PipelineCreationFeedback*    pPipelineFeedback)
+    PipelineCreationFeedback*    pPipelineFeedback,
+    PipelineCacheTier*           pCacheTier)
 {
     Util::Result cacheResult = Util::Result::Success;
 
@@ -561,10 +622,11 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
         if (cacheResult == Util::Result::Success)
         {
             *pIsUserCacheHit = true;
+            *pCacheTier      = PipelineCacheTierApplication;
             pPipelineFeedback->hitApplicationCache = true;
         }
     }
-    m_cacheAttempts++;
+    Util::AtomicIncrement(&m_cacheAttempts);
 
     if (m_pBinaryCache != nullptr)
     {
@@ -577,7 +639,8 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
         }
         else
         {
-            cacheResult = m_pBinaryCache->LoadPipelineBinary(pCacheId, pPipelineBinarySize, ppPipelineBinary);
+            cacheResult = m_pBinaryCache->LoadPipelineBinary(
+                pCacheId, pPipelineBinarySize, ppPipelineBinary, pCacheTier);
         }
         if (cacheResult == Util::Result::Success)
         {
@@ -588,14 +651,53 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
     {
         *pFreeWithCompiler = false;
         cacheResult = Util::Result::Success;
-        m_cacheHits++;
+        Util::AtomicIncrement(&m_cacheHits);
     }
 
     return cacheResult;
 }
 
 // =====================================================================================================================
-// Creates partial pipeline binary.
+// Calculates the internal binary cache ID of a partial pipeline, which identifies the stage it is built from.
+void PipelineCompiler::GetPartialPipelineCacheId(
+    uint32_t                           deviceIdx,
+    const void*                        pShaderModuleData,
+    const Vkgc::ShaderModuleEntryData* pShaderModuleEntryData,
+    uint32_t                           mappingNodeCount,
+    const Vkgc::ColorTarget*           pColorTarget,
+    PipelineBinaryCache::CacheId*      pCacheId) const
+{
+    static constexpr char PartialPipelineTag[] = "PartialPipeline";
+
+    const RuntimeSettings& settings = m_pPhysicalDevice->GetRuntimeSettings();
+    const auto* pModuleData         = static_cast<const Vkgc::ShaderModuleDataEx*>(pShaderModuleData);
+
+    Util::MetroHash128 hash = {};
+
+    // The tag keeps stage IDs apart from full pipeline IDs.  The resource mapping of a partial pipeline is derived from
+    // the module data alone, so the module hash covers it except for the node count.
+    hash.Update(reinterpret_cast<const uint8_t*>(PartialPipelineTag), sizeof(PartialPipelineTag));
+    hash.Update(pModuleData->common.hash);
+    hash.Update(reinterpret_cast<const uint8_t*>(pShaderModuleEntryData->pEntryName),
+                strlen(pShaderModuleEntryData->pEntryName));
+    hash.Update(pShaderModuleEntryData->stage);
+    hash.Update(mappingNodeCount);
+
+    if (pShaderModuleEntryData->stage == Vkgc::ShaderStageFragment)
+    {
+        hash.Update(reinterpret_cast<const uint8_t*>(pColorTarget), sizeof(Vkgc::ColorTarget) * Vkgc::MaxColorTargets);
+    }
+
+    hash.Update(deviceIdx);
+    hash.Update(reinterpret_cast<const uint8_t*>(settings.llpcOptions), sizeof(settings.llpcOptions));
+    hash.Finalize(pCacheId->bytes);
+}
+
+// =====================================================================================================================
+// Creates partial pipeline binary.  The stage parts LLPC caches while building go to the internal binary cache, from
+// where full pipeline builds sharing the stage link them instead of compiling the stage again.  Nothing reads the
+// partial binary itself, so only a small marker is stored under the ID of the stage, to tell that stages which were
+// built before, in this or an earlier run, don't need to be built again.
 VkResult PipelineCompiler::CreatePartialPipelineBinary(
     uint32_t                             deviceIdx,
     void*                                pShaderModuleData,
@@ -608,8 +710,45 @@ VkResult PipelineCompiler::CreatePartialPipelineBinary(
     VkResult result = VK_SUCCESS;
     if (compilerMask & (1 << PipelineCompilerTypeLlpc))
     {
-        result = m_compilerSolutionLlpc.CreatePartialPipelineBinary(deviceIdx, pShaderModuleData, pShaderModuleEntryData,
-                pResourceMappingNode, mappingNodeCount, pColorTarget);
+        PipelineBinaryCache::CacheId cacheId  = {};
+        Vkgc::ICache*                pCache   = nullptr;
+        bool                         isCached = false;
+
+        if (m_pBinaryCache != nullptr)
+        {
+            GetPartialPipelineCacheId(deviceIdx, pShaderModuleData, pShaderModuleEntryData, mappingNodeCount,
+                pColorTarget, &cacheId);
+
+            Util::QueryResult query = {};
+
+            isCached = (m_pBinaryCache->QueryPipelineBinary(&cacheId, 0, &query) == Util::Result::Success);
+            pCache   = m_pBinaryCache->GetCacheAdapter();
+        }
+
+        if (isCached == false)
+        {
+            size_t      pipelineBinarySize = 0;
+            const void* pPipelineBinary    = nullptr;
+
+            result = m_compilerSolutionLlpc.CreatePartialPipelineBinary(deviceIdx, pShaderModuleData,
+                pShaderModuleEntryData, pResourceMappingNode, mappingNodeCount, pColorTarget, pCache,
+                &pipelineBinarySize, &pPipelineBinary);
+
+            if ((result == VK_SUCCESS) && (m_pBinaryCache != nullptr))
+            {
+                // Not empty, since cache layers may reject empty entries.
+                static constexpr uint32_t PartialPipelineMarker = 0x50505344; // "PPSD"
+
+                Util::Result cacheResult = m_pBinaryCache->StorePipelineBinary(
+                    &cacheId,
+                    sizeof(PartialPipelineMarker),
+                    &PartialPipelineMarker);
+
+                VK_ASSERT(Util::IsErrorResult(cacheResult) == false);
+            }
+
+            m_pPhysicalDevice->VkInstance()->FreeMem(const_cast<void*>(pPipelineBinary));
+        }
     }
 
     return result;
@@ -633,7 +772,15 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
     auto                   pInstance     = m_pPhysicalDevice->Manager()->VkInstance();
 
     int64_t compileTime = 0;
-    uint64_t pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&pCreateInfo->pipelineInfo);
+
+    // The hash doesn't depend on the device or the shader options, so the pipeline computes it once for the compiles of
+    // all its devices and tiers.
+    if (pCreateInfo->pipelineHash == 0)
+    {
+        pCreateInfo->pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&pCreateInfo->pipelineInfo);
+    }
+
+    uint64_t pipelineHash = pCreateInfo->pipelineHash;
 
     void* pPipelineDumpHandle = nullptr;
     const void* moduleDataBaks[ShaderStage::ShaderStageGfxCount];
@@ -696,9 +843,13 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
 
     int64_t cacheTime   = 0;
 
+    PipelineCacheTier cacheTier = PipelineCacheTierNone;
+
     bool isUserCacheHit     = false;
     bool isInternalCacheHit = false;
 
+    InFlightCompileTable::Compile* pInFlightCompile = nullptr;
+
     PipelineBinaryCache* pPipelineBinaryCache = nullptr;
 
     if ((pPipelineCache != nullptr) && (pPipelineCache->GetPipelineCache() != nullptr))
@@ -706,9 +857,12 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
         pPipelineBinaryCache = pPipelineCache->GetPipelineCache();
     }
 
-    if (shouldCompile && ((pPipelineBinaryCache != nullptr) || (m_pBinaryCache != nullptr)))
+    const int64_t hashStartTime = Util::GetPerfCpuTime();
+
+    // The ID is computed even if neither cache exists: the pipeline tier-up queue compiles optimized binaries without
+    // the application's pipeline cache, and stores them in that cache itself under this ID.
+    if (shouldCompile)
     {
-        int64_t startTime = Util::GetPerfCpuTime();
         Util::MetroHash128 hash = {};
         hash.Update(pipelineHash);
         hash.Update(pCreateInfo->pipelineInfo.vs.options);
@@ -728,15 +882,51 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
             hash.Update(reinterpret_cast<const uint8_t*>(settings.llpcOptions), sizeof(settings.llpcOptions));
         }
         hash.Finalize(pCacheId->bytes);
+    }
+
+    if (shouldCompile && ((pPipelineBinaryCache != nullptr) || (m_pBinaryCache != nullptr)))
+    {
+        const int64_t lookupStartTime = Util::GetPerfCpuTime();
 
         cacheResult = GetCachedPipelineBinary(pCacheId, pPipelineBinaryCache, pPipelineBinarySize, ppPipelineBinary,
-            &isUserCacheHit, &isInternalCacheHit, &pCreateInfo->freeWithCompiler, &pCreateInfo->pipelineFeedback);
+            &isUserCacheHit, &isInternalCacheHit, &pCreateInfo->freeWithCompiler, &pCreateInfo->pipelineFeedback,
+            &cacheTier);
         if (cacheResult == Util::Result::Success)
         {
             shouldCompile = false;
         }
+        else if ((pCreateInfo->flags & VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT) == 0)
+        {
+            // Another thread may be compiling this pipeline already; wait for its binary rather than compiling it twice.
+            shouldCompile = m_inFlightCompiles.Begin(pCacheId,
+                                                     &pInFlightCompile,
+                                                     pPipelineBinarySize,
+                                                     ppPipelineBinary);
+
+            if (shouldCompile == false)
+            {
+                Util::QueryResult query = {};
+
+                // The compiling thread normally stored the binary in the internal cache already.  If it didn't, this
+                // thread stores it below.
+                isInternalCacheHit            = (m_pBinaryCache != nullptr) &&
+                                                (m_pBinaryCache->QueryPipelineBinary(pCacheId, 0, &query) ==
+                                                 Util::Result::Success);
+                cacheTier                     = PipelineCacheTierInFlight;
+                pCreateInfo->freeWithCompiler = false;
+            }
+        }
 
-        cacheTime = Util::GetPerfCpuTime() - startTime;
+        const int64_t endTime = Util::GetPerfCpuTime();
+
+        cacheTime = endTime - hashStartTime;
+
+        pCreateInfo->compileRecord.hashTime  += lookupStartTime - hashStartTime;
+        pCreateInfo->compileRecord.cacheTime += endTime - lookupStartTime;
+    }
+    else
+    {
+        pCreateInfo->compileRecord.hashTime += Util::GetPerfCpuTime() - hashStartTime;
     }
 
     if (shouldCompile)
@@ -795,8 +985,20 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
         VK_ASSERT(Util::IsErrorResult(cacheResult) == false);
     }
 
-    m_totalTimeSpent += shouldCompile ? compileTime : cacheTime;
-    m_totalBinaries++;
+    if (pInFlightCompile != nullptr)
+    {
+        m_inFlightCompiles.End(pCacheId, pInFlightCompile, result, *pPipelineBinarySize, *ppPipelineBinary);
+    }
+
+    Util::AtomicAdd64(&m_totalTimeSpent, static_cast<uint64_t>(shouldCompile ? compileTime : cacheTime));
+    Util::AtomicIncrement(&m_totalBinaries);
+
+    pCreateInfo->compileRecord.compileTime += compileTime;
+
+    if (deviceIdx == DefaultDeviceIndex)
+    {
+        pCreateInfo->compileRecord.cacheTier = cacheTier;
+    }
 
     if (settings.shaderReplaceMode == ShaderReplaceShaderISA)
     {
@@ -845,10 +1047,20 @@ VkResult PipelineCompiler::CreateComputePipelineBinary(
     auto                   pInstance     = m_pPhysicalDevice->Manager()->VkInstance();
     bool                   shouldCompile = true;
 
-    pCreateInfo->pipelineInfo.deviceIndex = deviceIdx;
+    // The device index is part of the hash, so a hash computed for another device is computed again.
+    if (pCreateInfo->pipelineInfo.deviceIndex != deviceIdx)
+    {
+        pCreateInfo->pipelineInfo.deviceIndex = deviceIdx;
+        pCreateInfo->pipelineHash             = 0;
+    }
+
+    if (pCreateInfo->pipelineHash == 0)
+    {
+        pCreateInfo->pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&pCreateInfo->pipelineInfo);
+    }
 
     int64_t compileTime = 0;
-    uint64_t pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&pCreateInfo->pipelineInfo);
+    uint64_t pipelineHash = pCreateInfo->pipelineHash;
 
     void* pPipelineDumpHandle = nullptr;
     const void* pModuleDataBak = nullptr;
@@ -898,9 +1110,13 @@ VkResult PipelineCompiler::CreateComputePipelineBinary(
 
     int64_t cacheTime   = 0;
 
+    PipelineCacheTier cacheTier = PipelineCacheTierNone;
+
     bool isUserCacheHit     = false;
     bool isInternalCacheHit = false;
 
+    InFlightCompileTable::Compile* pInFlightCompile = nullptr;
+
     PipelineBinaryCache* pPipelineBinaryCache = nullptr;
 
     if ((pPipelineCache != nullptr) && (pPipelineCache->GetPipelineCache() != nullptr))
@@ -925,14 +1141,43 @@ VkResult PipelineCompiler::CreateComputePipelineBinary(
         }
         hash.Finalize(pCacheId->bytes);
 
+        const int64_t lookupStartTime = Util::GetPerfCpuTime();
+
         cacheResult = GetCachedPipelineBinary(pCacheId, pPipelineBinaryCache, pPipelineBinarySize, ppPipelineBinary,
-            &isUserCacheHit, &isInternalCacheHit, &pCreateInfo->freeWithCompiler, &pCreateInfo->pipelineFeedback);
+            &isUserCacheHit, &isInternalCacheHit, &pCreateInfo->freeWithCompiler, &pCreateInfo->pipelineFeedback,
+            &cacheTier);
         if (cacheResult == Util::Result::Success)
         {
             shouldCompile = false;
         }
+        else if ((pCreateInfo->flags & VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT) == 0)
+        {
+            // Another thread may be compiling this pipeline already; wait for its binary rather than compiling it twice.
+            shouldCompile = m_inFlightCompiles.Begin(pCacheId,
+                                                     &pInFlightCompile,
+                                                     pPipelineBinarySize,
+                                                     ppPipelineBinary);
+
+            if (shouldCompile == false)
+            {
+                Util::QueryResult query = {};
+
+                // The compiling thread normally stored the binary in the internal cache already.  If it didn't, this
+                // thread stores it below.
+                isInternalCacheHit            = (m_pBinaryCache != nullptr) &&
+                                                (m_pBinaryCache->QueryPipelineBinary(pCacheId, 0, &query) ==
+                                                 Util::Result::Success);
+                cacheTier                     = PipelineCacheTierInFlight;
+                pCreateInfo->freeWithCompiler = false;
+            }
+        }
 
-        cacheTime = Util::GetPerfCpuTime() - startTime;
+        const int64_t endTime = Util::GetPerfCpuTime();
+
+        cacheTime = endTime - startTime;
+
+        pCreateInfo->compileRecord.hashTime  += lookupStartTime - startTime;
+        pCreateInfo->compileRecord.cacheTime += endTime - lookupStartTime;
     }
 
     if (shouldCompile)
@@ -988,8 +1233,21 @@ VkResult PipelineCompiler::CreateComputePipelineBinary(
         VK_ASSERT(Util::IsErrorResult(cacheResult) == false);
     }
 
-    m_totalTimeSpent += shouldCompile ? compileTime : cacheTime;
-    m_totalBinaries++;
+    if (pInFlightCompile != nullptr)
+    {
+        m_inFlightCompiles.End(pCacheId, pInFlightCompile, result, *pPipelineBinarySize, *ppPipelineBinary);
+    }
+
+    Util::AtomicAdd64(&m_totalTimeSpent, static_cast<uint64_t>(shouldCompile ? compileTime : cacheTime));
+    Util::AtomicIncrement(&m_totalBinaries);
+
+    pCreateInfo->compileRecord.compileTime += compileTime;
+
+    if (deviceIdx == DefaultDeviceIndex)
+    {
+        pCreateInfo->compileRecord.cacheTier = cacheTier;
+    }
+
     if (settings.shaderReplaceMode == ShaderReplaceShaderISA)
     {
         ReplacePipelineIsaCode(pDevice, pipelineHash, 0, *ppPipelineBinary, *pPipelineBinarySize);
@@ -1032,15 +1290,7 @@ void PipelineCompiler::GetPipelineCreationInfoNext(
         case VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT:
             *ppPipelineCreationFeadbackCreateInfo =
                 reinterpret_cast<const VkPipelineCreationFeedbackCreateInfoEXT*>(pHeader);
-            VK_ASSERT((*ppPipelineCreationFeadbackCreateInfo)->pPipelineCreationFeedback != nullptr);
-            (*ppPipelineCreationFeadbackCreateInfo)->pPipelineCreationFeedback->flags = 0;
-            if ((*ppPipelineCreationFeadbackCreateInfo)->pPipelineStageCreationFeedbacks != nullptr)
-            {
-                for (uint32_t i = 0; i < (*ppPipelineCreationFeadbackCreateInfo)->pipelineStageCreationFeedbackCount; i++)
-                {
-                    (*ppPipelineCreationFeadbackCreateInfo)->pPipelineStageCreationFeedbacks[i].flags = 0;
-                }
-            }
+            ResetPipelineCreationFeedback(*ppPipelineCreationFeadbackCreateInfo);
             break;
         default:
             break;
@@ -1048,6 +1298,22 @@ void PipelineCompiler::GetPipelineCreationInfoNext(
     }
 }
 
+// =====================================================================================================================
+// Clears the feedback flags of the given pipeline creation feedback create info.
+void PipelineCompiler::ResetPipelineCreationFeedback(
+    const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeadbackCreateInfo)
+{
+    VK_ASSERT(pPipelineCreationFeadbackCreateInfo->pPipelineCreationFeedback != nullptr);
+    pPipelineCreationFeadbackCreateInfo->pPipelineCreationFeedback->flags = 0;
+    if (pPipelineCreationFeadbackCreateInfo->pPipelineStageCreationFeedbacks != nullptr)
+    {
+        for (uint32_t i = 0; i < pPipelineCreationFeadbackCreateInfo->pipelineStageCreationFeedbackCount; i++)
+        {
+            pPipelineCreationFeadbackCreateInfo->pPipelineStageCreationFeedbacks[i].flags = 0;
+        }
+    }
+}
+
 // =====================================================================================================================
 VkResult PipelineCompiler::SetPipelineCreationFeedbackInfo(
     const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeadbackCreateInfo,
@@ -1072,11 +1338,124 @@ VkResult PipelineCompiler::SetPipelineCreationFeedbackInfo(
     return VK_SUCCESS;
 }
 
+// =====================================================================================================================
+// Collects the structures of a graphics pipeline create info that both ConvertGraphicsPipelineInfo passes read, so that
+// each pNext chain is walked once per pipeline.  State create infos that the create info says to ignore are skipped,
+// since they may be invalid pointers.
+void PipelineCompiler::GetGraphicsPipelineExtStructs(
+    const VkGraphicsPipelineCreateInfo* pIn,
+    GraphicsPipelineExtStructs*         pExtStructs)
+{
+    *pExtStructs = {};
+
+    for (const VkStructHeader* pHeader = reinterpret_cast<const VkStructHeader*>(pIn);
+         pHeader != nullptr;
+         pHeader = pHeader->pNext)
+    {
+        switch (static_cast<uint32_t>(pHeader->sType))
+        {
+        case VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO:
+            pExtStructs->pGraphicsPipelineCreateInfo = reinterpret_cast<const VkGraphicsPipelineCreateInfo*>(pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT:
+            pExtStructs->pPipelineCreationFeedbackCreateInfo =
+                reinterpret_cast<const VkPipelineCreationFeedbackCreateInfoEXT*>(pHeader);
+            break;
+        default:
+            break;
+        }
+    }
+
+    const VkGraphicsPipelineCreateInfo* pCreateInfo = pExtStructs->pGraphicsPipelineCreateInfo;
+
+    if (pCreateInfo != nullptr)
+    {
+        VkShaderStageFlags activeStages = 0;
+
+        for (uint32_t i = 0; i < pCreateInfo->stageCount; ++i)
+        {
+            activeStages |= pCreateInfo->pStages[i].stage;
+        }
+
+        const VkPipelineTessellationStateCreateInfo* pTs = pCreateInfo->pTessellationState;
+
+        if ((activeStages & (VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT)) &&
+            (pTs != nullptr))
+        {
+            for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pTs->pNext);
+                 pHeader != nullptr;
+                 pHeader = pHeader->pNext)
+            {
+                if (static_cast<uint32_t>(pHeader->sType) ==
+                    VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_DOMAIN_ORIGIN_STATE_CREATE_INFO)
+                {
+                    pExtStructs->pTessellationDomainOriginState =
+                        reinterpret_cast<const VkPipelineTessellationDomainOriginStateCreateInfo*>(pHeader);
+                }
+            }
+        }
+
+        const VkPipelineRasterizationStateCreateInfo* pRs = pCreateInfo->pRasterizationState;
+
+        if (pRs != nullptr)
+        {
+            for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pRs->pNext);
+                 pHeader != nullptr;
+                 pHeader = pHeader->pNext)
+            {
+                switch (static_cast<uint32_t>(pHeader->sType))
+                {
+                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_RASTERIZATION_ORDER_AMD:
+                    pExtStructs->pRasterizationOrder =
+                        reinterpret_cast<const VkPipelineRasterizationStateRasterizationOrderAMD*>(pHeader);
+                    break;
+                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_CONSERVATIVE_STATE_CREATE_INFO_EXT:
+                    pExtStructs->pConservativeRasterizationState =
+                        reinterpret_cast<const VkPipelineRasterizationConservativeStateCreateInfoEXT*>(pHeader);
+                    break;
+                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_STREAM_CREATE_INFO_EXT:
+                    pExtStructs->pRasterizationStreamState =
+                        reinterpret_cast<const VkPipelineRasterizationStateStreamCreateInfoEXT*>(pHeader);
+                    break;
+                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_LINE_STATE_CREATE_INFO_EXT:
+                    pExtStructs->pRasterizationLineState =
+                        reinterpret_cast<const VkPipelineRasterizationLineStateCreateInfoEXT*>(pHeader);
+                    break;
+                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_DEPTH_CLIP_STATE_CREATE_INFO_EXT:
+                    pExtStructs->pDepthClipState =
+                        reinterpret_cast<const VkPipelineRasterizationDepthClipStateCreateInfoEXT*>(pHeader);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            const VkPipelineMultisampleStateCreateInfo* pMs = pCreateInfo->pMultisampleState;
+
+            if ((pRs->rasterizerDiscardEnable != VK_TRUE) && (pMs != nullptr))
+            {
+                for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pMs->pNext);
+                     pHeader != nullptr;
+                     pHeader = pHeader->pNext)
+                {
+                    if (static_cast<uint32_t>(pHeader->sType) ==
+                        VK_STRUCTURE_TYPE_PIPELINE_SAMPLE_LOCATIONS_STATE_CREATE_INFO_EXT)
+                    {
+                        pExtStructs->pSampleLocationsState =
+                            reinterpret_cast<const VkPipelineSampleLocationsStateCreateInfoEXT*>(pHeader);
+                    }
+                }
+            }
+        }
+    }
+}
+
 // =====================================================================================================================
 // Converts Vulkan graphics pipeline parameters to an internal structure
 VkResult PipelineCompiler::ConvertGraphicsPipelineInfo(
     Device*                                         pDevice,
     const VkGraphicsPipelineCreateInfo*             pIn,
+    const GraphicsPipelineExtStructs&               extStructs,
     GraphicsPipelineCreateInfo*                     pCreateInfo,
     VbBindingInfo*                                  pVbInfo,
     const VkPipelineCreationFeedbackCreateInfoEXT** ppPipelineCreationFeadbackCreateInfo)
@@ -1086,17 +1465,13 @@ VkResult PipelineCompiler::ConvertGraphicsPipelineInfo(
     auto                   pInstance = m_pPhysicalDevice->Manager()->VkInstance();
     auto                   flags     = pIn->flags;
 
-    EXTRACT_VK_STRUCTURES_0(
-        gfxPipeline,
-        GraphicsPipelineCreateInfo,
-        pIn,
-        GRAPHICS_PIPELINE_CREATE_INFO)
+    const VkGraphicsPipelineCreateInfo* pGraphicsPipelineCreateInfo = extStructs.pGraphicsPipelineCreateInfo;
 
-    if ((pIn != nullptr) && (ppPipelineCreationFeadbackCreateInfo != nullptr))
+    if ((ppPipelineCreationFeadbackCreateInfo != nullptr) &&
+        (extStructs.pPipelineCreationFeedbackCreateInfo != nullptr))
     {
-        GetPipelineCreationInfoNext(
-            reinterpret_cast<const VkStructHeader*>(pIn->pNext),
-            ppPipelineCreationFeadbackCreateInfo);
+        *ppPipelineCreationFeadbackCreateInfo = extStructs.pPipelineCreationFeedbackCreateInfo;
+        ResetPipelineCreationFeedback(*ppPipelineCreationFeadbackCreateInfo);
     }
 
     // Fill in necessary non-zero defaults in case some information is missing
@@ -1142,13 +1517,10 @@ VkResult PipelineCompiler::ConvertGraphicsPipelineInfo(
 
         if (activeStages & (VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT))
         {
-            EXTRACT_VK_STRUCTURES_1(
-                Tess,
-                PipelineTessellationStateCreateInfo,
-                PipelineTessellationDomainOriginStateCreateInfo,
-                pGraphicsPipelineCreateInfo->pTessellationState,
-                PIPELINE_TESSELLATION_STATE_CREATE_INFO,
-                PIPELINE_TESSELLATION_DOMAIN_ORIGIN_STATE_CREATE_INFO)
+            const VkPipelineTessellationStateCreateInfo* pPipelineTessellationStateCreateInfo =
+                pGraphicsPipelineCreateInfo->pTessellationState;
+            const VkPipelineTessellationDomainOriginStateCreateInfo* pPipelineTessellationDomainOriginStateCreateInfo =
+                extStructs.pTessellationDomainOriginState;
 
             if (pPipelineTessellationStateCreateInfo != nullptr)
             {
@@ -1182,27 +1554,9 @@ VkResult PipelineCompiler::ConvertGraphicsPipelineInfo(
             pCreateInfo->pipelineInfo.rsState.frontFace               = pRs->frontFace;
             pCreateInfo->pipelineInfo.rsState.depthBiasEnable         = pRs->depthBiasEnable;
 
-            union
-            {
-                const VkStructHeader*                                        pInfo;
-                const VkPipelineRasterizationDepthClipStateCreateInfoEXT*    pRsDepthClip;
-            };
-
-            pInfo = static_cast<const VkStructHeader*>(pRs->pNext);
-
-            while (pInfo != nullptr)
+            if (extStructs.pDepthClipState != nullptr)
             {
-                switch (static_cast<uint32_t>(pInfo->sType))
-                {
-                case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_DEPTH_CLIP_STATE_CREATE_INFO_EXT:
-                    pCreateInfo->pipelineInfo.vpState.depthClipEnable = pRsDepthClip->depthClipEnable;
-
-                    break;
-                default:
-                    break;
-                }
-
-                pInfo = pInfo->pNext;
+                pCreateInfo->pipelineInfo.vpState.depthClipEnable = extStructs.pDepthClipState->depthClipEnable;
             }
         }
 
@@ -1559,6 +1913,23 @@ uint32_t PipelineCompiler::GetCompilerCollectionMask()
     return availCompilerMask;
 }
 
+// =====================================================================================================================
+// Checks whether another compiler produces the same pipeline binaries as this one, apart from the device index that
+// shaders may read.  Devices of a device group share one binary if their compilers have the same target.
+bool PipelineCompiler::HasSameTarget(
+    const PipelineCompiler& other
+    ) const
+{
+    const RuntimeSettings& settings      = m_pPhysicalDevice->GetRuntimeSettings();
+    const RuntimeSettings& otherSettings = other.m_pPhysicalDevice->GetRuntimeSettings();
+
+    return (m_gfxIp.major    == other.m_gfxIp.major)    &&
+           (m_gfxIp.minor    == other.m_gfxIp.minor)    &&
+           (m_gfxIp.stepping == other.m_gfxIp.stepping) &&
+           (m_pPhysicalDevice->PalProperties().revision == other.m_pPhysicalDevice->PalProperties().revision) &&
+           (strcmp(settings.llpcOptions, otherSettings.llpcOptions) == 0);
+}
+
 // =====================================================================================================================
 void PipelineCompiler::ApplyPipelineOptions(
     const Device*            pDevice,
@@ -1785,6 +2156,39 @@ void PipelineCompiler::ApplyDefaultShaderOptions(
 
 }
 
+// =====================================================================================================================
+// Applies the shader options that trade shader performance for compile time.
+void PipelineCompiler::ApplyFastCompileShaderOptions(
+    Vkgc::PipelineShaderOptions* pShaderOptions)
+{
+    pShaderOptions->disableLoopUnroll = true;
+    pShaderOptions->disableLicm       = true;
+}
+
+// =====================================================================================================================
+// Switches every stage of a converted graphics pipeline to the fast shader options of the first tier of a tiered
+// pipeline.  This changes the pipeline's cache ID, so the fast binary is cached separately from the optimized one.
+void PipelineCompiler::ApplyFastCompileOptions(
+    GraphicsPipelineCreateInfo* pCreateInfo) const
+{
+    Vkgc::PipelineShaderInfo* shaderInfos[] =
+    {
+        &pCreateInfo->pipelineInfo.vs,
+        &pCreateInfo->pipelineInfo.tcs,
+        &pCreateInfo->pipelineInfo.tes,
+        &pCreateInfo->pipelineInfo.gs,
+        &pCreateInfo->pipelineInfo.fs
+    };
+
+    for (uint32_t stage = 0; stage < ShaderStage::ShaderStageGfxCount; ++stage)
+    {
+        if (shaderInfos[stage]->pModuleData != nullptr)
+        {
+            ApplyFastCompileShaderOptions(&shaderInfos[stage]->options);
+        }
+    }
+}
+
 // =====================================================================================================================
 // Builds app profile key and applies profile options.
 void PipelineCompiler::ApplyProfileOptions(
@@ -1839,6 +2243,15 @@ void PipelineCompiler::FreeComputePipelineBinary(
         }
 
     }
+    else if (m_inFlightCompiles.ReleaseSharedBinary(pPipelineBinary))
+    {
+        // The binary was shared with other threads waiting for the same compile.
+    }
+    else if (m_pBinaryCache != nullptr)
+    {
+        // The binary may point into one of the cache's mapped files, so let the cache release it.
+        m_pBinaryCache->FreePipelineBinary(pPipelineBinary);
+    }
     else
     {
         m_pPhysicalDevice->Manager()->VkInstance()->FreeMem(const_cast<void*>(pPipelineBinary));
@@ -1860,6 +2273,15 @@ void PipelineCompiler::FreeGraphicsPipelineBinary(
         }
 
     }
+    else if (m_inFlightCompiles.ReleaseSharedBinary(pPipelineBinary))
+    {
+        // The binary was shared with other threads waiting for the same compile.
+    }
+    else if (m_pBinaryCache != nullptr)
+    {
+        // The binary may point into one of the cache's mapped files, so let the cache release it.
+        m_pBinaryCache->FreePipelineBinary(pPipelineBinary);
+    }
     else
     {
         m_pPhysicalDevice->Manager()->VkInstance()->FreeMem(const_cast<void*>(pPipelineBinary));
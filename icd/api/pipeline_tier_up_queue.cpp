@@ -0,0 +1,635 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_tier_up_queue.cpp
+* @brief Implementation of the background queue that recompiles tiered graphics pipelines with full optimization
+***********************************************************************************************************************
+*/
+#include "include/pipeline_tier_up_queue.h"
+#include "include/api_state_copier.h"
+#include "include/pipeline_binary_cache.h"
+#include "include/pipeline_compiler.h"
+#include "include/vk_conv.h"
+#include "include/vk_device.h"
+#include "include/vk_graphics_pipeline.h"
+#include "include/vk_instance.h"
+#include "include/vk_pipeline_cache.h"
+
+#include "palListImpl.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Optimized recompile of one tiered graphics pipeline
+struct PipelineTierUpQueue::Job
+{
+    GraphicsPipeline*               pPipeline;           // Pipeline to install the optimized tier in, or null once
+                                                         // the pipeline is destroyed
+    PipelineCache*                  pPipelineCache;      // Application pipeline cache to also store the optimized
+                                                         // binary in, or null once the cache is destroyed
+    GraphicsPipelineCreateInfo      binaryCreateInfo;    // Compiler input with the optimized shader options
+    Pal::GraphicsPipelineCreateInfo palCreateInfo;       // PAL create info of the pipeline, minus its binary
+    uint32_t                        rasterizationStream; // Rasterization stream of the pipeline
+    uint32_t                        retainedStageMask;   // Stages whose module data the job holds a reference to
+    void*                           pApiState;           // Copies of the application memory the compiler input uses
+};
+
+// =====================================================================================================================
+// Copies the application memory a converted graphics pipeline references into the copier, and points the pipeline at
+// the copies.  The pipeline is left alone while the copier only adds up sizes.
+static void CopyApiState(
+    ApiStateCopier*                  pCopier,
+    Vkgc::GraphicsPipelineBuildInfo* pPipelineInfo)
+{
+    const VkPipelineVertexInputStateCreateInfo* pVertexInput = pPipelineInfo->pVertexInput;
+
+    if (pVertexInput != nullptr)
+    {
+        auto* pVertexInputCopy = pCopier->Copy(pVertexInput, 1);
+        auto* pBindings        = pCopier->Copy(pVertexInput->pVertexBindingDescriptions,
+                                               pVertexInput->vertexBindingDescriptionCount);
+        auto* pAttributes      = pCopier->Copy(pVertexInput->pVertexAttributeDescriptions,
+                                               pVertexInput->vertexAttributeDescriptionCount);
+
+        // The divisor state is the only extension structure of the vertex input state the compiler looks at.
+        const VkPipelineVertexInputDivisorStateCreateInfoEXT* pDivisorState = nullptr;
+
+        for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pVertexInput->pNext);
+             pHeader != nullptr;
+             pHeader = pHeader->pNext)
+        {
+            if (static_cast<uint32>(pHeader->sType) ==
+                VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_DIVISOR_STATE_CREATE_INFO_EXT)
+            {
+                pDivisorState = reinterpret_cast<const VkPipelineVertexInputDivisorStateCreateInfoEXT*>(pHeader);
+            }
+        }
+
+        VkPipelineVertexInputDivisorStateCreateInfoEXT* pDivisorStateCopy = nullptr;
+        VkVertexInputBindingDivisorDescriptionEXT*      pDivisors         = nullptr;
+
+        if (pDivisorState != nullptr)
+        {
+            pDivisorStateCopy = pCopier->Copy(pDivisorState, 1);
+            pDivisors         = pCopier->Copy(pDivisorState->pVertexBindingDivisors,
+                                              pDivisorState->vertexBindingDivisorCount);
+        }
+
+        if (pVertexInputCopy != nullptr)
+        {
+            pVertexInputCopy->pNext                        = pDivisorStateCopy;
+            pVertexInputCopy->pVertexBindingDescriptions   = pBindings;
+            pVertexInputCopy->pVertexAttributeDescriptions = pAttributes;
+
+            if (pDivisorStateCopy != nullptr)
+            {
+                pDivisorStateCopy->pNext                  = nullptr;
+                pDivisorStateCopy->pVertexBindingDivisors = pDivisors;
+            }
+
+            pPipelineInfo->pVertexInput = pVertexInputCopy;
+        }
+    }
+
+    Vkgc::PipelineShaderInfo* shaderInfos[] =
+    {
+        &pPipelineInfo->vs,
+        &pPipelineInfo->tcs,
+        &pPipelineInfo->tes,
+        &pPipelineInfo->gs,
+        &pPipelineInfo->fs
+    };
+
+    for (uint32_t stage = 0; stage < ShaderStage::ShaderStageGfxCount; ++stage)
+    {
+        Vkgc::PipelineShaderInfo* pShaderInfo = shaderInfos[stage];
+
+        const VkSpecializationInfo* pSpecInfo = pShaderInfo->pSpecializationInfo;
+
+        if (pSpecInfo != nullptr)
+        {
+            auto* pSpecInfoCopy = pCopier->Copy(pSpecInfo, 1);
+            auto* pMapEntries   = pCopier->Copy(pSpecInfo->pMapEntries, pSpecInfo->mapEntryCount);
+            auto* pData         = pCopier->Copy(static_cast<const uint8_t*>(pSpecInfo->pData), pSpecInfo->dataSize);
+
+            if (pSpecInfoCopy != nullptr)
+            {
+                pSpecInfoCopy->pMapEntries = pMapEntries;
+                pSpecInfoCopy->pData       = pData;
+
+                pShaderInfo->pSpecializationInfo = pSpecInfoCopy;
+            }
+        }
+
+        if (pShaderInfo->pEntryTarget != nullptr)
+        {
+            char* pEntryTarget = pCopier->Copy(pShaderInfo->pEntryTarget, strlen(pShaderInfo->pEntryTarget) + 1);
+
+            if (pEntryTarget != nullptr)
+            {
+                pShaderInfo->pEntryTarget = pEntryTarget;
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Creates the queue and starts its thread.
+VkResult PipelineTierUpQueue::Create(
+    Device*               pDevice,
+    PipelineTierUpQueue** ppQueue)
+{
+    VkResult result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    void*    pMem   = pDevice->VkInstance()->AllocMem(sizeof(PipelineTierUpQueue), VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+
+    if (pMem != nullptr)
+    {
+        PipelineTierUpQueue* pQueue = VK_PLACEMENT_NEW(pMem) PipelineTierUpQueue(pDevice);
+
+        result = pQueue->Initialize();
+
+        if (result == VK_SUCCESS)
+        {
+            *ppQueue = pQueue;
+        }
+        else
+        {
+            pQueue->Destroy();
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Stops the thread, drops the jobs that haven't run yet and frees the queue.
+void PipelineTierUpQueue::Destroy()
+{
+    Instance* const pInstance = m_pDevice->VkInstance();
+
+    this->~PipelineTierUpQueue();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+PipelineTierUpQueue::PipelineTierUpQueue(
+    Device* pDevice)
+    :
+    m_pDevice     { pDevice },
+    m_jobs        { pDevice->VkInstance()->Allocator() },
+    m_pRunningJob { nullptr },
+    m_stop        { false }
+{
+}
+
+// =====================================================================================================================
+PipelineTierUpQueue::~PipelineTierUpQueue()
+{
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        m_stop = true;
+        m_workQueued.WakeAll();
+    }
+
+    if (m_thread.IsCreated())
+    {
+        m_thread.Join();
+    }
+
+    // Every tiered pipeline cancels its job when it is destroyed, and the application must destroy its pipelines
+    // before the device.
+    VK_ASSERT(m_jobs.NumElements() == 0);
+
+    Job* pJob = nullptr;
+
+    while ((pJob = PopJob()) != nullptr)
+    {
+        DiscardJob(pJob);
+    }
+}
+
+// =====================================================================================================================
+VkResult PipelineTierUpQueue::Initialize()
+{
+    Util::Result palResult = m_lock.Init();
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_workQueued.Init();
+    }
+
+    if (palResult == Util::Result::Success)
+    {
+        palResult = m_thread.Begin(ThreadFunc, this);
+    }
+
+    return PalToVkResult(palResult);
+}
+
+// =====================================================================================================================
+// Returns true if a graphics pipeline can be created tiered.  Pipelines whose binary or PAL pipeline is exposed to the
+// application or to tools are always created optimized, since swapping them would go unnoticed by their observers.
+// That includes every pipeline which retains its binary, so Pipeline::GetBinary() never describes a fast tier.  Shader
+// statistics and debug names of the others go through Pipeline::PalPipeline(), which returns the optimized tier once
+// it is installed.
+// So are the pipelines of device groups: their devices share one compile input, but only the default device's pipeline
+// is swapped.
+bool PipelineTierUpQueue::IsTierable(
+    const Device*                       pDevice,
+    const VkGraphicsPipelineCreateInfo* pCreateInfo)
+{
+    constexpr VkPipelineCreateFlags UntierableFlags = VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT                |
+                                                      VK_PIPELINE_CREATE_CAPTURE_INTERNAL_REPRESENTATIONS_BIT_KHR |
+                                                      VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+
+    bool tierable = ((pCreateInfo->flags & UntierableFlags) == 0) &&
+                    (pDevice->NumPalDevices() == 1)                   &&
+                    (pDevice->IsExtensionEnabled(DeviceExtensions::AMD_SHADER_INFO) == false);
+
+#if ICD_GPUOPEN_DEVMODE_BUILD
+    tierable &= (pDevice->VkInstance()->GetDevModeMgr() == nullptr);
+#endif
+
+    return tierable;
+}
+
+// =====================================================================================================================
+// Builds the optimized compiler input of a pipeline about to be created tiered.  The job owns copies of everything it
+// needs, so the application may free its create info and destroy its shader modules once the pipeline is created.
+// Returns null on failure, in which case the pipeline should be created optimized.
+PipelineTierUpQueue::Job* PipelineTierUpQueue::PrepareJob(
+    const VkGraphicsPipelineCreateInfo* pCreateInfo)
+{
+    Instance* const   pInstance = m_pDevice->VkInstance();
+    PipelineCompiler* pCompiler = m_pDevice->GetCompiler(DefaultDeviceIndex);
+
+    Job* pJob = static_cast<Job*>(pInstance->AllocMem(sizeof(Job), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT));
+
+    bool prepared = (pJob != nullptr);
+
+    if (prepared)
+    {
+        memset(pJob, 0, sizeof(Job));
+
+        VbBindingInfo              vbInfo     = {};
+        GraphicsPipelineExtStructs extStructs = {};
+
+        PipelineCompiler::GetGraphicsPipelineExtStructs(pCreateInfo, &extStructs);
+
+        prepared = (pCompiler->ConvertGraphicsPipelineInfo(
+            m_pDevice, pCreateInfo, extStructs, &pJob->binaryCreateInfo, &vbInfo, nullptr) == VK_SUCCESS);
+    }
+
+    if (prepared)
+    {
+        const Vkgc::PipelineShaderInfo* shaderInfos[] =
+        {
+            &pJob->binaryCreateInfo.pipelineInfo.vs,
+            &pJob->binaryCreateInfo.pipelineInfo.tcs,
+            &pJob->binaryCreateInfo.pipelineInfo.tes,
+            &pJob->binaryCreateInfo.pipelineInfo.gs,
+            &pJob->binaryCreateInfo.pipelineInfo.fs
+        };
+
+        for (uint32_t stage = 0; prepared && (stage < ShaderStage::ShaderStageGfxCount); ++stage)
+        {
+            if (shaderInfos[stage]->pModuleData != nullptr)
+            {
+                ShaderModuleHandle handle = {};
+                handle.pLlpcShaderModule  = const_cast<void*>(shaderInfos[stage]->pModuleData);
+
+                prepared = pCompiler->RetainShaderModule(&handle);
+
+                if (prepared)
+                {
+                    pJob->retainedStageMask |= (1 << stage);
+                }
+            }
+        }
+    }
+
+    if (prepared)
+    {
+        ApiStateCopier sizer(nullptr);
+        CopyApiState(&sizer, &pJob->binaryCreateInfo.pipelineInfo);
+
+        if (sizer.GetSize() > 0)
+        {
+            pJob->pApiState = pInstance->AllocMem(sizer.GetSize(), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+            prepared        = (pJob->pApiState != nullptr);
+        }
+
+        if (prepared)
+        {
+            ApiStateCopier copier(pJob->pApiState);
+            CopyApiState(&copier, &pJob->binaryCreateInfo.pipelineInfo);
+        }
+    }
+
+    if ((prepared == false) && (pJob != nullptr))
+    {
+        DiscardJob(pJob);
+        pJob = nullptr;
+    }
+
+    return pJob;
+}
+
+// =====================================================================================================================
+// Queues a prepared job for the pipeline it was prepared for.  The job is owned by the queue from now on.
+void PipelineTierUpQueue::SubmitJob(
+    Job*                                   pJob,
+    GraphicsPipeline*                      pPipeline,
+    PipelineCache*                         pPipelineCache,
+    const Pal::GraphicsPipelineCreateInfo& palCreateInfo,
+    uint32_t                               rasterizationStream)
+{
+    pJob->pPipeline           = pPipeline;
+    pJob->pPipelineCache      = ((pPipelineCache != nullptr) && (pPipelineCache->GetPipelineCache() != nullptr)) ?
+                                pPipelineCache : nullptr;
+    pJob->palCreateInfo       = palCreateInfo;
+    pJob->rasterizationStream = rasterizationStream;
+
+    Util::Result palResult = Util::Result::Success;
+
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        palResult = m_jobs.PushBack(pJob);
+
+        if (palResult == Util::Result::Success)
+        {
+            m_workQueued.WakeAll();
+        }
+    }
+
+    if (palResult != Util::Result::Success)
+    {
+        // The pipeline simply stays on its fast tier.
+        DiscardJob(pJob);
+    }
+}
+
+// =====================================================================================================================
+// Frees a job that won't run (anymore).
+void PipelineTierUpQueue::DiscardJob(
+    Job* pJob)
+{
+    Instance* const   pInstance = m_pDevice->VkInstance();
+    PipelineCompiler* pCompiler = m_pDevice->GetCompiler(DefaultDeviceIndex);
+
+    const Vkgc::PipelineShaderInfo* shaderInfos[] =
+    {
+        &pJob->binaryCreateInfo.pipelineInfo.vs,
+        &pJob->binaryCreateInfo.pipelineInfo.tcs,
+        &pJob->binaryCreateInfo.pipelineInfo.tes,
+        &pJob->binaryCreateInfo.pipelineInfo.gs,
+        &pJob->binaryCreateInfo.pipelineInfo.fs
+    };
+
+    for (uint32_t stage = 0; stage < ShaderStage::ShaderStageGfxCount; ++stage)
+    {
+        if ((pJob->retainedStageMask & (1 << stage)) != 0)
+        {
+            ShaderModuleHandle handle = {};
+            handle.pLlpcShaderModule  = const_cast<void*>(shaderInfos[stage]->pModuleData);
+
+            pCompiler->FreeShaderModule(&handle);
+        }
+    }
+
+    pCompiler->FreeGraphicsPipelineCreateInfo(&pJob->binaryCreateInfo);
+
+    pInstance->FreeMem(pJob->pApiState);
+    pInstance->FreeMem(pJob);
+}
+
+// =====================================================================================================================
+// Drops the job of a pipeline that is being destroyed.  If the job is running, it finishes, but doesn't touch the
+// pipeline anymore.
+void PipelineTierUpQueue::Cancel(
+    const GraphicsPipeline* pPipeline)
+{
+    Job* pCancelledJob = nullptr;
+
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        for (auto it = m_jobs.Begin(); it.Get() != nullptr; it.Next())
+        {
+            if ((*it.Get())->pPipeline == pPipeline)
+            {
+                pCancelledJob = *it.Get();
+                m_jobs.Erase(&it);
+
+                break;
+            }
+        }
+
+        if ((m_pRunningJob != nullptr) && (m_pRunningJob->pPipeline == pPipeline))
+        {
+            m_pRunningJob->pPipeline = nullptr;
+        }
+    }
+
+    if (pCancelledJob != nullptr)
+    {
+        DiscardJob(pCancelledJob);
+    }
+}
+
+// =====================================================================================================================
+// Detaches a pipeline cache that is being destroyed from the jobs that would store their optimized binary in it.  The
+// running job stores its binary under the lock, so the cache isn't in use once this returns.
+void PipelineTierUpQueue::ForgetPipelineCache(
+    const PipelineCache* pPipelineCache)
+{
+    Util::MutexAuto lock(&m_lock);
+
+    for (auto it = m_jobs.Begin(); it.Get() != nullptr; it.Next())
+    {
+        if ((*it.Get())->pPipelineCache == pPipelineCache)
+        {
+            (*it.Get())->pPipelineCache = nullptr;
+        }
+    }
+
+    if ((m_pRunningJob != nullptr) && (m_pRunningJob->pPipelineCache == pPipelineCache))
+    {
+        m_pRunningJob->pPipelineCache = nullptr;
+    }
+}
+
+// =====================================================================================================================
+// Takes the oldest job off the queue and marks it as running.
+PipelineTierUpQueue::Job* PipelineTierUpQueue::PopJob()
+{
+    Util::MutexAuto lock(&m_lock);
+
+    Job* pJob = nullptr;
+    auto it   = m_jobs.Begin();
+
+    if (it.Get() != nullptr)
+    {
+        pJob = *it.Get();
+        m_jobs.Erase(&it);
+    }
+
+    m_pRunningJob = pJob;
+
+    return pJob;
+}
+
+// =====================================================================================================================
+// Compiles the optimized tier of a job's pipeline and installs it in the pipeline.
+void PipelineTierUpQueue::RunJob(
+    Job* pJob)
+{
+    Instance* const   pInstance  = m_pDevice->VkInstance();
+    PipelineCompiler* pCompiler  = m_pDevice->GetCompiler(DefaultDeviceIndex);
+    Pal::IDevice*     pPalDevice = m_pDevice->PalDevice(DefaultDeviceIndex);
+
+    size_t                binarySize = 0;
+    const void*           pBinary    = nullptr;
+    Util::MetroHash::Hash cacheId    = {};
+
+    // The application's pipeline cache may be destroyed while the binary compiles, so the compiler only stores it in
+    // the internal cache.  It is stored in the application's cache below, under the lock.
+    VkResult result = pCompiler->CreateGraphicsPipelineBinary(
+        m_pDevice,
+        DefaultDeviceIndex,
+        nullptr,
+        &pJob->binaryCreateInfo,
+        &binarySize,
+        &pBinary,
+        pJob->rasterizationStream,
+        &cacheId);
+
+    Pal::IPipeline* pPalPipeline    = nullptr;
+    void*           pPalPipelineMem = nullptr;
+
+    if (result == VK_SUCCESS)
+    {
+        Pal::GraphicsPipelineCreateInfo palCreateInfo = pJob->palCreateInfo;
+        palCreateInfo.pipelineBinarySize              = binarySize;
+        palCreateInfo.pPipelineBinary                 = pBinary;
+
+        Pal::Result  palResult = Pal::Result::Success;
+        const size_t palSize   = pPalDevice->GetGraphicsPipelineSize(palCreateInfo, &palResult);
+
+        if (palResult == Pal::Result::Success)
+        {
+            pPalPipelineMem = pInstance->AllocMem(palSize, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+            palResult       = (pPalPipelineMem != nullptr) ? Pal::Result::Success : Pal::Result::ErrorOutOfMemory;
+        }
+
+        if (palResult == Pal::Result::Success)
+        {
+            palResult = pPalDevice->CreateGraphicsPipeline(palCreateInfo, pPalPipelineMem, &pPalPipeline);
+        }
+
+        if (palResult != Pal::Result::Success)
+        {
+            pInstance->FreeMem(pPalPipelineMem);
+
+            pPalPipeline    = nullptr;
+            pPalPipelineMem = nullptr;
+        }
+
+        {
+            Util::MutexAuto lock(&m_lock);
+
+            if (pJob->pPipelineCache != nullptr)
+            {
+                const Util::Result cacheResult = pJob->pPipelineCache->GetPipelineCache()->StorePipelineBinary(
+                    &cacheId,
+                    binarySize,
+                    pBinary);
+
+                VK_ASSERT(Util::IsErrorResult(cacheResult) == false);
+            }
+        }
+
+        pCompiler->FreeGraphicsPipelineBinary(&pJob->binaryCreateInfo, pBinary, binarySize);
+    }
+
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        if ((pPalPipeline != nullptr) && (pJob->pPipeline != nullptr))
+        {
+            pJob->pPipeline->InstallOptimizedTier(pPalPipeline, pPalPipelineMem);
+
+            pPalPipeline = nullptr;
+        }
+
+        m_pRunningJob = nullptr;
+    }
+
+    // The pipeline was destroyed while its optimized tier was being compiled.
+    if (pPalPipeline != nullptr)
+    {
+        pPalPipeline->Destroy();
+        pInstance->FreeMem(pPalPipelineMem);
+    }
+
+    DiscardJob(pJob);
+}
+
+// =====================================================================================================================
+void PipelineTierUpQueue::ThreadFunc(
+    void* pParam)
+{
+    static_cast<PipelineTierUpQueue*>(pParam)->WorkerLoop();
+}
+
+// =====================================================================================================================
+void PipelineTierUpQueue::WorkerLoop()
+{
+    while (m_stop == false)
+    {
+        Job* pJob = PopJob();
+
+        if (pJob != nullptr)
+        {
+            RunJob(pJob);
+        }
+        else
+        {
+            Util::MutexAuto lock(&m_lock);
+
+            // A timeout of UINT32_MAX waits without a timeout.
+            while ((m_jobs.NumElements() == 0) && (m_stop == false))
+            {
+                m_workQueued.Wait(&m_lock, UINT32_MAX);
+            }
+        }
+    }
+}
+
+} // namespace vk
@@ -0,0 +1,419 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shared_pipeline_cache.cpp
+* @brief Implementation of a pipeline binary cache in shared memory, shared by the processes of an application
+***********************************************************************************************************************
+*/
+#if defined(__unix__)
+#include "include/shared_pipeline_cache.h"
+#include "include/vk_instance.h"
+
+#include "palInlineFuncs.h"
+#include "palSysUtil.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vk
+{
+
+static constexpr uint32_t SharedCacheMagic      = 0x43505653;  // "SVPC"
+static constexpr uint32_t SharedCacheFormatting = 0x46505653;  // "SVPF"
+static constexpr size_t   MaxSharedCacheSize = 1u << 30;    // Keeps heap offsets well within 32 bits
+static constexpr size_t   BytesPerBucket     = 16 * 1024;   // Expected average size of a pipeline binary
+static constexpr uint32_t MinBucketCount     = 64;
+static constexpr uint32_t MaxProbes          = 64;          // Buckets a lookup or insertion inspects at most
+static constexpr uint32_t HeapAlignment      = 64;          // Alignment of binaries in the data heap
+
+// =====================================================================================================================
+// Opens the shared cache of the given name, creating it with the given size if it doesn't exist yet.  A cache created
+// by another process keeps the size it was created with.  Returns nullptr on failure.
+SharedPipelineCache* SharedPipelineCache::Create(
+    Instance*   pInstance,
+    const char* pName,
+    size_t      size,
+    uint64_t    platformKey)
+{
+    VK_ASSERT(pName != nullptr);
+
+    SharedPipelineCache* pCache = nullptr;
+
+    void* pMem = pInstance->AllocMem(sizeof(SharedPipelineCache), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if (pMem != nullptr)
+    {
+        pCache = VK_PLACEMENT_NEW(pMem) SharedPipelineCache(pInstance);
+
+        if (pCache->Initialize(pName, Util::Min(size, MaxSharedCacheSize), platformKey) != VK_SUCCESS)
+        {
+            pCache->Destroy();
+            pCache = nullptr;
+        }
+    }
+
+    return pCache;
+}
+
+// =====================================================================================================================
+void SharedPipelineCache::Destroy()
+{
+    Instance* const pInstance = m_pInstance;
+
+    this->~SharedPipelineCache();
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+SharedPipelineCache::SharedPipelineCache(
+    Instance* pInstance)
+    :
+    m_pInstance   { pInstance },
+    m_name        {},
+    m_device      { 0 },
+    m_inode       { 0 },
+    m_platformKey { 0 },
+    m_pMapping    { nullptr },
+    m_mappingSize { 0 },
+    m_pHeader     { nullptr },
+    m_pBuckets    { nullptr },
+    m_bucketCount { 0 },
+    m_pHeap       { nullptr },
+    m_heapSize    { 0 },
+    m_ready       { false },
+    m_retired     { 0 }
+{
+}
+
+// =====================================================================================================================
+SharedPipelineCache::~SharedPipelineCache()
+{
+    // The shared memory itself stays, for the other processes and the next run.
+    Unmap();
+}
+
+// =====================================================================================================================
+// Maps the shared memory.  If it holds binaries of another platform key or another layout, it is retired and a new
+// cache is created in its place.
+VkResult SharedPipelineCache::Initialize(
+    const char* pName,
+    size_t      size,
+    uint64_t    platformKey)
+{
+    Util::Strncpy(m_name, pName, sizeof(m_name));
+
+    m_platformKey = platformKey;
+
+    VkResult result = Map(size);
+
+    if ((result == VK_SUCCESS) && (AcceptHeader(platformKey) == false))
+    {
+        Retire();
+        Unmap();
+
+        m_retired = 0;
+
+        result = Map(size);
+
+        if ((result == VK_SUCCESS) && (AcceptHeader(platformKey) == false))
+        {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Opens or creates the shared memory and computes where the buckets and the data heap are.  The layout only depends on
+// the size, and freshly sized shared memory is zeroed, which is an empty cache, so only the header has to be written.
+VkResult SharedPipelineCache::Map(
+    size_t size)
+{
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+
+    // Only the process that creates the memory sizes it.  Sizing it again could shrink it under another process.
+    int  fd      = shm_open(m_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    bool created = (fd >= 0);
+
+    if (created)
+    {
+        if (ftruncate(fd, size) != 0)
+        {
+            close(fd);
+            shm_unlink(m_name);
+            fd = -1;
+        }
+    }
+    else
+    {
+        fd = shm_open(m_name, O_RDWR | O_CLOEXEC, 0600);
+    }
+
+    if (fd >= 0)
+    {
+        struct stat memStat = {};
+
+        // Memory that another process has created but not sized yet fails the size check, and this process runs
+        // without the shared cache rather than wait for the other one.
+        const size_t mappingSize = (fstat(fd, &memStat) == 0) ? static_cast<size_t>(memStat.st_size) : 0;
+        const size_t bucketCount = Util::Max(static_cast<size_t>(MinBucketCount), mappingSize / BytesPerBucket);
+        const size_t heapOffset  = Util::Pow2Align(sizeof(Header) + (bucketCount * sizeof(Bucket)), HeapAlignment);
+
+        if ((mappingSize > heapOffset) && (mappingSize <= MaxSharedCacheSize))
+        {
+            void* pMapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (pMapping != MAP_FAILED)
+            {
+                m_device      = static_cast<uint64_t>(memStat.st_dev);
+                m_inode       = static_cast<uint64_t>(memStat.st_ino);
+                m_pMapping    = pMapping;
+                m_mappingSize = mappingSize;
+                m_pHeader     = static_cast<Header*>(pMapping);
+                m_pBuckets    = static_cast<Bucket*>(Util::VoidPtrInc(pMapping, sizeof(Header)));
+                m_bucketCount = static_cast<uint32_t>(bucketCount);
+                m_pHeap       = Util::VoidPtrInc(pMapping, heapOffset);
+                m_heapSize    = static_cast<uint32_t>(mappingSize - heapOffset);
+
+                result = VK_SUCCESS;
+            }
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+void SharedPipelineCache::Unmap()
+{
+    if (m_pMapping != nullptr)
+    {
+        munmap(m_pMapping, m_mappingSize);
+
+        m_pMapping    = nullptr;
+        m_mappingSize = 0;
+        m_pHeader     = nullptr;
+        m_pBuckets    = nullptr;
+        m_bucketCount = 0;
+        m_pHeap       = nullptr;
+        m_heapSize    = 0;
+    }
+}
+
+// =====================================================================================================================
+// Writes the header if the memory is empty.  Returns false if another process wrote a header that doesn't fit, in
+// which case the memory can't be used.  A header another process is writing just now is accepted; the cache reports
+// misses until it is written.
+bool SharedPipelineCache::AcceptHeader(
+    uint64_t platformKey)
+{
+    if (Util::AtomicCompareAndSwap(&m_pHeader->magic, 0, SharedCacheFormatting) == 0)
+    {
+        m_pHeader->platformKey[0] = static_cast<uint32_t>(platformKey);
+        m_pHeader->platformKey[1] = static_cast<uint32_t>(platformKey >> 32);
+
+        // The swap is a full barrier, so the key is visible to anyone who sees the magic.
+        Util::AtomicCompareAndSwap(&m_pHeader->magic, SharedCacheFormatting, SharedCacheMagic);
+    }
+
+    const uint32_t magic = Util::AtomicCompareAndSwap(&m_pHeader->magic, 0, 0);
+
+    return (magic == SharedCacheFormatting) || IsReady();
+}
+
+// =====================================================================================================================
+// Returns true once the header has been written with the platform key of this process.
+bool SharedPipelineCache::IsReady() const
+{
+    if (m_ready == false)
+    {
+        // The swap doesn't change the magic; it reads it with a full barrier, so the key written before it is seen.
+        const uint32_t magic = Util::AtomicCompareAndSwap(&m_pHeader->magic, 0, 0);
+
+        m_ready = (magic == SharedCacheMagic)                                         &&
+                  (m_pHeader->platformKey[0] == static_cast<uint32_t>(m_platformKey))       &&
+                  (m_pHeader->platformKey[1] == static_cast<uint32_t>(m_platformKey >> 32));
+    }
+
+    return m_ready;
+}
+
+// =====================================================================================================================
+// Unlinks the name of the shared memory, unless it already names a newer cache, so that the next process to start
+// creates a new cache.  The memory itself stays until every process using it has unmapped it.
+void SharedPipelineCache::Retire()
+{
+    if (Util::AtomicCompareAndSwap(&m_retired, 0, 1) == 0)
+    {
+        const int fd = shm_open(m_name, O_RDONLY | O_CLOEXEC, 0600);
+
+        if (fd >= 0)
+        {
+            struct stat memStat = {};
+
+            const bool current = (fstat(fd, &memStat) == 0)                          &&
+                                 (static_cast<uint64_t>(memStat.st_dev) == m_device) &&
+                                 (static_cast<uint64_t>(memStat.st_ino) == m_inode);
+
+            close(fd);
+
+            if (current)
+            {
+                shm_unlink(m_name);
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Looks up a binary.  The returned pointer points into the shared memory, stays valid until the cache is destroyed and
+// must not be freed.
+bool SharedPipelineCache::FindBinary(
+    const CacheId* pCacheId,
+    size_t*        pDataSize,
+    const void**   ppData) const
+{
+    bool found = false;
+    bool done  = (IsReady() == false);
+
+    const uint32_t firstBucket = pCacheId->dwords[0] % m_bucketCount;
+
+    for (uint32_t probe = 0; (done == false) && (probe < MaxProbes); ++probe)
+    {
+        Bucket* const pBucket = &m_pBuckets[(firstBucket + probe) % m_bucketCount];
+
+        // The swap doesn't change the state; it reads it with a full barrier, so the fields written before the bucket
+        // was marked ready are seen as well.
+        const uint32_t state = Util::AtomicCompareAndSwap(&pBucket->state, BucketReady, BucketReady);
+
+        if (state == BucketEmpty)
+        {
+            // Insertions fill buckets in probe order, so the binary isn't further down the sequence either.
+            done = true;
+        }
+        else if ((state == BucketReady) && (memcmp(&pBucket->cacheId, pCacheId, sizeof(CacheId)) == 0))
+        {
+            done = true;
+
+            // Other processes write this memory, so don't trust the entry blindly.
+            if ((pBucket->offset <= m_heapSize) && (pBucket->dataSize <= (m_heapSize - pBucket->offset)))
+            {
+                *pDataSize = pBucket->dataSize;
+                *ppData    = Util::VoidPtrInc(m_pHeap, pBucket->offset);
+                found      = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+// =====================================================================================================================
+// Adds a binary to the cache, unless it is there already or the cache is full.
+void SharedPipelineCache::StoreBinary(
+    const CacheId* pCacheId,
+    size_t         dataSize,
+    const void*    pData)
+{
+    const uint32_t allocSize = static_cast<uint32_t>(Util::Pow2Align(Util::Min(dataSize, MaxSharedCacheSize),
+                                                                     HeapAlignment));
+
+    size_t      foundSize = 0;
+    const void* pFound    = nullptr;
+
+    if ((dataSize > 0)             &&
+        (dataSize <= m_heapSize)   &&
+        IsReady()                  &&
+        (FindBinary(pCacheId, &foundSize, &pFound) == false))
+    {
+        // The check before reserving keeps the heap counter from running far past the heap once it is full.
+        bool     full     = (allocSize > (m_heapSize - Util::Min(m_pHeader->usedBytes, m_heapSize)));
+        uint32_t heapEnd  = 0;
+        Bucket*  pClaimed = nullptr;
+
+        if (full == false)
+        {
+            heapEnd = Util::AtomicAdd(&m_pHeader->usedBytes, allocSize);
+            full    = (heapEnd > m_heapSize);
+        }
+
+        if (full == false)
+        {
+            const uint32_t firstBucket = pCacheId->dwords[0] % m_bucketCount;
+
+            for (uint32_t probe = 0; (pClaimed == nullptr) && (probe < MaxProbes); ++probe)
+            {
+                Bucket* const pBucket = &m_pBuckets[(firstBucket + probe) % m_bucketCount];
+
+                if (Util::AtomicCompareAndSwap(&pBucket->state, BucketEmpty, BucketClaimed) == BucketEmpty)
+                {
+                    pClaimed = pBucket;
+                }
+            }
+
+            // If no bucket is free, the reserved heap space is lost; the cache is about full at that point anyway.
+            full = (pClaimed == nullptr);
+        }
+
+        if (pClaimed != nullptr)
+        {
+            const uint32_t offset = heapEnd - allocSize;
+
+            pClaimed->dataSize = static_cast<uint32_t>(dataSize);
+            pClaimed->offset   = offset;
+            pClaimed->cacheId  = *pCacheId;
+
+            memcpy(Util::VoidPtrInc(m_pHeap, offset), pData, dataSize);
+
+            // Publish the entry.  The swap is a full barrier, so readers that see it ready see its data too.
+            Util::AtomicCompareAndSwap(&pClaimed->state, BucketClaimed, BucketReady);
+        }
+
+        if (full)
+        {
+            Retire();
+        }
+    }
+}
+
+// =====================================================================================================================
+// Returns true if the given binary was handed out from the shared memory and must not be freed
+bool SharedPipelineCache::ContainsBinary(
+    const void* pPipelineBinary) const
+{
+    return (m_pMapping != nullptr) &&
+           (pPipelineBinary >= m_pMapping) &&
+           (pPipelineBinary < Util::VoidPtrInc(m_pMapping, m_mappingSize));
+}
+
+} // namespace vk
+#endif
@@ -23,6 +23,7 @@
  *
  **********************************************************************************************************************/
 
+#include "include/pipeline_device_group.h"
 #include "include/vk_cmdbuffer.h"
 #include "include/vk_compute_pipeline.h"
 #include "include/vk_conv.h"
@@ -136,22 +137,40 @@ VkResult ComputePipeline::Create(
     PipelineCompiler*         pDefaultCompiler                   = pDevice->GetCompiler(DefaultDeviceIndex);
     ComputePipelineCreateInfo binaryCreateInfo                   = {};
     uint64_t                  apiPsoHash                         = BuildApiHash(pCreateInfo, &binaryCreateInfo.basePipelineHash);
+    const int64_t             convertStartTime                   = Util::GetPerfCpuTime();
 
     const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeadbackCreateInfo = nullptr;
     VkResult result = pDefaultCompiler->ConvertComputePipelineInfo(
         pDevice, pCreateInfo, &binaryCreateInfo, &pPipelineCreationFeadbackCreateInfo);
+    const int64_t convertEndTime = Util::GetPerfCpuTime();
 
     uint64_t pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&binaryCreateInfo.pipelineInfo);
-    for (uint32_t deviceIdx = 0; (result == VK_SUCCESS) && (deviceIdx < pDevice->NumPalDevices()); deviceIdx++)
+
+    binaryCreateInfo.pipelineHash = pipelineHash;
+
+    binaryCreateInfo.compileRecord.convertTime = convertEndTime - convertStartTime;
+    binaryCreateInfo.compileRecord.hashTime    = (convertStartTime - startTime) +
+                                                 (Util::GetPerfCpuTime() - convertEndTime);
+
+    bool     freeWithCompiler[MaxPalDevices] = {};
+    uint32_t binarySources[MaxPalDevices]    = {};
+
+    if (result == VK_SUCCESS)
     {
-        result = pDevice->GetCompiler(deviceIdx)->CreateComputePipelineBinary(
+        const ShaderModule* pModule = ShaderModule::ObjectFromHandle(pCreateInfo->stage.module);
+
+        result = CreateDeviceGroupBinaries(
             pDevice,
-            deviceIdx,
             pPipelineCache,
             &binaryCreateInfo,
-            &pipelineBinarySizes[deviceIdx],
-            &pPipelineBinaries[deviceIdx],
-            &cacheId[deviceIdx]);
+            0,
+            (pModule == nullptr) || pModule->ReadsDeviceIndex(),
+            pPipelineCreationFeadbackCreateInfo,
+            pipelineBinarySizes,
+            pPipelineBinaries,
+            cacheId,
+            binarySources,
+            freeWithCompiler);
     }
 
     if (result != VK_SUCCESS)
@@ -201,7 +220,8 @@ VkResult ComputePipeline::Create(
 
     if (result == VK_SUCCESS)
     {
-        void* pPalMem = Util::VoidPtrInc(pSystemMem, sizeof(ComputePipeline));
+        const int64_t palCreateStartTime = Util::GetPerfCpuTime();
+        void*         pPalMem            = Util::VoidPtrInc(pSystemMem, sizeof(ComputePipeline));
 
         for (uint32_t deviceIdx = 0;
             ((deviceIdx < pDevice->NumPalDevices()) && (palResult == Pal::Result::Success));
@@ -258,6 +278,8 @@ VkResult ComputePipeline::Create(
         }
 
         result = PalToVkResult(palResult);
+
+        binaryCreateInfo.compileRecord.palCreateTime = Util::GetPerfCpuTime() - palCreateStartTime;
     }
 
     // Retain a copy of the pipeline binary if an extension that can query it is enabled
@@ -301,8 +323,11 @@ VkResult ComputePipeline::Create(
     // Free the created pipeline binaries now that the PAL Pipelines/PipelineBinaryInfo have read them.
     for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); deviceIdx++)
     {
-        if (pPipelineBinaries[deviceIdx] != nullptr)
+        // Devices sharing the binary of another device don't own it.
+        if ((pPipelineBinaries[deviceIdx] != nullptr) && (binarySources[deviceIdx] == deviceIdx))
         {
+            binaryCreateInfo.freeWithCompiler = freeWithCompiler[deviceIdx];
+
             pDevice->GetCompiler(deviceIdx)->FreeComputePipelineBinary(
                 &binaryCreateInfo, pPipelineBinaries[deviceIdx], pipelineBinarySizes[deviceIdx]);
         }
@@ -334,6 +359,12 @@ VkResult ComputePipeline::Create(
         const RuntimeSettings& settings = pDevice->GetRuntimeSettings();
         // The hash is same as pipline dump file name, we can easily analyze further.
         AmdvlkLog(settings.logTagIdMask, PipelineCompileTime, "0x%016llX-%llu", pipelineHash, duration);
+
+        binaryCreateInfo.compileRecord.apiHash      = apiPsoHash;
+        binaryCreateInfo.compileRecord.pipelineHash = pipelineHash;
+        binaryCreateInfo.compileRecord.bindPoint    = VK_PIPELINE_BIND_POINT_COMPUTE;
+        binaryCreateInfo.compileRecord.totalTime    = duration;
+        pDefaultCompiler->RecordPipelineCompile(binaryCreateInfo.compileRecord);
     }
 
     return result;
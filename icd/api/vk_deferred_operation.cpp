@@ -0,0 +1,266 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  vk_deferred_operation.cpp
+ * @brief Contains implementation of Vulkan deferred host operation object.
+ ***********************************************************************************************************************
+ */
+
+#include "include/vk_deferred_operation.h"
+#include "include/vk_device.h"
+#include "include/vk_utils.h"
+
+#include "palSysUtil.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+VkResult DeferredHostOperation::Create(
+    Device*                         pDevice,
+    const VkAllocationCallbacks*    pAllocator,
+    VkDeferredOperationKHR*         pDeferredOperation)
+{
+    VkResult result  = VK_SUCCESS;
+    void*    pMemory = pDevice->AllocApiObject(pAllocator, sizeof(DeferredHostOperation));
+
+    if (pMemory != nullptr)
+    {
+        DeferredHostOperation* pOperation = VK_PLACEMENT_NEW(pMemory) DeferredHostOperation();
+
+        if (pOperation->m_lock.Init() == Util::Result::Success)
+        {
+            *pDeferredOperation = DeferredHostOperation::HandleFromObject(pOperation);
+        }
+        else
+        {
+            pOperation->Destroy(pDevice, pAllocator);
+
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+    else
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Returns the deferred operation a deferrable command should attach its work to, or null if the command should execute
+// immediately.
+DeferredHostOperation* DeferredHostOperation::FromCreateInfo(
+    const void* pNext)
+{
+    const VkDeferredOperationInfoKHR* pInfo = utils::GetExtensionStructure<VkDeferredOperationInfoKHR>(
+        reinterpret_cast<const VkStructHeader*>(pNext),
+        VK_STRUCTURE_TYPE_DEFERRED_OPERATION_INFO_KHR);
+
+    return ((pInfo != nullptr) && (pInfo->operationHandle != VK_NULL_HANDLE)) ?
+           DeferredHostOperation::ObjectFromHandle(pInfo->operationHandle) : nullptr;
+}
+
+// =====================================================================================================================
+void DeferredHostOperation::Destroy(
+    Device*                         pDevice,
+    const VkAllocationCallbacks*    pAllocator)
+{
+    // The application must not destroy an operation which has not completed yet.
+    VK_ASSERT(m_complete);
+
+    Util::Destructor(this);
+    pDevice->FreeApiObject(pAllocator, this);
+}
+
+// =====================================================================================================================
+DeferredHostOperation::DeferredHostOperation()
+    :
+    m_pfnWork(nullptr),
+    m_pfnFinish(nullptr),
+    m_pPayload(nullptr),
+    m_workCount(0),
+    m_nextIndex(0),
+    m_pendingCount(0),
+    m_complete(true),
+    m_result(VK_SUCCESS)
+{
+}
+
+// =====================================================================================================================
+// Attaches the work of a deferrable command to this operation.  Returns the result the deferrable command must return.
+VkResult DeferredHostOperation::Defer(
+    uint32_t   workCount,
+    WorkFunc   pfnWork,
+    FinishFunc pfnFinish,
+    void*      pPayload)
+{
+    VK_ASSERT(workCount > 0);
+
+    Util::MutexAuto lock(&m_lock);
+
+    // An operation may only be reused once the previous deferred command has completed.
+    VK_ASSERT(m_complete);
+
+    m_pfnWork      = pfnWork;
+    m_pfnFinish    = pfnFinish;
+    m_pPayload     = pPayload;
+    m_workCount    = workCount;
+    m_nextIndex    = 0;
+    m_pendingCount = workCount;
+    m_result       = VK_NOT_READY;
+    m_complete     = false;
+
+    return VK_OPERATION_DEFERRED_KHR;
+}
+
+// =====================================================================================================================
+// Claims the next work item which has not been started by any joined thread yet.
+bool DeferredHostOperation::ClaimWork(
+    uint32_t* pIndex)
+{
+    Util::MutexAuto lock(&m_lock);
+
+    bool claimed = false;
+
+    if ((m_complete == false) && (m_nextIndex < m_workCount))
+    {
+        *pIndex = m_nextIndex++;
+        claimed = true;
+    }
+
+    return claimed;
+}
+
+// =====================================================================================================================
+// Executes work items on the calling thread until none are left to claim.
+VkResult DeferredHostOperation::Join()
+{
+    uint32_t index = 0;
+
+    while (ClaimWork(&index))
+    {
+        m_pfnWork(m_pPayload, index);
+
+        if (Util::AtomicDecrement(&m_pendingCount) == 0)
+        {
+            // The thread finishing the last work item completes the operation.  The result is published under the
+            // lock, so a thread which sees the operation complete also sees its result.
+            const VkResult result = m_pfnFinish(m_pPayload);
+
+            Util::MutexAuto lock(&m_lock);
+
+            m_result   = result;
+            m_pPayload = nullptr;
+            m_complete = true;
+        }
+    }
+
+    // If the operation is still incomplete, the remaining items are being executed by other joined threads.
+    return IsComplete() ? VK_SUCCESS : VK_THREAD_DONE_KHR;
+}
+
+// =====================================================================================================================
+bool DeferredHostOperation::IsComplete() const
+{
+    Util::MutexAuto lock(const_cast<Util::Mutex*>(&m_lock));
+
+    return m_complete;
+}
+
+// =====================================================================================================================
+VkResult DeferredHostOperation::GetResult() const
+{
+    Util::MutexAuto lock(const_cast<Util::Mutex*>(&m_lock));
+
+    return m_complete ? m_result : VK_NOT_READY;
+}
+
+// =====================================================================================================================
+uint32_t DeferredHostOperation::GetMaxConcurrency() const
+{
+    Util::MutexAuto lock(const_cast<Util::Mutex*>(&m_lock));
+
+    return m_complete ? 0 : Util::Max(m_workCount - m_nextIndex, 1u);
+}
+
+namespace entry
+{
+
+// =====================================================================================================================
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateDeferredOperationKHR(
+    VkDevice                                    device,
+    const VkAllocationCallbacks*                pAllocator,
+    VkDeferredOperationKHR*                     pDeferredOperation)
+{
+    Device*                      pDevice  = ApiDevice::ObjectFromHandle(device);
+    const VkAllocationCallbacks* pAllocCB = pAllocator ? pAllocator : pDevice->VkInstance()->GetAllocCallbacks();
+
+    return DeferredHostOperation::Create(pDevice, pAllocCB, pDeferredOperation);
+}
+
+// =====================================================================================================================
+VKAPI_ATTR void VKAPI_CALL vkDestroyDeferredOperationKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation,
+    const VkAllocationCallbacks*                pAllocator)
+{
+    if (operation != VK_NULL_HANDLE)
+    {
+        Device*                      pDevice  = ApiDevice::ObjectFromHandle(device);
+        const VkAllocationCallbacks* pAllocCB = pAllocator ? pAllocator : pDevice->VkInstance()->GetAllocCallbacks();
+
+        DeferredHostOperation::ObjectFromHandle(operation)->Destroy(pDevice, pAllocCB);
+    }
+}
+
+// =====================================================================================================================
+VKAPI_ATTR uint32_t VKAPI_CALL vkGetDeferredOperationMaxConcurrencyKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation)
+{
+    return DeferredHostOperation::ObjectFromHandle(operation)->GetMaxConcurrency();
+}
+
+// =====================================================================================================================
+VKAPI_ATTR VkResult VKAPI_CALL vkGetDeferredOperationResultKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation)
+{
+    return DeferredHostOperation::ObjectFromHandle(operation)->GetResult();
+}
+
+// =====================================================================================================================
+VKAPI_ATTR VkResult VKAPI_CALL vkDeferredOperationJoinKHR(
+    VkDevice                                    device,
+    VkDeferredOperationKHR                      operation)
+{
+    return DeferredHostOperation::ObjectFromHandle(operation)->Join();
+}
+
+} // namespace entry
+
+} // namespace vk
@@ -65,7 +65,13 @@
 #include "include/vk_swapchain.h"
 #include "include/vk_utils.h"
 #include "include/vk_conv.h"
+
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+#include "include/vk_deferred_operation.h"
+#endif
 #include "include/internal_layer_hooks.h"
+#include "include/pipeline_compile_pool.h"
+#include "include/pipeline_tier_up_queue.h"
 
 #include "sqtt/sqtt_layer.h"
 #include "sqtt/sqtt_mgr.h"
@@ -224,6 +230,8 @@ Device::Device(
     m_pAsyncLayer(nullptr),
     m_pAppOptLayer(nullptr),
     m_pBarrierFilterLayer(nullptr),
+    m_pPipelineCompilePool(nullptr),
+    m_pPipelineTierUpQueue(nullptr),
     m_allocationSizeTracking(m_settings.memoryDeviceOverallocationAllowed ? false : true),
     m_useComputeAsTransferQueue(useComputeAsTransferQueue)
 {
@@ -621,6 +629,15 @@ VkResult Device::Create(
             break;
         }
 
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT:
+        {
+            vkResult = VerifyRequestedPhysicalDeviceFeatures<VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>(
+                pPhysicalDevice,
+                reinterpret_cast<const VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT*>(pHeader));
+
+            break;
+        }
+
         case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT:
         {
             vkResult = VerifyRequestedPhysicalDeviceFeatures<VkPhysicalDeviceMemoryPriorityFeaturesEXT>(
@@ -1466,6 +1483,34 @@ VkResult Device::Initialize(
             result = VK_ERROR_OUT_OF_HOST_MEMORY;
         }
     }
+
+    if ((result == VK_SUCCESS) && (m_settings.maxPipelineCompileThreads > 0))
+    {
+        Util::SystemInfo sysInfo = {};
+        Util::QuerySystemInfo(&sysInfo);
+
+        // The thread calling vkCreate*Pipelines works on its batch as well, so leave one core for it.
+        const uint32_t threadCount = Util::Min(m_settings.maxPipelineCompileThreads,
+                                               (sysInfo.cpuLogicalCoreCount > 1) ? sysInfo.cpuLogicalCoreCount - 1 : 0);
+
+        // Without the pool, batched pipelines are simply created one after another on the calling thread.
+        if ((threadCount > 0) &&
+            (PipelineCompilePool::Create(VkInstance(), threadCount, &m_pPipelineCompilePool) != VK_SUCCESS))
+        {
+            AmdvlkLog(m_settings.logTagIdMask, GeneralPrint,
+                      "Failed to start %u pipeline compile threads, creating batched pipelines serially\n", threadCount);
+
+            m_pPipelineCompilePool = nullptr;
+        }
+    }
+
+    // Swapping in the optimized tier of a pipeline is only implemented for single GPU devices.
+    if ((result == VK_SUCCESS) &&
+        (m_settings.pipelineFastCompileMode == PipelineFastCompileTiered) &&
+        (NumPalDevices() == 1))
+    {
+        result = PipelineTierUpQueue::Create(this, &m_pPipelineTierUpQueue);
+    }
     if (result == VK_SUCCESS)
     {
         result = PalToVkResult(m_memoryMutex.Init());
@@ -1835,6 +1880,16 @@ VkResult Device::Destroy(const VkAllocationCallbacks* pAllocator)
         VkInstance()->FreeMem(m_pAsyncLayer);
     }
 
+    if (m_pPipelineCompilePool != nullptr)
+    {
+        m_pPipelineCompilePool->Destroy();
+    }
+
+    if (m_pPipelineTierUpQueue != nullptr)
+    {
+        m_pPipelineTierUpQueue->Destroy();
+    }
+
     for (uint32_t i = 0; i < Queue::MaxQueueFamilies; ++i)
     {
         for (uint32_t j = 0; (j < Queue::MaxQueuesPerFamily) && (m_pQueues[i][j] != nullptr); ++j)
@@ -2485,6 +2540,231 @@ VkResult Device::CreateImageView(
     return ImageView::Create(this, pCreateInfo, pAllocator, 0, pView);
 }
 
+// =====================================================================================================================
+// State shared by the threads creating one batch of pipelines on the pipeline compile pool
+template<typename CreateInfoType>
+struct PipelineBatch
+{
+    Device*                      pDevice;
+    PipelineCache*               pPipelineCache;
+    const CreateInfoType*        pCreateInfos;
+    const VkAllocationCallbacks* pAllocator;
+    uint32_t                     count;
+    VkPipeline*                  pPipelines;
+    VkResult*                    pResults;
+    volatile uint32_t            earlyReturnIndex; // Lowest index that failed with EARLY_RETURN_ON_FAILURE set
+};
+
+// =====================================================================================================================
+// Creates the pipeline at the given index of a batch.  Executed by the pipeline compile pool.
+template<typename PipelineType, typename CreateInfoType>
+static void CreateBatchedPipeline(
+    void*    pPayload,
+    uint32_t index)
+{
+    PipelineBatch<CreateInfoType>* pBatch = static_cast<PipelineBatch<CreateInfoType>*>(pPayload);
+
+    // Pipelines past an early-return failure are destroyed afterwards anyway, so don't spend time compiling them.
+    if (index < pBatch->earlyReturnIndex)
+    {
+        const CreateInfoType* pCreateInfo = &pBatch->pCreateInfos[index];
+
+        VkResult result = PipelineType::Create(
+            pBatch->pDevice,
+            pBatch->pPipelineCache,
+            pCreateInfo,
+            pBatch->pAllocator,
+            &pBatch->pPipelines[index]);
+
+        pBatch->pResults[index] = result;
+
+        if ((result != VK_SUCCESS) && (pCreateInfo->flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT))
+        {
+            uint32_t curIndex = pBatch->earlyReturnIndex;
+
+            while ((index < curIndex) &&
+                   (Util::AtomicCompareAndSwap(&pBatch->earlyReturnIndex, curIndex, index) != curIndex))
+            {
+                curIndex = pBatch->earlyReturnIndex;
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Initializes the state of a batch of pipelines.  The results array must hold one entry per create info.
+template<typename CreateInfoType>
+static void InitPipelineBatch(
+    Device*                        pDevice,
+    PipelineCache*                 pPipelineCache,
+    uint32_t                       count,
+    const CreateInfoType*          pCreateInfos,
+    const VkAllocationCallbacks*   pAllocator,
+    VkPipeline*                    pPipelines,
+    VkResult*                      pResults,
+    PipelineBatch<CreateInfoType>* pBatch)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pResults[i] = VK_SUCCESS;
+    }
+
+    pBatch->pDevice          = pDevice;
+    pBatch->pPipelineCache   = pPipelineCache;
+    pBatch->pCreateInfos     = pCreateInfos;
+    pBatch->pAllocator       = pAllocator;
+    pBatch->count            = count;
+    pBatch->pPipelines       = pPipelines;
+    pBatch->pResults         = pResults;
+    pBatch->earlyReturnIndex = UINT32_MAX;
+}
+
+// =====================================================================================================================
+// Resolves the results of a batch of pipelines once all of them have been created.  The returned result and the
+// contents of pPipelines match what creating the pipelines one after another in index order would have produced.
+template<typename CreateInfoType>
+static VkResult FinishPipelineBatch(
+    PipelineBatch<CreateInfoType>* pBatch)
+{
+    VkResult finalResult = VK_SUCCESS;
+
+    for (uint32_t i = 0; i < pBatch->count; ++i)
+    {
+        VkPipeline* pPipeline = &pBatch->pPipelines[i];
+
+        if (i > pBatch->earlyReturnIndex)
+        {
+            // Serial creation would have stopped at the early-return failure; release anything built after it.
+            if (*pPipeline != VK_NULL_HANDLE)
+            {
+                Pipeline::ObjectFromHandle(*pPipeline)->Destroy(pBatch->pDevice, pBatch->pAllocator);
+                *pPipeline = VK_NULL_HANDLE;
+            }
+        }
+        else if (pBatch->pResults[i] != VK_SUCCESS)
+        {
+            // In case of failure, VK_NULL_HANDLE must be set
+            VK_ASSERT(*pPipeline == VK_NULL_HANDLE);
+
+            // Capture the first failure result and save it to be returned
+            finalResult = (finalResult != VK_SUCCESS) ? finalResult : pBatch->pResults[i];
+        }
+    }
+
+    return finalResult;
+}
+
+// =====================================================================================================================
+// Creates a batch of pipelines on the pipeline compile pool.
+template<typename PipelineType, typename CreateInfoType>
+static VkResult CreatePipelinesParallel(
+    Device*                      pDevice,
+    PipelineCache*               pPipelineCache,
+    uint32_t                     count,
+    const CreateInfoType*        pCreateInfos,
+    const VkAllocationCallbacks* pAllocator,
+    VkPipeline*                  pPipelines)
+{
+    VkResult finalResult = VK_SUCCESS;
+
+    Util::AutoBuffer<VkResult, 64, PalAllocator> results(count, pDevice->VkInstance()->Allocator());
+
+    if (results.Capacity() < count)
+    {
+        finalResult = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    else
+    {
+        PipelineBatch<CreateInfoType> batch = {};
+
+        InitPipelineBatch(pDevice, pPipelineCache, count, pCreateInfos, pAllocator, pPipelines, &results[0], &batch);
+
+        pDevice->GetPipelineCompilePool()->Execute(count, CreateBatchedPipeline<PipelineType, CreateInfoType>, &batch);
+
+        finalResult = FinishPipelineBatch(&batch);
+    }
+
+    return finalResult;
+}
+
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+// =====================================================================================================================
+// Completes a deferred batch of pipelines and releases its state.  Executed by the last thread joining the operation.
+template<typename CreateInfoType>
+static VkResult FinishDeferredPipelineBatch(
+    void* pPayload)
+{
+    PipelineBatch<CreateInfoType>* pBatch = static_cast<PipelineBatch<CreateInfoType>*>(pPayload);
+
+    const VkResult result = FinishPipelineBatch(pBatch);
+
+    pBatch->pDevice->VkInstance()->FreeMem(pBatch);
+
+    return result;
+}
+
+// =====================================================================================================================
+// Attaches the creation of a batch of pipelines to a deferred host operation.  Each pipeline is created by whichever
+// application thread joins the operation and claims it; a single pipeline compile can't be split any further.
+template<typename PipelineType, typename CreateInfoType>
+static VkResult DeferPipelines(
+    Device*                      pDevice,
+    DeferredHostOperation*       pOperation,
+    PipelineCache*               pPipelineCache,
+    uint32_t                     count,
+    const CreateInfoType*        pCreateInfos,
+    const VkAllocationCallbacks* pAllocator,
+    VkPipeline*                  pPipelines)
+{
+    VkResult result = VK_SUCCESS;
+
+    // The batch state must outlive this call, so allocate it together with the results array.
+    const size_t batchSize = Util::Pow2Align(sizeof(PipelineBatch<CreateInfoType>), sizeof(VkResult));
+
+    void* pMemory = pDevice->VkInstance()->AllocMem(
+        batchSize + (count * sizeof(VkResult)),
+        VK_DEFAULT_MEM_ALIGN,
+        VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if (pMemory != nullptr)
+    {
+        PipelineBatch<CreateInfoType>* pBatch   = VK_PLACEMENT_NEW(pMemory) PipelineBatch<CreateInfoType>();
+        VkResult*                      pResults = reinterpret_cast<VkResult*>(Util::VoidPtrInc(pMemory, batchSize));
+
+        InitPipelineBatch(pDevice, pPipelineCache, count, pCreateInfos, pAllocator, pPipelines, pResults, pBatch);
+
+        result = pOperation->Defer(
+            count,
+            CreateBatchedPipeline<PipelineType, CreateInfoType>,
+            FinishDeferredPipelineBatch<CreateInfoType>,
+            pBatch);
+    }
+    else
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Returns the deferred host operation chained to any of the create infos of a pipeline creation command, if any.
+template<typename CreateInfoType>
+static DeferredHostOperation* GetDeferredOperation(
+    uint32_t              count,
+    const CreateInfoType* pCreateInfos)
+{
+    DeferredHostOperation* pOperation = nullptr;
+
+    for (uint32_t i = 0; (i < count) && (pOperation == nullptr); ++i)
+    {
+        pOperation = DeferredHostOperation::FromCreateInfo(pCreateInfos[i].pNext);
+    }
+
+    return pOperation;
+}
+#endif
+
 // =====================================================================================================================
 VkResult Device::CreateGraphicsPipelines(
     VkPipelineCache                             pipelineCache,
@@ -2505,28 +2785,57 @@ VkResult Device::CreateGraphicsPipelines(
         pPipelines[i] = VK_NULL_HANDLE;
     }
 
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        const VkGraphicsPipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+    DeferredHostOperation* pOperation = GetDeferredOperation(count, pCreateInfos);
 
-        VkResult result = GraphicsPipeline::Create(
+    if ((pOperation != nullptr) && (count > 0))
+    {
+        finalResult = DeferPipelines<GraphicsPipeline>(
             this,
+            pOperation,
             pPipelineCache,
-            pCreateInfo,
+            count,
+            pCreateInfos,
             pAllocator,
-            &pPipelines[i]);
-
-        if (result != VK_SUCCESS)
+            pPipelines);
+    }
+    else
+#endif
+    if ((m_pPipelineCompilePool != nullptr) && (count > 1))
+    {
+        finalResult = CreatePipelinesParallel<GraphicsPipeline>(
+            this,
+            pPipelineCache,
+            count,
+            pCreateInfos,
+            pAllocator,
+            pPipelines);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
         {
-            // In case of failure, VK_NULL_HANDLE must be set
-            VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+            const VkGraphicsPipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
 
-            // Capture the first failure result and save it to be returned
-            finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+            VkResult result = GraphicsPipeline::Create(
+                this,
+                pPipelineCache,
+                pCreateInfo,
+                pAllocator,
+                &pPipelines[i]);
 
-            if (pCreateInfo->flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+            if (result != VK_SUCCESS)
             {
-                break;
+                // In case of failure, VK_NULL_HANDLE must be set
+                VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+
+                // Capture the first failure result and save it to be returned
+                finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+
+                if (pCreateInfo->flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+                {
+                    break;
+                }
             }
         }
     }
@@ -2554,28 +2863,57 @@ VkResult Device::CreateComputePipelines(
         pPipelines[i] = VK_NULL_HANDLE;
     }
 
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        const VkComputePipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+    DeferredHostOperation* pOperation = GetDeferredOperation(count, pCreateInfos);
 
-        VkResult result = ComputePipeline::Create(
+    if ((pOperation != nullptr) && (count > 0))
+    {
+        finalResult = DeferPipelines<ComputePipeline>(
             this,
+            pOperation,
             pPipelineCache,
-            pCreateInfo,
+            count,
+            pCreateInfos,
             pAllocator,
-            &pPipelines[i]);
-
-        if (result != VK_SUCCESS)
+            pPipelines);
+    }
+    else
+#endif
+    if ((m_pPipelineCompilePool != nullptr) && (count > 1))
+    {
+        finalResult = CreatePipelinesParallel<ComputePipeline>(
+            this,
+            pPipelineCache,
+            count,
+            pCreateInfos,
+            pAllocator,
+            pPipelines);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
         {
-            // In case of failure, VK_NULL_HANDLE must be set
-            VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+            const VkComputePipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
 
-            // Capture the first failure result and save it to be returned
-            finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+            VkResult result = ComputePipeline::Create(
+                this,
+                pPipelineCache,
+                pCreateInfo,
+                pAllocator,
+                &pPipelines[i]);
 
-            if (pCreateInfo->flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+            if (result != VK_SUCCESS)
             {
-                break;
+                // In case of failure, VK_NULL_HANDLE must be set
+                VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+
+                // Capture the first failure result and save it to be returned
+                finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+
+                if (pCreateInfo->flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+                {
+                    break;
+                }
             }
         }
     }
@@ -3372,11 +3710,17 @@ VkResult Device::SetDebugUtilsObjectName(
         }
         else // Pipeline
         {
+            // A name given to a tiered pipeline before its optimized tier is installed only reaches the fast tier.
             Pipeline* pPipeline = reinterpret_cast<Pipeline*>(pNameInfo->objectHandle);
             nameData.pObj = pPipeline->PalPipeline(DefaultDeviceIndex);
         }
         nameData.pDebugName = pNameInfo->pObjectName;
-        VkInstance()->PalPlatform()->LogEvent(Pal::PalEvent::DebugName, &nameData, sizeof(nameData));
+
+        // Graphics pipeline libraries have no PAL pipeline to name.
+        if (nameData.pObj != nullptr)
+        {
+            VkInstance()->PalPlatform()->LogEvent(Pal::PalEvent::DebugName, &nameData, sizeof(nameData));
+        }
     }
 
     return VkResult::VK_SUCCESS;
@@ -64,6 +64,10 @@
 #include "include/vk_swapchain.h"
 #include "include/vk_debug_report.h"
 
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+#include "include/vk_deferred_operation.h"
+#endif
+
 #include <cstring>
 
 namespace vk
@@ -614,6 +618,14 @@ void DispatchTable::Init()
     INIT_DISPATCH_ENTRY(vkDestroyPrivateDataSlotEXT                     );
     INIT_DISPATCH_ENTRY(vkSetPrivateDataEXT                             );
     INIT_DISPATCH_ENTRY(vkGetPrivateDataEXT                             );
+
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+    INIT_DISPATCH_ENTRY(vkCreateDeferredOperationKHR                    );
+    INIT_DISPATCH_ENTRY(vkDestroyDeferredOperationKHR                   );
+    INIT_DISPATCH_ENTRY(vkGetDeferredOperationMaxConcurrencyKHR         );
+    INIT_DISPATCH_ENTRY(vkGetDeferredOperationResultKHR                 );
+    INIT_DISPATCH_ENTRY(vkDeferredOperationJoinKHR                      );
+#endif
 }
 
 // =====================================================================================================================
@@ -24,9 +24,12 @@
  **********************************************************************************************************************/
 
 #include "include/log.h"
+#include "include/pipeline_device_group.h"
+#include "include/pipeline_tier_up_queue.h"
 #include "include/vk_conv.h"
 #include "include/vk_device.h"
 #include "include/vk_graphics_pipeline.h"
+#include "include/vk_graphics_pipeline_library.h"
 #include "include/vk_instance.h"
 #include "include/vk_memory.h"
 #include "include/vk_pipeline_cache.h"
@@ -617,6 +620,7 @@ bool GetDualSourceBlendEnableState(const VkPipelineColorBlendAttachmentState& pC
 void GraphicsPipeline::BuildRasterizationState(
     Device*                                       pDevice,
     const VkPipelineRasterizationStateCreateInfo* pIn,
+    const GraphicsPipelineExtStructs&             extStructs,
     CreateInfo*                                   pInfo,
     const bool                                    dynamicStateFlags[])
 {
@@ -676,116 +680,90 @@ void GraphicsPipeline::BuildRasterizationState(
         pInfo->staticStateMask |= 1 << VK_DYNAMIC_STATE_LINE_WIDTH;
     }
 
-    const void* pNext = pIn->pNext;
-
-    while (pNext != nullptr)
+    if (extStructs.pRasterizationOrder != nullptr)
     {
-        const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pNext);
-
-        switch (static_cast<int32>(pHeader->sType))
-        {
-        // Handle  extension specific structures
-        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_RASTERIZATION_ORDER_AMD:
-            {
-                const auto* pRsOrder = static_cast<const VkPipelineRasterizationStateRasterizationOrderAMD*>(pNext);
+        const auto* pRsOrder = extStructs.pRasterizationOrder;
 #if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 493
-                if (pPhysicalDevice->PalProperties().gfxipProperties.flags.supportOutOfOrderPrimitives)
+        if (pPhysicalDevice->PalProperties().gfxipProperties.flags.supportOutOfOrderPrimitives)
 #endif
-                {
-                    pInfo->pipeline.rsState.outOfOrderPrimsEnable = VkToPalRasterizationOrder(pRsOrder->rasterizationOrder);
-                }
-                break;
-            }
-        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_CONSERVATIVE_STATE_CREATE_INFO_EXT:
-            {
-                const auto* pRsConservative =
-                    static_cast<const VkPipelineRasterizationConservativeStateCreateInfoEXT*>(pNext);
-
-                // VK_EXT_conservative_rasterization must be enabled
-                VK_ASSERT(pDevice->IsExtensionEnabled(DeviceExtensions::EXT_CONSERVATIVE_RASTERIZATION));
-                VK_ASSERT(pRsConservative->flags == 0);
-                VK_ASSERT(pRsConservative->conservativeRasterizationMode >= VK_CONSERVATIVE_RASTERIZATION_MODE_BEGIN_RANGE_EXT);
-                VK_ASSERT(pRsConservative->conservativeRasterizationMode <= VK_CONSERVATIVE_RASTERIZATION_MODE_END_RANGE_EXT);
-                VK_IGNORE(pRsConservative->extraPrimitiveOverestimationSize);
+        {
+            pInfo->pipeline.rsState.outOfOrderPrimsEnable = VkToPalRasterizationOrder(pRsOrder->rasterizationOrder);
+        }
+    }
 
-                switch (pRsConservative->conservativeRasterizationMode)
-                {
-                case VK_CONSERVATIVE_RASTERIZATION_MODE_DISABLED_EXT:
-                    {
-                        pInfo->msaa.flags.enableConservativeRasterization = false;
-                    }
-                    break;
-                case VK_CONSERVATIVE_RASTERIZATION_MODE_OVERESTIMATE_EXT:
-                    {
-                        pInfo->msaa.flags.enableConservativeRasterization = true;
-                        pInfo->msaa.conservativeRasterizationMode = Pal::ConservativeRasterizationMode::Overestimate;
-                    }
-                    break;
-                case VK_CONSERVATIVE_RASTERIZATION_MODE_UNDERESTIMATE_EXT:
-                    {
-                        pInfo->msaa.flags.enableConservativeRasterization = true;
-                        pInfo->msaa.conservativeRasterizationMode = Pal::ConservativeRasterizationMode::Underestimate;
-                    }
-                    break;
+    if (extStructs.pConservativeRasterizationState != nullptr)
+    {
+        const auto* pRsConservative = extStructs.pConservativeRasterizationState;
 
-                default:
-                    break;
-                }
+        // VK_EXT_conservative_rasterization must be enabled
+        VK_ASSERT(pDevice->IsExtensionEnabled(DeviceExtensions::EXT_CONSERVATIVE_RASTERIZATION));
+        VK_ASSERT(pRsConservative->flags == 0);
+        VK_ASSERT(pRsConservative->conservativeRasterizationMode >= VK_CONSERVATIVE_RASTERIZATION_MODE_BEGIN_RANGE_EXT);
+        VK_ASSERT(pRsConservative->conservativeRasterizationMode <= VK_CONSERVATIVE_RASTERIZATION_MODE_END_RANGE_EXT);
+        VK_IGNORE(pRsConservative->extraPrimitiveOverestimationSize);
 
+        switch (pRsConservative->conservativeRasterizationMode)
+        {
+        case VK_CONSERVATIVE_RASTERIZATION_MODE_DISABLED_EXT:
+            {
+                pInfo->msaa.flags.enableConservativeRasterization = false;
             }
             break;
-        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_STREAM_CREATE_INFO_EXT:
+        case VK_CONSERVATIVE_RASTERIZATION_MODE_OVERESTIMATE_EXT:
             {
-                const auto* pRsStream = static_cast<const VkPipelineRasterizationStateStreamCreateInfoEXT*>(pNext);
-
-                pInfo->rasterizationStream = pRsStream->rasterizationStream;
+                pInfo->msaa.flags.enableConservativeRasterization = true;
+                pInfo->msaa.conservativeRasterizationMode = Pal::ConservativeRasterizationMode::Overestimate;
             }
             break;
-        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_LINE_STATE_CREATE_INFO_EXT:
+        case VK_CONSERVATIVE_RASTERIZATION_MODE_UNDERESTIMATE_EXT:
             {
-                const auto* pRsRasterizationLine =
-                    static_cast<const VkPipelineRasterizationLineStateCreateInfoEXT*>(pNext);
+                pInfo->msaa.flags.enableConservativeRasterization = true;
+                pInfo->msaa.conservativeRasterizationMode = Pal::ConservativeRasterizationMode::Underestimate;
+            }
+            break;
 
-                pInfo->bresenhamEnable =
-                    (pRsRasterizationLine->lineRasterizationMode == VK_LINE_RASTERIZATION_MODE_BRESENHAM_EXT);
+        default:
+            break;
+        }
+    }
 
-                // Bresenham Lines need axis aligned end caps
-                if (pInfo->bresenhamEnable)
-                {
-                    pInfo->pipeline.rsState.perpLineEndCapsEnable = false;
-                }
-                else if (pRsRasterizationLine->lineRasterizationMode == VK_LINE_RASTERIZATION_MODE_RECTANGULAR_EXT)
-                {
-                    pInfo->pipeline.rsState.perpLineEndCapsEnable = true;
-                }
+    if (extStructs.pRasterizationStreamState != nullptr)
+    {
+        pInfo->rasterizationStream = extStructs.pRasterizationStreamState->rasterizationStream;
+    }
 
-                pInfo->msaa.flags.enableLineStipple                   = pRsRasterizationLine->stippledLineEnable;
+    if (extStructs.pRasterizationLineState != nullptr)
+    {
+        const auto* pRsRasterizationLine = extStructs.pRasterizationLineState;
 
-                pInfo->immedInfo.lineStippleParams.lineStippleScale   = (pRsRasterizationLine->lineStippleFactor - 1);
-                pInfo->immedInfo.lineStippleParams.lineStippleValue   = pRsRasterizationLine->lineStipplePattern;
+        pInfo->bresenhamEnable =
+            (pRsRasterizationLine->lineRasterizationMode == VK_LINE_RASTERIZATION_MODE_BRESENHAM_EXT);
 
-                if (pRsRasterizationLine->stippledLineEnable &&
-                    (dynamicStateFlags[static_cast<uint32_t>(DynamicStatesInternal::LineStippleExt)] == false))
-                {
-                    pInfo->staticStateMask |= 1 << static_cast<uint32_t>(DynamicStatesInternal::LineStippleExt);
-                }
-            }
-            break;
-        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_DEPTH_CLIP_STATE_CREATE_INFO_EXT:
-            {
-                const auto* pRsRasterizationDepthClipState =
-                    static_cast<const VkPipelineRasterizationDepthClipStateCreateInfoEXT*>(pNext);
+        // Bresenham Lines need axis aligned end caps
+        if (pInfo->bresenhamEnable)
+        {
+            pInfo->pipeline.rsState.perpLineEndCapsEnable = false;
+        }
+        else if (pRsRasterizationLine->lineRasterizationMode == VK_LINE_RASTERIZATION_MODE_RECTANGULAR_EXT)
+        {
+            pInfo->pipeline.rsState.perpLineEndCapsEnable = true;
+        }
 
-                pInfo->pipeline.viewportInfo.depthClipEnable = (pRsRasterizationDepthClipState->depthClipEnable == VK_TRUE);
-            }
-            break;
+        pInfo->msaa.flags.enableLineStipple                   = pRsRasterizationLine->stippledLineEnable;
 
-        default:
-            // Skip any unknown extension structures
-            break;
+        pInfo->immedInfo.lineStippleParams.lineStippleScale   = (pRsRasterizationLine->lineStippleFactor - 1);
+        pInfo->immedInfo.lineStippleParams.lineStippleValue   = pRsRasterizationLine->lineStipplePattern;
+
+        if (pRsRasterizationLine->stippledLineEnable &&
+            (dynamicStateFlags[static_cast<uint32_t>(DynamicStatesInternal::LineStippleExt)] == false))
+        {
+            pInfo->staticStateMask |= 1 << static_cast<uint32_t>(DynamicStatesInternal::LineStippleExt);
         }
+    }
 
-        pNext = pHeader->pNext;
+    if (extStructs.pDepthClipState != nullptr)
+    {
+        pInfo->pipeline.viewportInfo.depthClipEnable = (extStructs.pDepthClipState->depthClipEnable == VK_TRUE);
     }
 }
 
@@ -794,6 +772,7 @@ void GraphicsPipeline::BuildRasterizationState(
 void GraphicsPipeline::ConvertGraphicsPipelineInfo(
     Device*                             pDevice,
     const VkGraphicsPipelineCreateInfo* pIn,
+    const GraphicsPipelineExtStructs&   extStructs,
     const VbBindingInfo*                pVbInfo,
     CreateInfo*                         pInfo)
 {
@@ -812,11 +791,7 @@ void GraphicsPipeline::ConvertGraphicsPipelineInfo(
     pInfo->sampleCoverage                       = 1;
     pInfo->rasterizationStream                  = 0;
 
-    EXTRACT_VK_STRUCTURES_0(
-        gfxPipeline,
-        GraphicsPipelineCreateInfo,
-        pIn,
-        GRAPHICS_PIPELINE_CREATE_INFO)
+    const VkGraphicsPipelineCreateInfo* pGraphicsPipelineCreateInfo = extStructs.pGraphicsPipelineCreateInfo;
 
     const RenderPass* pRenderPass = nullptr;
 
@@ -857,16 +832,13 @@ void GraphicsPipeline::ConvertGraphicsPipelineInfo(
 
         if (pInfo->activeStages & (VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT))
         {
-            EXTRACT_VK_STRUCTURES_0(
-                Tess,
-                PipelineTessellationStateCreateInfo,
-                pGraphicsPipelineCreateInfo->pTessellationState,
-                PIPELINE_TESSELLATION_STATE_CREATE_INFO)
+            const VkPipelineTessellationStateCreateInfo* pPipelineTessellationStateCreateInfo =
+                pGraphicsPipelineCreateInfo->pTessellationState;
 
-                if (pPipelineTessellationStateCreateInfo != nullptr)
-                {
-                    pInfo->pipeline.iaState.topologyInfo.patchControlPoints = pPipelineTessellationStateCreateInfo->patchControlPoints;
-                }
+            if (pPipelineTessellationStateCreateInfo != nullptr)
+            {
+                pInfo->pipeline.iaState.topologyInfo.patchControlPoints = pPipelineTessellationStateCreateInfo->patchControlPoints;
+            }
         }
         pInfo->staticStateMask = 0;
 
@@ -1061,6 +1033,7 @@ void GraphicsPipeline::ConvertGraphicsPipelineInfo(
 
         BuildRasterizationState(pDevice,
                                 pGraphicsPipelineCreateInfo->pRasterizationState,
+                                extStructs,
                                 pInfo,
                                 dynamicStateFlags);
 
@@ -1090,13 +1063,8 @@ void GraphicsPipeline::ConvertGraphicsPipelineInfo(
         if ((pIn->pRasterizationState->rasterizerDiscardEnable != VK_TRUE) && (pMs != nullptr))
         {
             // Sample Locations
-            EXTRACT_VK_STRUCTURES_1(
-                SampleLocations,
-                PipelineMultisampleStateCreateInfo,
-                PipelineSampleLocationsStateCreateInfoEXT,
-                pMs,
-                PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-                PIPELINE_SAMPLE_LOCATIONS_STATE_CREATE_INFO_EXT)
+            const VkPipelineSampleLocationsStateCreateInfoEXT* pPipelineSampleLocationsStateCreateInfoEXT =
+                extStructs.pSampleLocationsState;
 
             pInfo->customSampleLocations = ((pPipelineSampleLocationsStateCreateInfoEXT != nullptr) &&
                                             (pPipelineSampleLocationsStateCreateInfoEXT->sampleLocationsEnable));
@@ -1368,55 +1336,115 @@ VkResult GraphicsPipeline::Create(
 
     const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeadbackCreateInfo = nullptr;
 
+    // A library only holds parts of a pipeline, and a pipeline linking libraries is compiled from its own parts together
+    // with the parts of its libraries.
+    if ((pCreateInfo->flags & VK_PIPELINE_CREATE_LIBRARY_BIT_KHR) != 0)
+    {
+        return GraphicsPipelineLibrary::Create(pDevice, pPipelineCache, pCreateInfo, pAllocator, pPipeline);
+    }
+
+    GraphicsPipelineLibrary::LinkedCreateInfo linkedCreateInfo;
+
+    const bool linked = (GraphicsPipelineLibrary::GetLibraryCreateInfo(pCreateInfo) != nullptr);
+
+    if (linked)
+    {
+        const VkResult linkResult =
+            GraphicsPipelineLibrary::BuildLinkedCreateInfo(pDevice, pCreateInfo, pAllocator, &linkedCreateInfo);
+
+        if (linkResult != VK_SUCCESS)
+        {
+            GraphicsPipelineLibrary::FreeLinkedCreateInfo(pDevice, pAllocator, &linkedCreateInfo);
+
+            return linkResult;
+        }
+
+        pCreateInfo = &linkedCreateInfo.createInfo;
+    }
+
+    GraphicsPipelineExtStructs extStructs = {};
+
+    PipelineCompiler::GetGraphicsPipelineExtStructs(pCreateInfo, &extStructs);
+
     VkResult result = pDefaultCompiler->ConvertGraphicsPipelineInfo(
-        pDevice, pCreateInfo, &binaryCreateInfo, &vbInfo, &pPipelineCreationFeadbackCreateInfo);
-    ConvertGraphicsPipelineInfo(pDevice, pCreateInfo, &vbInfo, &localPipelineInfo);
+        pDevice, pCreateInfo, extStructs, &binaryCreateInfo, &vbInfo, &pPipelineCreationFeadbackCreateInfo);
+    ConvertGraphicsPipelineInfo(pDevice, pCreateInfo, extStructs, &vbInfo, &localPipelineInfo);
+    const int64_t convertEndTime = Util::GetPerfCpuTime();
     uint64_t apiPsoHash = BuildApiHash(pCreateInfo, &localPipelineInfo, &binaryCreateInfo.basePipelineHash);
 
     const uint32_t numPalDevices = pDevice->NumPalDevices();
     uint64_t pipelineHash = Vkgc::IPipelineDumper::GetPipelineHash(&binaryCreateInfo.pipelineInfo);
-    for (uint32_t i = 0; (result == VK_SUCCESS) && (i < numPalDevices); ++i)
+
+    binaryCreateInfo.pipelineHash = pipelineHash;
+
+    binaryCreateInfo.compileRecord.convertTime = convertEndTime - startTime;
+    binaryCreateInfo.compileRecord.hashTime    = Util::GetPerfCpuTime() - convertEndTime;
+
+    PipelineTierUpQueue*      pTierUpQueue = pDevice->GetPipelineTierUpQueue();
+    PipelineTierUpQueue::Job* pTierUpJob   = nullptr;
+
+    // A tiered pipeline is created optimized right away if a cache has its optimized binary already.  Otherwise it is
+    // compiled with the fast shader options now, and recompiled optimized in the background.
+    if ((result == VK_SUCCESS) && (pTierUpQueue != nullptr) && PipelineTierUpQueue::IsTierable(pDevice, pCreateInfo))
     {
-        if (i == DefaultDeviceIndex)
-        {
-            result = pDevice->GetCompiler(i)->CreateGraphicsPipelineBinary(
-                pDevice,
-                i,
-                pPipelineCache,
-                &binaryCreateInfo,
-                &pipelineBinarySizes[i],
-                &pPipelineBinaries[i],
-                localPipelineInfo.rasterizationStream,
-                &cacheId[i]);
-        }
-        else
-        {
-            GraphicsPipelineCreateInfo binaryCreateInfoMGPU = {};
-            VbBindingInfo vbInfoMGPU = {};
-            pDefaultCompiler->ConvertGraphicsPipelineInfo(
-                    pDevice, pCreateInfo, &binaryCreateInfoMGPU, &vbInfoMGPU, nullptr);
+        const VkPipelineCreateFlags flags = binaryCreateInfo.flags;
 
-            result = pDevice->GetCompiler(i)->CreateGraphicsPipelineBinary(
-                pDevice,
-                i,
-                pPipelineCache,
-                &binaryCreateInfoMGPU,
-                &pipelineBinarySizes[i],
-                &pPipelineBinaries[i],
-                localPipelineInfo.rasterizationStream,
-                &cacheId[i]);
+        binaryCreateInfo.flags |= VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+
+        result = pDefaultCompiler->CreateGraphicsPipelineBinary(
+            pDevice,
+            DefaultDeviceIndex,
+            pPipelineCache,
+            &binaryCreateInfo,
+            &pipelineBinarySizes[DefaultDeviceIndex],
+            &pPipelineBinaries[DefaultDeviceIndex],
+            localPipelineInfo.rasterizationStream,
+            &cacheId[DefaultDeviceIndex]);
+
+        binaryCreateInfo.flags = flags;
 
-            if (result == VK_SUCCESS)
+        if (result == VK_PIPELINE_COMPILE_REQUIRED_EXT)
+        {
+            pTierUpJob = pTierUpQueue->PrepareJob(pCreateInfo);
+
+            if (pTierUpJob != nullptr)
             {
-                pDefaultCompiler->SetPipelineCreationFeedbackInfo(
-                    pPipelineCreationFeadbackCreateInfo,
-                    &binaryCreateInfoMGPU.pipelineFeedback);
+                pDefaultCompiler->ApplyFastCompileOptions(&binaryCreateInfo);
             }
 
-            pDefaultCompiler->FreeGraphicsPipelineCreateInfo(&binaryCreateInfoMGPU);
+            result = VK_SUCCESS;
         }
     }
 
+    // Every device compiles from the one converted create info; the conversion depends on the create info only.
+    bool     freeWithCompiler[MaxPalDevices] = {};
+    uint32_t binarySources[MaxPalDevices]    = {};
+
+    if (result == VK_SUCCESS)
+    {
+        bool readsDeviceIndex = false;
+
+        for (uint32_t i = 0; i < pCreateInfo->stageCount; ++i)
+        {
+            const ShaderModule* pModule = ShaderModule::ObjectFromHandle(pCreateInfo->pStages[i].module);
+
+            readsDeviceIndex |= ((pModule == nullptr) || pModule->ReadsDeviceIndex());
+        }
+
+        result = CreateDeviceGroupBinaries(
+            pDevice,
+            pPipelineCache,
+            &binaryCreateInfo,
+            localPipelineInfo.rasterizationStream,
+            readsDeviceIndex,
+            pPipelineCreationFeadbackCreateInfo,
+            pipelineBinarySizes,
+            pPipelineBinaries,
+            cacheId,
+            binarySources,
+            freeWithCompiler);
+    }
+
     if (result == VK_SUCCESS)
     {
         pDevice->GetShaderOptimizer()->OverrideGraphicsPipelineCreateInfo(
@@ -1461,7 +1489,8 @@ VkResult GraphicsPipeline::Create(
 
     if (result == VK_SUCCESS)
     {
-        size_t palOffset = sizeof(GraphicsPipeline);
+        const int64_t palCreateStartTime = Util::GetPerfCpuTime();
+        size_t        palOffset          = sizeof(GraphicsPipeline);
 
         for (uint32_t deviceIdx = 0; deviceIdx < numPalDevices; deviceIdx++)
         {
@@ -1569,6 +1598,8 @@ VkResult GraphicsPipeline::Create(
         }
 
         result = PalToVkResult(palResult);
+
+        binaryCreateInfo.compileRecord.palCreateTime = Util::GetPerfCpuTime() - palCreateStartTime;
     }
 
     PipelineBinaryInfo* pBinaryInfo = nullptr;
@@ -1591,7 +1622,7 @@ VkResult GraphicsPipeline::Create(
     // On success, wrap it up in a Vulkan object.
     if (result == VK_SUCCESS)
     {
-        VK_PLACEMENT_NEW(pSystemMem) GraphicsPipeline(
+        GraphicsPipeline* pGraphicsPipeline = VK_PLACEMENT_NEW(pSystemMem) GraphicsPipeline(
             pDevice,
             pPalPipeline,
             localPipelineInfo.pLayout,
@@ -1612,14 +1643,36 @@ VkResult GraphicsPipeline::Create(
             apiPsoHash,
             &palPipelineHasher);
 
+        if (pTierUpJob != nullptr)
+        {
+            pGraphicsPipeline->m_flags.tiered = 1;
+
+            pTierUpQueue->SubmitJob(
+                pTierUpJob,
+                pGraphicsPipeline,
+                pPipelineCache,
+                localPipelineInfo.pipeline,
+                localPipelineInfo.rasterizationStream);
+
+            pTierUpJob = nullptr;
+        }
+
         *pPipeline = GraphicsPipeline::HandleFromVoidPointer(pSystemMem);
     }
 
+    if (pTierUpJob != nullptr)
+    {
+        pTierUpQueue->DiscardJob(pTierUpJob);
+    }
+
     // Free the created pipeline binaries now that the PAL Pipelines/PipelineBinaryInfo have read them.
     for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); deviceIdx++)
     {
-        if (pPipelineBinaries[deviceIdx] != nullptr)
+        // Devices sharing the binary of another device don't own it.
+        if ((pPipelineBinaries[deviceIdx] != nullptr) && (binarySources[deviceIdx] == deviceIdx))
         {
+            binaryCreateInfo.freeWithCompiler = freeWithCompiler[deviceIdx];
+
             pDevice->GetCompiler(deviceIdx)->FreeGraphicsPipelineBinary(
                 &binaryCreateInfo, pPipelineBinaries[deviceIdx], pipelineBinarySizes[deviceIdx]);
         }
@@ -1663,6 +1716,18 @@ VkResult GraphicsPipeline::Create(
 
         // The hash is same as pipline dump file name, we can easily analyze further.
         AmdvlkLog(settings.logTagIdMask, PipelineCompileTime, "0x%016llX-%llu", pipelineHash, duration);
+
+        binaryCreateInfo.compileRecord.apiHash      = apiPsoHash;
+        binaryCreateInfo.compileRecord.pipelineHash = pipelineHash;
+        binaryCreateInfo.compileRecord.bindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        binaryCreateInfo.compileRecord.totalTime    = duration;
+        pDefaultCompiler->RecordPipelineCompile(binaryCreateInfo.compileRecord);
+    }
+
+    // The pipeline keeps nothing of the layout it was compiled with.
+    if (linked)
+    {
+        GraphicsPipelineLibrary::FreeLinkedCreateInfo(pDevice, pAllocator, &linkedCreateInfo);
     }
 
     return result;
@@ -1693,6 +1758,7 @@ GraphicsPipeline::GraphicsPipeline(
     Pipeline(pDevice),
     m_info(immedInfo),
     m_vbInfo(vbInfo),
+    m_pOptimizedPalPipelineMem(nullptr),
     m_flags()
 {
     Pipeline::Init(pPalPipeline, pLayout, pBinary, staticStateMask, apiHash);
@@ -1839,11 +1905,41 @@ VkResult GraphicsPipeline::Destroy(
     Device*                      pDevice,
     const VkAllocationCallbacks* pAllocator)
 {
+    if (m_flags.tiered)
+    {
+        // Nothing installs an optimized tier after this.
+        pDevice->GetPipelineTierUpQueue()->Cancel(this);
+
+        Pal::IPipeline* pOptimizedPalPipeline = m_pOptimizedPalPipeline;
+
+        if (pOptimizedPalPipeline != nullptr)
+        {
+            pOptimizedPalPipeline->Destroy();
+            pDevice->VkInstance()->FreeMem(m_pOptimizedPalPipelineMem);
+        }
+    }
+
     DestroyStaticState(pAllocator);
 
     return Pipeline::Destroy(pDevice, pAllocator);
 }
 
+// =====================================================================================================================
+// Installs the optimized tier of a tiered pipeline, which is bound instead of the fast tier from the next bind on, and
+// returned by PalPipeline() from now on.  The fast tier stays alive until the pipeline is destroyed, since command
+// buffers may still reference it.
+void GraphicsPipeline::InstallOptimizedTier(
+    Pal::IPipeline* pPalPipeline,
+    void*           pPalPipelineMem)
+{
+    VK_ASSERT(m_flags.tiered && (m_pOptimizedPalPipeline == nullptr));
+
+    m_pOptimizedPalPipelineMem = pPalPipelineMem;
+
+    // The exchange is a full barrier, so a bind that sees the new pipeline also sees everything written before it.
+    Util::AtomicExchangePointer(reinterpret_cast<void* volatile*>(&m_pOptimizedPalPipeline), pPalPipeline);
+}
+
 // =====================================================================================================================
 GraphicsPipeline::~GraphicsPipeline()
 {
@@ -2059,12 +2155,17 @@ void GraphicsPipeline::BindToCmdBuffer(
         pRenderState->allGpuState.inputAssemblyState = m_info.inputAssemblyState;
     }
 
+    // Tiered pipelines only exist on single GPU devices.
+    Pal::IPipeline* const pOptimizedPalPipeline = m_pOptimizedPalPipeline;
+
     utils::IterateMask deviceGroup(pCmdBuffer->GetDeviceMask());
     do
     {
         const uint32_t deviceIdx = deviceGroup.Index();
 
-        Pal::ICmdBuffer* pPalCmdBuf = pCmdBuffer->PalCmdBuffer(deviceIdx);
+        Pal::ICmdBuffer* pPalCmdBuf   = pCmdBuffer->PalCmdBuffer(deviceIdx);
+        Pal::IPipeline*  pPalPipeline = (pOptimizedPalPipeline != nullptr) ? pOptimizedPalPipeline
+                                                                             : m_pPalPipeline[deviceIdx];
 
         if (pRenderState->allGpuState.pGraphicsPipeline != nullptr)
         {
@@ -2076,7 +2177,7 @@ void GraphicsPipeline::BindToCmdBuffer(
             {
                 Pal::PipelineBindParams params = {};
                 params.pipelineBindPoint = Pal::PipelineBindPoint::Graphics;
-                params.pPipeline         = m_pPalPipeline[deviceIdx];
+                params.pPipeline         = pPalPipeline;
                 params.graphics          = graphicsShaderInfos;
 #if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 471
                 params.apiPsoHash = m_apiHash;
@@ -2089,7 +2190,7 @@ void GraphicsPipeline::BindToCmdBuffer(
         {
             Pal::PipelineBindParams params = {};
             params.pipelineBindPoint = Pal::PipelineBindPoint::Graphics;
-            params.pPipeline         = m_pPalPipeline[deviceIdx];
+            params.pPipeline         = pPalPipeline;
             params.graphics          = graphicsShaderInfos;
 #if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 471
             params.apiPsoHash = m_apiHash;
@@ -0,0 +1,1016 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  vk_graphics_pipeline_library.cpp
+ * @brief Graphics pipeline libraries of VK_EXT_graphics_pipeline_library.
+ ***********************************************************************************************************************
+ */
+
+#include "include/api_state_copier.h"
+#include "include/pipeline_compiler.h"
+#include "include/vk_descriptor_set_layout.h"
+#include "include/vk_device.h"
+#include "include/vk_graphics_pipeline.h"
+#include "include/vk_graphics_pipeline_library.h"
+#include "include/vk_pipeline_layout.h"
+#include "include/vk_render_pass.h"
+#include "include/vk_shader.h"
+
+#include "palAutoBuffer.h"
+#include "palInlineFuncs.h"
+
+#include <string.h>
+
+namespace vk
+{
+
+extern bool IsSrcAlphaUsedInBlend(VkBlendFactor blend);
+
+// Parts of a complete graphics pipeline
+static constexpr VkGraphicsPipelineLibraryFlagsEXT AllLibraryFlags =
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT    |
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT           |
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+// Parts compiled against the pipeline layout
+static constexpr VkGraphicsPipelineLibraryFlagsEXT LayoutLibraryFlags =
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+
+// Parts that depend on the render pass
+static constexpr VkGraphicsPipelineLibraryFlagsEXT RenderPassLibraryFlags =
+    LayoutLibraryFlags | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+// =====================================================================================================================
+// Copies one extension structure as it is.
+template<typename T>
+static VkStructHeaderNonConst* CopyStruct(
+    ApiStateCopier*       pCopier,
+    const VkStructHeader* pHeader)
+{
+    return reinterpret_cast<VkStructHeaderNonConst*>(pCopier->Copy(reinterpret_cast<const T*>(pHeader), 1));
+}
+
+// =====================================================================================================================
+// Copies the extension structures of a pipeline state structure that graphics pipeline creation looks at, and returns
+// the chain of the copies.  Other extension structures are dropped.
+static const void* CopyStateChain(
+    ApiStateCopier* pCopier,
+    const void*     pNext)
+{
+    const void*             pChain = nullptr;
+    VkStructHeaderNonConst* pLast  = nullptr;
+
+    for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pNext);
+         pHeader != nullptr;
+         pHeader = pHeader->pNext)
+    {
+        VkStructHeaderNonConst* pCopy = nullptr;
+
+        switch (static_cast<uint32>(pHeader->sType))
+        {
+        case VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_DIVISOR_STATE_CREATE_INFO_EXT:
+        {
+            const auto* pInfo     = reinterpret_cast<const VkPipelineVertexInputDivisorStateCreateInfoEXT*>(pHeader);
+            auto*       pInfoCopy = pCopier->Copy(pInfo, 1);
+            auto*       pDivisors = pCopier->Copy(pInfo->pVertexBindingDivisors, pInfo->vertexBindingDivisorCount);
+
+            if (pInfoCopy != nullptr)
+            {
+                pInfoCopy->pVertexBindingDivisors = pDivisors;
+            }
+
+            pCopy = reinterpret_cast<VkStructHeaderNonConst*>(pInfoCopy);
+            break;
+        }
+        case VK_STRUCTURE_TYPE_PIPELINE_SAMPLE_LOCATIONS_STATE_CREATE_INFO_EXT:
+        {
+            const auto* pInfo     = reinterpret_cast<const VkPipelineSampleLocationsStateCreateInfoEXT*>(pHeader);
+            auto*       pInfoCopy = pCopier->Copy(pInfo, 1);
+            auto*       pLocations = pCopier->Copy(pInfo->sampleLocationsInfo.pSampleLocations,
+                                                   pInfo->sampleLocationsInfo.sampleLocationsCount);
+
+            if (pInfoCopy != nullptr)
+            {
+                pInfoCopy->sampleLocationsInfo.pNext            = nullptr;
+                pInfoCopy->sampleLocationsInfo.pSampleLocations = pLocations;
+            }
+
+            pCopy = reinterpret_cast<VkStructHeaderNonConst*>(pInfoCopy);
+            break;
+        }
+        case VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_DOMAIN_ORIGIN_STATE_CREATE_INFO:
+            pCopy = CopyStruct<VkPipelineTessellationDomainOriginStateCreateInfo>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_CONSERVATIVE_STATE_CREATE_INFO_EXT:
+            pCopy = CopyStruct<VkPipelineRasterizationConservativeStateCreateInfoEXT>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_RASTERIZATION_ORDER_AMD:
+            pCopy = CopyStruct<VkPipelineRasterizationStateRasterizationOrderAMD>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_STREAM_CREATE_INFO_EXT:
+            pCopy = CopyStruct<VkPipelineRasterizationStateStreamCreateInfoEXT>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_DEPTH_CLIP_STATE_CREATE_INFO_EXT:
+            pCopy = CopyStruct<VkPipelineRasterizationDepthClipStateCreateInfoEXT>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_LINE_STATE_CREATE_INFO_EXT:
+            pCopy = CopyStruct<VkPipelineRasterizationLineStateCreateInfoEXT>(pCopier, pHeader);
+            break;
+        case VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_ADVANCED_STATE_CREATE_INFO_EXT:
+            pCopy = CopyStruct<VkPipelineColorBlendAdvancedStateCreateInfoEXT>(pCopier, pHeader);
+            break;
+        default:
+            break;
+        }
+
+        if (pCopy != nullptr)
+        {
+            pCopy->pNext = nullptr;
+
+            if (pLast != nullptr)
+            {
+                pLast->pNext = reinterpret_cast<VkStructHeader*>(pCopy);
+            }
+            else
+            {
+                pChain = pCopy;
+            }
+
+            pLast = pCopy;
+        }
+    }
+
+    return pChain;
+}
+
+// =====================================================================================================================
+// Copies a pipeline state structure and its extension structures.  Arrays the structure points to are left to the
+// caller.
+template<typename T>
+static T* CopyState(
+    ApiStateCopier* pCopier,
+    const T*        pState)
+{
+    T* pCopy = nullptr;
+
+    if (pState != nullptr)
+    {
+        pCopy = pCopier->Copy(pState, 1);
+
+        const void* pNext = CopyStateChain(pCopier, pState->pNext);
+
+        if (pCopy != nullptr)
+        {
+            pCopy->pNext = pNext;
+        }
+    }
+
+    return pCopy;
+}
+
+// =====================================================================================================================
+static bool IsDynamicStateEnabled(
+    const VkPipelineDynamicStateCreateInfo* pDynamicState,
+    VkDynamicState                          dynamicState)
+{
+    bool enabled = false;
+
+    if (pDynamicState != nullptr)
+    {
+        for (uint32_t i = 0; (enabled == false) && (i < pDynamicState->dynamicStateCount); ++i)
+        {
+            enabled = (pDynamicState->pDynamicStates[i] == dynamicState);
+        }
+    }
+
+    return enabled;
+}
+
+// =====================================================================================================================
+// Copies the state a graphics pipeline create info points to into the copier, and points pOut at the copies.  pOut is
+// left alone while the copier only adds up sizes.
+static void CopyLibraryState(
+    ApiStateCopier*                     pCopier,
+    const VkGraphicsPipelineCreateInfo& in,
+    VkGraphicsPipelineCreateInfo*       pOut)
+{
+    auto* pStages = pCopier->Copy(in.pStages, in.stageCount);
+
+    for (uint32_t i = 0; i < in.stageCount; ++i)
+    {
+        const VkPipelineShaderStageCreateInfo& stage = in.pStages[i];
+
+        const char*           pName     = pCopier->Copy(stage.pName, strlen(stage.pName) + 1);
+        VkSpecializationInfo* pSpecInfo = pCopier->Copy(stage.pSpecializationInfo, 1);
+
+        if (stage.pSpecializationInfo != nullptr)
+        {
+            const VkSpecializationInfo& specInfo = *stage.pSpecializationInfo;
+
+            auto* pMapEntries = pCopier->Copy(specInfo.pMapEntries, specInfo.mapEntryCount);
+            auto* pData       = pCopier->Copy(static_cast<const uint8_t*>(specInfo.pData), specInfo.dataSize);
+
+            if (pSpecInfo != nullptr)
+            {
+                pSpecInfo->pMapEntries = pMapEntries;
+                pSpecInfo->pData       = pData;
+            }
+        }
+
+        if (pStages != nullptr)
+        {
+            pStages[i].pNext               = nullptr;
+            pStages[i].pName               = pName;
+            pStages[i].pSpecializationInfo = pSpecInfo;
+        }
+    }
+
+    auto* pVertexInput = CopyState(pCopier, in.pVertexInputState);
+
+    if (in.pVertexInputState != nullptr)
+    {
+        const VkPipelineVertexInputStateCreateInfo& vertexInput = *in.pVertexInputState;
+
+        auto* pBindings   = pCopier->Copy(vertexInput.pVertexBindingDescriptions,
+                                          vertexInput.vertexBindingDescriptionCount);
+        auto* pAttributes = pCopier->Copy(vertexInput.pVertexAttributeDescriptions,
+                                          vertexInput.vertexAttributeDescriptionCount);
+
+        if (pVertexInput != nullptr)
+        {
+            pVertexInput->pVertexBindingDescriptions   = pBindings;
+            pVertexInput->pVertexAttributeDescriptions = pAttributes;
+        }
+    }
+
+    auto* pViewport = CopyState(pCopier, in.pViewportState);
+
+    if (in.pViewportState != nullptr)
+    {
+        const VkPipelineViewportStateCreateInfo& viewport = *in.pViewportState;
+
+        // Static viewports and scissors are ignored, and may be invalid, when they are dynamic.
+        VkViewport* pViewports = nullptr;
+        VkRect2D*   pScissors  = nullptr;
+
+        if (IsDynamicStateEnabled(in.pDynamicState, VK_DYNAMIC_STATE_VIEWPORT) == false)
+        {
+            pViewports = pCopier->Copy(viewport.pViewports, viewport.viewportCount);
+        }
+
+        if (IsDynamicStateEnabled(in.pDynamicState, VK_DYNAMIC_STATE_SCISSOR) == false)
+        {
+            pScissors = pCopier->Copy(viewport.pScissors, viewport.scissorCount);
+        }
+
+        if (pViewport != nullptr)
+        {
+            pViewport->pViewports = pViewports;
+            pViewport->pScissors  = pScissors;
+        }
+    }
+
+    auto* pMultisample = CopyState(pCopier, in.pMultisampleState);
+
+    if (in.pMultisampleState != nullptr)
+    {
+        const VkPipelineMultisampleStateCreateInfo& multisample = *in.pMultisampleState;
+
+        auto* pSampleMask = pCopier->Copy(multisample.pSampleMask, (multisample.rasterizationSamples + 31) / 32);
+
+        if (pMultisample != nullptr)
+        {
+            pMultisample->pSampleMask = pSampleMask;
+        }
+    }
+
+    auto* pColorBlend = CopyState(pCopier, in.pColorBlendState);
+
+    if (in.pColorBlendState != nullptr)
+    {
+        auto* pAttachments = pCopier->Copy(in.pColorBlendState->pAttachments, in.pColorBlendState->attachmentCount);
+
+        if (pColorBlend != nullptr)
+        {
+            pColorBlend->pAttachments = pAttachments;
+        }
+    }
+
+    auto* pDynamic = CopyState(pCopier, in.pDynamicState);
+
+    if (in.pDynamicState != nullptr)
+    {
+        auto* pDynamicStates = pCopier->Copy(in.pDynamicState->pDynamicStates, in.pDynamicState->dynamicStateCount);
+
+        if (pDynamic != nullptr)
+        {
+            pDynamic->pDynamicStates = pDynamicStates;
+        }
+    }
+
+    auto* pInputAssembly = CopyState(pCopier, in.pInputAssemblyState);
+    auto* pTessellation  = CopyState(pCopier, in.pTessellationState);
+    auto* pRasterization = CopyState(pCopier, in.pRasterizationState);
+    auto* pDepthStencil  = CopyState(pCopier, in.pDepthStencilState);
+
+    if (pStages != nullptr)
+    {
+        pOut->pStages = pStages;
+    }
+
+    pOut->pVertexInputState   = pVertexInput;
+    pOut->pInputAssemblyState = pInputAssembly;
+    pOut->pTessellationState  = pTessellation;
+    pOut->pViewportState      = pViewport;
+    pOut->pRasterizationState = pRasterization;
+    pOut->pMultisampleState   = pMultisample;
+    pOut->pDepthStencilState  = pDepthStencil;
+    pOut->pColorBlendState    = pColorBlend;
+    pOut->pDynamicState       = pDynamic;
+}
+
+// =====================================================================================================================
+// Points a state pointer of a linked create info at the state of a part, unless an earlier part has set it already.
+template<typename T>
+static void SetIfNull(
+    const T** ppState,
+    const T*  pState)
+{
+    if (*ppState == nullptr)
+    {
+        *ppState = pState;
+    }
+}
+
+// =====================================================================================================================
+// Creates a pipeline layout holding the descriptor sets and push constants of all the given layouts.  Libraries created
+// with VK_PIPELINE_LAYOUT_CREATE_INDEPENDENT_SETS_BIT_EXT layouts may leave the sets only other parts use empty, so a
+// set that some layout actually uses is preferred over an empty one.  Set layouts are copied, so the given layouts only
+// need to be valid for the duration of the call.
+static VkResult CreateUnionLayout(
+    Device*                      pDevice,
+    const PipelineLayout* const* ppLayouts,
+    uint32_t                     layoutCount,
+    const VkAllocationCallbacks* pAllocator,
+    VkPipelineLayout*            pLayout)
+{
+    VkDescriptorSetLayout setLayouts[MaxDescriptorSets] = {};
+    uint32_t              setCount                      = 0;
+    uint32_t              pushConstRegCount             = 0;
+
+    for (uint32_t i = 0; i < layoutCount; ++i)
+    {
+        const PipelineLayout::Info& info = ppLayouts[i]->GetInfo();
+
+        for (uint32_t set = 0; set < info.setCount; ++set)
+        {
+            const DescriptorSetLayout* pSetLayout = ppLayouts[i]->GetSetLayouts(set);
+
+            if ((setLayouts[set] == VK_NULL_HANDLE) ||
+                ((pSetLayout->Info().activeStageMask != 0) &&
+                 (DescriptorSetLayout::ObjectFromHandle(setLayouts[set])->Info().activeStageMask == 0)))
+            {
+                setLayouts[set] = DescriptorSetLayout::HandleFromObject(pSetLayout);
+            }
+        }
+
+        setCount          = Util::Max(setCount, info.setCount);
+        pushConstRegCount = Util::Max(pushConstRegCount, info.userDataLayout.pushConstRegCount);
+    }
+
+    VkPushConstantRange pushConstRange = {};
+    pushConstRange.stageFlags = VK_SHADER_STAGE_ALL;
+    pushConstRange.size       = pushConstRegCount * sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount         = setCount;
+    layoutInfo.pSetLayouts            = setLayouts;
+    layoutInfo.pushConstantRangeCount = (pushConstRegCount > 0) ? 1 : 0;
+    layoutInfo.pPushConstantRanges    = &pushConstRange;
+
+    return PipelineLayout::Create(pDevice, &layoutInfo, pAllocator, pLayout);
+}
+
+// =====================================================================================================================
+// Creates a render pass with the attachments of a render pass and a copy of one of its subpasses, as far as pipelines
+// look at it: its color and depth/stencil attachments and its view mask.  The copied subpass is subpass 0 of the new
+// render pass.
+static VkResult CopyRenderPass(
+    Device*                      pDevice,
+    const RenderPass*            pRenderPass,
+    uint32_t                     subpass,
+    const VkAllocationCallbacks* pAllocator,
+    VkRenderPass*                pCopy)
+{
+    const uint32_t attachmentCount = pRenderPass->GetAttachmentCount();
+    const uint32_t colorCount      = Util::Min(pRenderPass->GetSubpassColorReferenceCount(subpass),
+                                               Pal::MaxColorTargets);
+
+    Util::AutoBuffer<VkAttachmentDescription2, 16, PalAllocator> attachments(
+        attachmentCount, pDevice->VkInstance()->Allocator());
+
+    VkResult result = (attachments.Capacity() >= attachmentCount) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+
+    if (result == VK_SUCCESS)
+    {
+        for (uint32_t i = 0; i < attachmentCount; ++i)
+        {
+            const AttachmentDescription& desc = pRenderPass->GetAttachmentDesc(i);
+
+            attachments[i]                = {};
+            attachments[i].sType          = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2;
+            attachments[i].flags          = desc.flags;
+            attachments[i].format         = desc.format;
+            attachments[i].samples        = desc.samples;
+            attachments[i].loadOp         = desc.loadOp;
+            attachments[i].storeOp        = desc.storeOp;
+            attachments[i].stencilLoadOp  = desc.stencilLoadOp;
+            attachments[i].stencilStoreOp = desc.stencilStoreOp;
+            attachments[i].initialLayout  = desc.initialLayout;
+            attachments[i].finalLayout    = desc.finalLayout;
+        }
+
+        VkAttachmentReference2 colorRefs[Pal::MaxColorTargets] = {};
+        VkAttachmentReference2 depthStencilRef                 = {};
+
+        for (uint32_t i = 0; i < colorCount; ++i)
+        {
+            const AttachmentReference& ref = pRenderPass->GetSubpassColorReference(subpass, i);
+
+            colorRefs[i].sType      = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
+            colorRefs[i].attachment = ref.attachment;
+            colorRefs[i].layout     = ref.layout;
+            colorRefs[i].aspectMask = ref.aspectMask;
+        }
+
+        const AttachmentReference& ref = pRenderPass->GetSubpassDepthStencilReference(subpass);
+
+        depthStencilRef.sType      = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
+        depthStencilRef.attachment = ref.attachment;
+        depthStencilRef.layout     = ref.layout;
+        depthStencilRef.aspectMask = ref.aspectMask;
+
+        VkSubpassDescription2 subpassDesc = {};
+        subpassDesc.sType                   = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2;
+        subpassDesc.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDesc.viewMask                = pRenderPass->GetViewMask(subpass);
+        subpassDesc.colorAttachmentCount    = colorCount;
+        subpassDesc.pColorAttachments       = colorRefs;
+        subpassDesc.pDepthStencilAttachment = &depthStencilRef;
+
+        VkRenderPassCreateInfo2 renderPassInfo = {};
+        renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2;
+        renderPassInfo.attachmentCount = attachmentCount;
+        renderPassInfo.pAttachments    = &attachments[0];
+        renderPassInfo.subpassCount    = 1;
+        renderPassInfo.pSubpasses      = &subpassDesc;
+
+        result = RenderPass::Create(pDevice, &renderPassInfo, pAllocator, pCopy);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Adds the parts of a create info selected by libraryFlags to a linked create info.  Parts and state the linked create
+// info has already are kept.
+static void MergeLibraryState(
+    const VkGraphicsPipelineCreateInfo&        in,
+    VkGraphicsPipelineLibraryFlagsEXT          libraryFlags,
+    GraphicsPipelineLibrary::LinkedCreateInfo* pLinkedInfo)
+{
+    VkGraphicsPipelineCreateInfo* pOut = &pLinkedInfo->createInfo;
+
+    const bool preRasterization = (libraryFlags & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) != 0;
+    const bool fragmentShader   = (libraryFlags & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) != 0;
+    const bool fragmentOutput   = (libraryFlags & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) != 0;
+
+    if ((libraryFlags & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) != 0)
+    {
+        SetIfNull(&pOut->pVertexInputState,   in.pVertexInputState);
+        SetIfNull(&pOut->pInputAssemblyState, in.pInputAssemblyState);
+    }
+
+    if (preRasterization)
+    {
+        SetIfNull(&pOut->pTessellationState,  in.pTessellationState);
+        SetIfNull(&pOut->pViewportState,      in.pViewportState);
+        SetIfNull(&pOut->pRasterizationState, in.pRasterizationState);
+    }
+
+    if (fragmentShader)
+    {
+        SetIfNull(&pOut->pDepthStencilState, in.pDepthStencilState);
+    }
+
+    if (fragmentShader || fragmentOutput)
+    {
+        SetIfNull(&pOut->pMultisampleState, in.pMultisampleState);
+    }
+
+    if (fragmentOutput)
+    {
+        SetIfNull(&pOut->pColorBlendState, in.pColorBlendState);
+    }
+
+    if ((libraryFlags & RenderPassLibraryFlags) != 0)
+    {
+        if (pOut->renderPass == VK_NULL_HANDLE)
+        {
+            pOut->renderPass = in.renderPass;
+            pOut->subpass    = in.subpass;
+        }
+    }
+
+    for (uint32_t i = 0; i < in.stageCount; ++i)
+    {
+        const VkPipelineShaderStageCreateInfo& stage = in.pStages[i];
+
+        const bool selected = (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) ? fragmentShader : preRasterization;
+        bool       present  = false;
+
+        for (uint32_t j = 0; j < pOut->stageCount; ++j)
+        {
+            present |= (pLinkedInfo->stages[j].stage == stage.stage);
+        }
+
+        if (selected && (present == false) && (pOut->stageCount < ShaderStage::ShaderStageGfxCount))
+        {
+            pLinkedInfo->stages[pOut->stageCount++] = stage;
+        }
+    }
+
+    if ((libraryFlags != 0) && (in.pDynamicState != nullptr))
+    {
+        VkPipelineDynamicStateCreateInfo* pDynamicState = &pLinkedInfo->dynamicState;
+
+        for (uint32_t i = 0; i < in.pDynamicState->dynamicStateCount; ++i)
+        {
+            const VkDynamicState dynamicState = in.pDynamicState->pDynamicStates[i];
+
+            if (IsDynamicStateEnabled(pDynamicState, dynamicState) == false)
+            {
+                VK_ASSERT(pDynamicState->dynamicStateCount < GraphicsPipelineLibrary::MaxDynamicStates);
+
+                if (pDynamicState->dynamicStateCount < GraphicsPipelineLibrary::MaxDynamicStates)
+                {
+                    pLinkedInfo->dynamicStates[pDynamicState->dynamicStateCount++] = dynamicState;
+                }
+            }
+        }
+    }
+
+    pLinkedInfo->libraryFlags |= libraryFlags;
+}
+
+// =====================================================================================================================
+// Returns the parts of a graphics pipeline a create info specifies itself, apart from the libraries it links.
+VkGraphicsPipelineLibraryFlagsEXT GraphicsPipelineLibrary::GetLibraryFlags(
+    const VkGraphicsPipelineCreateInfo* pCreateInfo)
+{
+    VkGraphicsPipelineLibraryFlagsEXT libraryFlags = AllLibraryFlags;
+    bool                              hasLibraryInfo = false;
+
+    for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pCreateInfo->pNext);
+         pHeader != nullptr;
+         pHeader = pHeader->pNext)
+    {
+        if (static_cast<uint32>(pHeader->sType) == VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT)
+        {
+            libraryFlags   = reinterpret_cast<const VkGraphicsPipelineLibraryCreateInfoEXT*>(pHeader)->flags;
+            hasLibraryInfo = true;
+        }
+    }
+
+    // A library, or a pipeline linking libraries, that doesn't say which parts it specifies specifies none.
+    if ((hasLibraryInfo == false) &&
+        (((pCreateInfo->flags & VK_PIPELINE_CREATE_LIBRARY_BIT_KHR) != 0) ||
+         (GetLibraryCreateInfo(pCreateInfo) != nullptr)))
+    {
+        libraryFlags = 0;
+    }
+
+    return libraryFlags;
+}
+
+// =====================================================================================================================
+// Returns the libraries a create info links, or null if it links none.
+const VkPipelineLibraryCreateInfoKHR* GraphicsPipelineLibrary::GetLibraryCreateInfo(
+    const VkGraphicsPipelineCreateInfo* pCreateInfo)
+{
+    const VkPipelineLibraryCreateInfoKHR* pLibraryInfo = nullptr;
+
+    for (const VkStructHeader* pHeader = static_cast<const VkStructHeader*>(pCreateInfo->pNext);
+         pHeader != nullptr;
+         pHeader = pHeader->pNext)
+    {
+        if (static_cast<uint32>(pHeader->sType) == VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR)
+        {
+            pLibraryInfo = reinterpret_cast<const VkPipelineLibraryCreateInfoKHR*>(pHeader);
+        }
+    }
+
+    if ((pLibraryInfo != nullptr) && (pLibraryInfo->libraryCount == 0))
+    {
+        pLibraryInfo = nullptr;
+    }
+
+    return pLibraryInfo;
+}
+
+// =====================================================================================================================
+// Assembles the parts a create info specifies itself and the parts of the libraries it links into one create info.
+// The linked create info points to the state of the create info and of the libraries, so it is valid only as long as
+// those are.  It must be freed with FreeLinkedCreateInfo().
+VkResult GraphicsPipelineLibrary::BuildLinkedCreateInfo(
+    Device*                             pDevice,
+    const VkGraphicsPipelineCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks*        pAllocator,
+    LinkedCreateInfo*                   pLinkedInfo)
+{
+    memset(pLinkedInfo, 0, sizeof(LinkedCreateInfo));
+
+    VkGraphicsPipelineCreateInfo* pOut = &pLinkedInfo->createInfo;
+
+    pOut->sType              = pCreateInfo->sType;
+    pOut->pNext              = pCreateInfo->pNext;
+    pOut->flags              = pCreateInfo->flags;
+    pOut->pStages            = pLinkedInfo->stages;
+    pOut->basePipelineHandle = pCreateInfo->basePipelineHandle;
+    pOut->basePipelineIndex  = pCreateInfo->basePipelineIndex;
+
+    pLinkedInfo->dynamicState.sType          = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    pLinkedInfo->dynamicState.pDynamicStates = pLinkedInfo->dynamicStates;
+
+    const VkGraphicsPipelineLibraryFlagsEXT libraryFlags = GetLibraryFlags(pCreateInfo);
+    const bool isLibrary = ((pCreateInfo->flags & VK_PIPELINE_CREATE_LIBRARY_BIT_KHR) != 0);
+
+    // A pipeline is compiled with its own layout and render pass, whether or not it specifies parts itself.  A library
+    // only has them for the parts that use them, and they may be invalid otherwise.
+    if ((isLibrary == false) || ((libraryFlags & LayoutLibraryFlags) != 0))
+    {
+        pOut->layout = pCreateInfo->layout;
+    }
+
+    if ((isLibrary == false) || ((libraryFlags & RenderPassLibraryFlags) != 0))
+    {
+        pOut->renderPass = pCreateInfo->renderPass;
+        pOut->subpass    = pCreateInfo->subpass;
+    }
+
+    MergeLibraryState(*pCreateInfo, libraryFlags, pLinkedInfo);
+
+    const VkPipelineLibraryCreateInfoKHR* pLibraryInfo = GetLibraryCreateInfo(pCreateInfo);
+
+    // Each part comes from one library at most, so at most one layout per part is linked.
+    const PipelineLayout* libraryLayouts[ShaderStage::ShaderStageGfxCount] = {};
+    uint32_t              libraryLayoutCount                               = 0;
+
+    for (uint32_t i = 0; (pLibraryInfo != nullptr) && (i < pLibraryInfo->libraryCount); ++i)
+    {
+        const auto* pLibrary =
+            static_cast<const GraphicsPipelineLibrary*>(Pipeline::ObjectFromHandle(pLibraryInfo->pLibraries[i]));
+
+        MergeLibraryState(*pLibrary->GetCreateInfo(), pLibrary->GetLibraryFlags(), pLinkedInfo);
+
+        const PipelineLayout* pLayout = PipelineLayout::ObjectFromHandle(pLibrary->GetCreateInfo()->layout);
+
+        if ((pLayout != nullptr) && (libraryLayoutCount < ShaderStage::ShaderStageGfxCount))
+        {
+            libraryLayouts[libraryLayoutCount++] = pLayout;
+        }
+    }
+
+    VkResult result = VK_SUCCESS;
+
+    // Without a layout of its own, the parts of the libraries are compiled with the union of their layouts.
+    if (pOut->layout == VK_NULL_HANDLE)
+    {
+        if (libraryLayoutCount == 1)
+        {
+            pOut->layout = PipelineLayout::HandleFromObject(libraryLayouts[0]);
+        }
+        else if (libraryLayoutCount > 1)
+        {
+            result = CreateUnionLayout(pDevice, libraryLayouts, libraryLayoutCount, pAllocator,
+                                       &pLinkedInfo->unionLayout);
+
+            pOut->layout = pLinkedInfo->unionLayout;
+        }
+    }
+
+    if (pLinkedInfo->dynamicState.dynamicStateCount > 0)
+    {
+        pOut->pDynamicState = &pLinkedInfo->dynamicState;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Frees the objects a linked create info created.
+void GraphicsPipelineLibrary::FreeLinkedCreateInfo(
+    Device*                      pDevice,
+    const VkAllocationCallbacks* pAllocator,
+    LinkedCreateInfo*            pLinkedInfo)
+{
+    if (pLinkedInfo->unionLayout != VK_NULL_HANDLE)
+    {
+        PipelineLayout::ObjectFromHandle(pLinkedInfo->unionLayout)->Destroy(pDevice, pAllocator);
+
+        pLinkedInfo->unionLayout = VK_NULL_HANDLE;
+    }
+}
+
+// =====================================================================================================================
+// Creates a graphics pipeline library.  The library copies the state of its parts, including the shader modules of its
+// stages, its pipeline layout and the render pass data its parts use, so the application may destroy everything once
+// it is created.
+VkResult GraphicsPipelineLibrary::Create(
+    Device*                                 pDevice,
+    PipelineCache*                          pPipelineCache,
+    const VkGraphicsPipelineCreateInfo*     pCreateInfo,
+    const VkAllocationCallbacks*            pAllocator,
+    VkPipeline*                             pPipeline)
+{
+    LinkedCreateInfo libraryInfo;
+    VkResult         result = BuildLinkedCreateInfo(pDevice, pCreateInfo, pAllocator, &libraryInfo);
+
+    const VkGraphicsPipelineCreateInfo& createInfo = libraryInfo.createInfo;
+
+    VkGraphicsPipelineCreateInfo stateInfo = createInfo;
+
+    stateInfo.layout     = VK_NULL_HANDLE;
+    stateInfo.renderPass = VK_NULL_HANDLE;
+    stateInfo.subpass    = 0;
+
+    ApiStateCopier sizer(nullptr);
+    CopyLibraryState(&sizer, createInfo, &stateInfo);
+
+    const size_t objSize = Util::Pow2Align(sizeof(GraphicsPipelineLibrary), VK_DEFAULT_MEM_ALIGN);
+
+    void*          pMemory = nullptr;
+    VkShaderModule shaderModules[ShaderStage::ShaderStageGfxCount] = {};
+
+    if ((result == VK_SUCCESS) && (createInfo.layout != VK_NULL_HANDLE))
+    {
+        const PipelineLayout* pLayout = PipelineLayout::ObjectFromHandle(createInfo.layout);
+
+        result = CreateUnionLayout(pDevice, &pLayout, 1, pAllocator, &stateInfo.layout);
+    }
+
+    if ((result == VK_SUCCESS) && (createInfo.renderPass != VK_NULL_HANDLE))
+    {
+        result = CopyRenderPass(pDevice, RenderPass::ObjectFromHandle(createInfo.renderPass), createInfo.subpass,
+                                pAllocator, &stateInfo.renderPass);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        pMemory = pDevice->AllocApiObject(pAllocator, objSize + sizer.GetSize());
+        result  = (pMemory != nullptr) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        ApiStateCopier copier(Util::VoidPtrInc(pMemory, objSize));
+        CopyLibraryState(&copier, createInfo, &stateInfo);
+
+        // The stages get shader modules of their own, which are cheap to create since built modules are interned.
+        for (uint32_t i = 0; (result == VK_SUCCESS) && (i < stateInfo.stageCount); ++i)
+        {
+            const ShaderModule* pModule = ShaderModule::ObjectFromHandle(createInfo.pStages[i].module);
+
+            VkShaderModuleCreateInfo moduleInfo = {};
+            moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            moduleInfo.codeSize = pModule->GetCodeSize();
+            moduleInfo.pCode    = static_cast<const uint32_t*>(pModule->GetCode());
+
+            result = ShaderModule::Create(pDevice, &moduleInfo, pAllocator, &shaderModules[i]);
+
+            const_cast<VkPipelineShaderStageCreateInfo*>(stateInfo.pStages)[i].module = shaderModules[i];
+        }
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        GraphicsPipelineLibrary* pLibrary = VK_PLACEMENT_NEW(pMemory) GraphicsPipelineLibrary(
+            pDevice,
+            libraryInfo.libraryFlags,
+            stateInfo,
+            shaderModules);
+
+        pLibrary->PrecompileFragmentShader(pDevice);
+
+        *pPipeline = GraphicsPipelineLibrary::HandleFromVoidPointer(pMemory);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < ShaderStage::ShaderStageGfxCount; ++i)
+        {
+            if (shaderModules[i] != VK_NULL_HANDLE)
+            {
+                ShaderModule::ObjectFromHandle(shaderModules[i])->Destroy(pDevice, pAllocator);
+            }
+        }
+
+        if (stateInfo.layout != VK_NULL_HANDLE)
+        {
+            PipelineLayout::ObjectFromHandle(stateInfo.layout)->Destroy(pDevice, pAllocator);
+        }
+
+        if (stateInfo.renderPass != VK_NULL_HANDLE)
+        {
+            RenderPass::ObjectFromHandle(stateInfo.renderPass)->Destroy(pDevice, pAllocator);
+        }
+
+        if (pMemory != nullptr)
+        {
+            pDevice->FreeApiObject(pAllocator, pMemory);
+        }
+    }
+
+    FreeLinkedCreateInfo(pDevice, pAllocator, &libraryInfo);
+
+    return result;
+}
+
+// =====================================================================================================================
+GraphicsPipelineLibrary::GraphicsPipelineLibrary(
+    Device* const                           pDevice,
+    VkGraphicsPipelineLibraryFlagsEXT       libraryFlags,
+    const VkGraphicsPipelineCreateInfo&     createInfo,
+    const VkShaderModule*                   pShaderModules)
+    :
+    Pipeline(pDevice),
+    m_libraryFlags(libraryFlags),
+    m_createInfo(createInfo)
+{
+    memcpy(m_shaderModules, pShaderModules, sizeof(m_shaderModules));
+
+    // Only the libraries linking this one may refer to the create info it was made from.
+    m_createInfo.pNext = nullptr;
+}
+
+// =====================================================================================================================
+VkResult GraphicsPipelineLibrary::Destroy(
+    Device*                         pDevice,
+    const VkAllocationCallbacks*    pAllocator)
+{
+    for (uint32_t i = 0; i < ShaderStage::ShaderStageGfxCount; ++i)
+    {
+        if (m_shaderModules[i] != VK_NULL_HANDLE)
+        {
+            ShaderModule::ObjectFromHandle(m_shaderModules[i])->Destroy(pDevice, pAllocator);
+        }
+    }
+
+    // The layout and render pass are the library's own copies.
+    if (m_createInfo.layout != VK_NULL_HANDLE)
+    {
+        PipelineLayout::ObjectFromHandle(m_createInfo.layout)->Destroy(pDevice, pAllocator);
+    }
+
+    if (m_createInfo.renderPass != VK_NULL_HANDLE)
+    {
+        RenderPass::ObjectFromHandle(m_createInfo.renderPass)->Destroy(pDevice, pAllocator);
+    }
+
+    return Pipeline::Destroy(pDevice, pAllocator);
+}
+
+// =====================================================================================================================
+// Builds the fragment shader of a library that holds the fragment output interface as well, whose color targets are
+// known then.  The shader parts LLPC builds go to the internal binary cache, from where the pipelines linking the
+// library pick them up instead of compiling the fragment shader again.
+void GraphicsPipelineLibrary::PrecompileFragmentShader(
+    Device* pDevice) const
+{
+#if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
+    constexpr VkGraphicsPipelineLibraryFlagsEXT FragmentFlags =
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT |
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+    const PipelineLayout* pLayout     = PipelineLayout::ObjectFromHandle(m_createInfo.layout);
+    const RenderPass*     pRenderPass = RenderPass::ObjectFromHandle(m_createInfo.renderPass);
+    PipelineCompiler*     pCompiler   = pDevice->GetCompiler(DefaultDeviceIndex);
+
+    const VkPipelineShaderStageCreateInfo* pStage = nullptr;
+
+    for (uint32_t i = 0; i < m_createInfo.stageCount; ++i)
+    {
+        if (m_createInfo.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+        {
+            pStage = &m_createInfo.pStages[i];
+        }
+    }
+
+    if (pDevice->GetRuntimeSettings().enablePartialPipelineCompile &&
+        ((m_libraryFlags & FragmentFlags) == FragmentFlags)         &&
+        (pStage != nullptr) && (pLayout != nullptr) && (pRenderPass != nullptr) &&
+        (pCompiler->GetShaderCacheType() == PipelineCompilerTypeLlpc))
+    {
+        const ShaderModule* pModule     = ShaderModule::ObjectFromHandle(pStage->module);
+        void*               pModuleData = pModule->GetShaderData(PipelineCompilerTypeLlpc);
+        auto*               pModuleDataEx = static_cast<Vkgc::ShaderModuleDataEx*>(pModuleData);
+
+        Vkgc::ShaderModuleEntryData* pEntryData = nullptr;
+
+        for (uint32_t i = 0; (pModuleDataEx != nullptr) && (i < pModuleDataEx->extra.entryCount); ++i)
+        {
+            Vkgc::ShaderModuleEntryData* pEntry = &pModuleDataEx->extra.entryDatas[i];
+
+            if ((pEntry->stage == Vkgc::ShaderStageFragment) && (strcmp(pEntry->pEntryName, pStage->pName) == 0))
+            {
+                pEntryData = pEntry;
+            }
+        }
+
+        Vkgc::ColorTarget colorTargets[Vkgc::MaxColorTargets] = {};
+
+        const VkPipelineColorBlendStateCreateInfo* pCb = m_createInfo.pColorBlendState;
+
+        if (pCb != nullptr)
+        {
+            const uint32_t numColorTargets = Util::Min(pCb->attachmentCount, Vkgc::MaxColorTargets);
+
+            for (uint32_t i = 0; i < numColorTargets; ++i)
+            {
+                const VkPipelineColorBlendAttachmentState& src = pCb->pAttachments[i];
+
+                colorTargets[i].format               = pRenderPass->GetColorAttachmentFormat(m_createInfo.subpass, i);
+                colorTargets[i].blendEnable          = (src.blendEnable == VK_TRUE);
+                colorTargets[i].blendSrcAlphaToColor = IsSrcAlphaUsedInBlend(src.srcAlphaBlendFactor) ||
+                                                       IsSrcAlphaUsedInBlend(src.dstAlphaBlendFactor) ||
+                                                       IsSrcAlphaUsedInBlend(src.srcColorBlendFactor) ||
+                                                       IsSrcAlphaUsedInBlend(src.dstColorBlendFactor);
+                colorTargets[i].channelWriteMask     = (colorTargets[i].format != VK_FORMAT_UNDEFINED) ?
+                                                       src.colorWriteMask : 0;
+            }
+        }
+
+        const size_t mappingBufferSize = pLayout->GetPipelineInfo()->mappingBufferSize;
+        void*        pMappingBuffer    = nullptr;
+
+        if ((pEntryData != nullptr) && (mappingBufferSize > 0))
+        {
+            pMappingBuffer = pDevice->VkInstance()->AllocMem(mappingBufferSize,
+                                                             VK_DEFAULT_MEM_ALIGN,
+                                                             VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+        }
+
+        if (pMappingBuffer != nullptr)
+        {
+            memset(pMappingBuffer, 0, mappingBufferSize);
+
+            Vkgc::ResourceMappingData mapping = {};
+            VbBindingInfo             vbInfo  = {};
+
+            VkResult result = pLayout->BuildLlpcPipelineMapping(
+                Vkgc::ShaderStageFragmentBit, pMappingBuffer, &mapping, nullptr, &vbInfo);
+
+            for (uint32_t deviceIdx = 0; (result == VK_SUCCESS) && (deviceIdx < pDevice->NumPalDevices()); ++deviceIdx)
+            {
+                // A failed build only means the linking pipelines compile the fragment shader themselves.
+                pDevice->GetCompiler(deviceIdx)->CreatePartialPipelineBinary(
+                    deviceIdx,
+                    pModuleData,
+                    pEntryData,
+                    mapping.pUserDataNodes,
+                    mapping.userDataNodeCount,
+                    colorTargets);
+            }
+
+            pDevice->VkInstance()->FreeMem(pMappingBuffer);
+        }
+    }
+#endif
+}
+
+} // namespace vk
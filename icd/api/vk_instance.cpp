@@ -681,6 +681,9 @@ VkResult Instance::Destroy(void)
     // Destroy physical device manager
     if (m_pPhysicalDeviceManager != nullptr)
     {
+        // Entries queued for the pipeline cache archives must reach the disk before the instance goes away.
+        m_pPhysicalDeviceManager->DrainPipelineCacheWrites();
+
         m_pPhysicalDeviceManager->Destroy();
     }
 
@@ -3532,6 +3532,10 @@ DeviceExtensions::Supported PhysicalDevice::GetAvailableExtensions(
     availableExtensions.AddExtension(VK_DEVICE_EXTENSION(EXT_INLINE_UNIFORM_BLOCK));
     availableExtensions.AddExtension(VK_DEVICE_EXTENSION(KHR_SHADER_FLOAT16_INT8));
 
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+    availableExtensions.AddExtension(VK_DEVICE_EXTENSION(KHR_DEFERRED_HOST_OPERATIONS));
+#endif
+
     if ((pPhysicalDevice == nullptr) ||
         (pPhysicalDevice->PalProperties().osProperties.supportQueuePriority))
     {
@@ -3597,6 +3601,14 @@ DeviceExtensions::Supported PhysicalDevice::GetAvailableExtensions(
 
     availableExtensions.AddExtension(VK_DEVICE_EXTENSION(EXT_PIPELINE_CREATION_CACHE_CONTROL));
 
+    availableExtensions.AddExtension(VK_DEVICE_EXTENSION(KHR_PIPELINE_LIBRARY));
+
+    // Linking libraries compiles the whole pipeline, so the extension is opt-in.
+    if ((pPhysicalDevice == nullptr) || pPhysicalDevice->GetRuntimeSettings().enableGraphicsPipelineLibrary)
+    {
+        availableExtensions.AddExtension(VK_DEVICE_EXTENSION(EXT_GRAPHICS_PIPELINE_LIBRARY));
+    }
+
     availableExtensions.AddExtension(VK_DEVICE_EXTENSION(EXT_IMAGE_ROBUSTNESS));
 
     availableExtensions.AddExtension(VK_DEVICE_EXTENSION(EXT_HOST_QUERY_RESET));
@@ -4824,6 +4836,14 @@ void PhysicalDevice::GetFeatures2(
                 break;
             }
 
+            case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT:
+            {
+                auto* pExtInfo = reinterpret_cast<VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT*>(pHeader);
+                pExtInfo->graphicsPipelineLibrary = GetRuntimeSettings().enableGraphicsPipelineLibrary ? VK_TRUE
+                                                                                                       : VK_FALSE;
+                break;
+            }
+
             case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT:
             {
                 auto* pExtInfo = reinterpret_cast<VkPhysicalDeviceMemoryPriorityFeaturesEXT *>(pHeader);
@@ -5619,6 +5639,16 @@ void PhysicalDevice::GetDeviceProperties2(
             break;
         }
 
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT:
+        {
+            auto* pProps = static_cast<VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT*>(pNext);
+
+            // Linking compiles the complete pipeline, reusing the stages its libraries have built already.
+            pProps->graphicsPipelineLibraryFastLinking                        = VK_FALSE;
+            pProps->graphicsPipelineLibraryIndependentInterpolationDecoration = VK_FALSE;
+            break;
+        }
+
         default:
             break;
         }
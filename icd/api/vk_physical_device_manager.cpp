@@ -29,6 +29,7 @@
  ***********************************************************************************************************************
  */
 
+#include "include/pipeline_binary_cache.h"
 #include "include/vk_conv.h"
 #include "include/vk_display_manager.h"
 #include "include/vk_physical_device.h"
@@ -462,6 +463,24 @@ void PhysicalDeviceManager::DestroyLockedPhysicalDeviceList(void)
     }
 }
 
+// =====================================================================================================================
+// Waits until the pipeline cache entries queued for the on-disk archives of every physical device have been written.
+void PhysicalDeviceManager::DrainPipelineCacheWrites()
+{
+    Util::MutexAuto lock(&m_devicesLock);
+
+    for (uint32_t i = 0; i < m_devices.NumElements(); ++i)
+    {
+        PhysicalDevice*      pPhysicalDevice = ApiPhysicalDevice::ObjectFromHandle(m_devices.At(i));
+        PipelineBinaryCache* pCache          = pPhysicalDevice->GetCompiler()->GetBinaryCache();
+
+        if (pCache != nullptr)
+        {
+            pCache->DrainArchiveWrites();
+        }
+    }
+}
+
 // =====================================================================================================================
 // Enumerates all NULL physical device properties
 VkResult PhysicalDeviceManager::EnumerateAllNullPhysicalDeviceProperties(
@@ -146,6 +146,7 @@ Pipeline::Pipeline(
     :
     m_pDevice(pDevice),
     m_userDataLayout(),
+    m_pOptimizedPalPipeline(nullptr),
     m_palPipelineHash(0),
     m_staticStateMask(0),
     m_apiHash(0),
@@ -495,9 +496,10 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetShaderInfoAMD(
 
     const Device*         pDevice      = ApiDevice::ObjectFromHandle(device);
     const Pipeline*       pPipeline    = Pipeline::ObjectFromHandle(pipeline);
-    const Pal::IPipeline* pPalPipeline = pPipeline->PalPipeline(DefaultDeviceIndex);
+    const Pal::IPipeline* pPalPipeline = (pPipeline != nullptr) ? pPipeline->PalPipeline(DefaultDeviceIndex) : nullptr;
 
-    if (pPipeline != nullptr)
+    // Graphics pipeline libraries have no PAL pipeline, so there is nothing to report for them.
+    if (pPalPipeline != nullptr)
     {
         Pal::ShaderType shaderType = VkToPalShaderType(shaderStage);
 
@@ -722,8 +724,16 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineExecutablePropertiesKHR(
     uint32_t*                                   pExecutableCount,
     VkPipelineExecutablePropertiesKHR*          pProperties)
 {
-    const Pipeline*                     pPipeline     = Pipeline::ObjectFromHandle(pPipelineInfo->pipeline);
-    const Pal::IPipeline*               pPalPipeline  = pPipeline->PalPipeline(DefaultDeviceIndex);
+    const Pipeline*       pPipeline    = Pipeline::ObjectFromHandle(pPipelineInfo->pipeline);
+    const Pal::IPipeline* pPalPipeline = pPipeline->PalPipeline(DefaultDeviceIndex);
+
+    // Graphics pipeline libraries have no PAL pipeline, and no executables.
+    if (pPalPipeline == nullptr)
+    {
+        *pExecutableCount = 0;
+        return VK_SUCCESS;
+    }
+
     const Util::Abi::ApiHwShaderMapping apiToHwShader = pPalPipeline->ApiHwShaderMapping();
 
     // Count the number of hardware stages that are used in this pipeline
@@ -798,8 +808,16 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineExecutableStatisticsKHR(
     uint32_t*                                   pStatisticCount,
     VkPipelineExecutableStatisticKHR*           pStatistics)
 {
-    const Pipeline*                     pPipeline     = Pipeline::ObjectFromHandle(pExecutableInfo->pipeline);
-    const Pal::IPipeline*               pPalPipeline  = pPipeline->PalPipeline(DefaultDeviceIndex);
+    const Pipeline*       pPipeline    = Pipeline::ObjectFromHandle(pExecutableInfo->pipeline);
+    const Pal::IPipeline* pPalPipeline = pPipeline->PalPipeline(DefaultDeviceIndex);
+
+    // Graphics pipeline libraries have no executables to report statistics of.
+    if (pPalPipeline == nullptr)
+    {
+        *pStatisticCount = 0;
+        return VK_SUCCESS;
+    }
+
     const Util::Abi::ApiHwShaderMapping apiToHwShader = pPalPipeline->ApiHwShaderMapping();
 
     // If pStatisticCount == nullptr the call to this function is just ment to return the number of statistics
@@ -885,9 +903,17 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineExecutableInternalRepresentationsKHR
     uint32_t*                                      pInternalRepresentationCount,
     VkPipelineExecutableInternalRepresentationKHR* pInternalRepresentations)
 {
-    const Device*                       pDevice       = ApiDevice::ObjectFromHandle(device);
-    const Pipeline*                     pPipeline     = Pipeline::ObjectFromHandle(pExecutableInfo->pipeline);
-    const Pal::IPipeline*               pPalPipeline  = pPipeline->PalPipeline(DefaultDeviceIndex);
+    const Device*         pDevice      = ApiDevice::ObjectFromHandle(device);
+    const Pipeline*       pPipeline    = Pipeline::ObjectFromHandle(pExecutableInfo->pipeline);
+    const Pal::IPipeline* pPalPipeline = pPipeline->PalPipeline(DefaultDeviceIndex);
+
+    // Graphics pipeline libraries have no executables to report internal representations of.
+    if (pPalPipeline == nullptr)
+    {
+        *pInternalRepresentationCount = 0;
+        return VK_SUCCESS;
+    }
+
     const Util::Abi::ApiHwShaderMapping apiToHwShader = pPalPipeline->ApiHwShaderMapping();
 
     // Count the number of hardware stages that are used in this pipeline
@@ -33,6 +33,7 @@
 #include "palAutoBuffer.h"
 
 #include "include/pipeline_binary_cache.h"
+#include "include/pipeline_tier_up_queue.h"
 
 namespace vk
 {
@@ -226,6 +227,11 @@ VkResult PipelineCache::Destroy(
 {
     if (m_pBinaryCache != nullptr)
     {
+        if (pDevice->GetPipelineTierUpQueue() != nullptr)
+        {
+            pDevice->GetPipelineTierUpQueue()->ForgetPipelineCache(this);
+        }
+
         m_pBinaryCache->Destroy();
         pDevice->VkPhysicalDevice(DefaultDeviceIndex)->VkInstance()->FreeMem(m_pBinaryCache);
         m_pBinaryCache = nullptr;
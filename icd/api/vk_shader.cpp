@@ -74,6 +74,54 @@ VK_INLINE void MetroHashTo128Bit(
               static_cast<uint64_t>(hash.dwords[3]) << 32;
 }
 
+// =====================================================================================================================
+// Scans the annotations of SPIR-V code for a DeviceIndex built-in decoration.  Code that is not SPIR-V is assumed to
+// read the device index.
+static bool SpirvReadsDeviceIndex(
+    size_t      codeSize,
+    const void* pCode)
+{
+    constexpr uint32_t SpirvMagic         = 0x07230203;
+    constexpr uint32_t SpirvHeaderWords   = 5;
+    constexpr uint32_t OpFunction         = 54;
+    constexpr uint32_t OpDecorate         = 71;
+    constexpr uint32_t OpMemberDecorate   = 72;
+    constexpr uint32_t DecorationBuiltIn  = 11;
+    constexpr uint32_t BuiltInDeviceIndex = 4438;
+
+    const uint32_t* pWords    = static_cast<const uint32_t*>(pCode);
+    const size_t    wordCount = codeSize / sizeof(uint32_t);
+
+    bool readsDeviceIndex = (wordCount < SpirvHeaderWords) || (pWords[0] != SpirvMagic);
+    bool done             = readsDeviceIndex;
+
+    for (size_t pos = SpirvHeaderWords; (done == false) && (pos < wordCount); )
+    {
+        const uint32_t opCode        = pWords[pos] & 0xFFFF;
+        const uint32_t instWordCount = pWords[pos] >> 16;
+
+        if ((instWordCount == 0) || ((pos + instWordCount) > wordCount))
+        {
+            // Malformed code, let the compiler deal with it
+            readsDeviceIndex = true;
+        }
+        else if ((opCode == OpDecorate) && (instWordCount >= 4))
+        {
+            readsDeviceIndex = (pWords[pos + 2] == DecorationBuiltIn) && (pWords[pos + 3] == BuiltInDeviceIndex);
+        }
+        else if ((opCode == OpMemberDecorate) && (instWordCount >= 5))
+        {
+            readsDeviceIndex = (pWords[pos + 3] == DecorationBuiltIn) && (pWords[pos + 4] == BuiltInDeviceIndex);
+        }
+
+        // Annotations always precede the function definitions.
+        done = readsDeviceIndex || (opCode == OpFunction);
+        pos += instWordCount;
+    }
+
+    return readsDeviceIndex;
+}
+
 // =====================================================================================================================
 // Returns a 128-bit hash based on this module's SPIRV code plus an optional entry point combination.
 Pal::ShaderHash ShaderModule::GetCodeHash(
@@ -145,6 +193,9 @@ ShaderModule::ShaderModule(
 
     MetroHashTo128Bit(codeHash, &m_codeHash.lower, &m_codeHash.upper);
     memset(&m_handle, 0, sizeof(m_handle));
+
+    // Device groups share one pipeline binary among their devices unless a shader reads the device index.
+    m_readsDeviceIndex = SpirvReadsDeviceIndex(codeSize, pCode);
 }
 
 // =====================================================================================================================
@@ -140,6 +140,8 @@ void VulkanSettingsLoader::OverrideSettingsBySystemInfo()
 
         MakeAbsolutePath(m_settings.pipelineProfileDumpFile, sizeof(m_settings.pipelineProfileDumpFile),
                          pRootPath, m_settings.pipelineProfileDumpFile);
+        MakeAbsolutePath(m_settings.pipelineCompileTelemetryFile, sizeof(m_settings.pipelineCompileTelemetryFile),
+                         pRootPath, m_settings.pipelineCompileTelemetryFile);
 #if ICD_RUNTIME_APP_PROFILE
         MakeAbsolutePath(m_settings.pipelineProfileRuntimeFile, sizeof(m_settings.pipelineProfileRuntimeFile),
                          pRootPath, m_settings.pipelineProfileRuntimeFile);
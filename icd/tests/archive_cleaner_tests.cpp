@@ -0,0 +1,157 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_cleaner_tests.cpp
+* @brief Unit tests of the background cleanup of the pipeline cache directory
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/archive_cleaner.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr size_t   FileSize       = 4096;
+static constexpr uint64_t MinIdleSeconds = 24 * 60 * 60;
+static constexpr uint32_t MaxWaitMs      = 10000;
+
+// =====================================================================================================================
+// Creates cache files of a given age and waits for the cleaner thread to remove files.
+class ArchiveCleanerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(MakeTestDir(m_path, sizeof(m_path)));
+    }
+
+    // Creates a file of FileSize bytes that was last used the given number of seconds ago.
+    void MakeFile(const char* pName, uint64_t ageSeconds)
+    {
+        char fullPath[PATH_MAX] = {};
+        Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", m_path, pName);
+
+        const int fd = open(fullPath, O_CREAT | O_WRONLY | O_CLOEXEC, 0600);
+
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(ftruncate(fd, FileSize), 0);
+
+        struct timespec times[2] = {};
+        times[0].tv_sec = time(nullptr) - static_cast<time_t>(ageSeconds);
+        times[1].tv_sec = times[0].tv_sec;
+
+        EXPECT_EQ(futimens(fd, times), 0);
+
+        close(fd);
+    }
+
+    bool FileExists(const char* pName) const
+    {
+        char fullPath[PATH_MAX] = {};
+        Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", m_path, pName);
+
+        return (access(fullPath, F_OK) == 0);
+    }
+
+    // Waits until the cleaner has removed the given file.  Returns false if it isn't removed in time.
+    bool WaitForRemoval(const char* pName) const
+    {
+        uint32_t waitMs = 0;
+
+        for (; FileExists(pName) && (waitMs < MaxWaitMs); ++waitMs)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return (FileExists(pName) == false);
+    }
+
+    char m_path[PATH_MAX] = {};
+};
+
+// =====================================================================================================================
+// Over budget, the cleaner removes idle files, oldest first, until the files are below 90% of the budget.
+TEST_F(ArchiveCleanerTest, RemovesOldestIdleFiles)
+{
+    MakeFile("oldest.parc", 4 * MinIdleSeconds);
+    MakeFile("older.parc",  3 * MinIdleSeconds);
+    MakeFile("old.parc",    2 * MinIdleSeconds);
+
+    // Removing the oldest file brings the directory down to 8192 bytes, below 90% of the budget.
+    ArchiveCleaner* pCleaner = ArchiveCleaner::Create(GetInstance(), m_path, 10000, MinIdleSeconds);
+
+    ASSERT_NE(pCleaner, nullptr);
+    ASSERT_EQ(pCleaner->Start(), VK_SUCCESS);
+
+    EXPECT_TRUE(WaitForRemoval("oldest.parc"));
+
+    // The next scan is a minute away, so nothing else changes while the cleaner is destroyed.
+    pCleaner->Destroy();
+
+    EXPECT_TRUE(FileExists("older.parc"));
+    EXPECT_TRUE(FileExists("old.parc"));
+}
+
+// =====================================================================================================================
+// Files the cache has open and files used recently are never removed, even if that leaves the directory over budget.
+TEST_F(ArchiveCleanerTest, KeepsOpenAndRecentFiles)
+{
+    MakeFile("open.parc",   4 * MinIdleSeconds);
+    MakeFile("idle.parc",   3 * MinIdleSeconds);
+    MakeFile("recent.parc", 0);
+
+    ArchiveCleaner* pCleaner = ArchiveCleaner::Create(GetInstance(), m_path, 1000, MinIdleSeconds);
+
+    ASSERT_NE(pCleaner, nullptr);
+
+    pCleaner->KeepFile("open.parc");
+
+    ASSERT_EQ(pCleaner->Start(), VK_SUCCESS);
+
+    EXPECT_TRUE(WaitForRemoval("idle.parc"));
+
+    pCleaner->Destroy();
+
+    EXPECT_TRUE(FileExists("open.parc"));
+    EXPECT_TRUE(FileExists("recent.parc"));
+}
+
+} // namespace test
+
+} // namespace vk
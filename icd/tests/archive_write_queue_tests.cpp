@@ -0,0 +1,252 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_write_queue_tests.cpp
+* @brief Unit tests of the archive write queue
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/archive_write_queue.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr uint32_t ShardCount = 2;
+static constexpr size_t   EntrySize  = 4096;
+
+// =====================================================================================================================
+// Expects the layer to hold the entry with the given ID and the data FillEntryData() generates for the seed.
+static void ExpectEntry(
+    Util::ICacheLayer* pLayer,
+    uint32_t           seed,
+    size_t             dataSize)
+{
+    const Util::MetroHash::Hash cacheId = MakeCacheId(seed);
+    Util::QueryResult           query   = {};
+
+    ASSERT_EQ(pLayer->Query(&cacheId, 0, 0, &query), Util::Result::Success) << "entry " << seed;
+    ASSERT_EQ(query.dataSize, dataSize) << "entry " << seed;
+
+    void* pExpected = malloc(dataSize);
+    void* pActual   = malloc(dataSize);
+
+    FillEntryData(seed, dataSize, pExpected);
+
+    EXPECT_EQ(pLayer->Load(&query, pActual), Util::Result::Success) << "entry " << seed;
+    EXPECT_EQ(memcmp(pExpected, pActual, dataSize), 0) << "entry " << seed;
+
+    free(pExpected);
+    free(pActual);
+}
+
+// =====================================================================================================================
+// Expects the layer not to hold an entry with the given ID.
+static void ExpectNoEntry(
+    Util::ICacheLayer* pLayer,
+    uint32_t           seed)
+{
+    const Util::MetroHash::Hash cacheId = MakeCacheId(seed);
+    Util::QueryResult           query   = {};
+
+    EXPECT_NE(pLayer->Query(&cacheId, 0, 0, &query), Util::Result::Success) << "entry " << seed;
+}
+
+// =====================================================================================================================
+// Writes to memory layers standing in for the archive shards.  The shard files only exist for the queue to sync.
+class ArchiveWriteQueueTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(MakeTestDir(m_path, sizeof(m_path)));
+
+        for (uint32_t i = 0; i < ShardCount; ++i)
+        {
+            char fullPath[PATH_MAX] = {};
+
+            Util::Snprintf(m_fileNames[i], sizeof(m_fileNames[i]), "shard%u.parc", i);
+            Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", m_path, m_fileNames[i]);
+
+            const int fd = open(fullPath, O_CREAT | O_WRONLY | O_CLOEXEC, 0600);
+
+            ASSERT_GE(fd, 0);
+            close(fd);
+
+            m_pShardLayers[i] = CreateMemoryLayer();
+
+            ASSERT_NE(m_pShardLayers[i], nullptr);
+        }
+
+        const char* fileNames[ShardCount] = {};
+
+        for (uint32_t i = 0; i < ShardCount; ++i)
+        {
+            fileNames[i] = m_fileNames[i];
+        }
+
+        m_pQueue = ArchiveWriteQueue::Create(GetInstance(), ShardCount, m_pShardLayers, m_path, fileNames);
+
+        ASSERT_NE(m_pQueue, nullptr);
+    }
+
+    void TearDown() override
+    {
+        DestroyQueue();
+
+        for (uint32_t i = 0; i < ShardCount; ++i)
+        {
+            DestroyMemoryLayer(m_pShardLayers[i]);
+        }
+    }
+
+    // Destroying the queue writes out everything still queued.
+    void DestroyQueue()
+    {
+        if (m_pQueue != nullptr)
+        {
+            m_pQueue->Destroy();
+            m_pQueue = nullptr;
+        }
+    }
+
+    Util::Result Enqueue(
+        uint32_t seed,
+        size_t   dataSize,
+        uint32_t shard)
+    {
+        const Util::MetroHash::Hash cacheId = MakeCacheId(seed);
+
+        void* pData = malloc(dataSize);
+
+        FillEntryData(seed, dataSize, pData);
+
+        const Util::Result result = m_pQueue->Enqueue(&cacheId, pData, dataSize, shard);
+
+        // The queue works on its own copy, so the caller's buffer may go away right after.
+        memset(pData, 0, dataSize);
+        free(pData);
+
+        return result;
+    }
+
+    char               m_path[PATH_MAX]            = {};
+    char               m_fileNames[ShardCount][32] = {};
+    Util::ICacheLayer* m_pShardLayers[ShardCount]  = {};
+    ArchiveWriteQueue* m_pQueue                    = nullptr;
+};
+
+// =====================================================================================================================
+// Every queued entry reaches the shard it was queued for, with the data it was queued with.
+TEST_F(ArchiveWriteQueueTest, WritesEntriesToTheirShards)
+{
+    static constexpr uint32_t EntryCount = 64;
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        ASSERT_EQ(Enqueue(seed, EntrySize + seed, seed % ShardCount), Util::Result::Success);
+    }
+
+    DestroyQueue();
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        ExpectEntry(m_pShardLayers[seed % ShardCount], seed, EntrySize + seed);
+        ExpectNoEntry(m_pShardLayers[(seed + 1) % ShardCount], seed);
+    }
+}
+
+// =====================================================================================================================
+// Draining the queue writes out every entry queued so far while the queue keeps running.
+TEST_F(ArchiveWriteQueueTest, DrainWritesQueuedEntries)
+{
+    static constexpr uint32_t EntryCount = 16;
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        ASSERT_EQ(Enqueue(seed, EntrySize, seed % ShardCount), Util::Result::Success);
+    }
+
+    m_pQueue->Drain();
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        ExpectEntry(m_pShardLayers[seed % ShardCount], seed, EntrySize);
+    }
+
+    // Draining an empty queue returns right away, and the queue still takes entries afterwards.
+    m_pQueue->Drain();
+
+    ASSERT_EQ(Enqueue(EntryCount, EntrySize, 0), Util::Result::Success);
+
+    m_pQueue->Drain();
+
+    ExpectEntry(m_pShardLayers[0], EntryCount, EntrySize);
+}
+
+// =====================================================================================================================
+// Storing an entry that is already queued succeeds without queueing it twice.
+TEST_F(ArchiveWriteQueueTest, CoalescesRepeatedStores)
+{
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        EXPECT_EQ(Enqueue(1, EntrySize, 0), Util::Result::Success);
+    }
+
+    DestroyQueue();
+
+    ExpectEntry(m_pShardLayers[0], 1, EntrySize);
+}
+
+// =====================================================================================================================
+// Entries which don't fit into the queue are refused, leaving the caller to write them itself.
+TEST_F(ArchiveWriteQueueTest, RefusesEntriesBeyondTheQueueLimit)
+{
+    static constexpr size_t LargeEntrySize = (64 * 1024 * 1024) + 1;
+
+    EXPECT_EQ(Enqueue(1, LargeEntrySize, 0), Util::Result::NotReady);
+
+    // Smaller entries are still accepted.
+    EXPECT_EQ(Enqueue(2, EntrySize, 1), Util::Result::Success);
+
+    DestroyQueue();
+
+    ExpectNoEntry(m_pShardLayers[0], 1);
+    ExpectEntry(m_pShardLayers[1], 2, EntrySize);
+}
+
+} // namespace test
+
+} // namespace vk
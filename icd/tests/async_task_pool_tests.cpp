@@ -0,0 +1,285 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  async_task_pool_tests.cpp
+* @brief Unit tests of the async compile task pool
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "appopt/async_task_pool.h"
+
+#include <chrono>
+#include <thread>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr uint32_t GateId    = 0;
+static constexpr uint32_t MaxWaitMs = 10000;
+static constexpr uint32_t MaxTasks  = 64;
+
+// Work of the tasks of a test: records the IDs of the tasks in the order they finish.  The gate task blocks its worker
+// until the test releases it.
+struct TaskLog
+{
+    volatile bool     gateReleased;
+    volatile uint32_t gateStarted;
+    volatile uint32_t gateFinished;
+    volatile uint32_t count;
+    uint32_t          ids[MaxTasks];
+};
+
+// =====================================================================================================================
+static void RecordTask(
+    void*      pPayload,
+    AsyncTask* pTask)
+{
+    TaskLog* pLog = static_cast<TaskLog*>(pPayload);
+
+    // The tests keep the ID of a task in the code size, as the tasks compile nothing.
+    const uint32_t id = static_cast<uint32_t>(pTask->shaderModule.info.codeSize);
+
+    if (id == GateId)
+    {
+        Util::AtomicIncrement(&pLog->gateStarted);
+
+        for (uint32_t waitMs = 0; (pLog->gateReleased == false) && (waitMs < MaxWaitMs); ++waitMs)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Util::AtomicIncrement(&pLog->gateFinished);
+    }
+
+    const uint32_t index = Util::AtomicIncrement(&pLog->count) - 1;
+
+    if (index < MaxTasks)
+    {
+        pLog->ids[index] = id;
+    }
+}
+
+// =====================================================================================================================
+class AsyncTaskPoolTest : public ::testing::Test
+{
+protected:
+    // Returns a module to own tasks.  The pool only compares the pointers, so they needn't point to live objects.
+    async::ShaderModule* GetModule(uint32_t index)
+        { return reinterpret_cast<async::ShaderModule*>(&m_modules[index]); }
+
+    void AddTask(
+        async::TaskPool*     pPool,
+        uint32_t             id,
+        TaskPriority         priority,
+        async::ShaderModule* pModule)
+    {
+        AsyncTask task = {};
+        task.type                       = ShaderModuleTaskType;
+        task.priority                   = priority;
+        task.pModule                    = pModule;
+        task.shaderModule.info.codeSize = id;
+
+        pPool->AddTask(task);
+    }
+
+    // Waits until a worker runs the gate task, so that the tasks added next queue up behind it.
+    bool WaitForGate() const
+    {
+        for (uint32_t waitMs = 0; (m_log.gateStarted == 0) && (waitMs < MaxWaitMs); ++waitMs)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return (m_log.gateStarted > 0);
+    }
+
+    // Expects the tasks to have finished in the given order.
+    void ExpectFinished(
+        const uint32_t* pIds,
+        uint32_t        count) const
+    {
+        ASSERT_EQ(m_log.count, count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(m_log.ids[i], pIds[i]) << "task " << i;
+        }
+    }
+
+    TaskLog  m_log        = {};
+    uint32_t m_modules[3] = {};
+};
+
+// =====================================================================================================================
+// Queued tasks are taken by priority, and tasks of the same priority oldest first.
+TEST_F(AsyncTaskPoolTest, TakesTasksByPriority)
+{
+    async::TaskPool pool(RecordTask, &m_log, GetInstance()->Allocator());
+
+    pool.Init(1);
+    ASSERT_EQ(pool.GetThreadCount(), 1u);
+
+    AddTask(&pool, GateId, TaskPriorityHigh, GetModule(0));
+    ASSERT_TRUE(WaitForGate());
+
+    AddTask(&pool, 1, TaskPriorityLow,    GetModule(0));
+    AddTask(&pool, 2, TaskPriorityNormal, GetModule(0));
+    AddTask(&pool, 3, TaskPriorityHigh,   GetModule(0));
+    AddTask(&pool, 4, TaskPriorityLow,    GetModule(0));
+    AddTask(&pool, 5, TaskPriorityNormal, GetModule(0));
+    AddTask(&pool, 6, TaskPriorityHigh,   GetModule(0));
+
+    m_log.gateReleased = true;
+    pool.SyncAll();
+
+    const uint32_t expected[] = { GateId, 3, 6, 2, 5, 1, 4 };
+    ExpectFinished(expected, VK_ARRAY_SIZE(expected));
+}
+
+// =====================================================================================================================
+// Tasks queued on a busy worker are stolen by an idle one instead of waiting for the busy worker.
+TEST_F(AsyncTaskPoolTest, StealsFromBusyWorkers)
+{
+    async::TaskPool pool(RecordTask, &m_log, GetInstance()->Allocator());
+
+    pool.Init(2);
+    ASSERT_EQ(pool.GetThreadCount(), 2u);
+
+    AddTask(&pool, GateId, TaskPriorityNormal, GetModule(0));
+    ASSERT_TRUE(WaitForGate());
+
+    // New tasks are spread over both workers, so half of them are queued on the one blocked by the gate.
+    constexpr uint32_t TaskCount = 8;
+
+    for (uint32_t i = 1; i <= TaskCount; ++i)
+    {
+        AddTask(&pool, i, TaskPriorityNormal, GetModule(0));
+    }
+
+    for (uint32_t waitMs = 0; (m_log.count < TaskCount) && (waitMs < MaxWaitMs); ++waitMs)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(m_log.count, TaskCount);
+    EXPECT_EQ(m_log.gateFinished, 0u);
+
+    m_log.gateReleased = true;
+    pool.SyncAll();
+
+    EXPECT_EQ(m_log.count, TaskCount + 1);
+}
+
+// =====================================================================================================================
+// Prioritizing a module raises its queued normal priority tasks to high priority.  Its low priority tasks and the tasks
+// of other modules keep their priority.
+TEST_F(AsyncTaskPoolTest, PrioritizesModuleTasks)
+{
+    async::TaskPool pool(RecordTask, &m_log, GetInstance()->Allocator());
+
+    pool.Init(1);
+    ASSERT_EQ(pool.GetThreadCount(), 1u);
+
+    AddTask(&pool, GateId, TaskPriorityHigh, GetModule(0));
+    ASSERT_TRUE(WaitForGate());
+
+    AddTask(&pool, 1, TaskPriorityNormal, GetModule(1));
+    AddTask(&pool, 2, TaskPriorityNormal, GetModule(2));
+    AddTask(&pool, 3, TaskPriorityNormal, GetModule(1));
+    AddTask(&pool, 4, TaskPriorityNormal, GetModule(2));
+    AddTask(&pool, 5, TaskPriorityLow,    GetModule(2));
+
+    pool.PrioritizeTasks(GetModule(2));
+
+    m_log.gateReleased = true;
+    pool.SyncAll();
+
+    const uint32_t expected[] = { GateId, 2, 4, 1, 3, 5 };
+    ExpectFinished(expected, VK_ARRAY_SIZE(expected));
+}
+
+// =====================================================================================================================
+// Cancelling drops the queued tasks of a module of every priority, and doesn't wait for the running tasks of other
+// modules.  The cancelled tasks no longer count as pending.
+TEST_F(AsyncTaskPoolTest, CancelsQueuedTasks)
+{
+    async::TaskPool pool(RecordTask, &m_log, GetInstance()->Allocator());
+
+    pool.Init(1);
+    ASSERT_EQ(pool.GetThreadCount(), 1u);
+
+    AddTask(&pool, GateId, TaskPriorityHigh, GetModule(0));
+    ASSERT_TRUE(WaitForGate());
+
+    AddTask(&pool, 1, TaskPriorityNormal, GetModule(1));
+    AddTask(&pool, 2, TaskPriorityNormal, GetModule(2));
+    AddTask(&pool, 3, TaskPriorityLow,    GetModule(1));
+    AddTask(&pool, 4, TaskPriorityHigh,   GetModule(1));
+
+    pool.CancelTasks(GetModule(1));
+
+    EXPECT_EQ(m_log.gateFinished, 0u);
+
+    m_log.gateReleased = true;
+    pool.SyncAll();
+
+    const uint32_t expected[] = { GateId, 2 };
+    ExpectFinished(expected, VK_ARRAY_SIZE(expected));
+}
+
+// =====================================================================================================================
+// Cancelling returns only once the running tasks of the module have finished, as the module is destroyed next.
+TEST_F(AsyncTaskPoolTest, CancelWaitsForRunningTasks)
+{
+    async::TaskPool pool(RecordTask, &m_log, GetInstance()->Allocator());
+
+    pool.Init(1);
+    ASSERT_EQ(pool.GetThreadCount(), 1u);
+
+    AddTask(&pool, GateId, TaskPriorityNormal, GetModule(1));
+    ASSERT_TRUE(WaitForGate());
+
+    std::thread releaser([this]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        m_log.gateReleased = true;
+    });
+
+    pool.CancelTasks(GetModule(1));
+
+    EXPECT_EQ(m_log.gateFinished, 1u);
+
+    releaser.join();
+    pool.SyncAll();
+}
+
+} // namespace test
+
+} // namespace vk
@@ -0,0 +1,223 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  deferred_operation_tests.cpp
+* @brief Unit tests of deferred host operations
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#if VKI_KHR_DEFERRED_HOST_OPERATIONS
+
+#include "include/vk_deferred_operation.h"
+
+#include "palThread.h"
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr uint32_t WorkCount = 256;
+
+// Work of a deferred command: counts how often every item and the finish callback ran
+struct DeferredPayload
+{
+    volatile uint32_t runCounts[WorkCount];
+    volatile uint32_t finishCount;
+    VkResult          finishResult;
+};
+
+// =====================================================================================================================
+static void CountWork(
+    void*    pPayload,
+    uint32_t index)
+{
+    Util::AtomicIncrement(&static_cast<DeferredPayload*>(pPayload)->runCounts[index]);
+}
+
+// =====================================================================================================================
+static VkResult CountFinish(
+    void* pPayload)
+{
+    DeferredPayload* const pDeferred = static_cast<DeferredPayload*>(pPayload);
+
+    Util::AtomicIncrement(&pDeferred->finishCount);
+
+    return pDeferred->finishResult;
+}
+
+// =====================================================================================================================
+class DeferredOperationTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(DeferredHostOperation::Create(GetDevice(), GetInstance()->GetAllocCallbacks(), &m_handle),
+                  VK_SUCCESS);
+
+        m_pOperation = DeferredHostOperation::ObjectFromHandle(m_handle);
+    }
+
+    void TearDown() override
+    {
+        if (m_pOperation != nullptr)
+        {
+            m_pOperation->Destroy(GetDevice(), GetInstance()->GetAllocCallbacks());
+        }
+    }
+
+    void ExpectEveryItemRanOnce(
+        const DeferredPayload& payload)
+    {
+        EXPECT_EQ(payload.finishCount, 1u);
+
+        for (uint32_t i = 0; i < WorkCount; ++i)
+        {
+            EXPECT_EQ(payload.runCounts[i], 1u) << "item " << i;
+        }
+    }
+
+    VkDeferredOperationKHR m_handle     = VK_NULL_HANDLE;
+    DeferredHostOperation* m_pOperation = nullptr;
+};
+
+// =====================================================================================================================
+// A new operation has nothing deferred and reports as complete.
+TEST_F(DeferredOperationTest, StartsComplete)
+{
+    EXPECT_EQ(m_pOperation->GetResult(), VK_SUCCESS);
+    EXPECT_EQ(m_pOperation->GetMaxConcurrency(), 0u);
+}
+
+// =====================================================================================================================
+// A deferred command stays pending until it is joined, and its result is the one returned by the finish callback.
+TEST_F(DeferredOperationTest, JoinExecutesDeferredWork)
+{
+    DeferredPayload payload = {};
+    payload.finishResult    = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+    EXPECT_EQ(m_pOperation->Defer(WorkCount, CountWork, CountFinish, &payload), VK_OPERATION_DEFERRED_KHR);
+
+    EXPECT_EQ(m_pOperation->GetResult(), VK_NOT_READY);
+    EXPECT_EQ(m_pOperation->GetMaxConcurrency(), WorkCount);
+    EXPECT_EQ(payload.runCounts[0], 0u);
+
+    EXPECT_EQ(m_pOperation->Join(), VK_SUCCESS);
+
+    ExpectEveryItemRanOnce(payload);
+
+    EXPECT_EQ(m_pOperation->GetResult(), VK_ERROR_OUT_OF_HOST_MEMORY);
+    EXPECT_EQ(m_pOperation->GetMaxConcurrency(), 0u);
+
+    // Joining a complete operation has nothing left to do.
+    EXPECT_EQ(m_pOperation->Join(), VK_SUCCESS);
+    EXPECT_EQ(payload.finishCount, 1u);
+}
+
+// =====================================================================================================================
+// An operation can be reused once its previous deferred command has completed.
+TEST_F(DeferredOperationTest, CanBeReused)
+{
+    DeferredPayload first = {};
+    first.finishResult    = VK_ERROR_UNKNOWN;
+
+    m_pOperation->Defer(WorkCount, CountWork, CountFinish, &first);
+    m_pOperation->Join();
+
+    DeferredPayload second = {};
+    second.finishResult    = VK_SUCCESS;
+
+    EXPECT_EQ(m_pOperation->Defer(WorkCount, CountWork, CountFinish, &second), VK_OPERATION_DEFERRED_KHR);
+    EXPECT_EQ(m_pOperation->GetResult(), VK_NOT_READY);
+
+    m_pOperation->Join();
+
+    ExpectEveryItemRanOnce(first);
+    ExpectEveryItemRanOnce(second);
+
+    EXPECT_EQ(m_pOperation->GetResult(), VK_SUCCESS);
+}
+
+// =====================================================================================================================
+static void JoinOperation(
+    void* pParam)
+{
+    const VkResult result = static_cast<DeferredHostOperation*>(pParam)->Join();
+
+    EXPECT_TRUE((result == VK_SUCCESS) || (result == VK_THREAD_DONE_KHR));
+}
+
+// =====================================================================================================================
+// Threads joining the same operation share its work items; the finish callback runs once, after the last item.
+TEST_F(DeferredOperationTest, ConcurrentJoinsShareWork)
+{
+    static constexpr uint32_t ThreadCount = 4;
+
+    DeferredPayload payload = {};
+    payload.finishResult    = VK_SUCCESS;
+
+    m_pOperation->Defer(WorkCount, CountWork, CountFinish, &payload);
+
+    Util::Thread threads[ThreadCount];
+
+    for (uint32_t i = 0; i < ThreadCount; ++i)
+    {
+        ASSERT_EQ(threads[i].Begin(JoinOperation, m_pOperation), Util::Result::Success);
+    }
+
+    for (uint32_t i = 0; i < ThreadCount; ++i)
+    {
+        threads[i].Join();
+    }
+
+    ExpectEveryItemRanOnce(payload);
+
+    EXPECT_EQ(m_pOperation->GetResult(), VK_SUCCESS);
+}
+
+// =====================================================================================================================
+// Deferrable commands find their operation in the pNext chain of their create info.
+TEST_F(DeferredOperationTest, FromCreateInfo)
+{
+    VkDeferredOperationInfoKHR info = {};
+    info.sType           = VK_STRUCTURE_TYPE_DEFERRED_OPERATION_INFO_KHR;
+    info.operationHandle = m_handle;
+
+    EXPECT_EQ(DeferredHostOperation::FromCreateInfo(&info), m_pOperation);
+
+    info.operationHandle = VK_NULL_HANDLE;
+
+    EXPECT_EQ(DeferredHostOperation::FromCreateInfo(&info), nullptr);
+    EXPECT_EQ(DeferredHostOperation::FromCreateInfo(nullptr), nullptr);
+}
+
+} // namespace test
+
+} // namespace vk
+
+#endif
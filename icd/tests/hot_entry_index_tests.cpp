@@ -0,0 +1,257 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  hot_entry_index_tests.cpp
+* @brief Unit tests of the hot entry index
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/hot_entry_index.h"
+
+#include "palFile.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr char     IndexName[]    = "cache";
+static constexpr uint32_t MaxPrefetches  = 64;
+static constexpr uint32_t PrefetchWaitMs = 5000;
+
+// Entries handed to the prefetch callback
+struct PrefetchLog
+{
+    Util::MetroHash::Hash cacheIds[MaxPrefetches];
+    uint32_t              count;
+    uint32_t              stopAfter; // Number of entries after which the callback ends prefetching
+};
+
+// =====================================================================================================================
+static bool LogPrefetch(
+    void*                        pContext,
+    const Util::MetroHash::Hash* pCacheId)
+{
+    PrefetchLog* const pLog = static_cast<PrefetchLog*>(pContext);
+
+    if (pLog->count < MaxPrefetches)
+    {
+        pLog->cacheIds[pLog->count] = *pCacheId;
+    }
+
+    ++pLog->count;
+
+    return (pLog->count < pLog->stopAfter);
+}
+
+// =====================================================================================================================
+class HotEntryIndexTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(MakeTestDir(m_path, sizeof(m_path)));
+    }
+
+    // Runs a session which looks up the entries of the given seeds in order, and writes the index at its end.
+    void RecordSession(
+        const uint32_t* pSeeds,
+        uint32_t        seedCount,
+        uint32_t        maxEntries)
+    {
+        HotEntryIndex* pIndex = HotEntryIndex::Create(GetInstance(), m_path, IndexName, maxEntries);
+
+        ASSERT_NE(pIndex, nullptr);
+
+        for (uint32_t i = 0; i < seedCount; ++i)
+        {
+            const Util::MetroHash::Hash cacheId = MakeCacheId(pSeeds[i]);
+
+            pIndex->RecordAccess(&cacheId);
+        }
+
+        pIndex->Destroy();
+    }
+
+    // Runs a session which prefetches the entries recorded by the previous one and waits until the given number of
+    // entries has been prefetched.  The session looks nothing up, so it keeps the index as it is.
+    void PrefetchSession(
+        uint32_t     maxEntries,
+        uint32_t     expectedCount,
+        PrefetchLog* pLog)
+    {
+        HotEntryIndex* pIndex = HotEntryIndex::Create(GetInstance(), m_path, IndexName, maxEntries);
+
+        ASSERT_NE(pIndex, nullptr);
+        ASSERT_EQ(pIndex->StartPrefetch(LogPrefetch, pLog), VK_SUCCESS);
+
+        for (uint32_t waitMs = 0; (pIndex->GetPrefetchCount() < expectedCount) && (waitMs < PrefetchWaitMs); ++waitMs)
+        {
+            usleep(1000);
+        }
+
+        EXPECT_EQ(pIndex->GetPrefetchCount(), expectedCount);
+
+        // Destroying the index joins the prefetch thread, after which the log is complete.
+        pIndex->Destroy();
+
+        EXPECT_EQ(pLog->count, expectedCount);
+    }
+
+    // Expects the log to hold the entries of the given seeds, in order.
+    void ExpectPrefetched(
+        const PrefetchLog& log,
+        const uint32_t*    pSeeds,
+        uint32_t           seedCount)
+    {
+        ASSERT_EQ(log.count, seedCount);
+
+        for (uint32_t i = 0; i < seedCount; ++i)
+        {
+            const Util::MetroHash::Hash cacheId = MakeCacheId(pSeeds[i]);
+
+            EXPECT_EQ(memcmp(&log.cacheIds[i], &cacheId, sizeof(cacheId)), 0) << "prefetch " << i;
+        }
+    }
+
+    char m_path[PATH_MAX] = {};
+};
+
+// =====================================================================================================================
+// Without an index from a previous run there is nothing to prefetch.
+TEST_F(HotEntryIndexTest, FirstRunPrefetchesNothing)
+{
+    PrefetchLog log = {};
+    log.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(16, 0, &log);
+}
+
+// =====================================================================================================================
+// The entries a run looked up are prefetched by the next run, in the order they were first looked up.
+TEST_F(HotEntryIndexTest, PrefetchesInFirstAccessOrder)
+{
+    static constexpr uint32_t Accesses[] = { 5, 3, 5, 9, 1, 3, 9 };
+    static constexpr uint32_t Expected[] = { 5, 3, 9, 1 };
+
+    RecordSession(Accesses, VK_ARRAY_SIZE(Accesses), 16);
+
+    PrefetchLog log = {};
+    log.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(16, VK_ARRAY_SIZE(Expected), &log);
+    ExpectPrefetched(log, Expected, VK_ARRAY_SIZE(Expected));
+
+    // A run which looks nothing up leaves the index of the run before it in place.
+    PrefetchLog again = {};
+    again.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(16, VK_ARRAY_SIZE(Expected), &again);
+    ExpectPrefetched(again, Expected, VK_ARRAY_SIZE(Expected));
+}
+
+// =====================================================================================================================
+// Only the most used entries make the index; among equally used ones, the entries looked up first win.
+TEST_F(HotEntryIndexTest, KeepsTheHottestEntries)
+{
+    static constexpr uint32_t Accesses[] = { 1, 2, 3, 4, 2, 3, 4, 2, 4, 5, 6 };
+    static constexpr uint32_t Expected[] = { 2, 4 };
+
+    RecordSession(Accesses, VK_ARRAY_SIZE(Accesses), 2);
+
+    PrefetchLog log = {};
+    log.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(2, VK_ARRAY_SIZE(Expected), &log);
+    ExpectPrefetched(log, Expected, VK_ARRAY_SIZE(Expected));
+
+    static constexpr uint32_t Ties[]         = { 7, 8, 9 };
+    static constexpr uint32_t ExpectedTies[] = { 7, 8 };
+
+    RecordSession(Ties, VK_ARRAY_SIZE(Ties), 2);
+
+    PrefetchLog tieLog = {};
+    tieLog.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(2, VK_ARRAY_SIZE(ExpectedTies), &tieLog);
+    ExpectPrefetched(tieLog, ExpectedTies, VK_ARRAY_SIZE(ExpectedTies));
+}
+
+// =====================================================================================================================
+// Prefetching ends as soon as the callback asks it to.
+TEST_F(HotEntryIndexTest, CallbackEndsPrefetching)
+{
+    static constexpr uint32_t Accesses[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    static constexpr uint32_t Expected[] = { 1, 2, 3 };
+
+    RecordSession(Accesses, VK_ARRAY_SIZE(Accesses), 16);
+
+    PrefetchLog log = {};
+    log.stopAfter   = VK_ARRAY_SIZE(Expected);
+
+    PrefetchSession(16, VK_ARRAY_SIZE(Expected), &log);
+    ExpectPrefetched(log, Expected, VK_ARRAY_SIZE(Expected));
+}
+
+// =====================================================================================================================
+// A malformed index is ignored rather than prefetched from.
+TEST_F(HotEntryIndexTest, IgnoresMalformedIndex)
+{
+    static constexpr uint32_t Accesses[] = { 1, 2, 3, 4 };
+
+    RecordSession(Accesses, VK_ARRAY_SIZE(Accesses), 16);
+
+    char indexPath[PATH_MAX] = {};
+
+    Util::Snprintf(indexPath, sizeof(indexPath), "%s/%s.hot", m_path, IndexName);
+
+    // Cut the last entry short.
+    ASSERT_EQ(truncate(indexPath, Util::File::GetFileSize(indexPath) - 1), 0);
+
+    PrefetchLog log = {};
+    log.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(16, 0, &log);
+
+    // An index recorded with more entries than the reader keeps is ignored as well.
+    RecordSession(Accesses, VK_ARRAY_SIZE(Accesses), 16);
+
+    PrefetchLog smallLog = {};
+    smallLog.stopAfter   = UINT32_MAX;
+
+    PrefetchSession(2, 0, &smallLog);
+}
+
+} // namespace test
+
+} // namespace vk
@@ -0,0 +1,238 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  in_flight_compile_table_tests.cpp
+* @brief Unit tests of the deduplication of concurrent pipeline compiles
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/in_flight_compile_table.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr uint32_t WaiterCount = 4;
+static constexpr uint32_t MaxWaitMs   = 10000;
+static constexpr size_t   BinarySize  = 256;
+
+// Result of Begin() on a thread asking for a binary which is being compiled
+struct WaiterResult
+{
+    bool                           mustCompile;
+    InFlightCompileTable::Compile* pCompile;
+    size_t                         binarySize;
+    const void*                    pBinary;
+};
+
+// =====================================================================================================================
+class InFlightCompileTableTest : public ::testing::Test
+{
+protected:
+    InFlightCompileTableTest()
+        :
+        m_table(GetInstance())
+    {
+    }
+
+    void SetUp() override
+    {
+        ASSERT_EQ(m_table.Init(), Util::Result::Success);
+    }
+
+    // Starts threads asking for the binary being compiled under pCompile, and waits until all of them wait for it.
+    void StartWaiters(
+        const Util::MetroHash::Hash*   pCacheId,
+        InFlightCompileTable::Compile* pCompile)
+    {
+        for (uint32_t i = 0; i < WaiterCount; ++i)
+        {
+            m_waiters[i] = std::thread([this, pCacheId, i]()
+            {
+                WaiterResult* pResult = &m_results[i];
+
+                pResult->mustCompile = m_table.Begin(pCacheId, &pResult->pCompile, &pResult->binarySize,
+                                                     &pResult->pBinary);
+            });
+        }
+
+        // The compiling thread holds one reference and every waiting thread one more.
+        for (uint32_t waitMs = 0; (pCompile->refCount < WaiterCount + 1) && (waitMs < MaxWaitMs); ++waitMs)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_EQ(pCompile->refCount, WaiterCount + 1);
+    }
+
+    void JoinWaiters()
+    {
+        for (uint32_t i = 0; i < WaiterCount; ++i)
+        {
+            m_waiters[i].join();
+        }
+    }
+
+    InFlightCompileTable m_table;
+    std::thread          m_waiters[WaiterCount];
+    WaiterResult         m_results[WaiterCount] = {};
+};
+
+// =====================================================================================================================
+// The first thread to ask for a binary compiles it.  Once it has published its result, the next thread to ask for the
+// binary compiles it again, as it is expected to find it in the cache by then.
+TEST_F(InFlightCompileTableTest, FirstThreadCompiles)
+{
+    const Util::MetroHash::Hash cacheId = MakeCacheId(1);
+
+    InFlightCompileTable::Compile* pCompile   = nullptr;
+    size_t                         binarySize = 0;
+    const void*                    pBinary    = nullptr;
+
+    EXPECT_TRUE(m_table.Begin(&cacheId, &pCompile, &binarySize, &pBinary));
+    ASSERT_NE(pCompile, nullptr);
+
+    uint8_t binary[BinarySize] = {};
+    m_table.End(&cacheId, pCompile, VK_SUCCESS, sizeof(binary), binary);
+
+    // Without waiting threads the binary is not copied.
+    EXPECT_FALSE(m_table.ReleaseSharedBinary(binary));
+
+    pCompile = nullptr;
+
+    EXPECT_TRUE(m_table.Begin(&cacheId, &pCompile, &binarySize, &pBinary));
+    ASSERT_NE(pCompile, nullptr);
+
+    m_table.End(&cacheId, pCompile, VK_SUCCESS, sizeof(binary), binary);
+}
+
+// =====================================================================================================================
+// Compiles of different binaries don't wait for each other.
+TEST_F(InFlightCompileTableTest, DistinctIdsCompileConcurrently)
+{
+    const Util::MetroHash::Hash cacheIds[] = { MakeCacheId(1), MakeCacheId(2) };
+
+    InFlightCompileTable::Compile* pCompiles[2] = {};
+    size_t                         binarySize   = 0;
+    const void*                    pBinary      = nullptr;
+
+    EXPECT_TRUE(m_table.Begin(&cacheIds[0], &pCompiles[0], &binarySize, &pBinary));
+    EXPECT_TRUE(m_table.Begin(&cacheIds[1], &pCompiles[1], &binarySize, &pBinary));
+
+    ASSERT_NE(pCompiles[0], nullptr);
+    ASSERT_NE(pCompiles[1], nullptr);
+    EXPECT_NE(pCompiles[0], pCompiles[1]);
+
+    m_table.End(&cacheIds[1], pCompiles[1], VK_ERROR_OUT_OF_HOST_MEMORY, 0, nullptr);
+    m_table.End(&cacheIds[0], pCompiles[0], VK_ERROR_OUT_OF_HOST_MEMORY, 0, nullptr);
+}
+
+// =====================================================================================================================
+// Threads asking for a binary while it is being compiled wait for it and share one copy of it, which is freed once the
+// last of them releases it.
+TEST_F(InFlightCompileTableTest, WaitersShareOneBinary)
+{
+    const Util::MetroHash::Hash cacheId = MakeCacheId(1);
+
+    InFlightCompileTable::Compile* pCompile   = nullptr;
+    size_t                         binarySize = 0;
+    const void*                    pBinary    = nullptr;
+
+    ASSERT_TRUE(m_table.Begin(&cacheId, &pCompile, &binarySize, &pBinary));
+    ASSERT_NE(pCompile, nullptr);
+
+    StartWaiters(&cacheId, pCompile);
+
+    uint8_t binary[BinarySize];
+    FillEntryData(1, sizeof(binary), binary);
+
+    // The compiling thread frees its own binary along with its pipeline, so the waiting threads can't use it.
+    m_table.End(&cacheId, pCompile, VK_SUCCESS, sizeof(binary), binary);
+
+    JoinWaiters();
+
+    const void* pSharedBinary = m_results[0].pBinary;
+
+    ASSERT_NE(pSharedBinary, nullptr);
+    EXPECT_NE(pSharedBinary, static_cast<const void*>(binary));
+    EXPECT_EQ(memcmp(pSharedBinary, binary, sizeof(binary)), 0);
+
+    for (uint32_t i = 0; i < WaiterCount; ++i)
+    {
+        EXPECT_FALSE(m_results[i].mustCompile) << "waiter " << i;
+        EXPECT_EQ(m_results[i].pCompile, nullptr) << "waiter " << i;
+        EXPECT_EQ(m_results[i].binarySize, sizeof(binary)) << "waiter " << i;
+        EXPECT_EQ(m_results[i].pBinary, pSharedBinary) << "waiter " << i;
+    }
+
+    for (uint32_t i = 0; i < WaiterCount; ++i)
+    {
+        EXPECT_TRUE(m_table.ReleaseSharedBinary(pSharedBinary)) << "waiter " << i;
+    }
+
+    // The last release freed the copy and forgot about it.
+    EXPECT_FALSE(m_table.ReleaseSharedBinary(pSharedBinary));
+}
+
+// =====================================================================================================================
+// If the compile fails, the waiting threads compile the binary themselves, so that each reports its own error.  They
+// don't wait for each other then.
+TEST_F(InFlightCompileTableTest, WaitersCompileAfterFailure)
+{
+    const Util::MetroHash::Hash cacheId = MakeCacheId(1);
+
+    InFlightCompileTable::Compile* pCompile   = nullptr;
+    size_t                         binarySize = 0;
+    const void*                    pBinary    = nullptr;
+
+    ASSERT_TRUE(m_table.Begin(&cacheId, &pCompile, &binarySize, &pBinary));
+    ASSERT_NE(pCompile, nullptr);
+
+    StartWaiters(&cacheId, pCompile);
+
+    m_table.End(&cacheId, pCompile, VK_ERROR_OUT_OF_HOST_MEMORY, 0, nullptr);
+
+    JoinWaiters();
+
+    for (uint32_t i = 0; i < WaiterCount; ++i)
+    {
+        EXPECT_TRUE(m_results[i].mustCompile) << "waiter " << i;
+        EXPECT_EQ(m_results[i].pCompile, nullptr) << "waiter " << i;
+        EXPECT_EQ(m_results[i].pBinary, nullptr) << "waiter " << i;
+    }
+}
+
+} // namespace test
+
+} // namespace vk
@@ -0,0 +1,559 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_binary_cache_tests.cpp
+* @brief Unit tests of serializing application pipeline binary caches and creating them from serialized data
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/pipeline_binary_cache.h"
+#include "include/pipeline_compiler.h"
+
+#include "palPlatformKey.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 534
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr size_t EntrySize = 2048;
+
+// A serialized cache, as returned by PipelineBinaryCache::Serialize()
+struct Blob
+{
+    void*  pData;
+    size_t dataSize;
+};
+
+// =====================================================================================================================
+class PipelineBinaryCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_savedDeltaSnapshots   = GetSettings()->pipelineCacheDeltaSnapshots;
+        m_savedAsyncInitialData = GetSettings()->pipelineCacheAsyncInitialData;
+    }
+
+    void TearDown() override
+    {
+        GetSettings()->pipelineCacheDeltaSnapshots   = m_savedDeltaSnapshots;
+        GetSettings()->pipelineCacheAsyncInitialData = m_savedAsyncInitialData;
+    }
+
+    // Selects the serialization features of the caches created afterwards.
+    void SetFeatures(
+        bool deltaSnapshots,
+        bool asyncInitialData)
+    {
+        GetSettings()->pipelineCacheDeltaSnapshots   = deltaSnapshots;
+        GetSettings()->pipelineCacheAsyncInitialData = asyncInitialData;
+    }
+
+    // Creates an application cache from the given blob, like vkCreatePipelineCache does.
+    PipelineBinaryCache* CreateCache(
+        const Blob* pInitialData = nullptr)
+    {
+        return PipelineBinaryCache::Create(
+            GetInstance(),
+            (pInitialData != nullptr) ? pInitialData->dataSize : 0,
+            (pInitialData != nullptr) ? pInitialData->pData : nullptr,
+            false,
+            GetDevice()->GetCompiler(DefaultDeviceIndex)->GetGfxIp(),
+            GetPhysicalDevice());
+    }
+
+    void DestroyCache(
+        PipelineBinaryCache* pCache)
+    {
+        pCache->Destroy();
+        GetInstance()->FreeMem(pCache);
+    }
+
+    void StoreEntry(
+        PipelineBinaryCache* pCache,
+        uint32_t             seed)
+    {
+        const Util::MetroHash::Hash cacheId = MakeCacheId(seed);
+
+        uint8_t data[EntrySize];
+
+        FillEntryData(seed, sizeof(data), data);
+
+        EXPECT_EQ(pCache->StorePipelineBinary(&cacheId, sizeof(data), data), Util::Result::Success);
+    }
+
+    // Returns whether the cache holds the entry of the given seed, and checks its data if it does.
+    bool HasEntry(
+        PipelineBinaryCache*         pCache,
+        const Util::MetroHash::Hash& cacheId,
+        uint32_t                     seed)
+    {
+        size_t      binarySize = 0;
+        const void* pBinary    = nullptr;
+
+        const bool found = (pCache->LoadPipelineBinary(&cacheId, &binarySize, &pBinary) == Util::Result::Success);
+
+        if (found)
+        {
+            uint8_t expected[EntrySize];
+
+            FillEntryData(seed, sizeof(expected), expected);
+
+            EXPECT_EQ(binarySize, sizeof(expected)) << "entry " << seed;
+            EXPECT_TRUE((binarySize == sizeof(expected)) && (memcmp(pBinary, expected, sizeof(expected)) == 0))
+                << "entry " << seed;
+
+            pCache->FreePipelineBinary(pBinary);
+        }
+
+        return found;
+    }
+
+    bool HasEntry(
+        PipelineBinaryCache* pCache,
+        uint32_t             seed)
+    {
+        return HasEntry(pCache, MakeCacheId(seed), seed);
+    }
+
+    // Serializes the cache like vkGetPipelineCacheData does: the size first, then the data.
+    Blob Serialize(
+        PipelineBinaryCache* pCache)
+    {
+        Blob blob = {};
+
+        EXPECT_EQ(pCache->Serialize(nullptr, &blob.dataSize), VK_SUCCESS);
+
+        blob.pData = malloc(blob.dataSize);
+
+        EXPECT_EQ(pCache->Serialize(blob.pData, &blob.dataSize), VK_SUCCESS);
+
+        return blob;
+    }
+
+    void FreeBlob(
+        Blob* pBlob)
+    {
+        free(pBlob->pData);
+        *pBlob = {};
+    }
+
+    ChecksummedBlobHeader GetHeader(
+        const Blob& blob)
+    {
+        ChecksummedBlobHeader header = {};
+
+        EXPECT_GE(blob.dataSize, sizeof(header));
+        memcpy(&header, blob.pData, sizeof(header));
+        EXPECT_EQ(header.marker, ChecksummedBlobMarker);
+
+        return header;
+    }
+
+    // Returns the offset of the header of the blob entry with the given ID, or 0 if the blob doesn't hold it.
+    size_t FindBlobEntry(
+        const Blob&                  blob,
+        const Util::MetroHash::Hash& cacheId)
+    {
+        size_t found  = 0;
+        size_t offset = sizeof(PipelineBinaryCachePrivateHeader);
+
+        while ((found == 0) && ((offset + sizeof(ChecksummedCacheEntry)) <= blob.dataSize))
+        {
+            ChecksummedCacheEntry entry = {};
+            memcpy(&entry, Util::VoidPtrInc(blob.pData, offset), sizeof(entry));
+
+            if (memcmp(&entry.hashId, &cacheId, sizeof(cacheId)) == 0)
+            {
+                found = offset;
+            }
+
+            offset += sizeof(ChecksummedCacheEntry) + entry.dataSize;
+        }
+
+        return found;
+    }
+
+    // Builds a blob in the format caches were serialized in before per-entry checksums: plain entry headers, and a hash
+    // of the platform key and all entries in place of the header.
+    Blob MakeLegacyBlob(
+        uint32_t entryCount)
+    {
+        Blob blob = {};
+
+        const size_t entriesSize = entryCount * (sizeof(BinaryCacheEntry) + EntrySize);
+
+        blob.dataSize = sizeof(PipelineBinaryCachePrivateHeader) + entriesSize;
+        blob.pData    = malloc(blob.dataSize);
+
+        size_t offset = sizeof(PipelineBinaryCachePrivateHeader);
+
+        for (uint32_t seed = 0; seed < entryCount; ++seed)
+        {
+            BinaryCacheEntry entry = {};
+            entry.hashId   = MakeCacheId(seed);
+            entry.dataSize = EntrySize;
+
+            memcpy(Util::VoidPtrInc(blob.pData, offset), &entry, sizeof(entry));
+            FillEntryData(seed, EntrySize, Util::VoidPtrInc(blob.pData, offset + sizeof(entry)));
+
+            offset += sizeof(entry) + EntrySize;
+        }
+
+        Util::IHashContext* const pKeyContext = GetPhysicalDevice()->GetPlatformKey()->GetKeyContext();
+
+        void*               pContextMem = malloc(pKeyContext->GetDuplicateObjectSize());
+        Util::IHashContext* pContext    = nullptr;
+
+        EXPECT_EQ(pKeyContext->Duplicate(pContextMem, &pContext), Util::Result::Success);
+        EXPECT_EQ(pContext->AddData(Util::VoidPtrInc(blob.pData, sizeof(PipelineBinaryCachePrivateHeader)),
+                                    blob.dataSize - sizeof(PipelineBinaryCachePrivateHeader)),
+                  Util::Result::Success);
+        EXPECT_EQ(pContext->Finish(static_cast<PipelineBinaryCachePrivateHeader*>(blob.pData)->hashId),
+                  Util::Result::Success);
+
+        pContext->Destroy();
+        free(pContextMem);
+
+        return blob;
+    }
+
+    bool m_savedDeltaSnapshots   = false;
+    bool m_savedAsyncInitialData = false;
+};
+
+// =====================================================================================================================
+// With delta snapshots, each blob holds only the entries stored since the previous one, and a cache created from a
+// blob doesn't hand the entries of its initial data back to the application.
+TEST_F(PipelineBinaryCacheTest, DeltaSnapshotRoundTrip)
+{
+    SetFeatures(true, false);
+
+    PipelineBinaryCache* pCacheA = CreateCache();
+
+    ASSERT_NE(pCacheA, nullptr);
+
+    StoreEntry(pCacheA, 0);
+    StoreEntry(pCacheA, 1);
+
+    Blob blob1 = Serialize(pCacheA);
+
+    EXPECT_EQ(GetHeader(blob1).flags & ChecksummedBlobDelta, ChecksummedBlobDelta);
+    EXPECT_EQ(GetHeader(blob1).entryCount, 2u);
+
+    StoreEntry(pCacheA, 2);
+
+    Blob blob2 = Serialize(pCacheA);
+
+    EXPECT_EQ(GetHeader(blob2).entryCount, 1u);
+    EXPECT_NE(FindBlobEntry(blob2, MakeCacheId(2)), 0u);
+
+    Blob blob3 = Serialize(pCacheA);
+
+    EXPECT_EQ(GetHeader(blob3).entryCount, 0u);
+    EXPECT_EQ(blob3.dataSize, sizeof(PipelineBinaryCachePrivateHeader));
+
+    DestroyCache(pCacheA);
+
+    PipelineBinaryCache* pCacheB = CreateCache(&blob1);
+
+    ASSERT_NE(pCacheB, nullptr);
+    EXPECT_TRUE(HasEntry(pCacheB, 0));
+    EXPECT_TRUE(HasEntry(pCacheB, 1));
+    EXPECT_FALSE(HasEntry(pCacheB, 2));
+
+    Blob blob4 = Serialize(pCacheB);
+
+    EXPECT_EQ(GetHeader(blob4).entryCount, 0u);
+
+    StoreEntry(pCacheB, 3);
+
+    Blob blob5 = Serialize(pCacheB);
+
+    EXPECT_EQ(GetHeader(blob5).entryCount, 1u);
+    EXPECT_NE(FindBlobEntry(blob5, MakeCacheId(3)), 0u);
+
+    DestroyCache(pCacheB);
+
+    PipelineBinaryCache* pCacheC = CreateCache(&blob2);
+
+    ASSERT_NE(pCacheC, nullptr);
+    EXPECT_TRUE(HasEntry(pCacheC, 2));
+    EXPECT_FALSE(HasEntry(pCacheC, 0));
+
+    DestroyCache(pCacheC);
+
+    FreeBlob(&blob1);
+    FreeBlob(&blob2);
+    FreeBlob(&blob3);
+    FreeBlob(&blob4);
+    FreeBlob(&blob5);
+}
+
+// =====================================================================================================================
+// Without delta snapshots, every blob holds the whole cache.
+TEST_F(PipelineBinaryCacheTest, FullSnapshots)
+{
+    SetFeatures(false, false);
+
+    PipelineBinaryCache* pCacheA = CreateCache();
+
+    ASSERT_NE(pCacheA, nullptr);
+
+    StoreEntry(pCacheA, 0);
+    StoreEntry(pCacheA, 1);
+
+    Blob blob1 = Serialize(pCacheA);
+
+    EXPECT_EQ(GetHeader(blob1).flags & ChecksummedBlobDelta, 0u);
+    EXPECT_EQ(GetHeader(blob1).entryCount, 2u);
+
+    Blob blob2 = Serialize(pCacheA);
+
+    EXPECT_EQ(GetHeader(blob2).entryCount, 2u);
+
+    DestroyCache(pCacheA);
+
+    PipelineBinaryCache* pCacheB = CreateCache(&blob1);
+
+    ASSERT_NE(pCacheB, nullptr);
+
+    StoreEntry(pCacheB, 2);
+
+    Blob blob3 = Serialize(pCacheB);
+
+    EXPECT_EQ(GetHeader(blob3).entryCount, 3u);
+
+    DestroyCache(pCacheB);
+
+    FreeBlob(&blob1);
+    FreeBlob(&blob2);
+    FreeBlob(&blob3);
+}
+
+// =====================================================================================================================
+// A corrupt entry is dropped on its own; the other entries of the blob still load.  The checksum covers the entry ID
+// as well as the data, so a corrupt ID can't make the data load under a different ID.
+TEST_F(PipelineBinaryCacheTest, DropsCorruptEntries)
+{
+    for (uint32_t async = 0; async < 2; ++async)
+    {
+        SetFeatures(false, async != 0);
+
+        PipelineBinaryCache* pSource = CreateCache();
+
+        ASSERT_NE(pSource, nullptr);
+
+        for (uint32_t seed = 0; seed < 4; ++seed)
+        {
+            StoreEntry(pSource, seed);
+        }
+
+        Blob blob = Serialize(pSource);
+
+        DestroyCache(pSource);
+
+        const size_t dataOffset = FindBlobEntry(blob, MakeCacheId(1));
+        const size_t idOffset   = FindBlobEntry(blob, MakeCacheId(2));
+
+        ASSERT_NE(dataOffset, 0u);
+        ASSERT_NE(idOffset, 0u);
+
+        static_cast<uint8_t*>(blob.pData)[dataOffset + sizeof(ChecksummedCacheEntry) + (EntrySize / 2)] ^= 0xFF;
+        static_cast<uint8_t*>(blob.pData)[idOffset + offsetof(ChecksummedCacheEntry, hashId)]          ^= 0xFF;
+
+        Util::MetroHash::Hash corruptId = {};
+        memcpy(&corruptId, Util::VoidPtrInc(blob.pData, idOffset + offsetof(ChecksummedCacheEntry, hashId)),
+               sizeof(corruptId));
+
+        PipelineBinaryCache* pCache = CreateCache(&blob);
+
+        ASSERT_NE(pCache, nullptr);
+
+        EXPECT_TRUE(HasEntry(pCache, 0)) << "async " << async;
+        EXPECT_FALSE(HasEntry(pCache, 1)) << "async " << async;
+        EXPECT_FALSE(HasEntry(pCache, 2)) << "async " << async;
+        EXPECT_FALSE(HasEntry(pCache, corruptId, 2)) << "async " << async;
+        EXPECT_TRUE(HasEntry(pCache, 3)) << "async " << async;
+
+        Blob reserialized = Serialize(pCache);
+
+        EXPECT_EQ(GetHeader(reserialized).entryCount, 2u) << "async " << async;
+
+        DestroyCache(pCache);
+
+        FreeBlob(&reserialized);
+        FreeBlob(&blob);
+    }
+}
+
+// =====================================================================================================================
+// Entries of initial data ingested in the background can be looked up right after the cache is created, and a
+// serialized cache holds all of them.
+TEST_F(PipelineBinaryCacheTest, AsyncIngest)
+{
+    static constexpr uint32_t EntryCount = 64;
+
+    SetFeatures(false, true);
+
+    PipelineBinaryCache* pSource = CreateCache();
+
+    ASSERT_NE(pSource, nullptr);
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        StoreEntry(pSource, seed);
+    }
+
+    Blob blob = Serialize(pSource);
+
+    DestroyCache(pSource);
+
+    ASSERT_EQ(GetHeader(blob).entryCount, EntryCount);
+
+    PipelineBinaryCache* pCache = CreateCache(&blob);
+
+    ASSERT_NE(pCache, nullptr);
+
+    // Look the entries up in reverse, so that most of them are taken ahead of the ingest thread.
+    for (uint32_t seed = EntryCount; seed > 0; --seed)
+    {
+        EXPECT_TRUE(HasEntry(pCache, seed - 1));
+    }
+
+    Blob reserialized = Serialize(pCache);
+
+    EXPECT_EQ(GetHeader(reserialized).entryCount, EntryCount);
+
+    for (uint32_t seed = 0; seed < EntryCount; ++seed)
+    {
+        EXPECT_NE(FindBlobEntry(reserialized, MakeCacheId(seed)), 0u) << "entry " << seed;
+    }
+
+    DestroyCache(pCache);
+
+    // A cache may be destroyed while its initial data is still being ingested.
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        PipelineBinaryCache* pShortLived = CreateCache(&blob);
+
+        ASSERT_NE(pShortLived, nullptr);
+
+        DestroyCache(pShortLived);
+    }
+
+    // With delta snapshots as well, the ingested entries are known to the application and aren't serialized again.
+    SetFeatures(true, true);
+
+    PipelineBinaryCache* pDeltaCache = CreateCache(&blob);
+
+    ASSERT_NE(pDeltaCache, nullptr);
+
+    Blob delta = Serialize(pDeltaCache);
+
+    EXPECT_EQ(GetHeader(delta).entryCount, 0u);
+    EXPECT_TRUE(HasEntry(pDeltaCache, 0));
+
+    DestroyCache(pDeltaCache);
+
+    FreeBlob(&delta);
+    FreeBlob(&reserialized);
+    FreeBlob(&blob);
+}
+
+// =====================================================================================================================
+// Blobs without per-entry checksums are recognized by their entry headers alone, and their hash is verified by the
+// cache, in the background if the data is ingested there.  A blob whose hash doesn't match is dropped as a whole.
+TEST_F(PipelineBinaryCacheTest, VerifiesLegacyBlobs)
+{
+    static constexpr uint32_t EntryCount = 8;
+
+    Blob blob = MakeLegacyBlob(EntryCount);
+
+    EXPECT_TRUE(PipelineBinaryCache::IsValidBlob(GetPhysicalDevice(), blob.dataSize, blob.pData));
+    EXPECT_FALSE(PipelineBinaryCache::IsValidBlob(GetPhysicalDevice(), blob.dataSize - 1, blob.pData));
+
+    for (uint32_t async = 0; async < 2; ++async)
+    {
+        SetFeatures(false, async != 0);
+
+        PipelineBinaryCache* pCache = CreateCache(&blob);
+
+        ASSERT_NE(pCache, nullptr);
+
+        // Serializing waits for the ingest, so every entry is in the cache afterwards.
+        Blob reserialized = Serialize(pCache);
+
+        EXPECT_EQ(GetHeader(reserialized).entryCount, EntryCount) << "async " << async;
+
+        for (uint32_t seed = 0; seed < EntryCount; ++seed)
+        {
+            EXPECT_TRUE(HasEntry(pCache, seed)) << "async " << async << " entry " << seed;
+        }
+
+        DestroyCache(pCache);
+        FreeBlob(&reserialized);
+    }
+
+    // Corrupting one entry only shows in the hash of the whole blob, which still passes the header check.
+    static_cast<uint8_t*>(blob.pData)[blob.dataSize - 1] ^= 0xFF;
+
+    EXPECT_TRUE(PipelineBinaryCache::IsValidBlob(GetPhysicalDevice(), blob.dataSize, blob.pData));
+
+    for (uint32_t async = 0; async < 2; ++async)
+    {
+        SetFeatures(false, async != 0);
+
+        PipelineBinaryCache* pCache = CreateCache(&blob);
+
+        ASSERT_NE(pCache, nullptr);
+
+        Blob reserialized = Serialize(pCache);
+
+        EXPECT_EQ(GetHeader(reserialized).entryCount, 0u) << "async " << async;
+        EXPECT_FALSE(HasEntry(pCache, 0)) << "async " << async;
+
+        DestroyCache(pCache);
+        FreeBlob(&reserialized);
+    }
+
+    FreeBlob(&blob);
+}
+
+} // namespace test
+
+} // namespace vk
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compile_pool_tests.cpp
+* @brief Unit tests of the pipeline compile pool
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/pipeline_compile_pool.h"
+
+#include "palThread.h"
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr uint32_t PoolThreadCount = 4;
+
+// Work of a batch: counts how often every index ran
+struct CountingPayload
+{
+    volatile uint32_t runCounts[1024];
+};
+
+// =====================================================================================================================
+static void CountRun(
+    void*    pPayload,
+    uint32_t index)
+{
+    Util::AtomicIncrement(&static_cast<CountingPayload*>(pPayload)->runCounts[index]);
+}
+
+// =====================================================================================================================
+class PipelineCompilePoolTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(PipelineCompilePool::Create(GetInstance(), PoolThreadCount, &m_pPool), VK_SUCCESS);
+    }
+
+    void TearDown() override
+    {
+        if (m_pPool != nullptr)
+        {
+            m_pPool->Destroy();
+        }
+    }
+
+    PipelineCompilePool* m_pPool = nullptr;
+};
+
+// =====================================================================================================================
+TEST_F(PipelineCompilePoolTest, StartsRequestedThreads)
+{
+    EXPECT_EQ(m_pPool->GetThreadCount(), PoolThreadCount);
+}
+
+// =====================================================================================================================
+TEST(PipelineCompilePoolCreateTest, ClampsThreadCount)
+{
+    PipelineCompilePool* pPool = nullptr;
+
+    ASSERT_EQ(PipelineCompilePool::Create(GetInstance(), PipelineCompilePool::MaxThreads * 4, &pPool), VK_SUCCESS);
+
+    EXPECT_GT(pPool->GetThreadCount(), 0u);
+    EXPECT_LE(pPool->GetThreadCount(), PipelineCompilePool::MaxThreads);
+
+    pPool->Destroy();
+}
+
+// =====================================================================================================================
+// Execute() returns only once every index has run, and runs each exactly once.
+TEST_F(PipelineCompilePoolTest, RunsEveryIndexOnce)
+{
+    CountingPayload payload = {};
+
+    const uint32_t count = static_cast<uint32_t>(VK_ARRAY_SIZE(payload.runCounts));
+
+    m_pPool->Execute(count, CountRun, &payload);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(payload.runCounts[i], 1u) << "index " << i;
+    }
+}
+
+// =====================================================================================================================
+// Batches of a single index run on the submitting thread without involving the pool.
+TEST_F(PipelineCompilePoolTest, RunsSmallBatches)
+{
+    CountingPayload payload = {};
+
+    m_pPool->Execute(0, CountRun, &payload);
+
+    EXPECT_EQ(payload.runCounts[0], 0u);
+
+    m_pPool->Execute(1, CountRun, &payload);
+
+    EXPECT_EQ(payload.runCounts[0], 1u);
+    EXPECT_EQ(payload.runCounts[1], 0u);
+}
+
+// A thread submitting batches to a shared pool
+struct SubmitterState
+{
+    PipelineCompilePool* pPool;
+    CountingPayload      payload;
+    uint32_t             batchCount;
+    uint32_t             batchSize;
+};
+
+// =====================================================================================================================
+static void SubmitBatches(
+    void* pParam)
+{
+    SubmitterState* const pState = static_cast<SubmitterState*>(pParam);
+
+    for (uint32_t batch = 0; batch < pState->batchCount; ++batch)
+    {
+        pState->pPool->Execute(pState->batchSize, CountRun, &pState->payload);
+    }
+}
+
+// =====================================================================================================================
+// Batches submitted from several threads at once are all completed, and none of their indices run twice.
+TEST_F(PipelineCompilePoolTest, RunsConcurrentBatches)
+{
+    static constexpr uint32_t SubmitterCount = 4;
+    static constexpr uint32_t BatchCount     = 32;
+    static constexpr uint32_t BatchSize      = 64;
+
+    SubmitterState states[SubmitterCount] = {};
+    Util::Thread   threads[SubmitterCount];
+
+    for (uint32_t i = 0; i < SubmitterCount; ++i)
+    {
+        states[i].pPool      = m_pPool;
+        states[i].batchCount = BatchCount;
+        states[i].batchSize  = BatchSize;
+
+        ASSERT_EQ(threads[i].Begin(SubmitBatches, &states[i]), Util::Result::Success);
+    }
+
+    for (uint32_t i = 0; i < SubmitterCount; ++i)
+    {
+        threads[i].Join();
+
+        for (uint32_t index = 0; index < BatchSize; ++index)
+        {
+            EXPECT_EQ(states[i].payload.runCounts[index], BatchCount) << "submitter " << i << ", index " << index;
+        }
+    }
+}
+
+} // namespace test
+
+} // namespace vk
@@ -0,0 +1,107 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_tier_up_queue_tests.cpp
+* @brief Unit tests of the pipeline tier-up queue
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/pipeline_tier_up_queue.h"
+
+namespace vk
+{
+
+namespace test
+{
+
+// =====================================================================================================================
+// Only pipelines without flags asking for an unoptimized, inspectable or cache-only pipeline are created tiered.
+TEST(PipelineTierUpQueueTest, TierableFlags)
+{
+    VkGraphicsPipelineCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+    ASSERT_FALSE(GetDevice()->IsExtensionEnabled(DeviceExtensions::AMD_SHADER_INFO));
+
+    EXPECT_TRUE(PipelineTierUpQueue::IsTierable(GetDevice(), &createInfo));
+
+    const VkPipelineCreateFlags untierableFlags[] =
+    {
+        VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT,
+        VK_PIPELINE_CREATE_CAPTURE_INTERNAL_REPRESENTATIONS_BIT_KHR,
+        VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT,
+    };
+
+    for (VkPipelineCreateFlags flags : untierableFlags)
+    {
+        createInfo.flags = flags;
+
+        EXPECT_FALSE(PipelineTierUpQueue::IsTierable(GetDevice(), &createInfo)) << "flags " << flags;
+    }
+
+    // Statistics are reported for the tier that is bound, so they don't keep a pipeline from being tiered.
+    createInfo.flags = VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+
+    EXPECT_TRUE(PipelineTierUpQueue::IsTierable(GetDevice(), &createInfo));
+}
+
+// =====================================================================================================================
+// The queue thread sleeps until it is stopped when there is nothing to compile, and stops right away, however soon
+// after starting it is stopped.
+TEST(PipelineTierUpQueueTest, StopsWhileIdle)
+{
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        PipelineTierUpQueue* pQueue = nullptr;
+
+        ASSERT_EQ(PipelineTierUpQueue::Create(GetDevice(), &pQueue), VK_SUCCESS);
+        ASSERT_NE(pQueue, nullptr);
+
+        pQueue->Destroy();
+    }
+}
+
+// =====================================================================================================================
+// Cancelling the job of a pipeline, or detaching a pipeline cache, which the queue knows nothing of is harmless.  The
+// queue only compares the pointers, so they needn't point to live objects.
+TEST(PipelineTierUpQueueTest, IgnoresUnknownObjects)
+{
+    PipelineTierUpQueue* pQueue = nullptr;
+
+    ASSERT_EQ(PipelineTierUpQueue::Create(GetDevice(), &pQueue), VK_SUCCESS);
+
+    uint32_t dummy = 0;
+
+    pQueue->Cancel(reinterpret_cast<const GraphicsPipeline*>(&dummy));
+    pQueue->ForgetPipelineCache(reinterpret_cast<const PipelineCache*>(&dummy));
+
+    pQueue->Destroy();
+}
+
+} // namespace test
+
+} // namespace vk
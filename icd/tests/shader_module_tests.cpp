@@ -0,0 +1,179 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shader_module_tests.cpp
+* @brief Unit tests of the interning of built shader modules
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/pipeline_compiler.h"
+#include "include/vk_shader.h"
+
+#include <string.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+// Index of the local size X operand in the code below
+static constexpr uint32_t LocalSizeXWord = 18;
+
+// SPIR-V of an empty compute shader with a local size of 1x1x1
+static const uint32_t EmptyComputeShader[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000, // Header, bound 5
+    0x00020011, 0x00000001,                                     // OpCapability Shader
+    0x0003000E, 0x00000000, 0x00000001,                         // OpMemoryModel Logical GLSL450
+    0x0005000F, 0x00000005, 0x00000003, 0x6E69616D, 0x00000000, // OpEntryPoint GLCompute %3 "main"
+    0x00060010, 0x00000003, 0x00000011,                         // OpExecutionMode %3 LocalSize 1 1 1
+    0x00000001, 0x00000001, 0x00000001,
+    0x00020013, 0x00000001,                                     // %1 = OpTypeVoid
+    0x00030021, 0x00000002, 0x00000001,                         // %2 = OpTypeFunction %1
+    0x00050036, 0x00000001, 0x00000003, 0x00000000, 0x00000002, // %3 = OpFunction %1 None %2
+    0x000200F8, 0x00000004,                                     // %4 = OpLabel
+    0x000100FD,                                                 // OpReturn
+    0x00010038,                                                 // OpFunctionEnd
+};
+
+// =====================================================================================================================
+class ShaderModuleTest : public ::testing::Test
+{
+protected:
+    // Creates a shader module from the empty compute shader with the given local size X.
+    ShaderModule* CreateModule(
+        uint32_t localSizeX)
+    {
+        uint32_t code[VK_ARRAY_SIZE(EmptyComputeShader)];
+        memcpy(code, EmptyComputeShader, sizeof(code));
+        code[LocalSizeXWord] = localSizeX;
+
+        VkShaderModuleCreateInfo createInfo = {};
+        createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = sizeof(code);
+        createInfo.pCode    = code;
+
+        VkShaderModule module = VK_NULL_HANDLE;
+
+        const VkResult result = ShaderModule::Create(GetDevice(), &createInfo, GetAllocator(), &module);
+
+        EXPECT_EQ(result, VK_SUCCESS);
+
+        return (result == VK_SUCCESS) ? ShaderModule::ObjectFromHandle(module) : nullptr;
+    }
+
+    void DestroyModule(
+        ShaderModule* pModule)
+    {
+        pModule->Destroy(GetDevice(), GetAllocator());
+    }
+
+    static const void* GetModuleData(
+        const ShaderModule* pModule)
+    {
+        return pModule->GetShaderModuleHandle()->pLlpcShaderModule;
+    }
+
+    static const VkAllocationCallbacks* GetAllocator()
+    {
+        return GetInstance()->GetAllocCallbacks();
+    }
+};
+
+// =====================================================================================================================
+// Modules built from the same code share one copy of the module data, which lives as long as any of them.
+TEST_F(ShaderModuleTest, SameCodeSharesModuleData)
+{
+    ShaderModule* pFirst  = CreateModule(1);
+    ShaderModule* pSecond = CreateModule(1);
+
+    ASSERT_NE(pFirst, nullptr);
+    ASSERT_NE(pSecond, nullptr);
+    ASSERT_NE(GetModuleData(pFirst), nullptr);
+
+    EXPECT_EQ(GetModuleData(pSecond), GetModuleData(pFirst));
+
+    const void* pModuleData = GetModuleData(pFirst);
+
+    DestroyModule(pFirst);
+
+    // The second module still references the module data, so a new module finds it interned.
+    ShaderModule* pThird = CreateModule(1);
+
+    ASSERT_NE(pThird, nullptr);
+    EXPECT_EQ(GetModuleData(pThird), pModuleData);
+
+    DestroyModule(pSecond);
+    DestroyModule(pThird);
+}
+
+// =====================================================================================================================
+// Modules built from different code get module data of their own.
+TEST_F(ShaderModuleTest, DifferentCodeGetsOwnModuleData)
+{
+    ShaderModule* pFirst  = CreateModule(1);
+    ShaderModule* pSecond = CreateModule(2);
+
+    ASSERT_NE(pFirst, nullptr);
+    ASSERT_NE(pSecond, nullptr);
+
+    EXPECT_NE(GetModuleData(pSecond), GetModuleData(pFirst));
+
+    DestroyModule(pFirst);
+    DestroyModule(pSecond);
+}
+
+// =====================================================================================================================
+// A reference taken on interned module data keeps it alive after its shader module is destroyed, until it is freed.
+TEST_F(ShaderModuleTest, RetainedModuleDataOutlivesModule)
+{
+    PipelineCompiler* pCompiler = GetDevice()->GetCompiler(DefaultDeviceIndex);
+
+    ShaderModule* pModule = CreateModule(1);
+
+    ASSERT_NE(pModule, nullptr);
+
+    ShaderModuleHandle handle = *pModule->GetShaderModuleHandle();
+
+    ASSERT_TRUE(pCompiler->RetainShaderModule(&handle));
+
+    DestroyModule(pModule);
+
+    pModule = CreateModule(1);
+
+    ASSERT_NE(pModule, nullptr);
+    EXPECT_EQ(GetModuleData(pModule), handle.pLlpcShaderModule);
+
+    pCompiler->FreeShaderModule(&handle);
+
+    DestroyModule(pModule);
+}
+
+} // namespace test
+
+} // namespace vk
@@ -0,0 +1,204 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shared_pipeline_cache_tests.cpp
+* @brief Unit tests of the pipeline binary cache in shared memory
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/shared_pipeline_cache.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+static constexpr size_t   TestCacheSize   = 256 * 1024;
+static constexpr size_t   TestBinarySize  = 4096;
+static constexpr uint64_t TestPlatformKey = 0x0123456789ABCDEFull;
+
+// =====================================================================================================================
+// Names the shared memory of a test after the test and the process, so that concurrent test runs don't share it.  The
+// memory is unlinked before and after the test.
+class SharedPipelineCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        const ::testing::TestInfo* const pInfo = ::testing::UnitTest::GetInstance()->current_test_info();
+
+        Util::Snprintf(m_name, sizeof(m_name), "/amdvlk-test-%d-%s", static_cast<int>(getpid()), pInfo->name());
+
+        shm_unlink(m_name);
+    }
+
+    void TearDown() override
+    {
+        shm_unlink(m_name);
+    }
+
+    SharedPipelineCache* Open(uint64_t platformKey)
+    {
+        return SharedPipelineCache::Create(GetInstance(), m_name, TestCacheSize, platformKey);
+    }
+
+    char m_name[128] = {};
+};
+
+// =====================================================================================================================
+// A binary one process stores is found by another process opening the cache, in place in the shared memory.  Each
+// mapping of the cache stands in for a process here.
+TEST_F(SharedPipelineCacheTest, SharesBinariesBetweenMappings)
+{
+    SharedPipelineCache* pWriter = Open(TestPlatformKey);
+    SharedPipelineCache* pReader = Open(TestPlatformKey);
+
+    ASSERT_NE(pWriter, nullptr);
+    ASSERT_NE(pReader, nullptr);
+
+    uint8_t data[TestBinarySize];
+    FillEntryData(1, sizeof(data), data);
+
+    const Util::MetroHash::Hash cacheId = MakeCacheId(1);
+
+    size_t      foundSize = 0;
+    const void* pFound    = nullptr;
+
+    EXPECT_FALSE(pReader->FindBinary(&cacheId, &foundSize, &pFound));
+
+    pWriter->StoreBinary(&cacheId, sizeof(data), data);
+
+    ASSERT_TRUE(pReader->FindBinary(&cacheId, &foundSize, &pFound));
+    ASSERT_EQ(foundSize, sizeof(data));
+    EXPECT_EQ(memcmp(pFound, data, sizeof(data)), 0);
+
+    EXPECT_TRUE(pReader->ContainsBinary(pFound));
+    EXPECT_FALSE(pReader->ContainsBinary(data));
+
+    pReader->Destroy();
+    pWriter->Destroy();
+}
+
+// =====================================================================================================================
+// Memory that holds binaries of another platform key is retired: the opening process gets a new, empty cache under
+// the same name, while the processes mapping the old memory keep using it.
+TEST_F(SharedPipelineCacheTest, RetiresCacheOfOtherPlatformKey)
+{
+    SharedPipelineCache* pOld = Open(TestPlatformKey);
+
+    ASSERT_NE(pOld, nullptr);
+
+    uint8_t data[TestBinarySize];
+    FillEntryData(2, sizeof(data), data);
+
+    const Util::MetroHash::Hash cacheId = MakeCacheId(2);
+
+    pOld->StoreBinary(&cacheId, sizeof(data), data);
+
+    SharedPipelineCache* pNew = Open(TestPlatformKey + 1);
+
+    ASSERT_NE(pNew, nullptr);
+
+    size_t      foundSize = 0;
+    const void* pFound    = nullptr;
+
+    EXPECT_FALSE(pNew->FindBinary(&cacheId, &foundSize, &pFound));
+    EXPECT_TRUE(pOld->FindBinary(&cacheId, &foundSize, &pFound));
+
+    // The new cache works, and it is the one the name refers to now.
+    pNew->StoreBinary(&cacheId, sizeof(data), data);
+
+    SharedPipelineCache* pLater = Open(TestPlatformKey + 1);
+
+    ASSERT_NE(pLater, nullptr);
+    EXPECT_TRUE(pLater->FindBinary(&cacheId, &foundSize, &pFound));
+
+    pLater->Destroy();
+    pNew->Destroy();
+    pOld->Destroy();
+}
+
+// =====================================================================================================================
+// A full cache is retired, so a process opening the cache afterwards starts with a new, empty one.  Binaries stored
+// before keep being found through the old mapping.
+TEST_F(SharedPipelineCacheTest, RetiresFullCache)
+{
+    SharedPipelineCache* pFull = Open(TestPlatformKey);
+
+    ASSERT_NE(pFull, nullptr);
+
+    uint8_t data[TestBinarySize];
+
+    size_t      foundSize = 0;
+    const void* pFound    = nullptr;
+    uint32_t    stored    = 0;
+
+    // Store until a binary doesn't fit anymore.
+    for (bool full = false; full == false; )
+    {
+        const Util::MetroHash::Hash cacheId = MakeCacheId(stored);
+
+        FillEntryData(stored, sizeof(data), data);
+        pFull->StoreBinary(&cacheId, sizeof(data), data);
+
+        full = (pFull->FindBinary(&cacheId, &foundSize, &pFound) == false);
+
+        if (full == false)
+        {
+            ++stored;
+        }
+
+        ASSERT_LE(stored, TestCacheSize / TestBinarySize);
+    }
+
+    ASSERT_GT(stored, 0u);
+
+    const Util::MetroHash::Hash firstId = MakeCacheId(0);
+
+    EXPECT_TRUE(pFull->FindBinary(&firstId, &foundSize, &pFound));
+
+    SharedPipelineCache* pNew = Open(TestPlatformKey);
+
+    ASSERT_NE(pNew, nullptr);
+    EXPECT_FALSE(pNew->FindBinary(&firstId, &foundSize, &pFound));
+
+    FillEntryData(0, sizeof(data), data);
+    pNew->StoreBinary(&firstId, sizeof(data), data);
+
+    EXPECT_TRUE(pNew->FindBinary(&firstId, &foundSize, &pFound));
+
+    pNew->Destroy();
+    pFull->Destroy();
+}
+
+} // namespace test
+
+} // namespace vk
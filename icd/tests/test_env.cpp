@@ -0,0 +1,258 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  test_env.cpp
+* @brief Driver objects shared by the unit tests
+***********************************************************************************************************************
+*/
+#include "test_env.h"
+
+#include "include/vk_alloccb.h"
+
+#include "palInlineFuncs.h"
+#include "palMetroHash.h"
+
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+// Objects shared by all tests
+static VkInstance      s_instance          = VK_NULL_HANDLE;
+static VkDevice        s_device            = VK_NULL_HANDLE;
+static PhysicalDevice* s_pPhysicalDevice   = nullptr;
+static char            s_tempDir[PATH_MAX] = {};
+
+// =====================================================================================================================
+// Creates the temporary directory and the driver objects.  Failures are fatal for the whole run.
+void TestEnvironment::SetUp()
+{
+    Util::Strncpy(s_tempDir, "/tmp/xgl-unit-tests.XXXXXX", sizeof(s_tempDir));
+
+    ASSERT_NE(mkdtemp(s_tempDir), nullptr);
+
+    // Tests may choose the null device through the environment; any of them will do.
+    setenv("AMDVLK_NULL_GPU", "ALL", 0);
+
+    // Keep the driver's internal pipeline cache out of the user's cache directory.
+    setenv("AMD_VK_PIPELINE_CACHE_PATH", s_tempDir, 1);
+
+    VkApplicationInfo appInfo = {};
+    appInfo.sType            = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "xgl-unit-tests";
+    appInfo.apiVersion       = VK_API_VERSION_1_1;
+
+    VkInstanceCreateInfo instanceInfo = {};
+    instanceInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+
+    ASSERT_EQ(Instance::Create(&instanceInfo, nullptr, &s_instance), VK_SUCCESS);
+
+    VkPhysicalDevice physicalDevice      = VK_NULL_HANDLE;
+    uint32_t         physicalDeviceCount = 1;
+
+    const VkResult enumResult = Instance::ObjectFromHandle(s_instance)->EnumeratePhysicalDevices(
+        &physicalDeviceCount,
+        &physicalDevice);
+
+    ASSERT_TRUE((enumResult == VK_SUCCESS) || (enumResult == VK_INCOMPLETE));
+    ASSERT_EQ(physicalDeviceCount, 1u);
+
+    s_pPhysicalDevice = ApiPhysicalDevice::ObjectFromHandle(physicalDevice);
+
+    // Null devices don't have to have any queues.  Devices are created just the same without one.
+    uint32_t queueFamilyCount = 0;
+
+    s_pPhysicalDevice->GetQueueFamilyProperties(&queueFamilyCount, static_cast<VkQueueFamilyProperties*>(nullptr));
+
+    const float priority = 1.0f;
+
+    VkDeviceQueueCreateInfo queueInfo = {};
+    queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = 0;
+    queueInfo.queueCount       = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo deviceInfo = {};
+    deviceInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = (queueFamilyCount > 0) ? 1 : 0;
+    deviceInfo.pQueueCreateInfos    = &queueInfo;
+
+    ASSERT_EQ(s_pPhysicalDevice->CreateDevice(&deviceInfo, GetInstance()->GetAllocCallbacks(), &s_device), VK_SUCCESS);
+}
+
+// =====================================================================================================================
+// Removes a file or directory of the temporary directory
+static int RemoveTempFile(
+    const char*        pPath,
+    const struct stat* pStat,
+    int                type,
+    struct FTW*        pFtw)
+{
+    return remove(pPath);
+}
+
+// =====================================================================================================================
+void TestEnvironment::TearDown()
+{
+    if (s_device != VK_NULL_HANDLE)
+    {
+        ApiDevice::ObjectFromHandle(s_device)->Destroy(GetInstance()->GetAllocCallbacks());
+        s_device = VK_NULL_HANDLE;
+    }
+
+    if (s_instance != VK_NULL_HANDLE)
+    {
+        Instance::ObjectFromHandle(s_instance)->Destroy();
+        s_instance = VK_NULL_HANDLE;
+    }
+
+    if (s_tempDir[0] != '\0')
+    {
+        nftw(s_tempDir, RemoveTempFile, 16, FTW_DEPTH | FTW_PHYS);
+    }
+}
+
+// =====================================================================================================================
+Instance* GetInstance()
+{
+    return Instance::ObjectFromHandle(s_instance);
+}
+
+// =====================================================================================================================
+PhysicalDevice* GetPhysicalDevice()
+{
+    return s_pPhysicalDevice;
+}
+
+// =====================================================================================================================
+Device* GetDevice()
+{
+    return ApiDevice::ObjectFromHandle(s_device);
+}
+
+// =====================================================================================================================
+RuntimeSettings* GetSettings()
+{
+    return const_cast<RuntimeSettings*>(&s_pPhysicalDevice->GetRuntimeSettings());
+}
+
+// =====================================================================================================================
+const char* GetTempDir()
+{
+    return s_tempDir;
+}
+
+// =====================================================================================================================
+bool MakeTestDir(
+    char*  pPath,
+    size_t pathSize)
+{
+    const ::testing::TestInfo* const pInfo = ::testing::UnitTest::GetInstance()->current_test_info();
+
+    const int length = Util::Snprintf(pPath, pathSize, "%s/%s.%s", s_tempDir, pInfo->test_suite_name(), pInfo->name());
+
+    return (length > 0) && (static_cast<size_t>(length) < pathSize) && (mkdir(pPath, 0700) == 0);
+}
+
+// =====================================================================================================================
+Util::ICacheLayer* CreateMemoryLayer()
+{
+    Util::AllocCallbacks allocCallbacks = {};
+    allocCallbacks.pClientData = GetInstance()->GetAllocCallbacks();
+    allocCallbacks.pfnAlloc    = allocator::PalAllocFuncDelegator;
+    allocCallbacks.pfnFree     = allocator::PalFreeFuncDelegator;
+
+    Util::MemoryCacheCreateInfo createInfo = {};
+    createInfo.baseInfo.pCallbacks = &allocCallbacks;
+    createInfo.maxObjectCount      = SIZE_MAX;
+    createInfo.maxMemorySize       = SIZE_MAX;
+    createInfo.evictOnFull         = true;
+    createInfo.evictDuplicates     = true;
+
+    Util::ICacheLayer* pLayer = nullptr;
+
+    void* pMem = GetInstance()->AllocMem(Util::GetMemoryCacheLayerSize(&createInfo), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if ((pMem != nullptr) && (Util::CreateMemoryCacheLayer(&createInfo, pMem, &pLayer) != Util::Result::Success))
+    {
+        GetInstance()->FreeMem(pMem);
+        pLayer = nullptr;
+    }
+
+    return pLayer;
+}
+
+// =====================================================================================================================
+void DestroyMemoryLayer(
+    Util::ICacheLayer* pLayer)
+{
+    if (pLayer != nullptr)
+    {
+        pLayer->Destroy();
+        GetInstance()->FreeMem(pLayer);
+    }
+}
+
+// =====================================================================================================================
+Util::MetroHash::Hash MakeCacheId(
+    uint32_t seed)
+{
+    Util::MetroHash::Hash cacheId = {};
+
+    Util::MetroHash128::Hash(reinterpret_cast<const uint8_t*>(&seed), sizeof(seed), cacheId.bytes);
+
+    return cacheId;
+}
+
+// =====================================================================================================================
+void FillEntryData(
+    uint32_t seed,
+    size_t   dataSize,
+    void*    pData)
+{
+    // Entries start like the ELF files they stand in for, which also keeps them from looking encoded.
+    static constexpr uint8_t ElfMagic[] = { 0x7F, 'E', 'L', 'F' };
+
+    uint8_t* const pBytes = static_cast<uint8_t*>(pData);
+
+    for (size_t i = 0; i < dataSize; ++i)
+    {
+        pBytes[i] = (i < sizeof(ElfMagic)) ? ElfMagic[i] : static_cast<uint8_t>((seed * 131) + (i * 7));
+    }
+}
+
+} // namespace test
+
+} // namespace vk
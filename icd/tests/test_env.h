@@ -0,0 +1,87 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  test_env.h
+* @brief Driver objects shared by the unit tests
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_device.h"
+#include "include/vk_instance.h"
+#include "include/vk_physical_device.h"
+
+#include "palCacheLayer.h"
+
+#include <gtest/gtest.h>
+
+namespace vk
+{
+
+namespace test
+{
+
+// =====================================================================================================================
+// Creates an instance and a device on a null device once for the whole test run, so that tests can create driver
+// objects without a GPU.  The pipeline cache directory of the driver is pointed at a temporary directory, which the
+// tests also use for their own files and which is removed again at the end.
+class TestEnvironment : public ::testing::Environment
+{
+public:
+    void SetUp() override;
+    void TearDown() override;
+};
+
+Instance*       GetInstance();
+PhysicalDevice* GetPhysicalDevice();
+Device*         GetDevice();
+
+// The settings of the physical device, which tests change to enable the features they test.  Tests restore what they
+// change.
+RuntimeSettings* GetSettings();
+
+// Temporary directory of the test run
+const char* GetTempDir();
+
+// Creates an empty directory in the temporary directory of the run, named after the running test.  Returns false on
+// failure.
+bool MakeTestDir(char* pPath, size_t pathSize);
+
+// Creates an unbounded memory cache layer like the one in front of every pipeline binary cache
+Util::ICacheLayer* CreateMemoryLayer();
+
+void DestroyMemoryLayer(Util::ICacheLayer* pLayer);
+
+// Returns a cache ID derived from a number
+Util::MetroHash::Hash MakeCacheId(uint32_t seed);
+
+// Fills a buffer with data derived from a number, so that every entry of a test has distinct contents
+void FillEntryData(uint32_t seed, size_t dataSize, void* pData);
+
+} // namespace test
+
+} // namespace vk
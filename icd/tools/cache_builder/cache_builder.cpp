@@ -0,0 +1,564 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  cache_builder.cpp
+* @brief Offline pipeline cache builder.  Compiles the pipelines of LLPC pipeline dumps for a null device and writes the
+*        binaries to a pipeline binary cache archive, so caches for a GPU can be built without the GPU.
+*
+*        Usage: xgl-cache-builder --gpu <null device name> --output-dir <dir> --name <archive name> [--icd <path>]
+*                                 [--depth-format <format>] <dump.pipe>...
+*               xgl-cache-builder --list-gpus [--icd <path>]
+*
+*        The depth/stencil format of a graphics pipeline's subpass is part of its cache key but not of its dump.
+*        --depth-format gives it for the dumps after it on the command line, as a VkFormat name without the VK_FORMAT_
+*        prefix, a VkFormat value, or "none".  Graphics dumps without one, and dumps using immutable samplers, are
+*        skipped since they would be stored under keys the driver never looks up.
+*
+*        The archive is written to <dir>/<archive name>.parc.  Drivers load it as a read-only cache through
+*        AMD_VK_PIPELINE_CACHE_PATH and AMD_VK_PIPELINE_CACHE_READ_ONLY_FILENAME.
+***********************************************************************************************************************
+*/
+#include "pipeline_replayer.h"
+
+#include "spvgen.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace CacheBuilder
+{
+
+static constexpr char DefaultIcdName[] = "amdvlk64.so";
+
+// A pipeline dump to replay
+struct DumpFile
+{
+    const char* pFileName;
+    VkFormat    depthStencilFormat; // PipelineReplayer::UnknownFormat if it wasn't given
+};
+
+// Command line options
+struct Options
+{
+    const char* pIcdName;
+    const char* pGpuName;
+    const char* pOutputDir;
+    const char* pArchiveName;
+    bool        listGpus;
+    uint32_t    fileCount;
+    DumpFile*   pFiles;     // Allocated by the caller with room for every argument
+};
+
+// Depth/stencil format names accepted by --depth-format
+struct FormatName
+{
+    const char* pName;
+    VkFormat    format;
+};
+
+static constexpr FormatName DepthStencilFormats[] =
+{
+    { "none",                VK_FORMAT_UNDEFINED           },
+    { "D16_UNORM",           VK_FORMAT_D16_UNORM           },
+    { "X8_D24_UNORM_PACK32", VK_FORMAT_X8_D24_UNORM_PACK32 },
+    { "D32_SFLOAT",          VK_FORMAT_D32_SFLOAT          },
+    { "S8_UINT",             VK_FORMAT_S8_UINT             },
+    { "D16_UNORM_S8_UINT",   VK_FORMAT_D16_UNORM_S8_UINT   },
+    { "D24_UNORM_S8_UINT",   VK_FORMAT_D24_UNORM_S8_UINT   },
+    { "D32_SFLOAT_S8_UINT",  VK_FORMAT_D32_SFLOAT_S8_UINT  },
+};
+
+// Instance level entry points, resolved from the ICD
+struct InstanceDispatch
+{
+    PFN_vkDestroyInstance                        vkDestroyInstance;
+    PFN_vkEnumeratePhysicalDevices               vkEnumeratePhysicalDevices;
+    PFN_vkGetPhysicalDeviceProperties            vkGetPhysicalDeviceProperties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties vkGetPhysicalDeviceQueueFamilyProperties;
+    PFN_vkEnumerateDeviceExtensionProperties     vkEnumerateDeviceExtensionProperties;
+    PFN_vkCreateDevice                           vkCreateDevice;
+    PFN_vkGetDeviceProcAddr                      vkGetDeviceProcAddr;
+    PFN_vkDestroyDevice                          vkDestroyDevice;
+};
+
+// =====================================================================================================================
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage: xgl-cache-builder --gpu <null device name> --output-dir <dir> --name <archive name> "
+            "[--icd <path>] [--depth-format <format>] <dump.pipe>...\n"
+            "       xgl-cache-builder --list-gpus [--icd <path>]\n"
+            "\n"
+            "--depth-format applies to the dumps after it.  <format> is a VkFormat name without the\n"
+            "VK_FORMAT_ prefix, a VkFormat value, or none.  Graphics dumps without a depth format are skipped.\n");
+}
+
+// =====================================================================================================================
+// Parses the value of --depth-format.  Returns false if it isn't a depth/stencil format name or a number.
+static bool ParseDepthStencilFormat(
+    const char* pValue,
+    VkFormat*   pFormat)
+{
+    bool valid = false;
+
+    for (const FormatName& name : DepthStencilFormats)
+    {
+        if (strcmp(pValue, name.pName) == 0)
+        {
+            *pFormat = name.format;
+            valid    = true;
+        }
+    }
+
+    if (valid == false)
+    {
+        char*               pEnd  = nullptr;
+        const unsigned long value = strtoul(pValue, &pEnd, 0);
+
+        if ((pEnd != pValue) && (*pEnd == '\0') && (value < VK_FORMAT_MAX_ENUM))
+        {
+            *pFormat = static_cast<VkFormat>(value);
+            valid    = true;
+        }
+    }
+
+    return valid;
+}
+
+// =====================================================================================================================
+// Parses the command line.  Returns false if it is malformed.  Options and pipeline dumps may be interleaved, since
+// --depth-format applies to the dumps that follow it.
+static bool ParseOptions(
+    int          argc,
+    const char** argv,
+    Options*     pOptions)
+{
+    bool valid = true;
+
+    pOptions->pIcdName     = DefaultIcdName;
+    pOptions->pGpuName     = nullptr;
+    pOptions->pOutputDir   = nullptr;
+    pOptions->pArchiveName = nullptr;
+    pOptions->listGpus     = false;
+    pOptions->fileCount    = 0;
+
+    VkFormat depthStencilFormat = PipelineReplayer::UnknownFormat;
+
+    for (int i = 1; valid && (i < argc); ++i)
+    {
+        const bool hasValue = ((i + 1) < argc);
+
+        if (strcmp(argv[i], "--list-gpus") == 0)
+        {
+            pOptions->listGpus = true;
+        }
+        else if ((strcmp(argv[i], "--icd") == 0) && hasValue)
+        {
+            pOptions->pIcdName = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--gpu") == 0) && hasValue)
+        {
+            pOptions->pGpuName = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--output-dir") == 0) && hasValue)
+        {
+            pOptions->pOutputDir = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--name") == 0) && hasValue)
+        {
+            pOptions->pArchiveName = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--depth-format") == 0) && hasValue)
+        {
+            valid = ParseDepthStencilFormat(argv[++i], &depthStencilFormat);
+        }
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            valid = false;
+        }
+        else
+        {
+            DumpFile* pFile = &pOptions->pFiles[pOptions->fileCount++];
+
+            pFile->pFileName          = argv[i];
+            pFile->depthStencilFormat = depthStencilFormat;
+        }
+    }
+
+    if (pOptions->listGpus == false)
+    {
+        valid = valid                               &&
+                (pOptions->pGpuName != nullptr)     &&
+                (pOptions->pOutputDir != nullptr)   &&
+                (pOptions->pArchiveName != nullptr) &&
+                (pOptions->fileCount > 0);
+    }
+
+    return valid;
+}
+
+// =====================================================================================================================
+// Points the driver at a null device and at the archive the internal pipeline binary cache writes to.  The driver
+// reads these once its instance is created.
+static void SetDriverEnvironment(
+    const Options& options)
+{
+    if (options.listGpus)
+    {
+        setenv("AMDVLK_NULL_GPU", "ALL", 1);
+    }
+    else
+    {
+        setenv("AMDVLK_NULL_GPU", options.pGpuName, 1);
+        setenv("AMD_VK_USE_PIPELINE_CACHE", "1", 1);
+        setenv("AMD_VK_PIPELINE_CACHE_PATH", options.pOutputDir, 1);
+        setenv("AMD_VK_PIPELINE_CACHE_FILENAME", options.pArchiveName, 1);
+    }
+}
+
+// =====================================================================================================================
+// Resolves the instance level entry points the builder calls.  Returns false if any is missing.
+static bool LoadInstanceDispatch(
+    PFN_vkGetInstanceProcAddr pfnGetInstanceProcAddr,
+    VkInstance                instance,
+    InstanceDispatch*         pDispatch)
+{
+#define LOAD_INSTANCE_ENTRY(name) \
+    pDispatch->name = reinterpret_cast<PFN_##name>(pfnGetInstanceProcAddr(instance, #name))
+
+    LOAD_INSTANCE_ENTRY(vkDestroyInstance);
+    LOAD_INSTANCE_ENTRY(vkEnumeratePhysicalDevices);
+    LOAD_INSTANCE_ENTRY(vkGetPhysicalDeviceProperties);
+    LOAD_INSTANCE_ENTRY(vkGetPhysicalDeviceQueueFamilyProperties);
+    LOAD_INSTANCE_ENTRY(vkEnumerateDeviceExtensionProperties);
+    LOAD_INSTANCE_ENTRY(vkCreateDevice);
+    LOAD_INSTANCE_ENTRY(vkGetDeviceProcAddr);
+    LOAD_INSTANCE_ENTRY(vkDestroyDevice);
+
+#undef LOAD_INSTANCE_ENTRY
+
+    return (pDispatch->vkDestroyInstance != nullptr)                        &&
+           (pDispatch->vkEnumeratePhysicalDevices != nullptr)               &&
+           (pDispatch->vkGetPhysicalDeviceProperties != nullptr)            &&
+           (pDispatch->vkGetPhysicalDeviceQueueFamilyProperties != nullptr) &&
+           (pDispatch->vkEnumerateDeviceExtensionProperties != nullptr)     &&
+           (pDispatch->vkCreateDevice != nullptr)                           &&
+           (pDispatch->vkGetDeviceProcAddr != nullptr)                      &&
+           (pDispatch->vkDestroyDevice != nullptr);
+}
+
+// =====================================================================================================================
+// Resolves the device level entry points the replayer calls.  Returns false if any is missing.
+static bool LoadDeviceDispatch(
+    PFN_vkGetDeviceProcAddr pfnGetDeviceProcAddr,
+    VkDevice                device,
+    DeviceDispatch*         pDispatch)
+{
+#define LOAD_DEVICE_ENTRY(name) \
+    pDispatch->name = reinterpret_cast<PFN_##name>(pfnGetDeviceProcAddr(device, #name))
+
+    LOAD_DEVICE_ENTRY(vkCreateShaderModule);
+    LOAD_DEVICE_ENTRY(vkDestroyShaderModule);
+    LOAD_DEVICE_ENTRY(vkCreateDescriptorSetLayout);
+    LOAD_DEVICE_ENTRY(vkDestroyDescriptorSetLayout);
+    LOAD_DEVICE_ENTRY(vkCreatePipelineLayout);
+    LOAD_DEVICE_ENTRY(vkDestroyPipelineLayout);
+    LOAD_DEVICE_ENTRY(vkCreateRenderPass);
+    LOAD_DEVICE_ENTRY(vkDestroyRenderPass);
+    LOAD_DEVICE_ENTRY(vkCreateGraphicsPipelines);
+    LOAD_DEVICE_ENTRY(vkCreateComputePipelines);
+    LOAD_DEVICE_ENTRY(vkDestroyPipeline);
+
+#undef LOAD_DEVICE_ENTRY
+
+    return (pDispatch->vkCreateShaderModule != nullptr)         &&
+           (pDispatch->vkDestroyShaderModule != nullptr)        &&
+           (pDispatch->vkCreateDescriptorSetLayout != nullptr)  &&
+           (pDispatch->vkDestroyDescriptorSetLayout != nullptr) &&
+           (pDispatch->vkCreatePipelineLayout != nullptr)       &&
+           (pDispatch->vkDestroyPipelineLayout != nullptr)      &&
+           (pDispatch->vkCreateRenderPass != nullptr)           &&
+           (pDispatch->vkDestroyRenderPass != nullptr)          &&
+           (pDispatch->vkCreateGraphicsPipelines != nullptr)    &&
+           (pDispatch->vkCreateComputePipelines != nullptr)     &&
+           (pDispatch->vkDestroyPipeline != nullptr);
+}
+
+// =====================================================================================================================
+// Prints the names of the null devices the driver can compile for.
+static VkResult ListGpus(
+    const InstanceDispatch& dispatch,
+    VkInstance              instance)
+{
+    static constexpr uint32_t MaxNullDevices = 64;
+
+    VkPhysicalDevice physicalDevices[MaxNullDevices] = {};
+    uint32_t         physicalDeviceCount             = MaxNullDevices;
+
+    VkResult result = dispatch.vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices);
+
+    if ((result == VK_SUCCESS) || (result == VK_INCOMPLETE))
+    {
+        for (uint32_t i = 0; i < physicalDeviceCount; ++i)
+        {
+            VkPhysicalDeviceProperties properties = {};
+
+            dispatch.vkGetPhysicalDeviceProperties(physicalDevices[i], &properties);
+
+            printf("%s\n", properties.deviceName);
+        }
+
+        result = VK_SUCCESS;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Creates a device on the null device and replays every pipeline dump on it.  Returns the number of dumps that failed,
+// and the number of dumps skipped through pSkippedCount.
+static uint32_t BuildCache(
+    const InstanceDispatch& dispatch,
+    VkInstance              instance,
+    const Options&          options,
+    uint32_t*               pSkippedCount)
+{
+    uint32_t         failedCount         = options.fileCount;
+    VkPhysicalDevice physicalDevice      = VK_NULL_HANDLE;
+    uint32_t         physicalDeviceCount = 1;
+
+    // The driver exposes just the null device that was asked for.
+    VkResult result = dispatch.vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, &physicalDevice);
+
+    if (((result != VK_SUCCESS) && (result != VK_INCOMPLETE)) || (physicalDeviceCount == 0))
+    {
+        fprintf(stderr, "No null device named %s\n", options.pGpuName);
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+    else
+    {
+        result = VK_SUCCESS;
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    if (result == VK_SUCCESS)
+    {
+        // Null devices don't have to have any queues.  Pipelines are created just the same without one.
+        uint32_t queueFamilyCount = 0;
+
+        dispatch.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+        const float priority = 1.0f;
+
+        VkDeviceQueueCreateInfo queueInfo = {};
+
+        queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = 0;
+        queueInfo.queueCount       = 1;
+        queueInfo.pQueuePriorities = &priority;
+
+        // Dumps may use inline uniform blocks, which need their extension.
+        const char* pInlineUniformBlock = VK_EXT_INLINE_UNIFORM_BLOCK_EXTENSION_NAME;
+        uint32_t    extensionCount      = 0;
+
+        static constexpr uint32_t MaxExtensions = 512;
+
+        VkExtensionProperties extensions[MaxExtensions] = {};
+        uint32_t              availableCount            = MaxExtensions;
+
+        dispatch.vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &availableCount, extensions);
+
+        for (uint32_t i = 0; i < availableCount; ++i)
+        {
+            if (strcmp(extensions[i].extensionName, pInlineUniformBlock) == 0)
+            {
+                extensionCount = 1;
+            }
+        }
+
+        VkDeviceCreateInfo deviceInfo = {};
+
+        deviceInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount    = (queueFamilyCount > 0) ? 1 : 0;
+        deviceInfo.pQueueCreateInfos       = &queueInfo;
+        deviceInfo.enabledExtensionCount   = extensionCount;
+        deviceInfo.ppEnabledExtensionNames = &pInlineUniformBlock;
+
+        result = dispatch.vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device);
+
+        if (result != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to create a device on %s (VkResult %d)\n", options.pGpuName, result);
+        }
+    }
+
+    DeviceDispatch deviceDispatch = {};
+
+    if ((result == VK_SUCCESS) && (LoadDeviceDispatch(dispatch.vkGetDeviceProcAddr, device, &deviceDispatch) == false))
+    {
+        fprintf(stderr, "The driver is missing device entry points\n");
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        PipelineReplayer replayer(device, deviceDispatch);
+
+        failedCount = 0;
+
+        for (uint32_t i = 0; i < options.fileCount; ++i)
+        {
+            const ReplayResult replayResult = replayer.Replay(options.pFiles[i].pFileName,
+                                                              options.pFiles[i].depthStencilFormat);
+
+            if (replayResult == ReplayFailed)
+            {
+                ++failedCount;
+            }
+            else if (replayResult == ReplaySkipped)
+            {
+                ++(*pSkippedCount);
+            }
+        }
+    }
+
+    if (device != VK_NULL_HANDLE)
+    {
+        dispatch.vkDestroyDevice(device, nullptr);
+    }
+
+    return failedCount;
+}
+
+} // namespace CacheBuilder
+
+// =====================================================================================================================
+int main(
+    int          argc,
+    const char** argv)
+{
+    using namespace CacheBuilder;
+
+    Options options = {};
+
+    options.pFiles = static_cast<DumpFile*>(calloc(argc, sizeof(DumpFile)));
+
+    if (options.pFiles == nullptr)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    if (ParseOptions(argc, argv, &options) == false)
+    {
+        PrintUsage();
+        free(options.pFiles);
+        return EXIT_FAILURE;
+    }
+
+    SetDriverEnvironment(options);
+
+    void* pIcd = dlopen(options.pIcdName, RTLD_NOW | RTLD_LOCAL);
+
+    if (pIcd == nullptr)
+    {
+        fprintf(stderr, "Failed to load %s: %s\n", options.pIcdName, dlerror());
+        free(options.pFiles);
+        return EXIT_FAILURE;
+    }
+
+    auto pfnGetInstanceProcAddr =
+        reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(pIcd, "vk_icdGetInstanceProcAddr"));
+    auto pfnCreateInstance = (pfnGetInstanceProcAddr != nullptr) ?
+        reinterpret_cast<PFN_vkCreateInstance>(pfnGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance")) :
+        nullptr;
+
+    int exitCode = EXIT_FAILURE;
+
+    VkInstance instance = VK_NULL_HANDLE;
+
+    if (pfnCreateInstance != nullptr)
+    {
+        VkApplicationInfo appInfo = {};
+
+        appInfo.sType            = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "xgl-cache-builder";
+        appInfo.apiVersion       = VK_API_VERSION_1_1;
+
+        VkInstanceCreateInfo instanceInfo = {};
+
+        instanceInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &appInfo;
+
+        if (pfnCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS)
+        {
+            instance = VK_NULL_HANDLE;
+        }
+    }
+
+    InstanceDispatch dispatch = {};
+
+    if ((instance == VK_NULL_HANDLE) || (LoadInstanceDispatch(pfnGetInstanceProcAddr, instance, &dispatch) == false))
+    {
+        fprintf(stderr, "Failed to create a Vulkan instance with %s\n", options.pIcdName);
+    }
+    else if (options.listGpus)
+    {
+        exitCode = (ListGpus(dispatch, instance) == VK_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (InitSpvGen() == false)
+    {
+        // Pipeline dumps hold their shaders as SPIR-V assembly, which vfx assembles with spvgen.
+        fprintf(stderr, "Failed to load spvgen\n");
+    }
+    else
+    {
+        uint32_t       skippedCount = 0;
+        const uint32_t failedCount  = BuildCache(dispatch, instance, options, &skippedCount);
+
+        printf("%u of %u pipelines added to %s/%s.parc, %u skipped\n",
+               options.fileCount - failedCount - skippedCount, options.fileCount,
+               options.pOutputDir, options.pArchiveName, skippedCount);
+
+        // Skipped dumps were reported, but they don't fail the build.
+        exitCode = (failedCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // The internal pipeline binary cache belongs to the physical device, so destroying the instance finishes writing the
+    // archive.
+    if ((instance != VK_NULL_HANDLE) && (dispatch.vkDestroyInstance != nullptr))
+    {
+        dispatch.vkDestroyInstance(instance, nullptr);
+    }
+
+    dlclose(pIcd);
+    free(options.pFiles);
+
+    return exitCode;
+}
@@ -0,0 +1,771 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_replayer.cpp
+* @brief Recreates the Vulkan pipelines of LLPC pipeline dumps for the offline pipeline cache builder.
+***********************************************************************************************************************
+*/
+#include "pipeline_replayer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace CacheBuilder
+{
+
+// Dword sizes of the descriptors the driver puts in a descriptor set, used to recover array sizes from node sizes
+static constexpr uint32_t SamplerDescDwords       = 4;
+static constexpr uint32_t ImageDescDwords         = 8;
+static constexpr uint32_t CombinedDescDwords      = ImageDescDwords + SamplerDescDwords;
+static constexpr uint32_t BufferDescDwords        = 4;
+static constexpr uint32_t CompactBufferDescDwords = 2;
+
+// =====================================================================================================================
+PipelineReplayer::PipelineReplayer(
+    VkDevice              device,
+    const DeviceDispatch& dispatch)
+    :
+    m_device(device),
+    m_dispatch(dispatch),
+    m_setCount(0),
+    m_pushConstRange(),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_renderPass(VK_NULL_HANDLE),
+    m_pipeline(VK_NULL_HANDLE)
+{
+    memset(m_sets, 0, sizeof(m_sets));
+    memset(m_setLayouts, 0, sizeof(m_setLayouts));
+    memset(m_shaderModules, 0, sizeof(m_shaderModules));
+}
+
+// =====================================================================================================================
+PipelineReplayer::~PipelineReplayer()
+{
+    DestroyObjects();
+}
+
+// =====================================================================================================================
+// Converts a mask of VKGC shader stage bits to Vulkan shader stage flags.
+VkShaderStageFlags PipelineReplayer::VkgcToVkShaderStages(
+    uint32_t visibility)
+{
+    VkShaderStageFlags stages = 0;
+
+    stages |= ((visibility & Vkgc::ShaderStageVertexBit) != 0)      ? VK_SHADER_STAGE_VERTEX_BIT                  : 0;
+    stages |= ((visibility & Vkgc::ShaderStageTessControlBit) != 0) ? VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT    : 0;
+    stages |= ((visibility & Vkgc::ShaderStageTessEvalBit) != 0)    ? VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT : 0;
+    stages |= ((visibility & Vkgc::ShaderStageGeometryBit) != 0)    ? VK_SHADER_STAGE_GEOMETRY_BIT                : 0;
+    stages |= ((visibility & Vkgc::ShaderStageFragmentBit) != 0)    ? VK_SHADER_STAGE_FRAGMENT_BIT                : 0;
+    stages |= ((visibility & Vkgc::ShaderStageComputeBit) != 0)     ? VK_SHADER_STAGE_COMPUTE_BIT                 : 0;
+
+    return stages;
+}
+
+// =====================================================================================================================
+// Collects the top-level resource mapping nodes of a dumped pipeline.  Returns the number of nodes.
+uint32_t PipelineReplayer::GatherRootNodes(
+    const Vfx::VfxPipelineState& state,
+    RootNode*                    pRootNodes
+    ) const
+{
+    uint32_t rootNodeCount = 0;
+
+    const bool isGraphics = (state.pipelineType == Vfx::VfxPipelineTypeGraphics);
+
+#if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
+    const Vkgc::ResourceMappingData& mapping = isGraphics ? state.gfxPipelineInfo.resourceMapping :
+                                                            state.compPipelineInfo.resourceMapping;
+
+    for (uint32_t i = 0; (i < mapping.userDataNodeCount) && (rootNodeCount < MaxRootNodes); ++i)
+    {
+        pRootNodes[rootNodeCount].pNode      = &mapping.pUserDataNodes[i].node;
+        pRootNodes[rootNodeCount].visibility = mapping.pUserDataNodes[i].visibility;
+        ++rootNodeCount;
+    }
+#else
+    // Each stage has its own copy of the nodes it uses; a node used by several stages is visible to all of them.
+    const Vkgc::PipelineShaderInfo* shaderInfos[] =
+    {
+        &state.gfxPipelineInfo.vs,
+        &state.gfxPipelineInfo.tcs,
+        &state.gfxPipelineInfo.tes,
+        &state.gfxPipelineInfo.gs,
+        &state.gfxPipelineInfo.fs,
+        &state.compPipelineInfo.cs,
+    };
+
+    for (uint32_t stage = 0; stage < Vkgc::ShaderStageCount; ++stage)
+    {
+        const bool stageUsed = isGraphics ? (stage != Vkgc::ShaderStageCompute) : (stage == Vkgc::ShaderStageCompute);
+        const Vkgc::PipelineShaderInfo* pShaderInfo = shaderInfos[stage];
+
+        for (uint32_t i = 0; stageUsed && (i < pShaderInfo->userDataNodeCount); ++i)
+        {
+            const Vkgc::ResourceMappingNode* pNode = &pShaderInfo->pUserDataNodes[i];
+
+            uint32_t nodeIdx = 0;
+
+            while ((nodeIdx < rootNodeCount) && (pRootNodes[nodeIdx].pNode->offsetInDwords != pNode->offsetInDwords))
+            {
+                ++nodeIdx;
+            }
+
+            if (nodeIdx < rootNodeCount)
+            {
+                pRootNodes[nodeIdx].visibility |= (1u << stage);
+            }
+            else if (rootNodeCount < MaxRootNodes)
+            {
+                pRootNodes[rootNodeCount].pNode      = pNode;
+                pRootNodes[rootNodeCount].visibility = (1u << stage);
+                ++rootNodeCount;
+            }
+        }
+    }
+#endif
+
+    return rootNodeCount;
+}
+
+// =====================================================================================================================
+// Returns true if a dumped pipeline has immutable sampler values.  The driver hashes them into the key of the pipeline,
+// but the replayer can't create samplers with the same values from the dump.
+bool PipelineReplayer::UsesImmutableSamplers(
+    const Vfx::VfxPipelineState& state)
+{
+    const bool isGraphics = (state.pipelineType == Vfx::VfxPipelineTypeGraphics);
+
+#if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
+    const Vkgc::ResourceMappingData& mapping = isGraphics ? state.gfxPipelineInfo.resourceMapping :
+                                                            state.compPipelineInfo.resourceMapping;
+
+    bool uses = (mapping.staticDescriptorValueCount > 0);
+#else
+    bool uses = (isGraphics == false) && (state.compPipelineInfo.cs.descriptorRangeValueCount > 0);
+
+    const Vkgc::PipelineShaderInfo* shaderInfos[] =
+    {
+        &state.gfxPipelineInfo.vs,
+        &state.gfxPipelineInfo.tcs,
+        &state.gfxPipelineInfo.tes,
+        &state.gfxPipelineInfo.gs,
+        &state.gfxPipelineInfo.fs,
+    };
+
+    for (uint32_t stage = 0; isGraphics && (stage < Vkgc::ShaderStageGfxCount); ++stage)
+    {
+        uses |= (shaderInfos[stage]->descriptorRangeValueCount > 0);
+    }
+#endif
+
+    return uses;
+}
+
+// =====================================================================================================================
+// Adds a binding to the descriptor set it belongs to, merging the stages of bindings found more than once.
+void PipelineReplayer::AddBinding(
+    uint32_t         set,
+    uint32_t         binding,
+    VkDescriptorType type,
+    uint32_t         count,
+    uint32_t         visibility)
+{
+    if (set < MaxSets)
+    {
+        SetInfo* pSet = &m_sets[set];
+
+        uint32_t bindingIdx = 0;
+
+        while ((bindingIdx < pSet->bindingCount) && (pSet->bindings[bindingIdx].binding != binding))
+        {
+            ++bindingIdx;
+        }
+
+        if (bindingIdx < pSet->bindingCount)
+        {
+            pSet->bindings[bindingIdx].stageFlags |= VkgcToVkShaderStages(visibility);
+        }
+        else if (bindingIdx < MaxSetBindings)
+        {
+            VkDescriptorSetLayoutBinding* pBinding = &pSet->bindings[bindingIdx];
+
+            pBinding->binding            = binding;
+            pBinding->descriptorType     = type;
+            pBinding->descriptorCount    = (count > 0) ? count : 1;
+            pBinding->stageFlags         = VkgcToVkShaderStages(visibility);
+            pBinding->pImmutableSamplers = nullptr;
+
+            ++pSet->bindingCount;
+        }
+
+        m_setCount = (set >= m_setCount) ? (set + 1) : m_setCount;
+    }
+}
+
+// =====================================================================================================================
+// Adds the bindings of the static descriptor nodes in a descriptor set table.  The driver maps descriptor types that
+// compile the same to one node type, so any type mapping to the node type gives back the same node.
+void PipelineReplayer::AddTableBindings(
+    const Vkgc::ResourceMappingNode& table,
+    uint32_t                         visibility)
+{
+    for (uint32_t i = 0; i < table.tablePtr.nodeCount; ++i)
+    {
+        const Vkgc::ResourceMappingNode& node = table.tablePtr.pNext[i];
+
+        VkDescriptorType type         = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        uint32_t         strideDwords = 1;
+
+        switch (node.type)
+        {
+        case Vkgc::ResourceMappingNodeType::DescriptorSampler:
+        case Vkgc::ResourceMappingNodeType::DescriptorYCbCrSampler:
+            type         = VK_DESCRIPTOR_TYPE_SAMPLER;
+            strideDwords = SamplerDescDwords;
+            break;
+        case Vkgc::ResourceMappingNodeType::DescriptorCombinedTexture:
+            type         = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            strideDwords = CombinedDescDwords;
+            break;
+        case Vkgc::ResourceMappingNodeType::DescriptorResource:
+            type         = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            strideDwords = ImageDescDwords;
+            break;
+        case Vkgc::ResourceMappingNodeType::DescriptorTexelBuffer:
+            type         = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            strideDwords = BufferDescDwords;
+            break;
+        case Vkgc::ResourceMappingNodeType::DescriptorBuffer:
+            type         = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            strideDwords = BufferDescDwords;
+            break;
+        case Vkgc::ResourceMappingNodeType::PushConst:
+            // Inline uniform blocks are sized in bytes
+            type         = VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT;
+            strideDwords = 1;
+            break;
+        default:
+            break;
+        }
+
+        if (type != VK_DESCRIPTOR_TYPE_MAX_ENUM)
+        {
+            const uint32_t count = (type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) ?
+                                   (node.sizeInDwords * sizeof(uint32_t)) :
+                                   (node.sizeInDwords / strideDwords);
+
+            AddBinding(node.srdRange.set, node.srdRange.binding, type, count, visibility);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Creates the descriptor set layouts and pipeline layout described by the resource mapping of a dumped pipeline.
+VkResult PipelineReplayer::CreatePipelineLayout(
+    const Vfx::VfxPipelineState& state)
+{
+    RootNode rootNodes[MaxRootNodes] = {};
+
+    const uint32_t rootNodeCount = GatherRootNodes(state, rootNodes);
+
+    for (uint32_t i = 0; i < rootNodeCount; ++i)
+    {
+        const Vkgc::ResourceMappingNode& node = *rootNodes[i].pNode;
+
+        switch (node.type)
+        {
+        case Vkgc::ResourceMappingNodeType::DescriptorTableVaPtr:
+            AddTableBindings(node, rootNodes[i].visibility);
+            break;
+        case Vkgc::ResourceMappingNodeType::DescriptorBuffer:
+        case Vkgc::ResourceMappingNodeType::DescriptorBufferCompact:
+        {
+            // Dynamic buffers are the only descriptors placed in user data directly
+            const uint32_t strideDwords = (node.type == Vkgc::ResourceMappingNodeType::DescriptorBuffer) ?
+                                          BufferDescDwords : CompactBufferDescDwords;
+
+            AddBinding(node.srdRange.set,
+                       node.srdRange.binding,
+                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                       node.sizeInDwords / strideDwords,
+                       rootNodes[i].visibility);
+            break;
+        }
+        case Vkgc::ResourceMappingNodeType::PushConst:
+            m_pushConstRange.stageFlags |= VkgcToVkShaderStages(rootNodes[i].visibility);
+            m_pushConstRange.size        = node.sizeInDwords * sizeof(uint32_t);
+            break;
+        default:
+            // The vertex buffer and transform feedback tables are internal to the driver.
+            break;
+        }
+    }
+
+    VkResult result = VK_SUCCESS;
+
+    // Sets the dump has no nodes for are unused by the pipeline, but still take their index in the layout.
+    for (uint32_t set = 0; (set < m_setCount) && (result == VK_SUCCESS); ++set)
+    {
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+
+        setLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setLayoutInfo.bindingCount = m_sets[set].bindingCount;
+        setLayoutInfo.pBindings    = m_sets[set].bindings;
+
+        result = m_dispatch.vkCreateDescriptorSetLayout(m_device, &setLayoutInfo, nullptr, &m_setLayouts[set]);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        VkPipelineLayoutCreateInfo layoutInfo = {};
+
+        layoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount         = m_setCount;
+        layoutInfo.pSetLayouts            = m_setLayouts;
+        layoutInfo.pushConstantRangeCount = (m_pushConstRange.size > 0) ? 1 : 0;
+        layoutInfo.pPushConstantRanges    = &m_pushConstRange;
+
+        result = m_dispatch.vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_pipelineLayout);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Creates the shader module of a stage of a dumped pipeline, if the pipeline has the stage.
+VkResult PipelineReplayer::CreateShaderModule(
+    const Vfx::VfxPipelineState& state,
+    uint32_t                     stage)
+{
+    VkResult result = VK_SUCCESS;
+
+    for (uint32_t i = 0; (i < state.numStages) && (result == VK_SUCCESS); ++i)
+    {
+        if ((state.stages[i].stage == stage) && (state.stages[i].dataSize > 0))
+        {
+            VkShaderModuleCreateInfo moduleInfo = {};
+
+            moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            moduleInfo.codeSize = state.stages[i].dataSize;
+            moduleInfo.pCode    = reinterpret_cast<const uint32_t*>(state.stages[i].pData);
+
+            result = m_dispatch.vkCreateShaderModule(m_device, &moduleInfo, nullptr, &m_shaderModules[stage]);
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Creates a render pass with a single subpass writing the color targets of a dumped graphics pipeline.  The build info
+// has no depth state, so the depth/stencil attachment has the format the caller gives, if any.
+VkResult PipelineReplayer::CreateRenderPass(
+    const Vkgc::GraphicsPipelineBuildInfo& info,
+    VkFormat                               depthStencilFormat)
+{
+    VkAttachmentDescription attachments[MaxColorTargets + 1] = {};
+    VkAttachmentReference   colorRefs[MaxColorTargets]       = {};
+    VkAttachmentReference   depthStencilRef                  = {};
+
+    const VkSampleCountFlagBits samples = (info.rsState.numSamples > 1) ?
+                                          static_cast<VkSampleCountFlagBits>(info.rsState.numSamples) :
+                                          VK_SAMPLE_COUNT_1_BIT;
+
+    uint32_t attachmentCount = 0;
+    uint32_t colorRefCount   = 0;
+
+    for (uint32_t target = 0; target < MaxColorTargets; ++target)
+    {
+        colorRefs[target].attachment = VK_ATTACHMENT_UNUSED;
+        colorRefs[target].layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        if (info.cbState.target[target].format != VK_FORMAT_UNDEFINED)
+        {
+            VkAttachmentDescription* pAttachment = &attachments[attachmentCount];
+
+            pAttachment->format         = info.cbState.target[target].format;
+            pAttachment->samples        = samples;
+            pAttachment->loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD;
+            pAttachment->storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+            pAttachment->stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            pAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            pAttachment->initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            pAttachment->finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            colorRefs[target].attachment = attachmentCount++;
+            colorRefCount                = target + 1;
+        }
+    }
+
+    depthStencilRef.attachment = VK_ATTACHMENT_UNUSED;
+    depthStencilRef.layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    if (depthStencilFormat != VK_FORMAT_UNDEFINED)
+    {
+        VkAttachmentDescription* pAttachment = &attachments[attachmentCount];
+
+        pAttachment->format         = depthStencilFormat;
+        pAttachment->samples        = samples;
+        pAttachment->loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD;
+        pAttachment->storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        pAttachment->stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_LOAD;
+        pAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+        pAttachment->initialLayout  = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        pAttachment->finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        depthStencilRef.attachment = attachmentCount++;
+    }
+
+    VkSubpassDescription subpass = {};
+
+    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount    = colorRefCount;
+    subpass.pColorAttachments       = colorRefs;
+    subpass.pDepthStencilAttachment = &depthStencilRef;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+
+    renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = attachmentCount;
+    renderPassInfo.pAttachments    = attachments;
+    renderPassInfo.subpassCount    = 1;
+    renderPassInfo.pSubpasses      = &subpass;
+
+    return m_dispatch.vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass);
+}
+
+// =====================================================================================================================
+// Creates the graphics pipeline of a dump.  Viewport and scissor are dynamic, as the dump doesn't record them.
+VkResult PipelineReplayer::CreateGraphicsPipeline(
+    const Vfx::VfxPipelineState& state,
+    VkFormat                     depthStencilFormat)
+{
+    const Vkgc::GraphicsPipelineBuildInfo& info = state.gfxPipelineInfo;
+
+    const Vkgc::PipelineShaderInfo* shaderInfos[] = { &info.vs, &info.tcs, &info.tes, &info.gs, &info.fs };
+
+    static const VkShaderStageFlagBits VkStages[] =
+    {
+        VK_SHADER_STAGE_VERTEX_BIT,
+        VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+        VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+        VK_SHADER_STAGE_GEOMETRY_BIT,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    VkPipelineShaderStageCreateInfo stages[Vkgc::ShaderStageGfxCount] = {};
+
+    uint32_t stageCount = 0;
+    VkResult result     = VK_SUCCESS;
+
+    for (uint32_t stage = 0; (stage < Vkgc::ShaderStageGfxCount) && (result == VK_SUCCESS); ++stage)
+    {
+        result = CreateShaderModule(state, stage);
+
+        if ((result == VK_SUCCESS) && (m_shaderModules[stage] != VK_NULL_HANDLE))
+        {
+            const char* pEntryPoint = shaderInfos[stage]->pEntryTarget;
+
+            stages[stageCount].sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stages[stageCount].stage               = VkStages[stage];
+            stages[stageCount].module              = m_shaderModules[stage];
+            stages[stageCount].pName               = (pEntryPoint != nullptr) ? pEntryPoint : "main";
+            stages[stageCount].pSpecializationInfo = shaderInfos[stage]->pSpecializationInfo;
+            ++stageCount;
+        }
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        result = CreateRenderPass(info, depthStencilFormat);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        VkPipelineVertexInputStateCreateInfo vertexInput = {};
+
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+
+        inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = info.iaState.topology;
+
+        VkPipelineTessellationStateCreateInfo tessellation = {};
+
+        tessellation.sType              = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO;
+        tessellation.patchControlPoints = info.iaState.patchControlPoints;
+
+        VkPipelineViewportStateCreateInfo viewport = {};
+
+        viewport.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport.viewportCount = 1;
+        viewport.scissorCount  = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterization = {};
+
+        rasterization.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterization.depthClampEnable        = (info.vpState.depthClipEnable == false);
+        rasterization.rasterizerDiscardEnable = info.rsState.rasterizerDiscardEnable;
+        rasterization.polygonMode             = info.rsState.polygonMode;
+        rasterization.cullMode                = info.rsState.cullMode;
+        rasterization.frontFace               = info.rsState.frontFace;
+        rasterization.depthBiasEnable         = info.rsState.depthBiasEnable;
+        rasterization.lineWidth               = 1.0f;
+
+        VkPipelineMultisampleStateCreateInfo multisample = {};
+
+        multisample.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisample.rasterizationSamples  = (info.rsState.numSamples > 1) ?
+                                            static_cast<VkSampleCountFlagBits>(info.rsState.numSamples) :
+                                            VK_SAMPLE_COUNT_1_BIT;
+        multisample.sampleShadingEnable   = info.rsState.perSampleShading;
+        multisample.minSampleShading      = 1.0f;
+        multisample.alphaToCoverageEnable = info.cbState.alphaToCoverageEnable;
+
+        // Blending only changes the shaders through dual source blending and the source alpha of a target.
+        VkPipelineColorBlendAttachmentState blendTargets[MaxColorTargets] = {};
+
+        const VkBlendFactor srcFactor = info.cbState.dualSourceBlendEnable ? VK_BLEND_FACTOR_SRC1_COLOR :
+                                                                             VK_BLEND_FACTOR_ONE;
+
+        uint32_t blendTargetCount = 0;
+
+        for (uint32_t target = 0; target < MaxColorTargets; ++target)
+        {
+            const auto& cbTarget = info.cbState.target[target];
+
+            if (cbTarget.format != VK_FORMAT_UNDEFINED)
+            {
+                blendTargets[target].blendEnable         = cbTarget.blendEnable;
+                blendTargets[target].srcColorBlendFactor = cbTarget.blendSrcAlphaToColor ?
+                                                           VK_BLEND_FACTOR_SRC_ALPHA : srcFactor;
+                blendTargets[target].dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+                blendTargets[target].colorBlendOp        = VK_BLEND_OP_ADD;
+                blendTargets[target].srcAlphaBlendFactor = srcFactor;
+                blendTargets[target].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+                blendTargets[target].alphaBlendOp        = VK_BLEND_OP_ADD;
+                blendTargets[target].colorWriteMask      = cbTarget.channelWriteMask;
+
+                blendTargetCount = target + 1;
+            }
+        }
+
+        // Depth/stencil state doesn't change the shaders, but a subpass with a depth/stencil attachment needs it.
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+
+        depthStencil.sType           = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthCompareOp  = VK_COMPARE_OP_ALWAYS;
+        depthStencil.front.compareOp = VK_COMPARE_OP_ALWAYS;
+        depthStencil.back.compareOp  = VK_COMPARE_OP_ALWAYS;
+        depthStencil.maxDepthBounds  = 1.0f;
+
+        VkPipelineColorBlendStateCreateInfo colorBlend = {};
+
+        colorBlend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlend.attachmentCount = blendTargetCount;
+        colorBlend.pAttachments    = blendTargets;
+
+        static const VkDynamicState DynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+
+        dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = sizeof(DynamicStates) / sizeof(DynamicStates[0]);
+        dynamicState.pDynamicStates    = DynamicStates;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo = {};
+
+        pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount          = stageCount;
+        pipelineInfo.pStages             = stages;
+        pipelineInfo.pVertexInputState   = (info.pVertexInput != nullptr) ? info.pVertexInput : &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pTessellationState  = (m_shaderModules[Vkgc::ShaderStageTessControl] != VK_NULL_HANDLE) ?
+                                           &tessellation : nullptr;
+        pipelineInfo.pViewportState      = &viewport;
+        pipelineInfo.pRasterizationState = &rasterization;
+        pipelineInfo.pMultisampleState   = &multisample;
+        pipelineInfo.pDepthStencilState  = (depthStencilFormat != VK_FORMAT_UNDEFINED) ? &depthStencil : nullptr;
+        pipelineInfo.pColorBlendState    = &colorBlend;
+        pipelineInfo.pDynamicState       = &dynamicState;
+        pipelineInfo.layout              = m_pipelineLayout;
+        pipelineInfo.renderPass          = m_renderPass;
+
+        result = m_dispatch.vkCreateGraphicsPipelines(
+            m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Creates the compute pipeline of a dump.
+VkResult PipelineReplayer::CreateComputePipeline(
+    const Vfx::VfxPipelineState& state)
+{
+    VkResult result = CreateShaderModule(state, Vkgc::ShaderStageCompute);
+
+    if ((result == VK_SUCCESS) && (m_shaderModules[Vkgc::ShaderStageCompute] == VK_NULL_HANDLE))
+    {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        const Vkgc::PipelineShaderInfo& shaderInfo  = state.compPipelineInfo.cs;
+        const char*                     pEntryPoint = shaderInfo.pEntryTarget;
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+
+        pipelineInfo.sType                     = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module              = m_shaderModules[Vkgc::ShaderStageCompute];
+        pipelineInfo.stage.pName               = (pEntryPoint != nullptr) ? pEntryPoint : "main";
+        pipelineInfo.stage.pSpecializationInfo = shaderInfo.pSpecializationInfo;
+        pipelineInfo.layout                    = m_pipelineLayout;
+
+        result = m_dispatch.vkCreateComputePipelines(
+            m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Destroys the objects created for the last pipeline replayed and resets the gathered layout.
+void PipelineReplayer::DestroyObjects()
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+    {
+        m_dispatch.vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    }
+
+    if (m_renderPass != VK_NULL_HANDLE)
+    {
+        m_dispatch.vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+    }
+
+    for (uint32_t stage = 0; stage < Vkgc::ShaderStageCount; ++stage)
+    {
+        if (m_shaderModules[stage] != VK_NULL_HANDLE)
+        {
+            m_dispatch.vkDestroyShaderModule(m_device, m_shaderModules[stage], nullptr);
+        }
+    }
+
+    if (m_pipelineLayout != VK_NULL_HANDLE)
+    {
+        m_dispatch.vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    }
+
+    for (uint32_t set = 0; set < m_setCount; ++set)
+    {
+        if (m_setLayouts[set] != VK_NULL_HANDLE)
+        {
+            m_dispatch.vkDestroyDescriptorSetLayout(m_device, m_setLayouts[set], nullptr);
+        }
+    }
+
+    m_setCount       = 0;
+    m_pushConstRange = {};
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_renderPass     = VK_NULL_HANDLE;
+    m_pipeline       = VK_NULL_HANDLE;
+
+    memset(m_sets, 0, sizeof(m_sets));
+    memset(m_setLayouts, 0, sizeof(m_setLayouts));
+    memset(m_shaderModules, 0, sizeof(m_shaderModules));
+}
+
+// =====================================================================================================================
+// Parses a pipeline dump and creates its pipeline, unless the pipeline can't be created under the key the driver gave
+// the original one.  The depth/stencil format of a graphics pipeline's subpass isn't in the dump, so the caller passes
+// it, VK_FORMAT_UNDEFINED for none or UnknownFormat if it isn't known.  The objects created for the pipeline are
+// destroyed again right away.
+ReplayResult PipelineReplayer::Replay(
+    const char* pFileName,
+    VkFormat    depthStencilFormat)
+{
+    ReplayResult replayResult = ReplayAdded;
+    void*        pDoc         = nullptr;
+    const char*  pErrorMsg    = nullptr;
+
+    if (Vfx::vfxParseFile(pFileName, 0, nullptr, Vfx::VfxDocTypePipeline, &pDoc, &pErrorMsg) == false)
+    {
+        fprintf(stderr, "%s: failed to parse pipeline dump: %s\n",
+                pFileName, (pErrorMsg != nullptr) ? pErrorMsg : "");
+        replayResult = ReplayFailed;
+    }
+
+    if (replayResult == ReplayAdded)
+    {
+        Vfx::VfxPipelineStatePtr pState = nullptr;
+
+        Vfx::vfxGetPipelineDoc(pDoc, &pState);
+
+        const bool isGraphics = (pState->pipelineType == Vfx::VfxPipelineTypeGraphics);
+
+        if (isGraphics && (depthStencilFormat == UnknownFormat))
+        {
+            fprintf(stderr, "%s: skipped, the depth/stencil format of the graphics pipeline isn't known\n", pFileName);
+            replayResult = ReplaySkipped;
+        }
+        else if (UsesImmutableSamplers(*pState))
+        {
+            fprintf(stderr, "%s: skipped, immutable samplers can't be recovered from the dump\n", pFileName);
+            replayResult = ReplaySkipped;
+        }
+        else
+        {
+            VkResult result = CreatePipelineLayout(*pState);
+
+            if (result == VK_SUCCESS)
+            {
+                result = isGraphics ? CreateGraphicsPipeline(*pState, depthStencilFormat) :
+                                      CreateComputePipeline(*pState);
+            }
+
+            if (result != VK_SUCCESS)
+            {
+                fprintf(stderr, "%s: failed to create pipeline (VkResult %d)\n", pFileName, result);
+                replayResult = ReplayFailed;
+            }
+
+            DestroyObjects();
+        }
+    }
+
+    if (pDoc != nullptr)
+    {
+        Vfx::vfxCloseDoc(pDoc);
+    }
+
+    return replayResult;
+}
+
+} // namespace CacheBuilder
@@ -0,0 +1,150 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_replayer.h
+* @brief Recreates the Vulkan pipelines of LLPC pipeline dumps for the offline pipeline cache builder.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "vulkan.h"
+
+#include "vkgcDefs.h"
+#include "vfx.h"
+
+namespace CacheBuilder
+{
+
+// Device level entry points the replayer calls, resolved from the ICD
+struct DeviceDispatch
+{
+    PFN_vkCreateShaderModule         vkCreateShaderModule;
+    PFN_vkDestroyShaderModule        vkDestroyShaderModule;
+    PFN_vkCreateDescriptorSetLayout  vkCreateDescriptorSetLayout;
+    PFN_vkDestroyDescriptorSetLayout vkDestroyDescriptorSetLayout;
+    PFN_vkCreatePipelineLayout       vkCreatePipelineLayout;
+    PFN_vkDestroyPipelineLayout      vkDestroyPipelineLayout;
+    PFN_vkCreateRenderPass           vkCreateRenderPass;
+    PFN_vkDestroyRenderPass          vkDestroyRenderPass;
+    PFN_vkCreateGraphicsPipelines    vkCreateGraphicsPipelines;
+    PFN_vkCreateComputePipelines     vkCreateComputePipelines;
+    PFN_vkDestroyPipeline            vkDestroyPipeline;
+};
+
+// Outcome of replaying a pipeline dump
+enum ReplayResult : uint32_t
+{
+    ReplayAdded,   // The pipeline was created, so its binary is in the cache
+    ReplaySkipped, // The pipeline can't be created under the key the driver gave the original, so it wasn't created
+    ReplayFailed,  // The dump couldn't be parsed or the pipeline couldn't be created
+};
+
+// =====================================================================================================================
+// Turns the build info of a pipeline dump back into the Vulkan objects an application would have created for it, and
+// creates the pipeline.  Creating the pipeline is all that is needed: the driver stores the binary it compiles in its
+// internal pipeline binary cache.
+//
+// Pipeline layouts are rebuilt from the resource mapping of the dump, so a pipeline is keyed the same as the original
+// one as long as its layout converts back to the same mapping.  Two parts of the key aren't in the dump:
+// - The depth/stencil format of a graphics pipeline's subpass, which the caller has to provide.
+// - Immutable sampler values, which can't be recovered from the mapping.
+// Pipelines whose key can't be reproduced are skipped rather than stored under a key nobody looks up.
+class PipelineReplayer
+{
+public:
+    PipelineReplayer(VkDevice device, const DeviceDispatch& dispatch);
+    ~PipelineReplayer();
+
+    // Format to pass for a depth/stencil format that isn't known
+    static constexpr VkFormat UnknownFormat = VK_FORMAT_MAX_ENUM;
+
+    ReplayResult Replay(const char* pFileName, VkFormat depthStencilFormat);
+
+private:
+    static constexpr uint32_t MaxRootNodes    = 64;
+    static constexpr uint32_t MaxSets         = 32;
+    static constexpr uint32_t MaxSetBindings  = 64;
+    static constexpr uint32_t MaxColorTargets = Vkgc::MaxColorTargets;
+
+    // A top-level resource mapping node and the stages it is visible to
+    struct RootNode
+    {
+        const Vkgc::ResourceMappingNode* pNode;
+        uint32_t                         visibility;
+    };
+
+    // The bindings of a descriptor set, gathered from the resource mapping
+    struct SetInfo
+    {
+        uint32_t                     bindingCount;
+        VkDescriptorSetLayoutBinding bindings[MaxSetBindings];
+    };
+
+    uint32_t GatherRootNodes(const Vfx::VfxPipelineState& state, RootNode* pRootNodes) const;
+
+    static bool UsesImmutableSamplers(const Vfx::VfxPipelineState& state);
+
+    void AddBinding(
+        uint32_t         set,
+        uint32_t         binding,
+        VkDescriptorType type,
+        uint32_t         count,
+        uint32_t         visibility);
+
+    void AddTableBindings(const Vkgc::ResourceMappingNode& table, uint32_t visibility);
+
+    VkResult CreatePipelineLayout(const Vfx::VfxPipelineState& state);
+
+    VkResult CreateShaderModule(const Vfx::VfxPipelineState& state, uint32_t stage);
+
+    VkResult CreateRenderPass(const Vkgc::GraphicsPipelineBuildInfo& info, VkFormat depthStencilFormat);
+
+    VkResult CreateGraphicsPipeline(const Vfx::VfxPipelineState& state, VkFormat depthStencilFormat);
+
+    VkResult CreateComputePipeline(const Vfx::VfxPipelineState& state);
+
+    void DestroyObjects();
+
+    static VkShaderStageFlags VkgcToVkShaderStages(uint32_t visibility);
+
+    VkDevice              m_device;
+    const DeviceDispatch& m_dispatch;
+
+    // Objects created for the pipeline being replayed
+    uint32_t              m_setCount;
+    SetInfo               m_sets[MaxSets];
+    VkPushConstantRange   m_pushConstRange;
+    VkDescriptorSetLayout m_setLayouts[MaxSets];
+    VkPipelineLayout      m_pipelineLayout;
+    VkShaderModule        m_shaderModules[Vkgc::ShaderStageCount];
+    VkRenderPass          m_renderPass;
+    VkPipeline            m_pipeline;
+
+    PipelineReplayer(const PipelineReplayer&) = delete;
+    PipelineReplayer& operator=(const PipelineReplayer&) = delete;
+};
+
+} // namespace CacheBuilder